@@ -56,7 +56,22 @@ while [ "$STEP" -lt "$STEPS" ]; do
     eval SENS="\$$SENS_PARAM"
 
     # 1. Prefilter hits
-    if notExists "$TMP_PATH/pref_$STEP.dbtype"; then
+    if [ -n "$FUSED_SEARCH" ]; then
+        # prefilter and alignment run in one process, no prefilter database is written
+        if [ "$STEPS" -eq 1 ]; then
+            FUSED_RES="$3"
+        else
+            FUSED_RES="$TMP_PATH/aln_$STEP"
+        fi
+        if notExists "${FUSED_RES}.dbtype"; then
+            # shellcheck disable=SC2086
+            $RUNNER "$MMSEQS" prefilteralign "$INPUT" "$TARGET" "$FUSED_RES" $FUSED_PAR -s "$SENS" \
+                || fail "Fused prefilter and alignment died"
+        fi
+        if [ "$STEPS" -eq 1 ]; then
+            break
+        fi
+    elif notExists "$TMP_PATH/pref_$STEP.dbtype"; then
       if [ "$PREFMODE" = "EXHAUSTIVE" ]; then
           fake_pref "${INPUT}" "${TARGET}" "$TMP_PATH/pref_$STEP"
       elif [ "$PREFMODE" = "UNGAPPED" ]; then
@@ -71,7 +86,9 @@ while [ "$STEP" -lt "$STEPS" ]; do
     fi
 
     # 2. alignment module
-    if [ "$STEPS" -eq 1 ]; then
+    if [ -n "$FUSED_SEARCH" ]; then
+        :
+    elif [ "$STEPS" -eq 1 ]; then
         if notExists "$3.dbtype"; then
             # shellcheck disable=SC2086
             $RUNNER "$MMSEQS" "${ALIGN_MODULE}" "$INPUT" "$TARGET${ALIGNMENT_DB_EXT}" "$TMP_PATH/pref_$STEP" "$3" $ALIGNMENT_PAR  \
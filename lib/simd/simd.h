@@ -41,119 +41,115 @@
 #define SIMDE_ENABLE_NATIVE_ALIASES
 #include <simde/simde-features.h>
 
-// FIXME: Finish AVX512 implementation
-//#if defined(SIMDE_X86_AVX512F_NATIVE) && defined(SIMDE_X86_AVX512BW_NATIVE)
-//#define AVX512
-//#endif
+// AVX512 integer support is only used by the kernels compiled per instruction set (see SimdDispatch),
+// the rest of the code base still assumes that simd_int is at most 256 bits wide
+#if defined(SIMD_DISPATCH_AVX512) && defined(SIMDE_X86_AVX512F_NATIVE) && defined(SIMDE_X86_AVX512BW_NATIVE)
+#define AVX512
+#endif
 
 #if defined(AVX512) || defined(SIMDE_X86_AVX2_NATIVE)
 #define AVX2
 #endif
 
 #ifdef AVX512
-#include <simde/x86/avx512f.h>
-#include <simde/x86/avx512bw.h>
+// only enabled for native builds, the bundled SIMDe AVX512 headers are incomplete
+#include <immintrin.h>
 
-// double support
-#ifndef SIMD_DOUBLE
-#define SIMD_DOUBLE
-#define ALIGN_DOUBLE        AVX512_ALIGN_DOUBLE
-#define VECSIZE_DOUBLE      AVX512_VECSIZE_DOUBLE
-typedef __m512d simd_double;
-#define simdf64_add(x,y)    _mm512_add_pd(x,y)
-#define simdf64_sub(x,y)    _mm512_sub_pd(x,y)
-#define simdf64_mul(x,y)    _mm512_mul_pd(x,y)
-#define simdf64_div(x,y)    _mm512_div_pd(x,y)
-#define simdf64_max(x,y)    _mm512_max_pd(x,y)
-#define simdf64_load(x)     _mm512_load_pd(x)
-#define simdf64_store(x,y)  _mm512_store_pd(x,y)
-#define simdf64_set(x)      _mm512_set1_pd(x)
-#define simdf64_setzero(x)  _mm512_setzero_pd()
-#define simdf64_gt(x,y)     _mm512_cmpnle_pd_mask(x,y)
-#define simdf64_lt(x,y)     _mm512_cmplt_pd_mask(x,y)
-#define simdf64_or(x,y)     _mm512_or_si512(x,y)
-#define simdf64_and(x,y)    _mm512_and_si512 (x,y)
-#define simdf64_andnot(x,y) _mm512_andnot_si512(x,y)
-#define simdf64_xor(x,y)    _mm512_xor_si512(x,y)
-#endif //SIMD_DOUBLE
-// float support
-#ifndef SIMD_FLOAT
-#define SIMD_FLOAT
-#define ALIGN_FLOAT         AVX512_ALIGN_FLOAT
-#define VECSIZE_FLOAT       AVX512_VECSIZE_FLOAT
-typedef __m512  simd_float;
-#define simdf32_add(x,y)    _mm512_add_ps(x,y)
-#define simdf32_sub(x,y)    _mm512_sub_ps(x,y)
-#define simdf32_mul(x,y)    _mm512_mul_ps(x,y)
-#define simdf32_div(x,y)    _mm512_div_ps(x,y)
-#define simdf32_rcp(x)      _mm512_rcp_ps(x)
-#define simdf32_max(x,y)    _mm512_max_ps(x,y)
-#define simdf32_min(x,y)    _mm512_min_ps(x,y)
-#define simdf32_load(x)     _mm512_load_ps(x)
-#define simdf32_store(x,y)  _mm512_store_ps(x,y)
-#define simdf32_set(x)      _mm512_set1_ps(x)
-#define simdf32_setzero(x)  _mm512_setzero_ps()
-#define simdf32_gt(x,y)     _mm512_cmpnle_ps_mask(x,y)
-#define simdf32_eq(x,y)     _mm512_cmpeq_ps_mask(x,y)
-#define simdf32_lt(x,y)     _mm512_cmplt_ps_mask(x,y)
-#define simdf32_or(x,y)     _mm512_or_si512(x,y)
-#define simdf32_and(x,y)    _mm512_and_si512(x,y)
-#define simdf32_andnot(x,y) _mm512_andnot_si512(x,y)
-#define simdf32_xor(x,y)    _mm512_xor_si512(x,y)
-#define simdf32_f2i(x) 	    _mm512_cvtps_epi32(x)  // convert s.p. float to integer
-#define simdf_f2icast(x)    _mm512_castps_si512(x)
-#endif //SIMD_FLOAT
-// integer support 
+// integer support
 #ifndef SIMD_INT
 #define SIMD_INT
 #define ALIGN_INT           AVX512_ALIGN_INT
 #define VECSIZE_INT         AVX512_VECSIZE_INT
+static inline uint16_t simd_hmax16_sse(const __m128i buffer);
+static inline uint8_t simd_hmax8_sse(const __m128i buffer);
+static inline uint16_t simd_hmax16_avx512(const __m512i buffer) {
+    const __m256i max256 = _mm256_max_epu16(_mm512_castsi512_si256(buffer), _mm512_extracti64x4_epi64(buffer, 1));
+    const __m128i max128 = _mm_max_epu16(_mm256_castsi256_si128(max256), _mm256_extracti128_si256(max256, 1));
+    return simd_hmax16_sse(max128);
+}
+
+static inline uint8_t simd_hmax8_avx512(const __m512i buffer) {
+    const __m256i max256 = _mm256_max_epu8(_mm512_castsi512_si256(buffer), _mm512_extracti64x4_epi64(buffer, 1));
+    const __m128i max128 = _mm_max_epu8(_mm256_castsi256_si128(max256), _mm256_extracti128_si256(max256, 1));
+    return simd_hmax8_sse(max128);
+}
+
+// shifts across the 128-bit lanes, the lane below (above) is moved into place first
+template  <unsigned int N>
+static inline __m512i _mm512_shift_left(__m512i a) {
+    __m512i mask = _mm512_maskz_shuffle_i32x4(0xFFF0, a, a, _MM_SHUFFLE(2,1,0,0));
+    return _mm512_alignr_epi8(a, mask, 16-N);
+}
+
+template  <unsigned int N>
+static inline __m512i _mm512_shift_right(__m512i a) {
+    __m512i mask = _mm512_maskz_shuffle_i32x4(0x0FFF, a, a, _MM_SHUFFLE(3,3,2,1));
+    return _mm512_alignr_epi8(mask, a, N);
+}
+
+static inline unsigned short extract_epi16(__m512i v, int pos) {
+    uint16_t values[32] __attribute__((aligned(64)));
+    _mm512_store_si512(values, v);
+    return values[pos];
+}
+
 typedef __m512i simd_int;
 #define simdi32_add(x,y)    _mm512_add_epi32(x,y)
 #define simdi16_add(x,y)    _mm512_add_epi16(x,y)
 #define simdi16_adds(x,y)   _mm512_adds_epi16(x,y)
-#define simdui8_adds(x,y)   _mm512_adds_epu8()
+#define simdi16_sub(x,y)    _mm512_sub_epi16(x,y)
+#define simdui8_adds(x,y)   _mm512_adds_epu8(x,y)
 #define simdi32_sub(x,y)    _mm512_sub_epi32(x,y)
-#define simdui8_subs(x,y)   _mm512_subs_epu8()
+#define simdui16_subs(x,y)  _mm512_subs_epu16(x,y)
+#define simdui8_subs(x,y)   _mm512_subs_epu8(x,y)
 #define simdi32_mul(x,y)    _mm512_mullo_epi32(x,y)
-#define simdui8_max(x,y)    _mm512_max_epu8()
-#define simdi16_max(x,y)    _mm512_max_epi16(x,y)
 #define simdi32_max(x,y)    _mm512_max_epi32(x,y)
+#define simdi16_max(x,y)    _mm512_max_epi16(x,y)
+#define simdi16_hmax(x)     simd_hmax16_avx512(x)
+#define simdui8_max(x,y)    _mm512_max_epu8(x,y)
+#define simdi8_hmax(x)      simd_hmax8_avx512(x)
 #define simdi_load(x)       _mm512_load_si512(x)
+#define simdui8_avg(x,y)    _mm512_avg_epu8(x,y)
+#define simdui16_avg(x,y)   _mm512_avg_epu16(x,y)
+#define simdi_loadu(x)      _mm512_loadu_si512(x)
 #define simdi_streamload(x) _mm512_stream_load_si512(x)
 #define simdi_store(x,y)    _mm512_store_si512(x,y)
 #define simdi_storeu(x,y)   _mm512_storeu_si512(x,y)
 #define simdi32_set(x)      _mm512_set1_epi32(x)
 #define simdi16_set(x)      _mm512_set1_epi16(x)
 #define simdi8_set(x)       _mm512_set1_epi8(x)
-#define simdi32_shuffle(x,y) _mm512_shuffle_epi32(x,y)
-#define simdi16_shuffle(x,y) NOT_YET_IMP(x,y)
+#define simdi32_shuffle(x,y) _mm512_shuffle_epi32(x,(_MM_PERM_ENUM)(y))
 #define simdi8_shuffle(x,y)  _mm512_shuffle_epi8(x,y)
 #define simdi_setzero()     _mm512_setzero_si512()
-#define simdi32_gt(x,y)     _mm512_cmpgt_epi32(x,y)
-#define simdi8_gt(x,y)      NOT_YET_IMP()
-#define simdi16_gt(x,y)     NOT_YET_IMP()
-#define simdi8_eq(x,y)      NOT_YET_IMP()
-#define simdi32_lt(x,y)     NOT_YET_IMP()
-#define simdi16_lt(x,y)     NOT_YET_IMP()
-#define simdi8_lt(x,y)      NOT_YET_IMP()
-
+// comparisons return a mask register, expand it to a vector like SSE and AVX2 do
+#define simdi8_blend(x,y,z) _mm512_mask_blend_epi8(_mm512_movepi8_mask(z),x,y)
+#define simdi32_gt(x,y)     _mm512_maskz_set1_epi32(_mm512_cmpgt_epi32_mask(x,y), -1)
+#define simdi8_gt(x,y)      _mm512_movm_epi8(_mm512_cmpgt_epi8_mask(x,y))
+#define simdi16_gt(x,y)     _mm512_movm_epi16(_mm512_cmpgt_epi16_mask(x,y))
+#define simdi8_eq(x,y)      _mm512_movm_epi8(_mm512_cmpeq_epi8_mask(x,y))
+#define simdi16_eq(x,y)     _mm512_movm_epi16(_mm512_cmpeq_epi16_mask(x,y))
+#define simdi32_eq(x,y)     _mm512_maskz_set1_epi32(_mm512_cmpeq_epi32_mask(x,y), -1)
+#define simdi32_lt(x,y)     simdi32_gt(y,x) // inverse
+#define simdi16_lt(x,y)     simdi16_gt(y,x) // inverse
+#define simdi8_lt(x,y)      simdi8_gt(y,x)
 #define simdi_or(x,y)       _mm512_or_si512(x,y)
 #define simdi_and(x,y)      _mm512_and_si512(x,y)
 #define simdi_andnot(x,y)   _mm512_andnot_si512(x,y)
 #define simdi_xor(x,y)      _mm512_xor_si512(x,y)
-#define simdi8_shiftl(x,y)  NOT_YET_IMP()
-#define simdi8_shiftr(x,y)  NOT_YET_IMP()
-#define simdi8_movemask(x)  NOT_YET_IMP()
-#define simdi16_extract(x,y) NOT_YET_IMP()
+#define simdi8_shiftl(x,y)  _mm512_shift_left<y>(x)
+#define simdi8_shiftr(x,y)  _mm512_shift_right<y>(x)
+#define SIMD_MOVEMASK_MAX   0xffffffffffffffffULL
+typedef uint64_t simd_movemask_t;
+#define simdi8_movemask(x)  _mm512_movepi8_mask(x)
+#define simdi16_extract(x,y) extract_epi16(x,y)
+#define simdi32_pack(x,y)   _mm512_packs_epi32(x,y)
+#define simdi16_pack(x,y)   _mm512_packs_epi16(x,y)
 #define simdi16_slli(x,y)	_mm512_slli_epi16(x,y) // shift integers in a left by y
 #define simdi16_srli(x,y)	_mm512_srli_epi16(x,y) // shift integers in a right by y
 #define simdi32_slli(x,y)	_mm512_slli_epi32(x,y) // shift integers in a left by y
 #define simdi32_srli(x,y)	_mm512_srli_epi32(x,y) // shift integers in a right by y
-#define simdi32_i2f(x) 	    _mm512_cvtepi32_ps(x)  // convert integer to s.p. float
-#define simdi_i2fcast(x)    _mm512_castsi512_ps(x)
 #endif //SIMD_INT
-#endif //AVX512_SUPPORT
+#endif //AVX512
 
 
 #ifdef AVX2
@@ -163,9 +159,9 @@ typedef __m512i simd_int;
 #define SIMD_INT
 #define ALIGN_INT           AVX2_ALIGN_INT
 #define VECSIZE_INT         AVX2_VECSIZE_INT
-uint16_t simd_hmax16_sse(const __m128i buffer);
-uint8_t simd_hmax8_sse(const __m128i buffer);
-inline uint16_t simd_hmax16_avx(const __m256i buffer) {
+static inline uint16_t simd_hmax16_sse(const __m128i buffer);
+static inline uint8_t simd_hmax8_sse(const __m128i buffer);
+static inline uint16_t simd_hmax16_avx(const __m256i buffer) {
     const __m128i abcd = _mm256_castsi256_si128(buffer);
     const uint16_t first = simd_hmax16_sse(abcd);
     const __m128i efgh = _mm256_extracti128_si256(buffer, 1);
@@ -173,7 +169,7 @@ inline uint16_t simd_hmax16_avx(const __m256i buffer) {
     return std::max(first, second);
 }
 
-inline uint8_t simd_hmax8_avx(const __m256i buffer) {
+static inline uint8_t simd_hmax8_avx(const __m256i buffer) {
     const __m128i abcd = _mm256_castsi256_si128(buffer);
     const uint8_t first = simd_hmax8_sse(abcd);
     const __m128i efgh = _mm256_extracti128_si256(buffer, 1);
@@ -181,7 +177,7 @@ inline uint8_t simd_hmax8_avx(const __m256i buffer) {
     return std::max(first, second);
 }
 
-inline float simdf32_hadd(const __m256 x) {
+static inline float simdf32_hadd(const __m256 x) {
     /* ( x3+x7, x2+x6, x1+x5, x0+x4 ) */
     const __m128 x128 = _mm_add_ps(_mm256_extractf128_ps(x, 1), _mm256_castps256_ps128(x));
     /* ( -, -, x1+x3+x5+x7, x0+x2+x4+x6 ) */
@@ -193,12 +189,12 @@ inline float simdf32_hadd(const __m256 x) {
 }
 
 template  <unsigned int N>
-inline __m256i _mm256_shift_left(__m256i a) {
+static inline __m256i _mm256_shift_left(__m256i a) {
     __m256i mask = _mm256_permute2x128_si256(a, a, _MM_SHUFFLE(0,0,3,0) );
     return _mm256_alignr_epi8(a,mask,16-N);
 }
 
-inline unsigned short extract_epi16(__m256i v, int pos) {
+static inline unsigned short extract_epi16(__m256i v, int pos) {
     switch(pos){
         case 0: return _mm256_extract_epi16(v, 0);
         case 1: return _mm256_extract_epi16(v, 1);
@@ -269,6 +265,7 @@ typedef __m256i simd_int;
 //TODO fix like shift_left
 #define simdi8_shiftr(x,y)  _mm256_srli_si256(x,y)
 #define SIMD_MOVEMASK_MAX   0xffffffff
+typedef uint32_t simd_movemask_t;
 #define simdi8_movemask(x)  _mm256_movemask_epi8(x)
 #define simdi16_extract(x,y) extract_epi16(x,y)
 #define simdi32_pack(x,y)   _mm256_packs_epi32(x,y)
@@ -334,13 +331,13 @@ typedef __m256 simd_float;
 #endif
 
 #include <simde/x86/sse4.1.h>
-inline uint16_t simd_hmax16_sse(const __m128i buffer) {
+static inline uint16_t simd_hmax16_sse(const __m128i buffer) {
     __m128i tmp1 = _mm_subs_epu16(_mm_set1_epi16((short)65535), buffer);
     __m128i tmp3 = _mm_minpos_epu16(tmp1);
     return (65535 - _mm_cvtsi128_si32(tmp3));
 }
 
-inline uint8_t simd_hmax8_sse(const __m128i buffer) {
+static inline uint8_t simd_hmax8_sse(const __m128i buffer) {
     __m128i tmp1 = _mm_subs_epu8(_mm_set1_epi8((char)255), buffer);
     __m128i tmp2 = _mm_min_epu8(tmp1, _mm_srli_epi16(tmp1, 8));
     __m128i tmp3 = _mm_minpos_epu16(tmp2);
@@ -348,7 +345,7 @@ inline uint8_t simd_hmax8_sse(const __m128i buffer) {
 }
 
 // see https://stackoverflow.com/questions/6996764/fastest-way-to-do-horizontal-sse-vector-sum-or-other-reduction
-inline float simdf32_hadd(const __m128 v) {
+static inline float simdf32_hadd(const __m128 v) {
     __m128 shuf = _mm_movehdup_ps(v);        // broadcast elements 3,1 to 2,0
     __m128 sums = _mm_add_ps(v, shuf);
     shuf        = _mm_movehl_ps(shuf, sums); // high half -> low half
@@ -410,7 +407,7 @@ typedef __m128  simd_float;
 // integer support
 #ifndef SIMD_INT
 #define SIMD_INT
-inline unsigned short extract_epi16(__m128i v, int pos) {
+static inline unsigned short extract_epi16(__m128i v, int pos) {
     switch(pos){
         case 0: return _mm_extract_epi16(v, 0);
         case 1: return _mm_extract_epi16(v, 1);
@@ -474,6 +471,7 @@ typedef __m128i simd_int;
 #define simdi8_shiftl(x,y)  _mm_slli_si128(x,y)
 #define simdi8_shiftr(x,y)  _mm_srli_si128(x,y)
 #define SIMD_MOVEMASK_MAX   0xffff
+typedef uint32_t simd_movemask_t;
 #define simdi8_movemask(x)  _mm_movemask_epi8(x)
 #define simdi16_extract(x,y) extract_epi16(x,y)
 #define simdi32_pack(x,y)   _mm_packs_epi32(x,y)
@@ -486,7 +484,7 @@ typedef __m128i simd_int;
 #define simdi_i2fcast(x)    _mm_castsi128_ps(x)
 #endif //SIMD_INT
 
-inline void *mem_align(size_t boundary, size_t size) {
+static inline void *mem_align(size_t boundary, size_t size) {
     void *pointer;
     if (posix_memalign(&pointer, boundary, size) != 0) {
 #define MEM_ALIGN_ERROR "mem_align could not allocate memory.\n"
@@ -497,17 +495,17 @@ inline void *mem_align(size_t boundary, size_t size) {
     return pointer;
 }
 #ifdef SIMD_FLOAT
-inline simd_float * malloc_simd_float(const size_t size) {
+static inline simd_float * malloc_simd_float(const size_t size) {
     return (simd_float *) mem_align(ALIGN_FLOAT, size);
 }
 #endif
 #ifdef SIMD_DOUBLE
-inline simd_double * malloc_simd_double(const size_t size) {
+static inline simd_double * malloc_simd_double(const size_t size) {
     return (simd_double *) mem_align(ALIGN_DOUBLE, size);
 }
 #endif
 #ifdef SIMD_INT
-inline simd_int * malloc_simd_int(const size_t size) {
+static inline simd_int * malloc_simd_int(const size_t size) {
     return (simd_int *) mem_align(ALIGN_INT, size);
 }
 #endif
@@ -533,7 +531,9 @@ T** malloc_matrix(int dim1, int dim2) {
 }
 
 
-inline simd_float simdf32_fpow2(simd_float X) {
+// simd_int and simd_float have a different width with AVX512
+#ifndef AVX512
+static inline simd_float simdf32_fpow2(simd_float X) {
 
     simd_int* xPtr = (simd_int*) &X;    // store address of float as pointer to int
 
@@ -602,10 +602,11 @@ inline simd_float simdf32_fpow2(simd_float X) {
 
     return result;
 }
+#endif
 
 
 
-inline float ScalarProd20(const float* qi, const float* tj) {
+static inline float ScalarProd20(const float* qi, const float* tj) {
 //#ifdef AVX
 //  float __attribute__((aligned(ALIGN_FLOAT))) res;
 //  __m256 P; // query 128bit SSE2 register holding 4 floats
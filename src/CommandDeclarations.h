@@ -85,6 +85,7 @@ extern int offsetalignment(int argc, const char **argv, const Command& command);
 extern int orftocontig(int argc, const char **argv, const Command& command);
 extern int touchdb(int argc, const char **argv, const Command& command);
 extern int prefilter(int argc, const char **argv, const Command& command);
+extern int prefilteralign(int argc, const char **argv, const Command& command);
 extern int prefixid(int argc, const char **argv, const Command& command);
 extern int profile2cs(int argc, const char **argv, const Command& command);
 extern int profile2pssm(int argc, const char **argv, const Command& command);
@@ -106,6 +107,7 @@ extern int result2repseq(int argc, const char **argv, const Command& command);
 extern int result2stats(int argc, const char **argv, const Command& command);
 extern int reverseseq(int argc, const char **argv, const Command& command);
 extern int search(int argc, const char **argv, const Command& command);
+extern int searchserver(int argc, const char **argv, const Command& command);
 extern int linsearch(int argc, const char **argv, const Command& command);
 extern int sortresult(int argc, const char **argv, const Command& command);
 extern int splitdb(int argc, const char **argv, const Command& command);
@@ -4,6 +4,8 @@
 #include "DownloadDatabase.h"
 
 const char* MMSEQS_CURRENT_INDEX_VERSION = "16";
+// indexes with packed k-mer lists need a reader that knows ENTRIESPACKED, older binaries reject this version
+const char* MMSEQS_PACKED_INDEX_VERSION = "17";
 
 Parameters& par = Parameters::getInstance();
 std::vector<Command> baseCommands = {
@@ -345,7 +347,7 @@ std::vector<Command> baseCommands = {
                 "<i:queryDb> <i:targetDb> <i:alignmentDB> <o:alignmentFile>",
                 CITATION_MMSEQS2, {{"queryDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA|DbType::NEED_HEADER, &DbValidator::sequenceDb },
                                           {"targetDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA|DbType::NEED_HEADER, &DbValidator::sequenceDb },
-                                          {"alignmentDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::alignmentDb },
+                                          {"alignmentDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::alignmentOrBinPrefDb },
                                           {"alignmentFile", DbType::ACCESS_MODE_OUTPUT, DbType::NEED_DATA, &DbValidator::flatfile}}},
         {"createtsv",            createtsv,            &par.createtsv,            COMMAND_FORMAT_CONVERSION,
                 "Convert result DB to tab-separated flat file",
@@ -507,7 +509,7 @@ std::vector<Command> baseCommands = {
                 "Milot Mirdita <milot@mirdita.de>",
                 "<i:targetDB> <i:resultDB> <o:taxaDB>",
                 CITATION_TAXONOMY|CITATION_MMSEQS2, {{"targetDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA|DbType::NEED_TAXONOMY, &DbValidator::taxSequenceDb },
-                                          {"resultDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::resultDb },
+                                          {"resultDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::resultOrBinAlnDb },
                                           {"taxDB",    DbType::ACCESS_MODE_OUTPUT, DbType::NEED_DATA, &DbValidator::taxResult }}},
         {"majoritylca",          majoritylca,          &par.majoritylca,          COMMAND_TAXONOMY | COMMAND_EXPERT,
                 "Compute the lowest common ancestor using majority voting",
@@ -623,8 +625,29 @@ std::vector<Command> baseCommands = {
                 "<i:queryDB> <i:targetDB> <i:resultDB> <o:alignmentDB>",
                 CITATION_MMSEQS2, {{"queryDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::sequenceDb },
                                                            {"targetDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::sequenceDb },
-                                                           {"resultDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::resultDb },
+                                                           {"resultDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::resultOrBinPrefDb },
                                                            {"alignmentDB", DbType::ACCESS_MODE_OUTPUT, DbType::NEED_DATA, &DbValidator::alignmentDb }}},
+        {"prefilteralign",       prefilteralign,       &par.prefilteralign,       COMMAND_ALIGNMENT,
+                "Fused k-mer prefilter and gapped alignment without a prefilter DB",
+                NULL,
+                "Martin Steinegger <martin.steinegger@snu.ac.kr>",
+                "<i:queryDB> <i:targetDB> <o:alignmentDB>",
+                CITATION_MMSEQS2, {{"queryDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::sequenceDb },
+                                                           {"targetDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::sequenceDb },
+                                                           {"alignmentDB", DbType::ACCESS_MODE_OUTPUT, DbType::NEED_DATA, &DbValidator::alignmentDb }}},
+        {"searchserver",         searchserver,         &par.prefilteralign,       COMMAND_ALIGNMENT,
+                "Keep a target DB loaded and search query DBs sent over a UNIX socket",
+                "# Serve searches against an index of targetDB\n"
+                "mmseqs createindex targetDB tmp\n"
+                "mmseqs searchserver targetDB search.sock &\n\n"
+                "# Search a batch, the reply is OK or ERROR and a reason\n"
+                "echo \"$PWD/queryDB $PWD/alnDB\" | nc -U search.sock\n\n"
+                "# Stop the server\n"
+                "echo SHUTDOWN | nc -U search.sock\n",
+                "Martin Steinegger <martin.steinegger@snu.ac.kr>",
+                "<i:targetDB> <o:socketFile>",
+                CITATION_MMSEQS2, {{"targetDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::sequenceDb },
+                                                           {"socketFile", DbType::ACCESS_MODE_OUTPUT, DbType::NEED_DATA, &DbValidator::flatfile }}},
         {"alignall",             alignall,             &par.alignall,             COMMAND_ALIGNMENT,
                 "Within-result all-vs-all gapped local alignment",
                 NULL,
@@ -669,7 +692,7 @@ std::vector<Command> baseCommands = {
                 "Martin Steinegger <martin.steinegger@snu.ac.kr> & Lars von den Driesch & Maria Hauser",
                 "<i:sequenceDB> <i:resultDB> <o:clusterDB>",
                 CITATION_MMSEQS2|CITATION_MMSEQS1,{{"sequenceDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::sequenceDb },
-                                                          {"resultDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::resultDb },
+                                                          {"resultDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::resultOrBinAlnDb },
                                                           {"clusterDB", DbType::ACCESS_MODE_OUTPUT, DbType::NEED_DATA, &DbValidator::clusterDb }}},
         {"clusthash",            clusthash,            &par.clusthash,            COMMAND_CLUSTER,
                 "Hash-based clustering of equal length sequences",
@@ -972,7 +995,7 @@ std::vector<Command> baseCommands = {
                 "<i:queryDB> <i:targetDB> <i:resultDB> <o:msaDB>",
                 CITATION_MMSEQS2,{{"queryDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::sequenceDb },
                                           {"targetDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::sequenceDb },
-                                          {"resultDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::resultDb },
+                                          {"resultDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::resultOrBinAlnDb },
                                           {"msaDB",    DbType::ACCESS_MODE_OUTPUT, DbType::NEED_DATA, &DbValidator::msaDb }}},
         {"result2dnamsa",           result2dnamsa,           &par.result2dnamsa,           COMMAND_RESULT,
                 "Compute MSA DB with out insertions in the query for DNA sequences",
@@ -1069,7 +1092,7 @@ std::vector<Command> baseCommands = {
                 "<i:queryDB> <i:targetDB> <i:resultDB> <o:profileDB>",
                 CITATION_MMSEQS2,{{"queryDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::sequenceDb },
                                                            {"targetDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::sequenceDb },
-                                                           {"resultDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::resultDb },
+                                                           {"resultDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::resultOrBinAlnDb },
                                                            {"profileDB", DbType::ACCESS_MODE_OUTPUT, DbType::NEED_DATA, &DbValidator::profileDb }}},
         {"msa2result",          msa2result,            &par.msa2profile,          COMMAND_PROFILE | COMMAND_EXPERT,
                 "Convert a MSA DB to a profile DB",
@@ -3,6 +3,7 @@
 #include "Debug.h"
 #include "Matcher.h"
 #include "QueryMatcher.h"
+#include "Prefiltering.h"
 #include "DBWriter.h"
 #include "IndexReader.h"
 #include "NucleotideMatrix.h"
@@ -12,6 +13,7 @@
 #include "Parameters.h"
 #include "FastSort.h"
 #include "Sequence.h"
+#include "Telemetry.h"
 
 #ifdef OPENMP
 #include <omp.h>
@@ -19,13 +21,14 @@
 
 Alignment::Alignment(const std::string &querySeqDB, const std::string &targetSeqDB,
                      const std::string &prefDB, const std::string &prefDBIndex,
-                     const std::string &outDB, const std::string &outDBIndex, const Parameters &par, const bool lcaAlign) :
+                     const std::string &outDB, const std::string &outDBIndex, const Parameters &par, const bool lcaAlign,
+                     Prefiltering *prefilter) :
         covThr(par.covThr), canCovThr(par.covThr), covMode(par.covMode), seqIdMode(par.seqIdMode), evalThr(par.evalThr), seqIdThr(par.seqIdThr),
         alnLenThr(par.alnLenThr), includeIdentity(par.includeIdentity), addBacktrace(par.addBacktrace), realign(par.realign), scoreBias(par.scoreBias), realignScoreBias(par.realignScoreBias), realignMaxSeqs(par.realignMaxSeqs),
         threads(static_cast<unsigned int>(par.threads)), compressed(par.compressed), outDB(outDB), outDBIndex(outDBIndex),
-        maxSeqLen(par.maxSeqLen), compBiasCorrection(par.compBiasCorrection), compBiasCorrectionScale(par.compBiasCorrectionScale), altAlignment(par.altAlignment), alignmentOutputMode(par.alignmentOutputMode),
+        maxSeqLen(par.maxSeqLen), compBiasCorrection(par.compBiasCorrection), compBiasCorrectionScale(par.compBiasCorrectionScale), altAlignment(par.altAlignment), alignmentOutputMode(par.alignmentOutputMode), binaryResult(par.binaryResult),
         maxAccept(static_cast<unsigned int>(par.maxAccept)), maxReject(static_cast<unsigned int>(par.maxRejected)), wrappedScoring(par.wrappedScoring),
-        lcaAlign(lcaAlign), qdbr(NULL), qDbrIdx(NULL), tdbr(NULL), tDbrIdx(NULL) {
+        lcaAlign(lcaAlign), qdbr(NULL), qDbrIdx(NULL), tdbr(NULL), tDbrIdx(NULL), prefdbr(NULL), prefilter(prefilter) {
     unsigned int alignmentMode = par.alignmentMode;
     if (alignmentMode == Parameters::ALIGNMENT_MODE_UNGAPPED) {
         Debug(Debug::ERROR) << "Use rescorediagonal for ungapped alignment mode.\n";
@@ -55,11 +58,15 @@ Alignment::Alignment(const std::string &querySeqDB, const std::string &targetSeq
         }
     }
 
-    uint16_t extended = DBReader<unsigned int>::getExtendedDbtype(FileUtil::parseDbType(prefDB.c_str()));
+    uint16_t extended = (prefilter != NULL) ? 0 : DBReader<unsigned int>::getExtendedDbtype(FileUtil::parseDbType(prefDB.c_str()));
     bool touch = (par.preloadMode != Parameters::PRELOAD_MODE_MMAP);
+    int targetDataMode = DBReader<unsigned int>::USE_INDEX | DBReader<unsigned int>::USE_DATA;
+    if (par.preloadMode == Parameters::PRELOAD_MODE_MMAP_HUGEPAGE) {
+        targetDataMode |= DBReader<unsigned int>::USE_HUGEPAGES;
+    }
     tDbrIdx = new IndexReader(targetSeqDB, par.threads,
                               extended & Parameters::DBTYPE_EXTENDED_INDEX_NEED_SRC ? IndexReader::SRC_SEQUENCES : IndexReader::SEQUENCES,
-                              (touch) ? (IndexReader::PRELOAD_INDEX | IndexReader::PRELOAD_DATA) : 0);
+                              (touch) ? (IndexReader::PRELOAD_INDEX | IndexReader::PRELOAD_DATA) : 0, targetDataMode);
     tdbr = tDbrIdx->sequenceReader;
     targetSeqType = tdbr->getDbtype();
     sameQTDB = (targetSeqDB.compare(querySeqDB) == 0);
@@ -67,6 +74,9 @@ Alignment::Alignment(const std::string &querySeqDB, const std::string &targetSeq
         qDbrIdx = tDbrIdx;
         qdbr = tdbr;
         querySeqType = targetSeqType;
+    } else if (querySeqDB.empty() && prefilter != NULL) {
+        // searchserver sets the query database of each batch with setQueryDb
+        querySeqType = prefilter->getQuerySeqType();
     } else {
         // open the sequence, prefiltering and output databases
         qDbrIdx = new IndexReader(par.db1, par.threads,
@@ -124,7 +134,7 @@ Alignment::Alignment(const std::string &querySeqDB, const std::string &targetSeq
         tdbr->readMmapedDataInMemory();
     }
 
-    if (qdbr->getSize() <= threads) {
+    if (qdbr != NULL && qdbr->getSize() <= threads) {
         threads = qdbr->getSize();
     }
 
@@ -133,14 +143,24 @@ Alignment::Alignment(const std::string &querySeqDB, const std::string &targetSeq
         EXIT(EXIT_FAILURE);
     }
 
-    Debug(Debug::INFO) << "Query database size: "  << qdbr->getSize() << " type: " << Parameters::getDbTypeName(querySeqType) << "\n";
+    if (qdbr != NULL) {
+        Debug(Debug::INFO) << "Query database size: "  << qdbr->getSize() << " type: " << Parameters::getDbTypeName(querySeqType) << "\n";
+    }
     Debug(Debug::INFO) << "Target database size: " << tdbr->getSize() << " type: " << Parameters::getDbTypeName(targetSeqType) << "\n";
 
-    prefdbr = new DBReader<unsigned int>(prefDB.c_str(), prefDBIndex.c_str(), threads, DBReader<unsigned int>::USE_DATA|DBReader<unsigned int>::USE_INDEX);
-    prefdbr->open(DBReader<unsigned int>::LINEAR_ACCCESS);
-    reversePrefilterResult = Parameters::isEqualDbtype(prefdbr->getDbtype(), Parameters::DBTYPE_PREFILTER_REV_RES);
+    if (prefilter != NULL) {
+        // the hits of the fused prefilter are read like binary prefilter results
+        reversePrefilterResult = false;
+        binaryPrefilterResult = true;
+    } else {
+        prefdbr = new DBReader<unsigned int>(prefDB.c_str(), prefDBIndex.c_str(), threads, DBReader<unsigned int>::USE_DATA|DBReader<unsigned int>::USE_INDEX);
+        prefdbr->open(DBReader<unsigned int>::LINEAR_ACCCESS);
+        reversePrefilterResult = Parameters::isEqualDbtype(prefdbr->getDbtype(), Parameters::DBTYPE_PREFILTER_REV_RES);
+        binaryPrefilterResult = QueryMatcher::isBinaryPrefilterResult(prefdbr->getDbtype());
+    }
 
     correlationScoreWeight = par.correlationScoreWeight;
+    nuclAligner = par.nuclAligner;
     if (Parameters::isEqualDbtype(querySeqType, Parameters::DBTYPE_NUCLEOTIDES)) {
         m = new NucleotideMatrix(par.scoringMatrixFile.values.nucleotide().c_str(), 1.0, scoreBias);
         gapOpen = par.gapOpen.values.nucleotide();
@@ -206,21 +226,33 @@ Alignment::~Alignment() {
     if (sameQTDB == false) {
         if(qDbrIdx != NULL){
             delete qDbrIdx;
-        }else{
+        }else if(qdbr != NULL){
             qdbr->close();
             delete qdbr;
         }
     }
 
-    prefdbr->close();
-    delete prefdbr;
+    if (prefdbr != NULL) {
+        prefdbr->close();
+        delete prefdbr;
+    }
+}
+
+void Alignment::setQueryDb(const std::string &querySeqDB) {
+    if (sameQTDB == false && qDbrIdx != NULL) {
+        delete qDbrIdx;
+    }
+    sameQTDB = false;
+    qDbrIdx = new IndexReader(querySeqDB, threads, IndexReader::SEQUENCES, IndexReader::PRELOAD_INDEX);
+    qdbr = qDbrIdx->sequenceReader;
 }
 
 void Alignment::run(const unsigned int mpiRank, const unsigned int mpiNumProc) {
 
     size_t dbFrom = 0;
     size_t dbSize = 0;
-    prefdbr->decomposeDomainByAminoAcid(mpiRank, mpiNumProc, &dbFrom, &dbSize);
+    DBReader<unsigned int> *domainReader = (prefilter != NULL) ? prefilter->getQueryDbReader() : prefdbr;
+    domainReader->decomposeDomainByAminoAcid(mpiRank, mpiNumProc, &dbFrom, &dbSize);
 
     Debug(Debug::INFO) << "Compute split from " << dbFrom << " to " << (dbFrom + dbSize) << "\n";
     std::pair<std::string, std::string> tmpOutput = Util::createTmpFileNames(outDB, outDBIndex, mpiRank);
@@ -242,15 +274,18 @@ void Alignment::run(const unsigned int mpiRank, const unsigned int mpiNumProc) {
 }
 
 void Alignment::run() {
-    run(outDB, outDBIndex, 0, prefdbr->getSize(), false);
+    const size_t dbSize = (prefilter != NULL) ? prefilter->getQueryDbReader()->getSize() : prefdbr->getSize();
+    run(outDB, outDBIndex, 0, dbSize, false);
 }
 
 void Alignment::run(const std::string &outDB, const std::string &outDBIndex, const size_t dbFrom, const size_t dbSize, bool merge) {
-    int dbtype = Parameters::DBTYPE_ALIGNMENT_RES;
+    int dbtype = binaryResult ? Parameters::DBTYPE_ALIGNMENT_BIN_RES : Parameters::DBTYPE_ALIGNMENT_RES;
     if (alignmentOutputMode == Parameters::ALIGNMENT_OUTPUT_CLUSTER) {
         dbtype = Parameters::DBTYPE_CLUSTER_RES;
     }
-    dbtype = DBReader<unsigned int>::setExtendedDbtype(dbtype, DBReader<unsigned int>::getExtendedDbtype(prefdbr->getDbtype()));
+    if (prefdbr != NULL) {
+        dbtype = DBReader<unsigned int>::setExtendedDbtype(dbtype, DBReader<unsigned int>::getExtendedDbtype(prefdbr->getDbtype()));
+    }
     DBWriter dbw(outDB.c_str(), outDBIndex.c_str(), threads, compressed, dbtype);
     dbw.open();
 
@@ -264,7 +299,7 @@ void Alignment::run(const std::string &outDB, const std::string &outDBIndex, con
 
     size_t totalMemory = Util::getTotalSystemMemory();
     size_t flushSize = 1000000;
-    if (totalMemory > prefdbr->getTotalDataSize()) {
+    if (prefdbr == NULL || totalMemory > prefdbr->getTotalDataSize()) {
         flushSize = dbSize;
     }
     size_t iterations = static_cast<size_t>(ceil(static_cast<double>(dbSize) / static_cast<double>(flushSize)));
@@ -292,7 +327,7 @@ void Alignment::run(const std::string &outDB, const std::string &outDBIndex, con
 
             std::vector<Matcher::result_t> swResults;
             swResults.reserve(300);
-            Matcher matcher(querySeqType, targetSeqType, maxMatcherSeqLen, m, &evaluer, compBiasCorrection, compBiasCorrectionScale, gapOpen, gapExtend, correlationScoreWeight, zdrop);
+            Matcher matcher(querySeqType, targetSeqType, maxMatcherSeqLen, m, &evaluer, compBiasCorrection, compBiasCorrectionScale, gapOpen, gapExtend, correlationScoreWeight, zdrop, nuclAligner);
 
             std::vector<Matcher::result_t> swRealignResults;
             Matcher *realigner = NULL;
@@ -300,26 +335,59 @@ void Alignment::run(const std::string &outDB, const std::string &outDBIndex, con
                 swRealignResults.reserve(300);
                 realigner = &matcher;
                 if (realign_m != NULL) {
-                    realigner = new Matcher(querySeqType, targetSeqType, maxMatcherSeqLen, realign_m, &evaluer, compBiasCorrection, compBiasCorrectionScale, gapOpen, gapExtend, 0.0, zdrop);
+                    realigner = new Matcher(querySeqType, targetSeqType, maxMatcherSeqLen, realign_m, &evaluer, compBiasCorrection, compBiasCorrectionScale, gapOpen, gapExtend, 0.0, zdrop, nuclAligner);
                 }
             }
 
             std::string queryToWrap;
             queryToWrap.reserve(maxSeqLen * 2);
 
+            Sequence *prefSeq = NULL;
+            QueryMatcher *queryMatcher = NULL;
+            if (prefilter != NULL) {
+                prefSeq = prefilter->createQuerySequence();
+                queryMatcher = prefilter->createFusedQueryMatcher(prefSeq);
+            }
+
             const char* words[10];
 
+            std::vector<PrefilterHit> hits;
+            hits.reserve(300);
+            std::vector<SmithWatermanKernel::alignment_end> batchEnds;
+            batchEnds.reserve(300);
+            Sequence batchSeq(maxSeqLen, targetSeqType, m, 0, false, compBiasCorrection);
+            // the correlation score can raise the e-value of a hit after the traceback
+            const bool batchScoring = correlationScoreWeight == 0.0f && wrappedScoring == false;
+
 #pragma omp for schedule(dynamic, 5) reduction(+: alignmentsNum, totalPassedNum)
             for (size_t id = start; id < (start + bucketSize); id++) {
                 progress.updateProgress();
 
                 // get the prefiltering list
-                char *data, *origData;
-                data = origData = prefdbr->getData(id, thread_idx);
-                unsigned int queryDbKey = prefdbr->getDbKey(id);
+                char *data = NULL, *origData = NULL;
+                unsigned int queryDbKey;
+                const hit_t *fusedHits = NULL;
+                const hit_bin_t *binaryHits = NULL;
+                size_t binaryHitCount = 0;
+                if (prefilter != NULL) {
+                    std::pair<hit_t *, size_t> prefResults = prefilter->matchFusedQuery(*queryMatcher, *prefSeq, id, thread_idx);
+                    queryDbKey = prefSeq->getDbKey();
+                    fusedHits = prefResults.first;
+                    binaryHitCount = prefResults.second;
+                } else {
+                    data = origData = prefdbr->getData(id, thread_idx);
+                    queryDbKey = prefdbr->getDbKey(id);
+                    // binary prefilter results are read in place as fixed-width hit_bin_t records
+                    if (binaryPrefilterResult) {
+                        binaryHits = QueryMatcher::getBinaryPrefilterHits(origData);
+                        binaryHitCount = QueryMatcher::getBinaryPrefilterHitCount(origData, prefdbr->getEntryLen(id));
+                    }
+                }
+                size_t binaryHitIdx = 0;
+                const bool hasHits = binaryPrefilterResult ? (binaryHitCount > 0) : (*data != '\0');
                 size_t origQueryLen = 0;
                 // only load query data if data != \0
-                if (*data != '\0') {
+                if (hasHits) {
                     size_t qId = qdbr->getId(queryDbKey);
                     char *querySeqData = qdbr->getData(qId, thread_idx);
                     if (querySeqData == NULL) {
@@ -340,24 +408,54 @@ void Alignment::run(const std::string &outDB, const std::string &outDBIndex, con
                     matcher.initQuery(&qSeq);
                 }
 
-                // parse the prefiltering list and calculate a Smith-Waterman alignment for each sequence in the list
-                size_t passedNum = 0;
-                unsigned int rejected = 0;
-                while (*data != '\0' && passedNum < maxAccept && rejected < maxReject) {
-                    Util::parseKey(data, buffer);
-                    const unsigned int dbKey = (unsigned int) strtoul(buffer, NULL, 10);
-                    size_t elements = Util::getWordsOfLine(data, words, 10);
-
-                    short diagonal = 0;
-                    bool isReverse = false;
-                    // Prefilter result (need to make this better)
-                    if (elements == 3) {
-                        hit_t hit = QueryMatcher::parsePrefilterHit(data);
-                        isReverse = reversePrefilterResult && (hit.prefScore < 0);
-                        diagonal = static_cast<short>(hit.diagonal);
+                // parse the prefiltering list
+                hits.clear();
+                while (binaryPrefilterResult ? (binaryHitIdx < binaryHitCount) : (*data != '\0')) {
+                    PrefilterHit prefHit;
+                    prefHit.diagonal = 0;
+                    prefHit.isReverse = false;
+                    if (fusedHits != NULL) {
+                        const hit_t &hit = fusedHits[binaryHitIdx++];
+                        prefHit.dbKey = hit.seqId;
+                        prefHit.diagonal = static_cast<short>(hit.diagonal);
+                    } else if (binaryPrefilterResult) {
+                        const hit_bin_t &hit = binaryHits[binaryHitIdx++];
+                        prefHit.dbKey = hit.seqId;
+                        prefHit.diagonal = static_cast<short>(hit.diagonal);
+                    } else {
+                        Util::parseKey(data, buffer);
+                        prefHit.dbKey = (unsigned int) strtoul(buffer, NULL, 10);
+                        size_t elements = Util::getWordsOfLine(data, words, 10);
+
+                        // Prefilter result (need to make this better)
+                        if (elements == 3) {
+                            hit_t hit = QueryMatcher::parsePrefilterHit(data);
+                            prefHit.isReverse = reversePrefilterResult && (hit.prefScore < 0);
+                            prefHit.diagonal = static_cast<short>(hit.diagonal);
+                        }
+                        data = Util::skipLine(data);
                     }
-                    data = Util::skipLine(data);
+                    hits.emplace_back(prefHit);
+                }
 
+                // short targets are scored in batches ahead of the striped alignment,
+                // hits whose exact score already fails the e-value threshold are rejected without aligning them
+                // and the alignment of the others continues from the batch score and end position
+                const bool scoreBatches = batchScoring && hasHits && matcher.canScoreBatch();
+                SmithWatermanKernel::alignment_end notScored;
+                notScored.score = 0;
+                notScored.ref = -1;
+                notScored.read = -1;
+                batchEnds.assign(hits.size(), notScored);
+                // end positions are only needed for hits that pass the e-value threshold
+                const uint8_t batchEndScore = scoreBatches ? static_cast<uint8_t>(matcher.minPassingScore(evalThr)) : UCHAR_MAX;
+                size_t batchedUntil = 0;
+
+                // calculate a Smith-Waterman alignment for each sequence in the list
+                size_t passedNum = 0;
+                unsigned int rejected = 0;
+                for (size_t hitIdx = 0; hitIdx < hits.size() && passedNum < maxAccept && rejected < maxReject; hitIdx++) {
+                    const unsigned int dbKey = hits[hitIdx].dbKey;
                     size_t dbId = tdbr->getId(dbKey);
                     char *dbSeqData = tdbr->getData(dbId, thread_idx);
                     if (dbSeqData == NULL) {
@@ -374,9 +472,19 @@ void Alignment::run(const std::string &outDB, const std::string &outDBIndex, con
 
                     const bool isIdentity = (queryDbKey == dbKey && (includeIdentity || sameQTDB)) ? true : false;
 
-                    // calculate Smith-Waterman alignment
+                    if (scoreBatches && hitIdx >= batchedUntil && isBatchable(dbKey, dbSeq.L, origQueryLen, queryDbKey)) {
+                        batchedUntil = fillScoreBatch(hitIdx, hits, batchEnds, batchEndScore, batchSeq, matcher, queryDbKey, origQueryLen, thread_idx);
+                    }
+                    const bool isBatched = batchEnds[hitIdx].score > 0;
+                    if (isBatched && matcher.computeEvalue(batchEnds[hitIdx].score) > evalThr) {
+                        alignmentsNum++;
+                        rejected++;
+                        continue;
+                    }
 
-                    Matcher::result_t res = matcher.getSWResult(&dbSeq, static_cast<int>(diagonal), isReverse, covMode, covThr, evalThr, swMode, seqIdMode, isIdentity, wrappedScoring);
+                    // calculate Smith-Waterman alignment
+                    Matcher::result_t res = matcher.getSWResult(&dbSeq, static_cast<int>(hits[hitIdx].diagonal), hits[hitIdx].isReverse, covMode, covThr, evalThr, swMode, seqIdMode, isIdentity, wrappedScoring,
+                                                                (isBatched && batchEnds[hitIdx].ref >= 0) ? &batchEnds[hitIdx] : NULL);
                     alignmentsNum++;
 
                     if (isIdentity) {
@@ -405,7 +513,7 @@ void Alignment::run(const std::string &outDB, const std::string &outDBIndex, con
                 }
 
                 std::vector<Matcher::result_t> *returnRes = &swResults;
-                if (realign == true && *origData != '\0') {
+                if (realign == true && hasHits) {
                     realigner->initQuery(&qSeq);
                     int realignAccepted = 0;
                     for (size_t result = 0; result < swResults.size() && realignAccepted < realignMaxSeqs; result++) {
@@ -457,10 +565,18 @@ void Alignment::run(const std::string &outDB, const std::string &outDBIndex, con
                     swRealignResults.clear();
 
                     data = origData;
+                    binaryHitIdx = 0;
                     unsigned int rejected = 0;
-                    while (*data != '\0' && rejected < maxReject) {
-                        Util::parseKey(data, buffer);
-                        const unsigned int dbKey = (unsigned int) strtoul(buffer, NULL, 10);
+                    while ((binaryPrefilterResult ? (binaryHitIdx < binaryHitCount) : (*data != '\0')) && rejected < maxReject) {
+                        unsigned int dbKey;
+                        if (binaryPrefilterResult) {
+                            dbKey = (fusedHits != NULL) ? fusedHits[binaryHitIdx].seqId : binaryHits[binaryHitIdx].seqId;
+                            binaryHitIdx++;
+                        } else {
+                            Util::parseKey(data, buffer);
+                            dbKey = (unsigned int) strtoul(buffer, NULL, 10);
+                            data = Util::skipLine(data);
+                        }
 //                        size_t elements = Util::getWordsOfLine(data, words, 10);
 //                        short diagonal = 0;
 //                        bool isReverse = false;
@@ -470,7 +586,6 @@ void Alignment::run(const std::string &outDB, const std::string &outDBIndex, con
 //                            isReverse = reversePrefilterResult && (hit.prefScore < 0);
 //                            diagonal = static_cast<short>(hit.diagonal);
 //                        }
-                        data = Util::skipLine(data);
 
                         dbId = tdbr->getId(dbKey);
                         char* dbSeqData = tdbr->getData(dbId, thread_idx);
@@ -501,6 +616,8 @@ void Alignment::run(const std::string &outDB, const std::string &outDBIndex, con
                         alnResultsOutString.append(SSTR((*returnRes)[result].dbKey));
                         alnResultsOutString.push_back('\n');
                     }
+                } else if (binaryResult) {
+                    Matcher::resultsToBinaryBuffer(alnResultsOutString, *returnRes, addBacktrace);
                 }else{
                     for (size_t result = 0; result < returnRes->size(); result++) {
                         size_t len = Matcher::resultToBuffer(buffer, (*returnRes)[result], addBacktrace);
@@ -515,8 +632,12 @@ void Alignment::run(const std::string &outDB, const std::string &outDBIndex, con
             if (realigner != NULL && realigner != &matcher) {
                 delete realigner;
             }
+            if (queryMatcher != NULL) {
+                delete queryMatcher;
+                delete prefSeq;
+            }
             // only remap if we have more than one iteration and we are not at the last iteration
-            if (i != (iterations - 1)) {
+            if (i != (iterations - 1) && prefdbr != NULL) {
 #pragma omp barrier
                 if (thread_idx == 0) {
                     prefdbr->remapData();
@@ -527,6 +648,8 @@ void Alignment::run(const std::string &outDB, const std::string &outDBIndex, con
     }
     dbw.close(merge);
 
+    Telemetry::addCounter("align_alignments", alignmentsNum);
+    Telemetry::addCounter("align_passed", totalPassedNum);
     Debug(Debug::INFO) << alignmentsNum << " alignments calculated\n";
     Debug(Debug::INFO) << totalPassedNum << " sequence pairs passed the thresholds";
     if (alignmentsNum > 0) {
@@ -545,6 +668,40 @@ size_t Alignment::estimateHDDMemoryConsumption(int dbSize, int maxSeqs) {
     return 2 * (dbSize * maxSeqs * 21 * 1.75);
 }
 
+bool Alignment::isBatchable(unsigned int dbKey, unsigned int dbLen, size_t queryLen, unsigned int queryDbKey) {
+    const bool isIdentity = (queryDbKey == dbKey && (includeIdentity || sameQTDB));
+    return isIdentity == false && dbLen <= static_cast<unsigned int>(SmithWaterman::BATCH_MAX_TARGET_LENGTH)
+           && Util::canBeCovered(canCovThr, covMode, static_cast<float>(queryLen), static_cast<float>(dbLen));
+}
+
+size_t Alignment::fillScoreBatch(size_t hitIdx, const std::vector<PrefilterHit> &hits, std::vector<SmithWatermanKernel::alignment_end> &batchEnds,
+                                 uint8_t endScore, Sequence &batchSeq, Matcher &matcher, unsigned int queryDbKey, size_t queryLen, int thread_idx) {
+    size_t batchIdx[64];
+    SmithWatermanKernel::alignment_end ends[64];
+    size_t batchSize = 0;
+    matcher.clearBatch();
+    size_t idx = hitIdx;
+    for (; idx < hits.size() && batchSize < matcher.getBatchSize(); idx++) {
+        const unsigned int dbKey = hits[idx].dbKey;
+        const size_t dbId = tdbr->getId(dbKey);
+        if (dbId == UINT_MAX) {
+            continue;
+        }
+        const unsigned int dbLen = tdbr->getSeqLen(dbId);
+        if (isBatchable(dbKey, dbLen, queryLen, queryDbKey) == false) {
+            continue;
+        }
+        batchSeq.mapSequence(dbId, dbKey, tdbr->getData(dbId, thread_idx), dbLen);
+        matcher.addToBatch(&batchSeq);
+        batchIdx[batchSize++] = idx;
+    }
+    matcher.scoreBatch(ends, endScore);
+    for (size_t i = 0; i < batchSize; i++) {
+        batchEnds[batchIdx[i]] = ends[i];
+    }
+    return idx;
+}
+
 bool Alignment::checkCriteria(Matcher::result_t &res, bool isIdentity, double evalThr, double seqIdThr, int alnLenThr, int covMode, float covThr) {
     const bool evalOk = (res.eval <= evalThr); // -e
     const bool seqIdOK = (res.seqId >= seqIdThr); // --min-seq-id
@@ -7,13 +7,15 @@
 #include "BaseMatrix.h"
 #include "Matcher.h"
 
+class Prefiltering;
+
 class Alignment {
 public:
     Alignment(const std::string &querySeqDB,
               const std::string &targetSeqDB,
               const std::string &prefDB, const std::string &prefDBIndex,
               const std::string &outDB, const std::string &outDBIndex,
-              const Parameters &par, const bool lcaAlign);
+              const Parameters &par, const bool lcaAlign, Prefiltering *prefilter = NULL);
     ~Alignment();
 
     //Non-MPI
@@ -25,6 +27,9 @@ public:
     //Run parallel
     void run(const std::string &outDB, const std::string &outDBIndex, const size_t dbFrom, const size_t dbSize, bool merge);
 
+    // replaces the query database, the target database and the matrices stay loaded (used by searchserver)
+    void setQueryDb(const std::string &querySeqDB);
+
     static bool checkCriteria(Matcher::result_t &res, bool isIdentity, double evalThr, double seqIdThr, int alnLenThr, int covMode, float covThr);
 
     static unsigned int initSWMode(unsigned int alignmentMode, float covThr, float seqIdThr);
@@ -88,6 +93,8 @@ private:
 
     int altAlignment;
     int alignmentOutputMode;
+    // write DBTYPE_ALIGNMENT_BIN_RES instead of text alignment results
+    const bool binaryResult;
 
     const unsigned int maxAccept;
     const unsigned int maxReject;
@@ -105,6 +112,9 @@ private:
     // score difference to break alignment
     int zdrop;
 
+    // gapped aligner for nucleotide alignments
+    int nuclAligner;
+
     bool lcaAlign;
 
     // needed for realignment
@@ -118,10 +128,27 @@ private:
 
     DBReader<unsigned int> *prefdbr;
 
+    // fused search computes the prefilter hits in-process, prefdbr is NULL then
+    Prefiltering *prefilter;
+
     bool reversePrefilterResult;
+    bool binaryPrefilterResult;
 
     static size_t estimateHDDMemoryConsumption(int dbSize, int maxSeqs);
 
+    struct PrefilterHit {
+        unsigned int dbKey;
+        short diagonal;
+        bool isReverse;
+    };
+
+    bool isBatchable(unsigned int dbKey, unsigned int dbLen, size_t queryLen, unsigned int queryDbKey);
+
+    // scores the next batchable hits starting at hitIdx, end positions are located for scores of at least endScore
+    // returns the index after the last inspected hit
+    size_t fillScoreBatch(size_t hitIdx, const std::vector<PrefilterHit> &hits, std::vector<SmithWatermanKernel::alignment_end> &batchEnds,
+                          uint8_t endScore, Sequence &batchSeq, Matcher &matcher, unsigned int queryDbKey, size_t queryLen, int thread_idx);
+
     void computeAlternativeAlignment(unsigned int queryDbKey, Sequence &dbSeq,
                                      std::vector<Matcher::result_t> &vector, Matcher &matcher,
                                      float covThr, float evalThr, int swMode, int thread_idx);
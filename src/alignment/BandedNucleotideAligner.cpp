@@ -14,9 +14,14 @@
 #include "Debug.h"
 #include "StripedSmithWaterman.h"
 
+#include <climits>
 
-BandedNucleotideAligner::BandedNucleotideAligner(BaseMatrix * subMat, size_t maxSequenceLength, int gapo, int gape, int zdrop) :
-        fastMatrix(SubstitutionMatrix::createAsciiSubMat(*subMat))
+const int BandedNucleotideAligner::WAVEFRONT_MAX_DIVERGENCE;
+const int BandedNucleotideAligner::WAVEFRONT_MAX_PENALTY;
+const int BandedNucleotideAligner::WAVEFRONT_START_BAND;
+
+BandedNucleotideAligner::BandedNucleotideAligner(BaseMatrix * subMat, size_t maxSequenceLength, int gapo, int gape, int zdrop, int nuclAligner) :
+        fastMatrix(SubstitutionMatrix::createAsciiSubMat(*subMat)), wavefront(NULL)
 {
     targetSeqRevDataLen = maxSequenceLength;
     targetSeqRev = static_cast<uint8_t*>(malloc(targetSeqRevDataLen + 1));
@@ -35,6 +40,24 @@ BandedNucleotideAligner::BandedNucleotideAligner(BaseMatrix * subMat, size_t max
     this->gape = gape;
     this->gapo = gapo;
     this->zdrop = zdrop;
+    // a path over n query and m target residues with score S gets the wavefront penalty match * (n + m) - 2 * S
+    // a gap of length l scores -(gapo + l * gape) as in ksw2
+    // this only holds for a matrix with a single match and mismatch score, all other matrices are left to ksw2
+    const int match = subMat->subMatrix[0][0];
+    const int mismatch = -subMat->subMatrix[0][1];
+    const int unknownResidue = subMat->aa2num[static_cast<int>('X')];
+    bool isUniform = (match > 0 && mismatch > 0);
+    for (int i = 0; i < subMat->alphabetSize; i++) {
+        for (int j = 0; j < subMat->alphabetSize; j++) {
+            // N/X is a mismatch to everything, including itself
+            const int expected = (i == j && i != unknownResidue) ? match : -mismatch;
+            isUniform = isUniform && (subMat->subMatrix[i][j] == expected);
+        }
+    }
+    wavefrontMismatch = 2 * (match + mismatch);
+    if (nuclAligner == Parameters::NUCL_ALIGNER_WAVEFRONT && isUniform) {
+        wavefront = new WavefrontAligner(wavefrontMismatch, 2 * gapo, 2 * gape + match, unknownResidue);
+    }
 }
 
 BandedNucleotideAligner::~BandedNucleotideAligner(){
@@ -46,6 +69,9 @@ BandedNucleotideAligner::~BandedNucleotideAligner(){
     delete [] fastMatrix.matrixData;
     delete [] fastMatrix.matrix;
     delete [] mat;
+    if (wavefront != NULL) {
+        delete wavefront;
+    }
 }
 
 void BandedNucleotideAligner::initQuery(Sequence * query){
@@ -159,66 +185,74 @@ s_align BandedNucleotideAligner::align(Sequence * targetSeqObj,
     }
 //    printf("%d\t%d\t%d\n", alignment.score,  alignment.startPos, alignment.endPos);
 
-    // get middle position of ungapped alignment
-    int qStartRev = (querySeqObj->L  - qUngappedEndPos) - 1;
-    int tStartRev = (targetSeqObj->L - dbUngappedEndPos) - 1;
-
-    ksw_extz_t ez;
-    int flag = 0;
-    flag |= KSW_EZ_SCORE_ONLY;
-    flag |= KSW_EZ_EXTZ_ONLY;
+    uint32_t * retCigar;
+    int cigarLen;
+    int score;
+    int qStartPos, qEndPos, tStartPos, tEndPos;
+    if (wavefront == NULL || wrappedScoring
+        || alignWavefront(querySeqAlign, querySeqObj->L, targetSeq, targetSeqObj->L, dbUngappedStartPos - qUngappedStartPos,
+                          retCigar, cigarLen, score, qStartPos, qEndPos, tStartPos, tEndPos) == false) {
+        // get middle position of ungapped alignment
+        int qStartRev = (querySeqObj->L  - qUngappedEndPos) - 1;
+        int tStartRev = (targetSeqObj->L - dbUngappedEndPos) - 1;
 
-    int queryRevLenToAlign = querySeqObj->L - qStartRev;
-    if (wrappedScoring && queryRevLenToAlign > origQueryLen){
-        queryRevLenToAlign = origQueryLen;
-    }
+        ksw_extz_t ez;
+        int flag = 0;
+        flag |= KSW_EZ_SCORE_ONLY;
+        flag |= KSW_EZ_EXTZ_ONLY;
 
-    ksw_extz2_sse(0, queryRevLenToAlign, querySeqRevAlign + qStartRev, targetSeqObj->L - tStartRev, targetSeqRev + tStartRev, 5, mat, gapo, gape, 64, zdrop, flag, &ez);
+        int queryRevLenToAlign = querySeqObj->L - qStartRev;
+        if (wrappedScoring && queryRevLenToAlign > origQueryLen){
+            queryRevLenToAlign = origQueryLen;
+        }
 
-    int qStartPos = querySeqObj->L  - ( qStartRev + ez.max_q ) -1;
-    int tStartPos = targetSeqObj->L - ( tStartRev + ez.max_t ) -1;
+        ksw_extz2_sse(0, queryRevLenToAlign, querySeqRevAlign + qStartRev, targetSeqObj->L - tStartRev, targetSeqRev + tStartRev, 5, mat, gapo, gape, 64, zdrop, flag, &ez);
 
-    int alignFlag = 0;
-    alignFlag |= KSW_EZ_EXTZ_ONLY;
+        qStartPos = querySeqObj->L  - ( qStartRev + ez.max_q ) -1;
+        tStartPos = targetSeqObj->L - ( tStartRev + ez.max_t ) -1;
 
-    ksw_extz_t ezAlign;
-//    ezAlign.cigar = cigar;
-//    printf("%d %d\n", qStartPos, tStartPos);
-    memset(&ezAlign, 0, sizeof(ksw_extz_t));
+        int alignFlag = 0;
+        alignFlag |= KSW_EZ_EXTZ_ONLY;
 
-    int queryLenToAlign = querySeqObj->L-qStartPos;
-    if (wrappedScoring && queryLenToAlign > origQueryLen)
-        queryLenToAlign = origQueryLen;
-    ksw_extz2_sse(0, queryLenToAlign, querySeqAlign+qStartPos, targetSeqObj->L-tStartPos, targetSeq+tStartPos, 5,
-                  mat, gapo, gape, 64, zdrop, alignFlag, &ezAlign);
+        ksw_extz_t ezAlign;
+        memset(&ezAlign, 0, sizeof(ksw_extz_t));
 
-    std::string letterCode = "MID";
-    uint32_t * retCigar;
+        int queryLenToAlign = querySeqObj->L-qStartPos;
+        if (wrappedScoring && queryLenToAlign > origQueryLen)
+            queryLenToAlign = origQueryLen;
+        ksw_extz2_sse(0, queryLenToAlign, querySeqAlign+qStartPos, targetSeqObj->L-tStartPos, targetSeq+tStartPos, 5,
+                      mat, gapo, gape, 64, zdrop, alignFlag, &ezAlign);
 
-    if (ez.max_q > ezAlign.max_q && ez.max_t > ezAlign.max_t){
+        if (ez.max_q > ezAlign.max_q && ez.max_t > ezAlign.max_t){
 
-        ksw_extz2_sse(0, queryRevLenToAlign, querySeqRevAlign + qStartRev, targetSeqObj->L - tStartRev,
-                      targetSeqRev + tStartRev, 5, mat, gapo, gape, 64, zdrop, alignFlag, &ezAlign);
+            ksw_extz2_sse(0, queryRevLenToAlign, querySeqRevAlign + qStartRev, targetSeqObj->L - tStartRev,
+                          targetSeqRev + tStartRev, 5, mat, gapo, gape, 64, zdrop, alignFlag, &ezAlign);
 
-        retCigar = new uint32_t[ezAlign.n_cigar];
-        for(int i = 0; i < ezAlign.n_cigar; i++){
-            retCigar[i]=ezAlign.cigar[ezAlign.n_cigar-1-i];
+            retCigar = new uint32_t[ezAlign.n_cigar];
+            for(int i = 0; i < ezAlign.n_cigar; i++){
+                retCigar[i]=ezAlign.cigar[ezAlign.n_cigar-1-i];
+            }
         }
-    }
-    else {
-        retCigar = new uint32_t[ezAlign.n_cigar];
-        for(int i = 0; i < ezAlign.n_cigar; i++){
-            retCigar[i]=ezAlign.cigar[i];
+        else {
+            retCigar = new uint32_t[ezAlign.n_cigar];
+            for(int i = 0; i < ezAlign.n_cigar; i++){
+                retCigar[i]=ezAlign.cigar[i];
+            }
         }
+        cigarLen = ezAlign.n_cigar;
+        score = ezAlign.max;
+        qEndPos = qStartPos + ezAlign.max_q;
+        tEndPos = tStartPos + ezAlign.max_t;
+        free(ezAlign.cigar);
     }
 
     s_align result;
     result.cigar = retCigar;
-    result.cigarLen = ezAlign.n_cigar;
-    result.score1 = ezAlign.max;
+    result.cigarLen = cigarLen;
+    result.score1 = score;
     result.qStartPos1 = qStartPos;
-    result.qEndPos1 = qStartPos+ezAlign.max_q;
-    result.dbEndPos1 = tStartPos+ezAlign.max_t;
+    result.qEndPos1 = qEndPos;
+    result.dbEndPos1 = tEndPos;
     result.dbStartPos1 = tStartPos;
     result.qCov = SmithWaterman::computeCov(result.qStartPos1, result.qEndPos1, querySeqObj->L);
     if(wrappedScoring) {
@@ -256,8 +290,81 @@ s_align BandedNucleotideAligner::align(Sequence * targetSeqObj,
         }
     }
     result.identicalAACnt = aaIds;
-    free(ezAlign.cigar);
     return result;
 //        std::cout << static_cast<float>(aaIds)/ static_cast<float>(alignment.len) << std::endl;
 
 }
+
+bool BandedNucleotideAligner::alignWavefront(const uint8_t *querySeqAlign, int queryLen, const uint8_t *targetSeq, int targetLen,
+                                             int diagonal, uint32_t *&retCigar, int &cigarLen, int &score,
+                                             int &qStartPos, int &qEndPos, int &tStartPos, int &tEndPos) {
+    const int overlap = std::min(queryLen - std::max(-diagonal, 0), targetLen - std::max(diagonal, 0));
+    const int maxPenalty = std::min(WAVEFRONT_MAX_PENALTY, (overlap / WAVEFRONT_MAX_DIVERGENCE + 1) * wavefrontMismatch);
+    const float penaltyPerPosition = static_cast<float>(wavefrontMismatch) / WAVEFRONT_MAX_DIVERGENCE;
+    if (wavefront->align(querySeqAlign, queryLen, targetSeq, targetLen, diagonal, WAVEFRONT_START_BAND,
+                         maxPenalty, penaltyPerPosition) == false) {
+        return false;
+    }
+
+    // the wavefront path runs from sequence border to sequence border
+    // keep its best scoring segment that starts and ends with an aligned column, like the local ksw2 extension
+    const std::vector<unsigned char> &ops = wavefront->operations;
+    int qPos = wavefront->queryStart;
+    int tPos = wavefront->targetStart;
+    int prefixScore = 0;
+    int minPrefixScore = INT_MAX;
+    size_t minIdx = 0;
+    int minQPos = 0;
+    int minTPos = 0;
+    int bestScore = INT_MIN;
+    size_t bestStart = 0;
+    size_t bestEnd = 0;
+    for (size_t i = 0; i < ops.size(); i++) {
+        if (ops[i] == WavefrontAligner::OP_MATCH) {
+            if (prefixScore < minPrefixScore) {
+                minPrefixScore = prefixScore;
+                minIdx = i;
+                minQPos = qPos;
+                minTPos = tPos;
+            }
+            prefixScore += mat[querySeqAlign[qPos] * subMat->alphabetSize + targetSeq[tPos]];
+            qPos++;
+            tPos++;
+            if (prefixScore - minPrefixScore > bestScore) {
+                bestScore = prefixScore - minPrefixScore;
+                bestStart = minIdx;
+                bestEnd = i;
+                qStartPos = minQPos;
+                tStartPos = minTPos;
+                qEndPos = qPos - 1;
+                tEndPos = tPos - 1;
+            }
+        } else {
+            prefixScore -= (i > 0 && ops[i - 1] == ops[i]) ? gape : (gapo + gape);
+            if (ops[i] == WavefrontAligner::OP_INS) {
+                qPos++;
+            } else {
+                tPos++;
+            }
+        }
+    }
+    if (bestScore == INT_MIN) {
+        return false;
+    }
+
+    cigarLen = 0;
+    for (size_t i = bestStart; i <= bestEnd; i++) {
+        cigarLen += (i == bestStart || ops[i] != ops[i - 1]);
+    }
+    retCigar = new uint32_t[cigarLen];
+    int cigarIdx = -1;
+    for (size_t i = bestStart; i <= bestEnd; i++) {
+        if (i == bestStart || ops[i] != ops[i - 1]) {
+            cigarIdx++;
+            retCigar[cigarIdx] = ops[i];
+        }
+        retCigar[cigarIdx] += 1 << 4;
+    }
+    score = bestScore;
+    return true;
+}
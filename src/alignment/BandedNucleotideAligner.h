@@ -7,6 +7,7 @@
 #include <Parameters.h>
 #include <NucleotideMatrix.h>
 #include "StripedSmithWaterman.h"
+#include "WavefrontAligner.h"
 
 #include "Util.h"
 #include "SubstitutionMatrix.h"
@@ -15,9 +16,14 @@
 
 class BandedNucleotideAligner {
 public:
+    // the wavefront aligner gives up once the penalty exceeds one mismatch per WAVEFRONT_MAX_DIVERGENCE positions
+    // or WAVEFRONT_MAX_PENALTY, more divergent pairs are left to ksw2
+    static const int WAVEFRONT_MAX_DIVERGENCE = 20;
+    static const int WAVEFRONT_MAX_PENALTY = 4000;
+    static const int WAVEFRONT_START_BAND = 16;
 
-
-    BandedNucleotideAligner(BaseMatrix *subMat, size_t maxSequenceLength, int gapo, int gape, int zdrop);
+    BandedNucleotideAligner(BaseMatrix *subMat, size_t maxSequenceLength, int gapo, int gape, int zdrop,
+                            int nuclAligner = Parameters::NUCL_ALIGNER_KSW2);
 
     ~BandedNucleotideAligner();
 
@@ -27,7 +33,13 @@ public:
                   std::string & backtrace, EvalueComputation * evaluer, bool wrappedScoring=false);
 
 private:
+    // aligns along the ungapped diagonal with the wavefront aligner, returns false if ksw2 should be used instead
+    bool alignWavefront(const uint8_t *querySeqAlign, int queryLen, const uint8_t *targetSeq, int targetLen,
+                        int diagonal, uint32_t *&retCigar, int &cigarLen, int &score,
+                        int &qStartPos, int &qEndPos, int &tStartPos, int &tEndPos);
+
     SubstitutionMatrix::FastMatrix fastMatrix;
+    WavefrontAligner * wavefront;
     uint8_t * targetSeqRev;
     int targetSeqRevDataLen;
     uint8_t * querySeq;
@@ -43,4 +55,5 @@ private:
     int gapo;
     int gape;
     int zdrop;
+    int wavefrontMismatch;
 };
@@ -0,0 +1,195 @@
+#include "EvalueComputation.h"
+#include "FileUtil.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <unistd.h>
+
+// bump when the ALP settings in init change, old cache entries are ignored then
+static const int EVALUE_CACHE_VERSION = 1;
+static const size_t EVALUE_CACHE_VALUES = 12;
+
+static std::map<std::string, Sls::AlignmentEvaluerParameters> evalueCache;
+
+static void hashBytes(uint64_t &hash, const void *data, size_t length) {
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+}
+
+static std::string getCacheDirectory() {
+    const char *dir = getenv("MMSEQS_EVALUE_CACHE");
+    if (dir != NULL) {
+        return dir;
+    }
+    const char *xdgCache = getenv("XDG_CACHE_HOME");
+    if (xdgCache != NULL && xdgCache[0] != '\0') {
+        return std::string(xdgCache) + "/mmseqs";
+    }
+    const char *home = getenv("HOME");
+    if (home != NULL && home[0] != '\0') {
+        return std::string(home) + "/.cache/mmseqs";
+    }
+    return "";
+}
+
+static void toValues(const Sls::AlignmentEvaluerParameters &par, double *values) {
+    const double tmp[EVALUE_CACHE_VALUES] = {par.d_lambda, par.d_k, par.d_a1, par.d_b1, par.d_a2, par.d_b2,
+                                             par.d_alpha1, par.d_beta1, par.d_alpha2, par.d_beta2, par.d_sigma, par.d_tau};
+    memcpy(values, tmp, sizeof(tmp));
+}
+
+static Sls::AlignmentEvaluerParameters fromValues(const double *values) {
+    Sls::AlignmentEvaluerParameters par = {values[0], values[1], values[2], values[3], values[4], values[5],
+                                           values[6], values[7], values[8], values[9], values[10], values[11]};
+    return par;
+}
+
+static std::string formatEntry(const std::string &key, const Sls::AlignmentEvaluerParameters &par) {
+    double values[EVALUE_CACHE_VALUES];
+    toValues(par, values);
+    std::string line = key;
+    char buffer[32];
+    for (size_t i = 0; i < EVALUE_CACHE_VALUES; ++i) {
+        snprintf(buffer, sizeof(buffer), "\t%.17g", values[i]);
+        line.append(buffer);
+    }
+    line.push_back('\n');
+    return line;
+}
+
+// parses one entry line, returns the position after it or NULL if the line is malformed
+static const char *parseEntry(const char *data, const char *end, std::string &key, Sls::AlignmentEvaluerParameters &par) {
+    const char *keyEnd = data;
+    while (keyEnd < end && *keyEnd != '\t' && *keyEnd != '\n') {
+        keyEnd++;
+    }
+    if (keyEnd == data || keyEnd == end || *keyEnd != '\t') {
+        return NULL;
+    }
+    key.assign(data, keyEnd - data);
+    const std::string line(keyEnd, std::find(keyEnd, end, '\n'));
+    const char *pos = line.c_str();
+    double values[EVALUE_CACHE_VALUES];
+    for (size_t i = 0; i < EVALUE_CACHE_VALUES; ++i) {
+        char *next;
+        values[i] = strtod(pos, &next);
+        if (next == pos) {
+            return NULL;
+        }
+        pos = next;
+    }
+    par = fromValues(values);
+    const char *lineEnd = keyEnd + line.size();
+    return (lineEnd < end) ? lineEnd + 1 : end;
+}
+
+std::string EvalueComputation::getCacheKey(BaseMatrix *subMat, int gapOpen, int gapExtend, bool isGapped) {
+    uint64_t hash = 14695981039346656037ULL;
+    const int settings[] = {EVALUE_CACHE_VERSION, subMat->alphabetSize, gapOpen, gapExtend, isGapped};
+    hashBytes(hash, settings, sizeof(settings));
+    for (int i = 0; i < subMat->alphabetSize; ++i) {
+        hashBytes(hash, subMat->subMatrix[i], sizeof(short) * subMat->alphabetSize);
+    }
+    hashBytes(hash, subMat->pBack, sizeof(double) * subMat->alphabetSize);
+    char buffer[17];
+    snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(hash));
+    return buffer;
+}
+
+bool EvalueComputation::lookupCache(const std::string &key, Sls::AlignmentEvaluerParameters &par) {
+    bool found = false;
+#pragma omp critical(evalueCache)
+    {
+        std::map<std::string, Sls::AlignmentEvaluerParameters>::const_iterator it = evalueCache.find(key);
+        if (it != evalueCache.end()) {
+            par = it->second;
+            found = true;
+        }
+    }
+    if (found) {
+        return true;
+    }
+
+    const std::string dir = getCacheDirectory();
+    if (dir.empty()) {
+        return false;
+    }
+    const std::string fileName = dir + "/" + key + ".alp";
+    FILE *file = fopen(fileName.c_str(), "r");
+    if (file == NULL) {
+        return false;
+    }
+    char buffer[1024];
+    size_t length = fread(buffer, 1, sizeof(buffer), file);
+    fclose(file);
+    std::string fileKey;
+    if (parseEntry(buffer, buffer + length, fileKey, par) == NULL || fileKey != key) {
+        Debug(Debug::WARNING) << "Ignoring invalid E-value cache entry " << fileName << "\n";
+        return false;
+    }
+#pragma omp critical(evalueCache)
+    evalueCache[key] = par;
+    return true;
+}
+
+void EvalueComputation::storeCache(const std::string &key, const Sls::ALP_set_of_parameters &alp) {
+    const Sls::AlignmentEvaluerParameters par = {alp.lambda, alp.K, alp.a_J, alp.b_J, alp.a_I, alp.b_I,
+                                                 alp.alpha_J, alp.beta_J, alp.alpha_I, alp.beta_I, alp.sigma, alp.tau};
+#pragma omp critical(evalueCache)
+    evalueCache[key] = par;
+
+    const std::string dir = getCacheDirectory();
+    if (dir.empty()) {
+        return;
+    }
+    // create missing parent directories, e.g. ~/.cache
+    for (size_t pos = dir.find('/', 1); pos != std::string::npos; pos = dir.find('/', pos + 1)) {
+        FileUtil::makeDir(dir.substr(0, pos).c_str());
+    }
+    FileUtil::makeDir(dir.c_str());
+
+    // write to a private file and rename it, so concurrent processes never read partial entries
+    const std::string fileName = dir + "/" + key + ".alp";
+    const std::string tmpName = fileName + ".tmp" + SSTR(getpid());
+    FILE *file = fopen(tmpName.c_str(), "w");
+    if (file == NULL) {
+        Debug(Debug::INFO) << "Cannot write E-value cache entry " << fileName << "\n";
+        return;
+    }
+    const std::string entry = formatEntry(key, par);
+    const bool written = fwrite(entry.c_str(), 1, entry.size(), file) == entry.size();
+    if (fclose(file) != 0 || written == false || rename(tmpName.c_str(), fileName.c_str()) != 0) {
+        Debug(Debug::INFO) << "Cannot write E-value cache entry " << fileName << "\n";
+        unlink(tmpName.c_str());
+    }
+}
+
+std::string EvalueComputation::getCacheEntry(BaseMatrix *subMat, int gapOpen, int gapExtend, bool isGapped) {
+    const std::string key = getCacheKey(subMat, gapOpen, gapExtend, isGapped);
+    Sls::AlignmentEvaluerParameters par;
+    if (lookupCache(key, par) == false) {
+        return "";
+    }
+    return formatEntry(key, par);
+}
+
+void EvalueComputation::addCacheEntries(const char *data, size_t length) {
+    const char *end = data + length;
+    while (data < end && *data != '\0') {
+        std::string key;
+        Sls::AlignmentEvaluerParameters par;
+        data = parseEntry(data, end, key, par);
+        if (data == NULL) {
+            Debug(Debug::WARNING) << "Ignoring invalid E-value parameters\n";
+            return;
+        }
+#pragma omp critical(evalueCache)
+        evalueCache[key] = par;
+    }
+}
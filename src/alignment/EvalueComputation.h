@@ -44,15 +44,25 @@ public:
         return log(eval);
     }
 
-private:
-    void init(BaseMatrix * subMat, int gapOpen, int gapExtend, bool isGapped) {
-        const double lambdaTolerance = 0.01;
-        const double kTolerance = 0.05;
-        const double maxMegabytes = 500;
-        const long randomSeed = 42; // we all know why 42
-        const double maxSeconds = 60.0;
-        Sls::AlignmentEvaluerParameters *par = NULL;
+    // ALP results are cached in memory and in the directory given by MMSEQS_EVALUE_CACHE
+    // (default $XDG_CACHE_HOME/mmseqs or ~/.cache/mmseqs, an empty value disables the disk cache)
+    // cache entries are keyed by a hash of the matrix, background frequencies and gap costs
+    static std::string getCacheKey(BaseMatrix *subMat, int gapOpen, int gapExtend, bool isGapped);
 
+    // one "key<TAB>parameters" line or an empty string if the scoring uses built-in parameters or was never computed
+    static std::string getCacheEntry(BaseMatrix *subMat, int gapOpen, int gapExtend, bool isGapped);
+
+    // adds entries from getCacheEntry (e.g. stored in a createindex index) to the in-memory cache
+    static void addCacheEntries(const char *data, size_t length);
+
+    // true if the scoring uses built-in parameters and does not need ALP
+    static bool hasDefaultParameters(BaseMatrix *subMat, int gapOpen, int gapExtend, bool isGapped) {
+        return getDefaultParameters(subMat, gapOpen, gapExtend, isGapped) != NULL;
+    }
+
+private:
+    // built-in parameters for the default scoring or NULL
+    static const Sls::AlignmentEvaluerParameters *getDefaultParameters(BaseMatrix *subMat, int gapOpen, int gapExtend, bool isGapped) {
         const static EvalueParameters defaultParameter[] = {
                 {"nucleotide.out", 7, 1, true, {1.0960171987681839, 0.33538787507026158,
                                                        2.0290734315292083, -0.46514786408422282,
@@ -75,18 +85,35 @@ private:
                                                        4.5269915477182944841,  0}}
         };
 
-
-
         for (size_t i = 0; i < ARRAY_SIZE(defaultParameter); i++) {
             if(defaultParameter[i].matrixName == subMat->getMatrixName()){
                 if ((fabs(defaultParameter[i].gapOpen - ((double) gapOpen)) < 0.1) &&
                     (fabs(defaultParameter[i].gapExtend - ((double) gapExtend)) < 0.1)&&
                     defaultParameter[i].isGapped == isGapped) {
-                    par = (Sls::AlignmentEvaluerParameters*) &(defaultParameter[i].par);
-                    break;
+                    return &(defaultParameter[i].par);
                 }
             }
         }
+        return NULL;
+    }
+
+    void init(BaseMatrix * subMat, int gapOpen, int gapExtend, bool isGapped) {
+        const double lambdaTolerance = 0.01;
+        const double kTolerance = 0.05;
+        const double maxMegabytes = 500;
+        const long randomSeed = 42; // we all know why 42
+        const double maxSeconds = 60.0;
+        Sls::AlignmentEvaluerParameters *par = (Sls::AlignmentEvaluerParameters*) getDefaultParameters(subMat, gapOpen, gapExtend, isGapped);
+
+        // ALP takes up to a minute, reuse results of earlier runs with the same scoring
+        std::string cacheKey;
+        Sls::AlignmentEvaluerParameters cached;
+        if (par == NULL) {
+            cacheKey = getCacheKey(subMat, gapOpen, gapExtend, isGapped);
+            if (lookupCache(cacheKey, cached)) {
+                par = &cached;
+            }
+        }
 
         if(par!=NULL){
             evaluer.initParameters(*par);
@@ -144,6 +171,9 @@ private:
             delete [] tmpMatData;
             delete [] tmpMat;
 
+            if (evaluer.isGood()) {
+                storeCache(cacheKey, evaluer.parameters());
+            }
         }
         if(evaluer.isGood()==false){
             Debug(Debug::ERROR) << "ALP did not converge for the substitution matrix, gap open, gap extend input.\n"
@@ -153,6 +183,9 @@ private:
         logK = log(evaluer.parameters().K);
     }
 
+    static bool lookupCache(const std::string &key, Sls::AlignmentEvaluerParameters &par);
+    static void storeCache(const std::string &key, const Sls::ALP_set_of_parameters &par);
+
     Sls::AlignmentEvaluer evaluer;
     const size_t dbResCount;
     double logK;
@@ -7,12 +7,12 @@
 
 
 Matcher::Matcher(int querySeqType, int targetSeqType, int maxSeqLen, BaseMatrix *m, EvalueComputation * evaluer,
-                 bool aaBiasCorrection, float aaBiasCorrectionScale, int gapOpen, int gapExtend, float correlationScoreWeight, int zdrop)
+                 bool aaBiasCorrection, float aaBiasCorrectionScale, int gapOpen, int gapExtend, float correlationScoreWeight, int zdrop, int nuclAligner)
                  : gapOpen(gapOpen), gapExtend(gapExtend), correlationScoreWeight(correlationScoreWeight), m(m), evaluer(evaluer), tinySubMat(NULL)  {
     setSubstitutionMatrix(m);
 
     if (Parameters::isEqualDbtype(querySeqType, Parameters::DBTYPE_NUCLEOTIDES)) {
-        nuclaligner = new BandedNucleotideAligner(m, maxSeqLen, gapOpen, gapExtend, zdrop);
+        nuclaligner = new BandedNucleotideAligner(m, maxSeqLen, gapOpen, gapExtend, zdrop, nuclAligner);
         aligner = NULL;
     } else {
         nuclaligner = NULL;
@@ -58,7 +58,7 @@ void Matcher::initQuery(Sequence* query){
 
 Matcher::result_t Matcher::getSWResult(Sequence* dbSeq, const int diagonal, bool isReverse, const int covMode, const float covThr,
                                        const double evalThr, unsigned int alignmentMode, unsigned int seqIdMode, bool isIdentity,
-                                       bool wrappedScoring){
+                                       bool wrappedScoring, const SmithWatermanKernel::alignment_end *forwardEnd){
 
     // calculation of the score and traceback of the alignment
     int32_t maskLen = currentQuery->L / 2;
@@ -79,7 +79,7 @@ Matcher::result_t Matcher::getSWResult(Sequence* dbSeq, const int diagonal, bool
             alignment = aligner->ssw_align(dbSeq->numSequence, dbSeq->numConsensusSequence,
                                            dbSeq->getAlignmentProfile(), dbSeq->L, backtrace,
                                            gapOpen, gapExtend, alignmentMode, evalThr, evaluer, covMode,
-                                           covThr, correlationScoreWeight, maskLen, dbSeq->getId());
+                                           covThr, correlationScoreWeight, maskLen, dbSeq->getId(), forwardEnd);
         } else {
             alignment = aligner->scoreIdentical(dbSeq->numSequence, dbSeq->L, evaluer, alignmentMode, backtrace);
         }
@@ -152,6 +152,164 @@ void Matcher::readAlignmentResults(std::vector<result_t> &result, char *data, bo
     }
 }
 
+void Matcher::readAlignmentResults(std::vector<result_t> &result, char *data, size_t entryLength, bool isBinary, bool readCompressed) {
+    if (isBinary == false) {
+        readAlignmentResults(result, data, readCompressed);
+        return;
+    }
+    if (data == NULL) {
+        return;
+    }
+    const unsigned int count = getBinaryResultCount(data, entryLength);
+    const result_bin_t *records = getBinaryResults(data);
+    const char *arena = getBinaryBacktraceArena(data, count);
+    result.reserve(result.size() + count);
+    for (unsigned int i = 0; i < count; ++i) {
+        result.emplace_back(binaryRecordToResult(records[i], arena, readCompressed));
+    }
+}
+
+Matcher::result_t Matcher::binaryRecordToResult(const result_bin_t &record, const char *arena, bool readCompressed) {
+    const int adjustQstart = (record.qStartPos == -1) ? 0 : record.qStartPos;
+    const int adjustDBstart = (record.dbStartPos == -1) ? 0 : record.dbStartPos;
+    const float qCov = SmithWaterman::computeCov(adjustQstart, record.qEndPos, record.qLen);
+    const float dbCov = SmithWaterman::computeCov(adjustDBstart, record.dbEndPos, record.dbLen);
+    const unsigned int alnLength = Matcher::computeAlnLength(adjustQstart, record.qEndPos, adjustDBstart, record.dbEndPos);
+    result_t res(record.dbKey, record.score, qCov, dbCov, record.seqId, record.eval,
+                 alnLength, record.qStartPos, record.qEndPos, record.qLen,
+                 record.dbStartPos, record.dbEndPos, record.dbLen,
+                 record.queryOrfStartPos, record.queryOrfEndPos, record.dbOrfStartPos, record.dbOrfEndPos,
+                 std::string());
+    // the backtrace is the only part that needs an allocation
+    if (record.backtraceLength > 0) {
+        res.backtrace.assign(arena + record.backtraceOffset, record.backtraceLength);
+        if (readCompressed == false) {
+            res.backtrace = uncompressAlignment(res.backtrace);
+        }
+    }
+    return res;
+}
+
+size_t Matcher::binaryRecordToBuffer(char *buff1, const result_bin_t &record, const char *arena) {
+    char *basePos = buff1;
+    char *tmpBuff = Itoa::u32toa_sse2((uint32_t) record.dbKey, buff1);
+    *(tmpBuff-1) = '\t';
+    tmpBuff = Itoa::i32toa_sse2(record.score, tmpBuff);
+    *(tmpBuff-1) = '\t';
+    tmpBuff = Util::fastSeqIdToBuffer(record.seqId, tmpBuff);
+    *(tmpBuff-1) = '\t';
+    tmpBuff += snprintf(tmpBuff, 32, "%.3E", record.eval);
+    tmpBuff++;
+    *(tmpBuff-1) = '\t';
+    tmpBuff = Itoa::i32toa_sse2(record.qStartPos, tmpBuff);
+    *(tmpBuff-1) = '\t';
+    tmpBuff = Itoa::i32toa_sse2(record.qEndPos, tmpBuff);
+    *(tmpBuff-1) = '\t';
+    tmpBuff = Itoa::i32toa_sse2(record.qLen, tmpBuff);
+    *(tmpBuff-1) = '\t';
+    tmpBuff = Itoa::i32toa_sse2(record.dbStartPos, tmpBuff);
+    *(tmpBuff-1) = '\t';
+    tmpBuff = Itoa::i32toa_sse2(record.dbEndPos, tmpBuff);
+    *(tmpBuff-1) = '\t';
+    tmpBuff = Itoa::i32toa_sse2(record.dbLen, tmpBuff);
+    if (record.queryOrfStartPos != -1 || record.dbOrfStartPos != -1) {
+        *(tmpBuff-1) = '\t';
+        tmpBuff = Itoa::i32toa_sse2(record.queryOrfStartPos, tmpBuff);
+        *(tmpBuff-1) = '\t';
+        tmpBuff = Itoa::i32toa_sse2(record.queryOrfEndPos, tmpBuff);
+        *(tmpBuff-1) = '\t';
+        tmpBuff = Itoa::i32toa_sse2(record.dbOrfStartPos, tmpBuff);
+        *(tmpBuff-1) = '\t';
+        tmpBuff = Itoa::i32toa_sse2(record.dbOrfEndPos, tmpBuff);
+    }
+    if (record.backtraceLength > 0) {
+        *(tmpBuff-1) = '\t';
+        memcpy(tmpBuff, arena + record.backtraceOffset, record.backtraceLength);
+        tmpBuff += record.backtraceLength + 1;
+    }
+    *(tmpBuff-1) = '\n';
+    *(tmpBuff) = '\0';
+    return tmpBuff - basePos;
+}
+
+void Matcher::appendBinaryRecords(const char *data, size_t entryLength, std::string &records, std::string &arena) {
+    const unsigned int count = getBinaryResultCount(data, entryLength);
+    const result_bin_t *entryRecords = getBinaryResults(data);
+    const char *entryArena = getBinaryBacktraceArena(data, count);
+    for (unsigned int i = 0; i < count; ++i) {
+        appendBinaryRecord(entryRecords[i], entryArena + entryRecords[i].backtraceOffset, records, arena);
+    }
+}
+
+void Matcher::appendBinaryRecord(const result_bin_t &record, const char *backtrace, std::string &records, std::string &arena) {
+    result_bin_t copy;
+    memcpy(&copy, &record, sizeof(result_bin_t));
+    copy.backtraceOffset = static_cast<unsigned int>(arena.size());
+    arena.append(backtrace, record.backtraceLength);
+    records.append(reinterpret_cast<const char *>(&copy), sizeof(result_bin_t));
+}
+
+void Matcher::binaryRecordsToBuffer(std::string &out, const std::string &records, const std::string &arena) {
+    if (records.empty()) {
+        return;
+    }
+    const unsigned int count = static_cast<unsigned int>(records.size() / sizeof(result_bin_t));
+    out.append(reinterpret_cast<const char *>(&count), sizeof(unsigned int));
+    out.append(records);
+    out.append(arena);
+}
+
+void Matcher::resultsToBinaryBuffer(std::string &out, const std::vector<result_t> &results, bool addBacktrace, bool compress) {
+    if (results.empty()) {
+        return;
+    }
+    const unsigned int count = static_cast<unsigned int>(results.size());
+    out.append(reinterpret_cast<const char *>(&count), sizeof(unsigned int));
+    const size_t recordStart = out.size();
+    const size_t arenaStart = recordStart + results.size() * sizeof(result_bin_t);
+    out.resize(arenaStart);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const result_t &res = results[i];
+        result_bin_t record;
+        record.dbKey = res.dbKey;
+        record.score = res.score;
+        record.seqId = res.seqId;
+        record.eval = res.eval;
+        record.qStartPos = res.qStartPos;
+        record.qEndPos = res.qEndPos;
+        record.qLen = res.qLen;
+        record.dbStartPos = res.dbStartPos;
+        record.dbEndPos = res.dbEndPos;
+        record.dbLen = res.dbLen;
+        record.queryOrfStartPos = res.queryOrfStartPos;
+        record.queryOrfEndPos = res.queryOrfEndPos;
+        record.dbOrfStartPos = res.dbOrfStartPos;
+        record.dbOrfEndPos = res.dbOrfEndPos;
+        record.backtraceOffset = static_cast<unsigned int>(out.size() - arenaStart);
+        record.backtraceLength = 0;
+        if (addBacktrace && res.backtrace.empty() == false) {
+            if (compress) {
+                out.append(compressAlignment(res.backtrace));
+            } else {
+                out.append(res.backtrace);
+            }
+            record.backtraceLength = static_cast<unsigned int>(out.size() - arenaStart - record.backtraceOffset);
+        }
+        memcpy(&out[recordStart + i * sizeof(result_bin_t)], &record, sizeof(result_bin_t));
+    }
+}
+
+void Matcher::binaryResultsToText(const char *data, size_t entryLength, std::string &out) {
+    char buffer[1024 + 32768*4];
+    const unsigned int count = getBinaryResultCount(data, entryLength);
+    const result_bin_t *records = getBinaryResults(data);
+    const char *arena = getBinaryBacktraceArena(data, count);
+    for (unsigned int i = 0; i < count; ++i) {
+        size_t len = binaryRecordToBuffer(buffer, records[i], arena);
+        out.append(buffer, len);
+    }
+}
+
 int Matcher::computeAlnLength(int qStart, int qEnd, int dbStart, int dbEnd) {
     return std::max(abs(qEnd - qStart), abs(dbEnd - dbStart)) + 1;
 }
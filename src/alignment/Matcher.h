@@ -142,16 +142,41 @@ public:
         }
     };
 
+    // fixed-width record of DBTYPE_ALIGNMENT_BIN_RES entries
+    // an entry is laid out as: unsigned int count, count result_bin_t records, backtrace arena
+    // coverages and alignment length are recomputed from the positions, as for text records
+    struct __attribute__((__packed__)) result_bin_t {
+        unsigned int dbKey;
+        int score;
+        float seqId;
+        double eval;
+        int qStartPos;
+        int qEndPos;
+        unsigned int qLen;
+        int dbStartPos;
+        int dbEndPos;
+        unsigned int dbLen;
+        int queryOrfStartPos;
+        int queryOrfEndPos;
+        int dbOrfStartPos;
+        int dbOrfEndPos;
+        // backtrace as it would appear in the text column, relative to the start of the arena
+        unsigned int backtraceOffset;
+        unsigned int backtraceLength;
+    };
+
     Matcher(int querySeqType, int targetSeqType, int maxSeqLen, BaseMatrix *m,
             EvalueComputation * evaluer, bool aaBiasCorrection, float aaBiasCorrectionScale,
             int gapOpen, int gapExtend, float correlationScoreWeight,
-            int zdrop);
+            int zdrop, int nuclAligner = Parameters::NUCL_ALIGNER_KSW2);
 
     ~Matcher();
 
     // run SSE2 parallelized Smith-Waterman alignment calculation and traceback
+    // forwardEnd is the score and end position of a protein alignment if it is already known (see scoreBatch)
     result_t getSWResult(Sequence* dbSeq, const int diagonal, bool isReverse, const int covMode, const float covThr, const double evalThr,
-                         unsigned int alignmentMode, unsigned int seqIdMode, bool isIdentical, bool wrappedScoring=false);
+                         unsigned int alignmentMode, unsigned int seqIdMode, bool isIdentical, bool wrappedScoring=false,
+                         const SmithWatermanKernel::alignment_end *forwardEnd=NULL);
 
     // need for sorting the results
     static bool compareHits(const result_t &first, const result_t &second) {
@@ -205,6 +230,41 @@ public:
     // map new query into memory (create queryProfile, ...)
     void initQuery(Sequence* query);
 
+    // score short amino acid targets of the current query in batches (see SmithWaterman::ssw_batch_score)
+    bool canScoreBatch() {
+        return aligner != NULL && aligner->ssw_batch_supported();
+    }
+
+    size_t getBatchSize() {
+        return aligner->getBatchSize();
+    }
+
+    void clearBatch() {
+        aligner->ssw_batch_clear();
+    }
+
+    void addToBatch(const Sequence *dbSeq) {
+        aligner->ssw_batch_add(dbSeq->numSequence, dbSeq->L);
+    }
+
+    void scoreBatch(SmithWatermanKernel::alignment_end *ends, uint8_t endScore) {
+        aligner->ssw_batch_score(gapOpen, gapExtend, endScore, ends);
+    }
+
+    // e-value of a raw score as computed by getSWResult
+    double computeEvalue(int score) {
+        return evaluer->computeEvalue(score, currentQuery->L);
+    }
+
+    // lowest byte score of the current query that passes evalThr (UCHAR_MAX if none)
+    int minPassingScore(double evalThr) {
+        int score = 1;
+        while (score < UCHAR_MAX && computeEvalue(score) > evalThr) {
+            score++;
+        }
+        return score;
+    }
+
     static result_t parseAlignmentRecord(const char *data, bool readCompressed=false);
 
     static void readAlignmentResults(std::vector<result_t> &result, char *data, bool readCompressed = false);
@@ -218,6 +278,50 @@ public:
 
     static size_t resultToBuffer(char * buffer, const result_t &result, bool addBacktrace, bool compress  = true, bool addOrfPosition = false);
 
+    static bool isBinaryAlignmentResult(int dbtype) {
+        return Parameters::isEqualDbtype(dbtype, Parameters::DBTYPE_ALIGNMENT_BIN_RES);
+    }
+
+    // appends a complete binary entry, nothing is appended for an empty result list
+    static void resultsToBinaryBuffer(std::string &out, const std::vector<result_t> &results, bool addBacktrace, bool compress = true);
+
+    // entryLength includes the terminating null byte as returned by DBReader::getEntryLen
+    // (the uncompressed length for compressed databases), empty entries have no count
+    static unsigned int getBinaryResultCount(const char *data, size_t entryLength) {
+        if (entryLength <= sizeof(unsigned int)) {
+            return 0;
+        }
+        unsigned int count;
+        memcpy(&count, data, sizeof(unsigned int));
+        return count;
+    }
+
+    static const result_bin_t *getBinaryResults(const char *data) {
+        return reinterpret_cast<const result_bin_t *>(data + sizeof(unsigned int));
+    }
+
+    static const char *getBinaryBacktraceArena(const char *data, unsigned int count) {
+        return data + sizeof(unsigned int) + static_cast<size_t>(count) * sizeof(result_bin_t);
+    }
+
+    // only use where a result_t is needed, most readers can work on the records and the arena directly
+    static result_t binaryRecordToResult(const result_bin_t &record, const char *arena, bool readCompressed = false);
+
+    // formats a record as text line with the backtrace as stored, like resultToBuffer
+    static size_t binaryRecordToBuffer(char *buffer, const result_bin_t &record, const char *arena);
+
+    // collects records and their backtraces of several entries without converting them to result_t
+    static void appendBinaryRecords(const char *data, size_t entryLength, std::string &records, std::string &arena);
+    static void appendBinaryRecord(const result_bin_t &record, const char *backtrace, std::string &records, std::string &arena);
+
+    // appends a complete binary entry from collected records, nothing is appended for no records
+    static void binaryRecordsToBuffer(std::string &out, const std::string &records, const std::string &arena);
+
+    // reads text or binary alignment entries
+    static void readAlignmentResults(std::vector<result_t> &result, char *data, size_t entryLength, bool isBinary, bool readCompressed = false);
+
+    static void binaryResultsToText(const char *data, size_t entryLength, std::string &out);
+
     static int computeAlnLength(int anEnd, int start, int dbEnd, int dbStart);
 
     static void updateResultByRescoringBacktrace(const char *querySeq, const char *targetSeq, const char **subMat, EvalueComputation &evaluer,
@@ -25,7 +25,7 @@
 */
 #include "Parameters.h"
 #include "StripedSmithWaterman.h"
-#include "UngappedAlignment.h"
+#include "SimdDispatch.h"
 
 #include "Util.h"
 #include "SubstitutionMatrix.h"
@@ -38,15 +38,16 @@ SmithWaterman::SmithWaterman(size_t maxSequenceLength, int aaSize, bool aaBiasCo
     this->aaBiasCorrectionScale = aaBiasCorrectionScale;
 	this->aaBiasCorrection = aaBiasCorrection;
 
+	kernel = SmithWatermanKernel::get();
 	int segmentSize = (maxSequenceLength+7)/8;
     segSize = segmentSize;
-	vHStore = (simd_int*) mem_align(ALIGN_INT, segSize * sizeof(simd_int));
-	vHLoad  = (simd_int*) mem_align(ALIGN_INT, segSize * sizeof(simd_int));
-	vE      = (simd_int*) mem_align(ALIGN_INT, segSize * sizeof(simd_int));
-	vHmax   = (simd_int*) mem_align(ALIGN_INT, segSize * sizeof(simd_int));
+	vHStore = (simd_int*) mem_align(kernel->vectorBytes, segSize * kernel->vectorBytes);
+	vHLoad  = (simd_int*) mem_align(kernel->vectorBytes, segSize * kernel->vectorBytes);
+	vE      = (simd_int*) mem_align(kernel->vectorBytes, segSize * kernel->vectorBytes);
+	vHmax   = (simd_int*) mem_align(kernel->vectorBytes, segSize * kernel->vectorBytes);
 
 	// setting up target
-	target_profile_byte = (simd_int*) mem_align(ALIGN_INT, aaSize * segSize * sizeof(simd_int));
+	target_profile_byte = (simd_int*) mem_align(kernel->vectorBytes, aaSize * segSize * kernel->vectorBytes);
 
 
     isTargetProfile = Parameters::isEqualDbtype(targetSeqType, Parameters::DBTYPE_HMM_PROFILE);
@@ -55,23 +56,23 @@ SmithWaterman::SmithWaterman(size_t maxSequenceLength, int aaSize, bool aaBiasCo
     // setting up query
 	profile = new s_profile();
 	// query profile
-	profile->profile_byte = (simd_int*)mem_align(ALIGN_INT, aaSize * segSize * sizeof(simd_int));
-	profile->profile_word = (simd_int*)mem_align(ALIGN_INT, aaSize * segSize * sizeof(simd_int));
-    profile->profile_rev_byte = (simd_int*)mem_align(ALIGN_INT, aaSize * segSize * sizeof(simd_int));
-    profile->profile_rev_word = (simd_int*)mem_align(ALIGN_INT, aaSize * segSize * sizeof(simd_int));
+	profile->profile_byte = (simd_int*)mem_align(kernel->vectorBytes, aaSize * segSize * kernel->vectorBytes);
+	profile->profile_word = (simd_int*)mem_align(kernel->vectorBytes, aaSize * segSize * kernel->vectorBytes);
+    profile->profile_rev_byte = (simd_int*)mem_align(kernel->vectorBytes, aaSize * segSize * kernel->vectorBytes);
+    profile->profile_rev_word = (simd_int*)mem_align(kernel->vectorBytes, aaSize * segSize * kernel->vectorBytes);
 #ifdef GAP_POS_SCORING
-    profile->profile_gDelOpen_byte = (simd_int*)mem_align(ALIGN_INT, segSize * sizeof(simd_int));
-    profile->profile_gDelOpen_word = (simd_int*)mem_align(ALIGN_INT, segSize * sizeof(simd_int));
-    profile->profile_gDelClose_byte = (simd_int*)mem_align(ALIGN_INT, segSize * sizeof(simd_int));
-    profile->profile_gDelClose_word = (simd_int*)mem_align(ALIGN_INT, segSize * sizeof(simd_int));
-    profile->profile_gIns_byte = (simd_int*)mem_align(ALIGN_INT, segSize * sizeof(simd_int));
-    profile->profile_gIns_word = (simd_int*)mem_align(ALIGN_INT, segSize * sizeof(simd_int));
-    profile->profile_gDelOpen_rev_byte = (simd_int*)mem_align(ALIGN_INT, segSize * sizeof(simd_int));
-    profile->profile_gDelOpen_rev_word = (simd_int*)mem_align(ALIGN_INT, segSize * sizeof(simd_int));
-    profile->profile_gDelClose_rev_byte = (simd_int*)mem_align(ALIGN_INT, segSize * sizeof(simd_int));
-    profile->profile_gDelClose_rev_word = (simd_int*)mem_align(ALIGN_INT, segSize * sizeof(simd_int));
-    profile->profile_gIns_rev_byte = (simd_int*)mem_align(ALIGN_INT, segSize * sizeof(simd_int));
-    profile->profile_gIns_rev_word = (simd_int*)mem_align(ALIGN_INT, segSize * sizeof(simd_int));
+    profile->profile_gDelOpen_byte = (simd_int*)mem_align(kernel->vectorBytes, segSize * kernel->vectorBytes);
+    profile->profile_gDelOpen_word = (simd_int*)mem_align(kernel->vectorBytes, segSize * kernel->vectorBytes);
+    profile->profile_gDelClose_byte = (simd_int*)mem_align(kernel->vectorBytes, segSize * kernel->vectorBytes);
+    profile->profile_gDelClose_word = (simd_int*)mem_align(kernel->vectorBytes, segSize * kernel->vectorBytes);
+    profile->profile_gIns_byte = (simd_int*)mem_align(kernel->vectorBytes, segSize * kernel->vectorBytes);
+    profile->profile_gIns_word = (simd_int*)mem_align(kernel->vectorBytes, segSize * kernel->vectorBytes);
+    profile->profile_gDelOpen_rev_byte = (simd_int*)mem_align(kernel->vectorBytes, segSize * kernel->vectorBytes);
+    profile->profile_gDelOpen_rev_word = (simd_int*)mem_align(kernel->vectorBytes, segSize * kernel->vectorBytes);
+    profile->profile_gDelClose_rev_byte = (simd_int*)mem_align(kernel->vectorBytes, segSize * kernel->vectorBytes);
+    profile->profile_gDelClose_rev_word = (simd_int*)mem_align(kernel->vectorBytes, segSize * kernel->vectorBytes);
+    profile->profile_gIns_rev_byte = (simd_int*)mem_align(kernel->vectorBytes, segSize * kernel->vectorBytes);
+    profile->profile_gIns_rev_word = (simd_int*)mem_align(kernel->vectorBytes, segSize * kernel->vectorBytes);
     profile->gDelOpen = new uint8_t[maxSequenceLength];
     profile->gDelClose = new uint8_t[maxSequenceLength];
     profile->gDelOpen_rev = new uint8_t[maxSequenceLength];
@@ -79,10 +80,10 @@ SmithWaterman::SmithWaterman(size_t maxSequenceLength, int aaSize, bool aaBiasCo
     profile->gIns_rev = new uint8_t[maxSequenceLength];
 #endif
     // query consensus profile
-	profile->consens_byte = (simd_int*)mem_align(ALIGN_INT, segSize * sizeof(simd_int));
-	profile->consens_word = (simd_int*)mem_align(ALIGN_INT, segSize * sizeof(simd_int));
-	profile->consens_rev_byte = (simd_int*)mem_align(ALIGN_INT, segSize * sizeof(simd_int));
-    profile->consens_rev_word = (simd_int*)mem_align(ALIGN_INT, segSize * sizeof(simd_int));
+	profile->consens_byte = (simd_int*)mem_align(kernel->vectorBytes, segSize * kernel->vectorBytes);
+	profile->consens_word = (simd_int*)mem_align(kernel->vectorBytes, segSize * kernel->vectorBytes);
+	profile->consens_rev_byte = (simd_int*)mem_align(kernel->vectorBytes, segSize * kernel->vectorBytes);
+    profile->consens_rev_word = (simd_int*)mem_align(kernel->vectorBytes, segSize * kernel->vectorBytes);
     // query sequence
     profile->query_sequence     = new int8_t[maxSequenceLength];
 	profile->query_rev_sequence = new int8_t[maxSequenceLength];
@@ -99,6 +100,19 @@ SmithWaterman::SmithWaterman(size_t maxSequenceLength, int aaSize, bool aaBiasCo
     /* array to record the largest score of each reference position */
 	maxColumn = new uint8_t[maxSequenceLength*sizeof(uint16_t)];
 	memset(maxColumn, 0, maxSequenceLength*sizeof(uint16_t));
+	buffers.vHStore = vHStore;
+	buffers.vHLoad = vHLoad;
+	buffers.vE = vE;
+	buffers.vHmax = vHmax;
+	buffers.maxColumn = maxColumn;
+	this->maxSequenceLength = maxSequenceLength;
+	batchQueryTable = NULL;
+	batchQueryTableValid = false;
+	batchH = NULL;
+	batchF = NULL;
+	batchTargets = NULL;
+	batchCount = 0;
+	batchLength = 0;
 	memset(profile->query_sequence, 0, maxSequenceLength * sizeof(int8_t));
 	memset(profile->query_rev_sequence, 0, maxSequenceLength * sizeof(int8_t));
     memset(profile->query_consens_sequence, 0, maxSequenceLength * sizeof(int8_t));
@@ -154,14 +168,19 @@ SmithWaterman::~SmithWaterman(){
 	delete [] tmp_composition_bias;
 	delete [] scorePerCol;
 	delete [] maxColumn;
+	free(batchQueryTable);
+	free(batchH);
+	free(batchF);
+	free(batchTargets);
 	delete profile;
 }
 
 
 /* Generate query profile rearrange query sequence & calculate the weight of match/mismatch. */
-template <typename T, size_t Elements, const unsigned int type>
+template <typename T, const unsigned int type>
 void SmithWaterman::createQueryProfile(simd_int *profile, const int8_t *query_sequence, const int8_t * composition_bias, const int8_t *mat,
         const int32_t query_length, const int32_t aaSize, uint8_t bias, const int32_t offset, const int32_t entryLength) {
+	const size_t Elements = kernel->vectorBytes / sizeof(T);
 	const int32_t segLen = (query_length + Elements - 1) / Elements;
 	T* t = (T*) profile;
     for (int32_t nt = 0; LIKELY(nt < aaSize); nt++) {
@@ -186,8 +205,9 @@ void SmithWaterman::createQueryProfile(simd_int *profile, const int8_t *query_se
 	}
 }
 
-template <typename T, size_t Elements>
+template <typename T>
 void SmithWaterman::createConsensProfile(simd_int *profile, const int8_t *consens_sequence, const int32_t query_length, const int32_t offset) {
+    const size_t Elements = kernel->vectorBytes / sizeof(T);
     const int32_t segLen = (query_length + Elements - 1) / Elements;
     T* t = (T*) profile;
     for (int32_t i = 0; i < segLen; i++) {
@@ -214,9 +234,10 @@ void SmithWaterman::createTargetProfile(simd_int *profile, const int8_t *mat, co
         }
     }
 }
-template <typename T, size_t Elements>
+template <typename T>
 void SmithWaterman::updateQueryProfile(simd_int *profile, const int32_t query_length, const int32_t aaSize,
         uint8_t shift) {
+    const size_t Elements = kernel->vectorBytes / sizeof(T);
     const int32_t segLen = (query_length + Elements - 1) / Elements;
     T* t = (T*) profile;
     for (uint32_t i = 0; i < segLen * Elements * aaSize; i++) {
@@ -255,10 +276,10 @@ void SmithWaterman::reverseMat(int8_t *mat_rev, const int8_t *mat, const int32_t
 }
 
 #ifdef GAP_POS_SCORING
-template <typename T, size_t Elements>
+template <typename T>
 void createGapProfile(simd_int* profile_gDelOpen, simd_int* profile_gDelClose, simd_int* profile_gIns,
                       const uint8_t* gDelOpen, const uint8_t* gDelClose, const uint8_t* gIns,
-                      const int32_t query_length, const int32_t offset) {
+                      const int32_t query_length, const int32_t offset, const size_t Elements) {
     const int32_t segLen = (query_length - offset + Elements - 1) / Elements;
     T* delOpen = (T*) profile_gDelOpen;
     T* delClose = (T*) profile_gDelClose;
@@ -287,21 +308,21 @@ s_align SmithWaterman::ssw_align (
         const double  evalueThr,
         EvalueComputation * evaluer,
         const int covMode, const float covThr, const float correlationScoreWeight,
-        const int32_t maskLen, const size_t id) {
+        const int32_t maskLen, const size_t id, const alignment_end *forwardEnd) {
     s_align alignment;
     // check if both query and target are profiles
     if (isQueryProfile && isTargetProfile) {
         alignment = ssw_align_private<SmithWaterman::PROFILE_PROFILE, true>(db_consens_sequence, db_mat, db_length, backtrace, gap_open,
-                                                                       gap_extend, alignmentMode, evalueThr, evaluer, covMode, covThr, correlationScoreWeight, maskLen, id);
+                                                                       gap_extend, alignmentMode, evalueThr, evaluer, covMode, covThr, correlationScoreWeight, maskLen, id, forwardEnd);
     } else if (isQueryProfile && !isTargetProfile) {
         alignment = ssw_align_private<SmithWaterman::PROFILE_SEQ, true>(db_num_sequence, db_mat, db_length, backtrace, gap_open,
-                                                                  gap_extend, alignmentMode, evalueThr, evaluer, covMode, covThr, correlationScoreWeight, maskLen, id);
+                                                                  gap_extend, alignmentMode, evalueThr, evaluer, covMode, covThr, correlationScoreWeight, maskLen, id, forwardEnd);
     } else if (!isQueryProfile && isTargetProfile) {
         alignment = ssw_align_private<SmithWaterman::SEQ_PROFILE, false>(db_num_sequence, db_mat, db_length, backtrace, gap_open,
-                                                                  gap_extend, alignmentMode, evalueThr, evaluer, covMode, covThr, correlationScoreWeight, maskLen, id);
+                                                                  gap_extend, alignmentMode, evalueThr, evaluer, covMode, covThr, correlationScoreWeight, maskLen, id, forwardEnd);
     } else {
         alignment = ssw_align_private<SmithWaterman::SEQ_SEQ, false>(db_num_sequence, db_mat, db_length, backtrace, gap_open,
-                                                              gap_extend, alignmentMode, evalueThr, evaluer, covMode, covThr, correlationScoreWeight, maskLen, id);
+                                                              gap_extend, alignmentMode, evalueThr, evaluer, covMode, covThr, correlationScoreWeight, maskLen, id, forwardEnd);
     }
     return alignment;
 }
@@ -318,7 +339,7 @@ s_align SmithWaterman::ssw_align_private (
 		const double  evalueThr,
 		EvalueComputation * evaluer,
 		const int covMode, const float covThr, const float correlationScoreWeight,
-		const int32_t maskLen, const size_t id) {
+		const int32_t maskLen, const size_t id, const alignment_end *forwardEnd) {
 
     target_id = id;
 	int32_t word = 0, query_length = profile->query_length;
@@ -330,8 +351,8 @@ s_align SmithWaterman::ssw_align_private (
 	r.cigar = 0;
 	r.cigarLen = 0;
 
-    std::pair<alignment_end, alignment_end> bests;
-    std::pair<alignment_end, alignment_end> bests_reverse;
+    alignment_end bests[2];
+    alignment_end bests_reverse[2];
 
     simd_int* db_profile_byte = target_profile_byte;
 
@@ -341,42 +362,51 @@ s_align SmithWaterman::ssw_align_private (
     const int8_t *db_matrix = db_mat;
 
     // find the alignment position
-    if (profile->profile_byte) {
+    if (forwardEnd != NULL) {
+        // computed by the byte kernel without overflow
+        bests[0] = *forwardEnd;
+        bests[1].score = 0;
+        bests[1].ref = -1;
+    } else if (profile->profile_byte) {
         if (type == PROFILE_PROFILE) {
             uint8_t db_bias = computeBias(db_length, db_mat, profile->alphabetSize);
             if (db_bias > profile->bias) {
                 uint8_t shift = abs(profile->bias - db_bias);
-                updateQueryProfile<int8_t, VECSIZE_INT * 4>(profile->profile_byte, profile->query_length, profile->alphabetSize, shift);
+                updateQueryProfile<int8_t>(profile->profile_byte, profile->query_length, profile->alphabetSize, shift);
             }
             profile->bias = std::max(db_bias, profile->bias);
             createTargetProfile(db_profile_byte, db_mat, db_length, profile->alphabetSize - 1, profile->bias);
         }
-        bests = sw_sse2_byte<type,posSpecificGaps>(db_sequence, db_profile_byte, 0, db_length, query_length, gap_open, gap_extend,
+        kernel->swByte(type == PROFILE_PROFILE, posSpecificGaps, buffers, db_sequence, db_profile_byte, 0, db_length, query_length, gap_open, gap_extend,
                 profile->profile_byte, profile->consens_byte,
 #ifdef GAP_POS_SCORING
 				profile->profile_gDelOpen_byte, profile->profile_gDelClose_byte, profile->profile_gIns_byte,
+#else
+				NULL, NULL, NULL,
 #endif
-				UCHAR_MAX, profile->bias, maskLen);
-        if (bests.first.score == 255) {
-            bests = sw_sse2_word<type,posSpecificGaps>(db_sequence, db_profile_byte, 0, db_length, query_length, gap_open, gap_extend,
+				UCHAR_MAX, profile->bias, maskLen, bests);
+        if (bests[0].score == 255) {
+            kernel->swWord(type == PROFILE_PROFILE, posSpecificGaps, buffers, db_sequence, db_profile_byte, 0, db_length, query_length, gap_open, gap_extend,
                     profile->profile_word, profile->consens_word,
 #ifdef GAP_POS_SCORING
 					profile->profile_gDelOpen_word, profile->profile_gDelClose_word, profile->profile_gIns_word,
+#else
+					NULL, NULL, NULL,
 #endif
-					USHRT_MAX, profile->bias, maskLen);
+					USHRT_MAX, profile->bias, maskLen, bests);
             word = 1;
         }
     } else {
         fprintf(stderr, "Please call the function ssw_init before ssw_align.\n");
         EXIT(EXIT_FAILURE);
     }
-	r.score1 = bests.first.score;
-	r.dbEndPos1 = bests.first.ref;
-	r.qEndPos1 = bests.first.read;
+	r.score1 = bests[0].score;
+	r.dbEndPos1 = bests[0].ref;
+	r.qEndPos1 = bests[0].read;
 
 	if (maskLen >= 15) {
-		r.score2 = bests.second.score;
-		r.ref_end2 = bests.second.ref;
+		r.score2 = bests[1].score;
+		r.ref_end2 = bests[1].ref;
 	} else {
 		r.score2 = 0;
 		r.ref_end2 = -1;
@@ -399,81 +429,85 @@ s_align SmithWaterman::ssw_align_private (
 
 	if (word == 0) {
 	    if (type == PROFILE_SEQ || type == PROFILE_PROFILE) {
-	        createQueryProfile<int8_t, VECSIZE_INT * 4, PROFILE>(profile->profile_rev_byte, profile->query_rev_sequence, NULL, profile->mat_rev,
+	        createQueryProfile<int8_t, PROFILE>(profile->profile_rev_byte, profile->query_rev_sequence, NULL, profile->mat_rev,
                                                                      r.qEndPos1 + 1, profile->alphabetSize, profile->bias, queryOffset, profile->query_length);
 #ifdef GAP_POS_SCORING
 			if (posSpecificGaps) {
-				createGapProfile<int8_t, VECSIZE_INT * 4>(profile->profile_gDelOpen_rev_byte, profile->profile_gDelClose_rev_byte, profile->profile_gIns_rev_byte,
-														profile->gDelOpen_rev, profile->gDelClose_rev, profile->gIns_rev, profile->query_length, queryOffset);
+				createGapProfile<int8_t>(profile->profile_gDelOpen_rev_byte, profile->profile_gDelClose_rev_byte, profile->profile_gIns_rev_byte,
+														profile->gDelOpen_rev, profile->gDelClose_rev, profile->gIns_rev, profile->query_length, queryOffset, kernel->vectorBytes);
 			}
 #endif
 	        if (type == PROFILE_PROFILE) {
-                createConsensProfile<int8_t, VECSIZE_INT * 4>(profile->consens_rev_byte, profile->query_consens_rev_sequence,
+                createConsensProfile<int8_t>(profile->consens_rev_byte, profile->query_consens_rev_sequence,
                                                               r.qEndPos1 + 1, queryOffset);
 	        }
 	    } else {
-            createQueryProfile<int8_t, VECSIZE_INT * 4, SUBSTITUTIONMATRIX>(profile->profile_rev_byte,
+            createQueryProfile<int8_t, SUBSTITUTIONMATRIX>(profile->profile_rev_byte,
                                                                             profile->query_rev_sequence,
                                                                             profile->composition_bias_rev,
                                                                             profile->mat,r.qEndPos1 + 1,
                                                                             profile->alphabetSize, profile->bias,
                                                                             queryOffset, 0);
 	    }
-        bests_reverse = sw_sse2_byte<type,posSpecificGaps>(db_sequence, db_profile_byte, 1, r.dbEndPos1 + 1, r.qEndPos1 + 1, gap_open,
+        kernel->swByte(type == PROFILE_PROFILE, posSpecificGaps, buffers, db_sequence, db_profile_byte, 1, r.dbEndPos1 + 1, r.qEndPos1 + 1, gap_open,
                                            gap_extend, profile->profile_rev_byte, profile->consens_rev_byte,
 #ifdef GAP_POS_SCORING
                                            profile->profile_gDelOpen_rev_byte, profile->profile_gDelClose_rev_byte, profile->profile_gIns_rev_byte,
+#else
+                                           NULL, NULL, NULL,
 #endif
-										   r.score1, profile->bias, maskLen);
+										   r.score1, profile->bias, maskLen, bests_reverse);
 	} else {
         if (type == PROFILE_SEQ || type == PROFILE_PROFILE) {
-            createQueryProfile<int16_t, VECSIZE_INT * 2, PROFILE>(profile->profile_rev_word,
+            createQueryProfile<int16_t, PROFILE>(profile->profile_rev_word,
                                                                   profile->query_rev_sequence, NULL, profile->mat_rev,
                                                                   r.qEndPos1 + 1, profile->alphabetSize, 0, queryOffset,
                                                                   profile->query_length);
 #ifdef GAP_POS_SCORING
 			if (posSpecificGaps) {
-				createGapProfile<int16_t, VECSIZE_INT * 2>(profile->profile_gDelOpen_rev_word,
+				createGapProfile<int16_t>(profile->profile_gDelOpen_rev_word,
 														profile->profile_gDelClose_rev_word,
 														profile->profile_gIns_rev_word, profile->gDelOpen_rev,
 														profile->gDelClose_rev, profile->gIns_rev,
-														profile->query_length, queryOffset);
+														profile->query_length, queryOffset, kernel->vectorBytes / 2);
 			}
 #endif
             if (type == PROFILE_PROFILE) {
-                createConsensProfile<int16_t, VECSIZE_INT * 2>(profile->consens_rev_word,
+                createConsensProfile<int16_t>(profile->consens_rev_word,
                                                                profile->query_consens_rev_sequence,
                                                                r.qEndPos1 + 1, queryOffset);
             }
         } else {
-            createQueryProfile<int16_t, VECSIZE_INT * 2, SUBSTITUTIONMATRIX>(profile->profile_rev_word,
+            createQueryProfile<int16_t, SUBSTITUTIONMATRIX>(profile->profile_rev_word,
                                                                              profile->query_rev_sequence,
                                                                              profile->composition_bias_rev,
                                                                              profile->mat,
                                                                              r.qEndPos1 + 1, profile->alphabetSize, 0,
                                                                              queryOffset, 0);
         }
-        bests_reverse = sw_sse2_word<type,posSpecificGaps>(db_sequence, db_profile_byte, 1, r.dbEndPos1 + 1, r.qEndPos1 + 1, gap_open,
+        kernel->swWord(type == PROFILE_PROFILE, posSpecificGaps, buffers, db_sequence, db_profile_byte, 1, r.dbEndPos1 + 1, r.qEndPos1 + 1, gap_open,
                                            gap_extend,
                                            profile->profile_rev_word, profile->consens_rev_word,
 #ifdef GAP_POS_SCORING
                                            profile->profile_gDelOpen_rev_word, profile->profile_gDelClose_rev_word, profile->profile_gIns_rev_word,
+#else
+                                           NULL, NULL, NULL,
 #endif
-										   r.score1, profile->bias, maskLen);
+										   r.score1, profile->bias, maskLen, bests_reverse);
     }
 
 
-	if(bests_reverse.first.score != r.score1){
-        fprintf(stderr, "Score of forward/backward SW differ: %d %d. Q: %lu T: %lu.\n", r.score1, bests_reverse.first.score, query_id, target_id);
-        fprintf(stderr, "Start: Q: %d, T: %d. End: Q: %d, T %d\n", r.qEndPos1 - bests_reverse.first.read, bests_reverse.first.ref, r.qEndPos1, r.dbEndPos1);
+	if(bests_reverse[0].score != r.score1){
+        fprintf(stderr, "Score of forward/backward SW differ: %d %d. Q: %lu T: %lu.\n", r.score1, bests_reverse[0].score, query_id, target_id);
+        fprintf(stderr, "Start: Q: %d, T: %d. End: Q: %d, T %d\n", r.qEndPos1 - bests_reverse[0].read, bests_reverse[0].ref, r.qEndPos1, r.dbEndPos1);
         //  if qry is not a profile, just exit
         if (!(type == PROFILE_SEQ) || !(type == PROFILE_PROFILE)) {
             EXIT(EXIT_FAILURE);
         }
 	}
 
-	r.dbStartPos1 = bests_reverse.first.ref;
-	r.qStartPos1 = r.qEndPos1 - bests_reverse.first.read;
+	r.dbStartPos1 = bests_reverse[0].ref;
+	r.qStartPos1 = r.qEndPos1 - bests_reverse[0].read;
 
     if (r.dbStartPos1 == -1) {
         fprintf(stderr, "Target start position is -1. This should not happen.\n");
@@ -634,607 +668,13 @@ int SmithWaterman::computeCorrelationScore(int8_t * scorePreCol, size_t length){
     return (corrScore1+corrScore2+corrScore3+corrScore4);
 }
 
-
-template <const unsigned int type, const bool posSpecificGaps>
-std::pair<SmithWaterman::alignment_end, SmithWaterman::alignment_end> SmithWaterman::sw_sse2_byte (
-														   const unsigned char *db_sequence,
-														   const simd_int* db_profile_byte,
-														   int8_t ref_dir,	// 0: forward ref; 1: reverse ref
-														   int32_t db_length,
-														   int32_t query_length,
-														   const uint8_t gap_open, /* will be used as - */
-														   const uint8_t gap_extend, /* will be used as - */
-														   const simd_int* query_profile_byte, /* profile_byte loaded in ssw_init */
-														   const simd_int* query_consens_byte, /* profile_consens_byte loaded in ssw_init */
-#ifdef GAP_POS_SCORING
-                                                           const simd_int *gap_open_del,
-                                                           const simd_int *gap_close_del,
-                                                           const simd_int *gap_open_ins,
-#endif
-														   uint8_t terminate,	/* the best alignment score: used to terminate
-                                                         the matrix calculation when locating the
-                                                         alignment beginning point. If this score
-                                                         is set to 0, it will not be used */
-														   uint8_t bias,  /* Shift 0 point to a positive value. */
-														   int32_t maskLen) {
-#define max16(m, vm) ((m) = simdi8_hmax((vm)));
-
-	uint8_t max = 0;		                     /* the max alignment score */
-	int32_t end_query = query_length - 1;
-	int32_t end_db = -1; /* 0_based best alignment ending point; Initialized as isn't aligned -1. */
-	const int SIMD_SIZE = VECSIZE_INT * 4;
-	int32_t segLen = (query_length + SIMD_SIZE-1) / SIMD_SIZE; /* number of segment */
-	/* array to record the largest score of each reference position */
-	memset(this->maxColumn, 0, db_length * sizeof(uint8_t));
-	uint8_t * maxColumn = (uint8_t *) this->maxColumn;
-
-	/* Define 16 byte 0 vector. */
-	simd_int vZero = simdi32_set(0);
-	simd_int* pvHStore = vHStore;
-	simd_int* pvHLoad = vHLoad;
-	simd_int* pvE = vE;
-	simd_int* pvHmax = vHmax;
-
-    memset(pvHStore,0,segLen*sizeof(simd_int));
-	memset(pvHLoad,0,segLen*sizeof(simd_int));
-	memset(pvE,0,segLen*sizeof(simd_int));
-	memset(pvHmax,0,segLen*sizeof(simd_int));
-
-	int32_t i, j;
-    /* 16 byte insertion begin vector */
-	simd_int vGapO = simdi8_set(gap_open);
-
-    /* 16 byte insertion extension vector */
-	simd_int vGapE = simdi8_set(gap_extend);
-
-	/* 16 byte bias vector */
-	simd_int vBias = simdi8_set(bias);
-
-	simd_int vMaxScore = vZero; /* Trace the highest score of the whole SW matrix. */
-	simd_int vMaxMark = vZero; /* Trace the highest score till the previous column. */
-	simd_int vTemp;
-	int32_t edge, begin = 0, end = db_length, step = 1;
-
-    //fprintf(stderr, "start alignment of length %d [%u]\n", query_length, segLen * SIMD_SIZE);
-
-	/* outer loop to process the reference sequence */
-	if (ref_dir == 1) {
-		begin = db_length - 1;
-		end = -1;
-		step = -1;
-	}
-
-#ifndef AVX2
-    const simd_int sixten  = simdi8_set(16);
-    const simd_int fiveten = simdi8_set(15);
-#endif
-
-    // store the query consensus profile
-    const simd_int* vQueryCons = query_consens_byte;
-	for (i = begin; LIKELY(i != end); i += step) {
-//	    cnt = i;
-		simd_int e, vF = vZero, vMaxColumn = vZero; /* Initialize F value to 0.
-                                                    Any errors to vH values will be corrected in the Lazy_F loop.
-                                                    */
-
-		simd_int vH = pvHStore[segLen - 1];
-		vH = simdi8_shiftl (vH, 1); /* Shift the 128-bit value in vH left by 1 byte. */
-		const simd_int* vP = query_profile_byte + db_sequence[i] * segLen; /* Right part of the query_profile_byte */
-
-#ifdef AVX2
-        simd_int target_scores1 = simdi8_set(0);
-        if (type == PROFILE_PROFILE) {
-            target_scores1 = simdi_load(&db_profile_byte[i]);
-        }
-#else
-        simd_int target_scores1 = simdi8_set(0);
-        simd_int target_scores2 = simdi8_set(0);
-        if (type == PROFILE_PROFILE) {
-            target_scores1 = simdi_load(&db_profile_byte[i]);
-            target_scores2 = simdi_load(&db_profile_byte[i + 16]);
-        }
-#endif
-
-		/* Swap the 2 H buffers. */
-		simd_int* pv = pvHLoad;
-		pvHLoad = pvHStore;
-		pvHStore = pv;
-
-		/* inner loop to process the query sequence */
-		for (j = 0; LIKELY(j < segLen); ++j) {
-		    simd_int score = simdi8_set(0);
-		    if (type == PROFILE_PROFILE) {
-#ifdef AVX2
-                __m256i scoreLookup = UngappedAlignment::Shuffle(target_scores1, simdi_load(vQueryCons + j));
-#else
-		        const __m128i vQueryConsJ = _mm_load_si128(vQueryCons + j);
-                __m128i score01 = _mm_shuffle_epi8(target_scores1, vQueryConsJ);
-                __m128i score16 = _mm_shuffle_epi8(target_scores2, vQueryConsJ);
-                __m128i lookup_mask01 = _mm_cmplt_epi8(vQueryConsJ, sixten);
-                __m128i lookup_mask16 = _mm_cmplt_epi8(fiveten, vQueryConsJ);
-                score01 = _mm_and_si128(lookup_mask01, score01);
-                score16 = _mm_and_si128(lookup_mask16, score16);
-                __m128i scoreLookup = _mm_add_epi8(score01, score16);
-#endif
-                //score = simdui8_max(scoreLookup, simdi_load(vP + j));
-                score = simdui8_avg(scoreLookup, simdi_load(vP + j));
-		    } else {
-		        score = simdi_load(vP + j);
-		    }
-
-
-            vH = simdui8_adds(vH, score);
-            vH = simdui8_subs(vH, vBias);   /* vH will be always > 0 */
-
-            /* Get max from vH, vE and vF. */
-			e = simdi_load(pvE + j);
-            vH = simdui8_max(vH, e);
-#ifdef GAP_POS_SCORING
-            if (posSpecificGaps) {
-                vH = simdui8_max(vH, simdui8_subs(vF, simdi_load(gap_close_del + j)));
-            } else {
-#endif
-                vH = simdui8_max(vH, vF);
-#ifdef GAP_POS_SCORING
-            }
-#endif
-			vMaxColumn = simdui8_max(vMaxColumn, vH);
-
-			/* Save vH values. */
-			simdi_store(pvHStore + j, vH);
-
-			/* Update vE value. */
-#ifdef GAP_POS_SCORING
-            if (posSpecificGaps) {
-                // copy vH for update of vF
-                vTemp = vH;
-                vH = simdui8_subs(vH, simdi_load(gap_open_ins + j)); /* saturation arithmetic, result >= 0 */
-            } else {
-#endif
-                vH = simdui8_subs(vH, vGapO); /* saturation arithmetic, result >= 0 */
-#ifdef GAP_POS_SCORING
-            }
-#endif
-
-			e = simdui8_subs(e, vGapE);
-			e = simdui8_max(e, vH);
-			simdi_store(pvE + j, e);
-
-			/* Update vF value. */
-			vF = simdui8_subs(vF, vGapE);
-#ifdef GAP_POS_SCORING
-            if (posSpecificGaps) {
-                vF = simdui8_max(vF, simdui8_subs(vTemp, simdi_load(gap_open_del + j)));
-            } else {
-#endif
-                vF = simdui8_max(vF, vH);
-#ifdef GAP_POS_SCORING
-            }
-#endif
-
-			/* Load the next vH. */
-			vH = simdi_load(pvHLoad + j);
-
-        }
-
-		/* Lazy_F loop: has been revised to disallow adjecent insertion and then deletion, so don't update E(i, j), learn from SWPS3 */
-		/* reset pointers to the start of the saved data */
-		j = 0;
-		vH = simdi_load (pvHStore + j);
-		/*  the computed vF value is for the given column.  since */
-		/*  we are at the end, we need to shift the vF value over */
-		/*  to the next column. */
-		vF = simdi8_shiftl (vF, 1);
-#ifdef GAP_POS_SCORING
-        if (posSpecificGaps) {
-            vTemp = simdui8_subs(vH, simdi_load(gap_open_del + j));
-        } else {
-#endif
-            vTemp = simdui8_subs(vH, vGapO);
-#ifdef GAP_POS_SCORING
-        }
-#endif
-		vTemp = simdui8_subs (vF, vTemp);
-		vTemp = simdi8_eq (vTemp, vZero);
-		uint32_t cmp = simdi8_movemask (vTemp);
-		while (cmp != SIMD_MOVEMASK_MAX) {
-#ifdef GAP_POS_SCORING
-            if (posSpecificGaps) {
-                vH = simdui8_max (vH, simdui8_subs(vF, simdi_load(gap_close_del + j)));
-                simdi_store(pvE + j, simdui8_max(simdi_load(pvE + j), simdui8_subs(vH, simdi_load(gap_open_ins + j))));
-            } else {
-#endif
-                vH = simdui8_max (vH, vF);
-#ifdef GAP_POS_SCORING
-            }
-#endif
-
-			vMaxColumn = simdui8_max(vMaxColumn, vH);
-			simdi_store (pvHStore + j, vH);
-
-			vF = simdui8_subs (vF, vGapE);
-			j++;
-			if (j >= segLen)
-			{
-				j = 0;
-				vF = simdi8_shiftl (vF, 1);
-			}
-			vH = simdi_load (pvHStore + j);
-
-#ifdef GAP_POS_SCORING
-            if (posSpecificGaps) {
-                vTemp = simdui8_subs(vH, simdi_load(gap_open_del + j));
-            } else {
-#endif
-                vTemp = simdui8_subs(vH, vGapO);
-#ifdef GAP_POS_SCORING
-            }
-#endif
-			vTemp = simdui8_subs (vF, vTemp);
-			vTemp = simdi8_eq (vTemp, vZero);
-			cmp  = simdi8_movemask (vTemp);
-		}
-
-		vMaxScore = simdui8_max(vMaxScore, vMaxColumn);
-		vTemp = simdi8_eq(vMaxMark, vMaxScore);
-		cmp = simdi8_movemask(vTemp);
-		if (cmp != SIMD_MOVEMASK_MAX) {
-			uint8_t temp;
-			vMaxMark = vMaxScore;
-			max16(temp, vMaxScore);
-			vMaxScore = vMaxMark;
-
-
-			if (LIKELY(temp > max)) {
-			    max = temp;
-				if (max + bias >= 255) {
-				    break;	//overflow
-				}
-				end_db = i;
-
-				/* Store the column with the highest alignment score in order to trace the alignment ending position on read. */
-				for (j = 0; LIKELY(j < segLen); ++j) pvHmax[j] = pvHStore[j];
-			}
-		}
-
-        //uint8_t *t = (uint8_t *)pvHStore;
-        //for (int ti = 0; ti < segLen * SIMD_SIZE; ++ti) {
-        //    fprintf(stderr, "%d ", t[ti / segLen + ti % segLen * SIMD_SIZE]);
-        //}
-        //fprintf(stderr, "\n");
-
-		/* Record the max score of current column. */
-		max16(maxColumn[i], vMaxColumn);
-		//		fprintf(stderr, "maxColumn[%d]: %d\n", i, maxColumn[i]);
-		if (maxColumn[i] == terminate) break;
-	}
-
-	/* Trace the alignment ending position on read. */
-	uint8_t *t = (uint8_t*)pvHmax;
-	int32_t column_len = segLen * SIMD_SIZE;
-	for (i = 0; LIKELY(i < column_len); ++i, ++t) {
-		int32_t temp;
-		if (*t == max) {
-			temp = i / SIMD_SIZE + i % SIMD_SIZE * segLen;
-			if (temp < end_query) end_query = temp;
-		}
-	}
-
-	/* Find the most possible 2nd best alignment. */
-	alignment_end best0;
-    best0.score = max + bias >= 255 ? 255 : max;
-    best0.ref = end_db;
-    best0.read = end_query;
-
-    alignment_end best1;
-    best1.score = 0;
-    best1.ref = 0;
-    best1.read = 0;
-
-	edge = (end_db - maskLen) > 0 ? (end_db - maskLen) : 0;
-	for (i = 0; i < edge; i ++) {
-		if (maxColumn[i] > best1.score) {
-            best1.score = maxColumn[i];
-            best1.ref = i;
-		}
-	}
-	edge = (end_db + maskLen) > db_length ? db_length : (end_db + maskLen);
-	for (i = edge + 1; i < db_length; i ++) {
-		if (maxColumn[i] > best1.score) {
-            best1.score = maxColumn[i];
-            best1.ref = i;
-		}
-	}
-	return std::make_pair(best0, best1);
-#undef max16
-}
-
-template <const unsigned int type, const bool posSpecificGaps>
-std::pair<SmithWaterman::alignment_end, SmithWaterman::alignment_end> SmithWaterman::sw_sse2_word (const unsigned char* db_sequence,
-														   const simd_int* db_profile_byte,
-														   int8_t ref_dir,	// 0: forward ref; 1: reverse ref
-														   int32_t db_length,
-														   int32_t query_length,
-														   const uint8_t gap_open, /* will be used as - */
-														   const uint8_t gap_extend, /* will be used as - */
-														   const simd_int* query_profile_word,
-														   const simd_int* query_consens_word,
-#ifdef GAP_POS_SCORING
-                                                           const simd_int *gap_open_del,
-                                                           const simd_int *gap_close_del,
-                                                           const simd_int *gap_open_ins,
-#endif
-														   uint16_t terminate,
-                                                           const uint16_t bias,
-                                                           int32_t maskLen) {
-
-#define max8(m, vm) ((m) = simdi16_hmax((vm)));
-
-	uint16_t max = 0;		                     /* the max alignment score */
-	int32_t end_read = query_length - 1;
-	int32_t end_ref = 0; /* 1_based best alignment ending point; Initialized as isn't aligned - 0. */
-	const unsigned int SIMD_SIZE = VECSIZE_INT * 2;
-	int32_t segLen = (query_length + SIMD_SIZE-1) / SIMD_SIZE; /* number of segment */
-	/* array to record the alignment read ending position of the largest score of each reference position */
-	memset(this->maxColumn, 0, db_length * sizeof(uint16_t));
-	uint16_t * maxColumn = (uint16_t *) this->maxColumn;
-
-	/* Define 16 byte 0 vector. */
-	simd_int vZero = simdi32_set(0);
-	simd_int* pvHStore = vHStore;
-	simd_int* pvHLoad = vHLoad;
-	simd_int* pvE = vE;
-	simd_int* pvHmax = vHmax;
-	memset(pvHStore,0,segLen*sizeof(simd_int));
-	memset(pvHLoad,0, segLen*sizeof(simd_int));
-	memset(pvE,0,     segLen*sizeof(simd_int));
-	memset(pvHmax,0,  segLen*sizeof(simd_int));
-
-	int32_t i, j, k;
-
-    /* 16 byte insertion begin vector */
-    simd_int vGapO = simdi16_set(gap_open);
-
-	/* 16 byte insertion extension vector */
-	simd_int vGapE = simdi16_set(gap_extend);
-
-	/* 16 byte bias vector */
-	simd_int vBias = simdi16_set(bias);
-	//simd_int vBias = simdi16_set(-bias);    // set as a negative value for simd use
-	simd_int vMaxScore = vZero; /* Trace the highest score of the whole SW matrix. */
-	simd_int vMaxMark = vZero; /* Trace the highest score till the previous column. */
-	simd_int vTemp;
-	int32_t edge, begin = 0, end = db_length, step = 1;
-
-    //fprintf(stderr, "start alignment of length %d [%d]\n", query_length, segLen * SIMD_SIZE);
-
-	/* outer loop to process the reference sequence */
-	if (ref_dir == 1) {
-		begin = db_length - 1;
-		end = -1;
-		step = -1;
-	}
-
-    // store the query consensus profile
-	const simd_int* vQueryCons = query_consens_word;
-
-#ifndef AVX2
-    const simd_int sixten  = simdi8_set(16);
-    const simd_int fiveten = simdi8_set(15);
-#endif
-
-	for (i = begin; LIKELY(i != end); i += step) {
-		simd_int e, vF = vZero, vMaxColumn = vZero; /* Initialize F value to 0.
-                                Any errors to vH values will be corrected in the Lazy_F loop.
-                                */
-
-		simd_int vH = pvHStore[segLen - 1];
-		vH = simdi8_shiftl (vH, 2); /* Shift the 128-bit value in vH left by 2 byte. */
-		const simd_int* vP = query_profile_word + db_sequence[i] * segLen; /* Right part of the query_profile_byte */
-
-#ifdef AVX2
-        simd_int target_scores1 = simdi16_set(0);
-        if (type == PROFILE_PROFILE) {
-            target_scores1 = simdi_load(&db_profile_byte[i]);
-        }
-#else
-        simd_int target_scores1 = simdi16_set(0);
-        simd_int target_scores2 = simdi16_set(0);
-        if (type == PROFILE_PROFILE) {
-            target_scores1 = simdi_load(&db_profile_byte[i]);
-            target_scores2 = simdi_load(&db_profile_byte[i + 16]);
-        }
-#endif
-
-        /* Swap the 2 H buffers. */
-        simd_int* pv = pvHLoad;
-		pvHLoad = pvHStore;
-		pvHStore = pv;
-
-		/* inner loop to process the query sequence */
-		for (j = 0; LIKELY(j < segLen); j ++) {
-		    simd_int score = simdi16_set(0);
-		    if (type == PROFILE_PROFILE) {
-#ifdef AVX2
-                __m256i scoreLookup = UngappedAlignment::Shuffle(target_scores1, simdi_load(vQueryCons + j));
-#else
-                const __m128i vQueryConsJ = _mm_load_si128(vQueryCons + j);
-                __m128i score01 = _mm_shuffle_epi8(target_scores1, vQueryConsJ);
-                __m128i score16 = _mm_shuffle_epi8(target_scores2, vQueryConsJ);
-                __m128i lookup_mask01 = _mm_cmplt_epi8(vQueryConsJ, sixten);
-                __m128i lookup_mask16 = _mm_cmplt_epi8(fiveten, vQueryConsJ);
-                score01 = _mm_and_si128(lookup_mask01, score01);
-                score16 = _mm_and_si128(lookup_mask16, score16);
-                __m128i scoreLookup = _mm_add_epi8(score01, score16);
-#endif
-                scoreLookup = simdi_and(scoreLookup, simdi16_set(0x00FF));
-                score = simdui16_avg(scoreLookup, simdi16_add(simdi_load(vP + j), vBias));
-				score = simdi16_sub(score, vBias);
-				//scoreLookup = simdi16_add(scoreLookup, vBias);
-                //score = simdi16_max(scoreLookup, simdi_load(vP + j));
-		    } else {
-		        score = simdi_load(vP + j);
-		    }
-
-			vH = simdi16_adds(vH, score);
-
-			/* Get max from vH, vE and vF. */
-			e = simdi_load(pvE + j);
-            vH = simdi16_max(vH, e);
-#ifdef GAP_POS_SCORING
-            if (posSpecificGaps) {
-                vH = simdi16_max(vH, simdui16_subs(vF, simdi_load(gap_close_del + j)));
-            } else {
-#endif
-                vH = simdi16_max(vH, vF);
-#ifdef GAP_POS_SCORING
-            }
-#endif
-
-			vMaxColumn = simdi16_max(vMaxColumn, vH);
-
-			/* Save vH values. */
-			simdi_store(pvHStore + j, vH);
-
-			/* Update vE value. */
-#ifdef GAP_POS_SCORING
-            if (posSpecificGaps) {
-                // copy vH for update of vF
-                vTemp = vH;
-                vH = simdui16_subs(vH, simdi_load(gap_open_ins + j)); /* saturation arithmetic, result >= 0 */
-            } else {
-#endif
-                vH = simdui16_subs(vH, vGapO); /* saturation arithmetic, result >= 0 */
-#ifdef GAP_POS_SCORING
-            }
-#endif
-			e = simdui16_subs(e, vGapE);
-			e = simdi16_max(e, vH);
-			simdi_store(pvE + j, e);
-
-			/* Update vF value. */
-			vF = simdui16_subs(vF, vGapE);
-#ifdef GAP_POS_SCORING
-            if (posSpecificGaps) {
-                vF = simdi16_max(vF, simdui16_subs(vTemp, simdi_load(gap_open_del + j)));
-            } else {
-#endif
-                vF = simdi16_max(vF, vH);
-#ifdef GAP_POS_SCORING
-            }
-#endif
-
-			/* Load the next vH. */
-			vH = simdi_load(pvHLoad + j);
-		}
-
-		/* Lazy_F loop: has been revised to disallow adjecent insertion and then deletion, so don't update E(i, j), learn from SWPS3 */
-		for (k = 0; LIKELY(k < (int32_t) SIMD_SIZE); ++k) {
-			vF = simdi8_shiftl (vF, 2);
-			for (j = 0; LIKELY(j < segLen); ++j) {
-				vH = simdi_load(pvHStore + j);
-#ifdef GAP_POS_SCORING
-                if (posSpecificGaps) {
-                    vH = simdi16_max(vH, simdui16_subs(vF, simdi_load(gap_close_del + j)));
-                    simdi_store(pvE + j, simdi16_max(simdi_load(pvE + j), simdui16_subs(vH, simdi_load(gap_open_ins + j))));
-                } else {
-#endif
-                    vH = simdi16_max(vH, vF);
-#ifdef GAP_POS_SCORING
-                }
-#endif
-
-				vMaxColumn = simdi16_max(vMaxColumn, vH); //newly added line
-				simdi_store(pvHStore + j, vH);
-#ifdef GAP_POS_SCORING
-                if (posSpecificGaps) {
-                    vH = simdui16_subs(vH, simdi_load(gap_open_del + j));
-                } else {
-#endif
-                    vH = simdui16_subs(vH, vGapO);
-#ifdef GAP_POS_SCORING
-                }
-#endif
-				vF = simdui16_subs(vF, vGapE);
-				if (UNLIKELY(! simdi8_movemask(simdi16_gt(vF, vH)))) goto end;
-			}
-		}
-
-		end:
-		vMaxScore = simdi16_max(vMaxScore, vMaxColumn);
-		vTemp = simdi16_eq(vMaxMark, vMaxScore);
-		uint32_t cmp = simdi8_movemask(vTemp);
-		if (cmp != SIMD_MOVEMASK_MAX) {
-			uint16_t temp;
-			vMaxMark = vMaxScore;
-			max8(temp, vMaxScore);
-			vMaxScore = vMaxMark;
-
-			if (LIKELY(temp > max)) {
-				max = temp;
-				end_ref = i;
-				for (j = 0; LIKELY(j < segLen); ++j) pvHmax[j] = pvHStore[j];
-			}
-		}
-
-        //uint16_t *t = (uint16_t *)pvHStore;
-        //for (size_t ti = 0; ti < segLen * SIMD_SIZE; ++ti) {
-        //    fprintf(stderr, "%d ", t[ti / segLen + ti % segLen * SIMD_SIZE]);
-        //}
-        //fprintf(stderr, "\n");
-
-		/* Record the max score of current column. */
-		max8(maxColumn[i], vMaxColumn);
-		if (maxColumn[i] == terminate) break;
-	}
-
-	/* Trace the alignment ending position on read. */
-	uint16_t *t = (uint16_t*)pvHmax;
-	int32_t column_len = segLen * SIMD_SIZE;
-	for (i = 0; LIKELY(i < column_len); ++i, ++t) {
-		int32_t temp;
-		if (*t == max) {
-			temp = i / SIMD_SIZE + i % SIMD_SIZE * segLen;
-			if (temp < end_read) end_read = temp;
-		}
-	}
-
-	/* Find the most possible 2nd best alignment. */
-	alignment_end best0;
-    best0.score = max;
-    best0.ref = end_ref;
-    best0.read = end_read;
-
-    alignment_end best1;
-    best1.score = 0;
-    best1.ref = 0;
-    best1.read = 0;
-
-	edge = (end_ref - maskLen) > 0 ? (end_ref - maskLen) : 0;
-	for (i = 0; i < edge; i ++) {
-		if (maxColumn[i] > best1.score) {
-            best1.score = maxColumn[i];
-            best1.ref = i;
-		}
-	}
-	edge = (end_ref + maskLen) > db_length ? db_length : (end_ref + maskLen);
-	for (i = edge; i < db_length; i ++) {
-		if (maxColumn[i] > best1.score) {
-            best1.score = maxColumn[i];
-            best1.ref = i;
-		}
-	}
-
-	return std::make_pair(best0, best1);
-#undef max8
-}
-
 void SmithWaterman::ssw_init(const Sequence* q,
 							 const int8_t* mat,
 							 const BaseMatrix *m) {
 
     query_id = q->getId();
 	profile->bias = 0;
+	batchQueryTableValid = false;
     profile->query_length = q->L;
 	profile->sequence_type = q->getSequenceType();
 	isQueryProfile = (Parameters::isEqualDbtype(profile->sequence_type, Parameters::DBTYPE_HMM_PROFILE));
@@ -1305,20 +745,20 @@ void SmithWaterman::ssw_init(const Sequence* q,
     if (isProfile) {
         // offset = 1 when createQueryProfile + createConsensProfile is old versions
         // create byte version of profiles
-        createQueryProfile<int8_t, VECSIZE_INT * 4, PROFILE>(profile->profile_byte, profile->query_sequence, NULL,
+        createQueryProfile<int8_t, PROFILE>(profile->profile_byte, profile->query_sequence, NULL,
                                                              profile->mat, q->L, alphabetSize, profile->bias, 0, q->L);
-        createConsensProfile<int8_t, VECSIZE_INT * 4>(profile->consens_byte, profile->query_consens_sequence, q->L, 0);
+        createConsensProfile<int8_t>(profile->consens_byte, profile->query_consens_sequence, q->L, 0);
 #ifdef GAP_POS_SCORING
-        createGapProfile<int8_t, VECSIZE_INT * 4>(profile->profile_gDelOpen_byte, profile->profile_gDelClose_byte,
-                                                  profile->profile_gIns_byte, profile->gDelOpen, profile->gDelClose, q->gIns, q->L, 0);
+        createGapProfile<int8_t>(profile->profile_gDelOpen_byte, profile->profile_gDelClose_byte,
+                                                  profile->profile_gIns_byte, profile->gDelOpen, profile->gDelClose, q->gIns, q->L, 0, kernel->vectorBytes);
 #endif
         // create word version of profiles
-        createQueryProfile<int16_t, VECSIZE_INT * 2, PROFILE>(profile->profile_word, profile->query_sequence, NULL,
+        createQueryProfile<int16_t, PROFILE>(profile->profile_word, profile->query_sequence, NULL,
                                                               profile->mat, q->L, alphabetSize, 0, 0, q->L);
-        createConsensProfile<int16_t, VECSIZE_INT * 2>(profile->consens_word, profile->query_consens_sequence, q->L, 0);
+        createConsensProfile<int16_t>(profile->consens_word, profile->query_consens_sequence, q->L, 0);
 #ifdef GAP_POS_SCORING
-        createGapProfile<int16_t, VECSIZE_INT * 2>(profile->profile_gDelOpen_word, profile->profile_gDelClose_word, profile->profile_gIns_word,
-                                                   profile->gDelOpen, profile->gDelClose, q->gIns, q->L, 0);
+        createGapProfile<int16_t>(profile->profile_gDelOpen_word, profile->profile_gDelClose_word, profile->profile_gIns_word,
+                                                   profile->gDelOpen, profile->gDelClose, q->gIns, q->L, 0, kernel->vectorBytes / 2);
 #endif
         // create linear version of word profile
         for (int32_t i = 0; i< alphabetSize; i++) {
@@ -1329,9 +769,9 @@ void SmithWaterman::ssw_init(const Sequence* q,
         }
     } else {
         // create byte version of query profile
-        createQueryProfile<int8_t, VECSIZE_INT * 4, SUBSTITUTIONMATRIX>(profile->profile_byte, profile->query_sequence, profile->composition_bias, profile->mat, q->L, alphabetSize, bias, 0, 0);
+        createQueryProfile<int8_t, SUBSTITUTIONMATRIX>(profile->profile_byte, profile->query_sequence, profile->composition_bias, profile->mat, q->L, alphabetSize, bias, 0, 0);
         // create word version of query profile
-        createQueryProfile<int16_t, VECSIZE_INT * 2, SUBSTITUTIONMATRIX>(profile->profile_word, profile->query_sequence, profile->composition_bias, profile->mat, q->L, alphabetSize, 0, 0, 0);
+        createQueryProfile<int16_t, SUBSTITUTIONMATRIX>(profile->profile_word, profile->query_sequence, profile->composition_bias, profile->mat, q->L, alphabetSize, 0, 0, 0);
         // create linear version of word profile
         for (int32_t i = 0; i< alphabetSize; i++) {
             profile->profile_word_linear[i] = &profile_word_linear_data[i*q->L];
@@ -1725,73 +1165,84 @@ s_align SmithWaterman::scoreIdentical(unsigned char *dbSeq, int L, EvalueComputa
 	return r;
 }
 
-template <typename F>
-inline F simd_hmax(const F * in, unsigned int n) {
-    F current = std::numeric_limits<F>::min();
-    do {
-        current = std::max(current, *in++);
-    } while(--n);
+int SmithWaterman::ungapped_alignment(const unsigned char *db_sequence, int32_t db_length) {
+    return kernel->ungappedAlignment(buffers, profile->profile_byte, profile->query_length, profile->bias, db_sequence, db_length);
+}
 
-    return current;
+bool SmithWaterman::ssw_batch_supported() {
+#ifdef GAP_POS_SCORING
+    if (isQueryProfile) {
+        return false;
+    }
+#endif
+    // residues are looked up in 32 entry tables
+    return isTargetProfile == false && profile->alphabetSize <= 31;
 }
 
-int SmithWaterman::ungapped_alignment(const unsigned char *db_sequence, int32_t db_length) {
-#define SWAP(tmp, arg1, arg2) tmp = arg1; arg1 = arg2; arg2 = tmp;
-
-    int i; // position in query bands (0,..,W-1)
-    int j; // position in db sequence (0,..,dbseq_length-1)
-    int element_count = (VECSIZE_INT * 4);
-    const int W = (profile->query_length + (element_count - 1)) /
-                  element_count; // width of bands in query and score matrix = hochgerundetes LQ/16
-
-    simd_int *p;
-    simd_int S;              // 16 unsigned bytes holding S(b*W+i,j) (b=0,..,15)
-    simd_int Smax = simdi_setzero();
-    simd_int Soffset; // all scores in query profile are shifted up by Soffset to obtain pos values
-    simd_int *s_prev, *s_curr; // pointers to Score(i-1,j-1) and Score(i,j), resp.
-    simd_int *qji;             // query profile score in row j (for residue x_j)
-    simd_int *s_prev_it, *s_curr_it;
-    simd_int *query_profile_it = (simd_int *) profile->profile_byte;
-
-    // Load the score offset to all 16 unsigned byte elements of Soffset
-    Soffset = simdi8_set(profile->bias);
-    s_curr = vHStore;
-    s_prev = vHLoad;
-
-    memset(vHStore, 0, W * sizeof(simd_int));
-    memset(vHLoad, 0, W * sizeof(simd_int));
-
-    for (j = 0; j < db_length; ++j) // loop over db sequence positions
-    {
-
-        // Get address of query scores for row j
-        qji = query_profile_it + db_sequence[j] * W;
-
-        // Load the next S value
-        S = simdi_load(s_curr + W - 1);
-        S = simdi8_shiftl(S, 1);
-
-        // Swap s_prev and s_curr, smax_prev and smax_curr
-        SWAP(p, s_prev, s_curr);
-
-        s_curr_it = s_curr;
-        s_prev_it = s_prev;
-
-        for (i = 0; i < W; ++i) // loop over query band positions
-        {
-            // Saturated addition and subtraction to score S(i,j)
-            S = simdui8_adds(S, *(qji++)); // S(i,j) = S(i-1,j-1) + (q(i,x_j) + Soffset)
-            S = simdui8_subs(S, Soffset);       // S(i,j) = max(0, S(i,j) - Soffset)
-            simdi_store(s_curr_it++, S);       // store S to s_curr[i]
-            Smax = simdui8_max(Smax, S);       // Smax(i,j) = max(Smax(i,j), S(i,j))
-
-            // Load the next S and Smax values
-            S = simdi_load(s_prev_it++);
+void SmithWaterman::ssw_batch_add(const unsigned char *db_sequence, int32_t db_length) {
+    const size_t lanes = kernel->vectorBytes;
+    if (batchTargets == NULL) {
+        batchTargets = (unsigned char *) mem_align(lanes, BATCH_MAX_TARGET_LENGTH * lanes);
+    }
+    for (int32_t j = 0; j < db_length; j++) {
+        batchTargets[j * lanes + batchCount] = db_sequence[j];
+    }
+    batchTargetLength[batchCount] = db_length;
+    batchLength = std::max(batchLength, db_length);
+    batchCount++;
+}
+
+void SmithWaterman::ssw_batch_score(const uint8_t gap_open, const uint8_t gap_extend, const uint8_t end_score, alignment_end *ends) {
+    const size_t lanes = kernel->vectorBytes;
+    const int32_t query_length = profile->query_length;
+    if (batchH == NULL) {
+        batchQueryTable = (uint8_t *) mem_align(lanes, maxSequenceLength * 32);
+        batchH = (simd_int *) mem_align(lanes, maxSequenceLength * lanes);
+        batchF = (simd_int *) mem_align(lanes, maxSequenceLength * lanes);
+    }
+    // same biased scores as the byte query profile, the last entry scores padding with -bias
+    if (batchQueryTableValid == false) {
+        memset(batchQueryTable, 0, query_length * 32);
+        for (int32_t i = 0; i < query_length; i++) {
+            uint8_t *row = batchQueryTable + i * 32;
+            for (int32_t aa = 0; aa < profile->alphabetSize; aa++) {
+                if (isQueryProfile) {
+                    row[aa] = (uint8_t) (profile->mat[aa * query_length + i] + profile->bias);
+                } else {
+                    row[aa] = (uint8_t) (profile->mat[aa * profile->alphabetSize + profile->query_sequence[i]]
+                                         + profile->composition_bias[i] + profile->bias);
+                }
+            }
+        }
+        batchQueryTableValid = true;
+    }
+    // pad shorter and unused lanes
+    for (size_t lane = 0; lane < lanes; lane++) {
+        const int32_t start = (lane < batchCount) ? batchTargetLength[lane] : 0;
+        for (int32_t j = start; j < batchLength; j++) {
+            batchTargets[j * lanes + lane] = 31;
         }
     }
-    int score = simd_hmax((unsigned char *) &Smax, element_count);
+    uint8_t laneScores[64];
+    int32_t queryEnds[64];
+    int32_t targetEnds[64];
+    kernel->swByteBatch(batchQueryTable, query_length, batchTargets, batchLength, gap_open, gap_extend, profile->bias,
+                        end_score, batchH, batchF, laneScores, queryEnds, targetEnds);
+    for (size_t lane = 0; lane < batchCount; lane++) {
+        ends[lane].score = (laneScores[lane] == 255) ? 0 : laneScores[lane];
+        ends[lane].ref = targetEnds[lane];
+        ends[lane].read = queryEnds[lane];
+    }
+}
 
-    /* return largest score */
-    return score;
-#undef SWAP
+const SmithWatermanKernel *SmithWatermanKernel::get() {
+#ifdef SIMD_DISPATCH
+    if (SimdDispatch::getLevel() >= SimdDispatch::LEVEL_AVX512) {
+        return &simd_avx512::smithWatermanKernel;
+    }
+    if (SimdDispatch::getLevel() >= SimdDispatch::LEVEL_AVX2) {
+        return &simd_avx2::smithWatermanKernel;
+    }
+#endif
+    return &simd_baseline::smithWatermanKernel;
 }
@@ -42,6 +42,7 @@
 
 #include "simd.h"
 #include "BaseMatrix.h"
+#include "StripedSmithWatermanKernel.h"
 
 #include "Sequence.h"
 #include "EvalueComputation.h"
@@ -185,6 +186,9 @@ public:
      reference loci nearby (mask length = maskLen) the best alignment ending position and locates the second largest
      score from the unmasked elements.
 
+     @param	forwardEnd	optional best score and end position of the alignment (e.g. from ssw_batch_score),
+     the forward pass is skipped if it is given
+
      @return	pointer to the alignment result structure
 
      @note	Whatever the parameter flag is setted, this function will at least return the optimal and sub-optimal alignment score,
@@ -203,7 +207,8 @@ public:
                         const double filters,
                         EvalueComputation * filterd,
                         const int covMode, const float covThr, const float correlationScoreWeight,
-                        const int32_t maskLen, const size_t id);
+                        const int32_t maskLen, const size_t id,
+                        const SmithWatermanKernel::alignment_end *forwardEnd = NULL);
 
 
     /*!	@function computed ungapped alignment score
@@ -217,6 +222,32 @@ public:
    int ungapped_alignment(const unsigned char *db_sequence,
                           int32_t db_length);
 
+    /*!	@function	Inter-sequence scoring of short targets.
+    Up to getBatchSize() targets are collected with ssw_batch_add, ssw_batch_score computes the best local
+    alignment score and its end position for each of them in one pass over the query (one target per vector lane).
+    The results are the same as score1, qEndPos1 and dbEndPos1 of ssw_align and can be passed to it as forwardEnd.
+    End positions are only located for scores of at least end_score (-1 otherwise).
+    A score of 0 marks a target that needs to be aligned with ssw_align (byte overflow or nothing aligned).
+    Only available for sequence targets, see ssw_batch_supported.
+    */
+    bool ssw_batch_supported();
+
+    size_t getBatchSize() {
+        return kernel->vectorBytes;
+    }
+
+    void ssw_batch_clear() {
+        batchCount = 0;
+        batchLength = 0;
+    }
+
+    void ssw_batch_add(const unsigned char *db_sequence, int32_t db_length);
+
+    void ssw_batch_score(const uint8_t gap_open, const uint8_t gap_extend, const uint8_t end_score, SmithWatermanKernel::alignment_end *ends);
+
+    // longest target that is added to a batch
+    const static int32_t BATCH_MAX_TARGET_LENGTH = 512;
+
   /*!	@function	Create the query profile using the query sequence.
    @param	read	pointer to the query sequence; the query sequence needs to be numbers
    @param	readLen	length of the query sequence
@@ -290,11 +321,22 @@ private:
     // needed for type checking query and target databases
     bool isTargetProfile, isQueryProfile;
 
-    typedef struct {
-        uint16_t score;
-        int32_t ref;	 //0-based position
-        int32_t read;    //alignment ending position on read, 0-based
-    } alignment_end;
+    typedef SmithWatermanKernel::alignment_end alignment_end;
+
+    // striped kernels for the instruction set selected at runtime, the profiles are laid out for their vector width
+    const SmithWatermanKernel *kernel;
+    SmithWatermanKernel::Buffers buffers;
+
+    // inter-sequence scoring, allocated on first use
+    uint8_t *batchQueryTable;
+    bool batchQueryTableValid;
+    simd_int *batchH;
+    simd_int *batchF;
+    unsigned char *batchTargets;
+    int32_t batchTargetLength[64];
+    size_t batchCount;
+    int32_t batchLength;
+    size_t maxSequenceLength;
 
 
     typedef struct {
@@ -314,55 +356,7 @@ private:
                         const double filters,
                         EvalueComputation * filterd,
                         const int covMode, const float covThr, const float correlationScoreWeight,
-                        const int32_t maskLen, const size_t id);
-
-    /* Striped Smith-Waterman
-     Record the highest score of each reference position.
-     Return the alignment score and ending position of the best alignment, 2nd best alignment, etc.
-     Gap begin and gap extension are different.
-     wight_match > 0, all other weights < 0.
-     The returned positions are 0-based.
-     */
-    template <const unsigned int type, const bool posSpecificGaps>
-    std::pair<alignment_end, alignment_end> sw_sse2_byte(const unsigned char *db_sequence,
-                                 const simd_int* db_profile_byte,
-                                 int8_t ref_dir,	// 0: forward ref; 1: reverse ref
-                                 int32_t db_length,
-                                 int32_t query_length,
-                                 const uint8_t gap_open, /* will be used as - */
-                                 const uint8_t gap_extend, /* will be used as - */
-                                 const simd_int* query_profile_byte,
-                                 const simd_int* query_consens_byte,
-#ifdef GAP_POS_SCORING
-                                 const simd_int* gap_open_del,
-                                 const simd_int* gap_close_del,
-                                 const simd_int* gap_open_ins,
-#endif
-                                 uint8_t terminate,	/* the best alignment score: used to terminate
-                                                     the matrix calculation when locating the
-                                                     alignment beginning point. If this score
-                                                     is set to 0, it will not be used */
-                                 uint8_t bias,  /* Shift 0 point to a positive value. */
-                                 int32_t maskLen);
-
-    template <const unsigned int type, const bool posSpecificGaps>
-    std::pair<alignment_end, alignment_end> sw_sse2_word (const unsigned char* db_sequence,
-                                 const simd_int* db_profile_byte,
-                                 int8_t ref_dir,	// 0: forward ref; 1: reverse ref
-                                 int32_t db_length,
-                                 int32_t query_length,
-                                 const uint8_t gap_open, /* will be used as - */
-                                 const uint8_t gap_extend, /* will be used as - */
-                                 const simd_int*query_profile_word,
-                                 const simd_int* query_consens_word,
-#ifdef GAP_POS_SCORING
-                                 const simd_int* gap_open_del,
-                                 const simd_int* gap_close_del,
-                                 const simd_int* gap_open_ins,
-#endif
-                                 uint16_t terminate,
-                                 uint16_t bias,
-                                 int32_t maskLen);
+                        const int32_t maskLen, const size_t id, const alignment_end *forwardEnd);
 
     template <const unsigned int type, const bool posSpecificGaps>
     SmithWaterman::cigar *banded_sw(const unsigned char *db_sequence, const int8_t *query_sequence,
@@ -388,7 +382,7 @@ private:
     size_t target_id;
 
 
-    template <typename T, size_t Elements, const unsigned int type>
+    template <typename T, const unsigned int type>
     void createQueryProfile(simd_int *profile, const int8_t *query_sequence, const int8_t * composition_bias,
             const int8_t *mat, const int32_t query_length, const int32_t aaSize, uint8_t bias, const int32_t offset, const int32_t entryLength);
 
@@ -398,12 +392,12 @@ private:
     bool aaBiasCorrection;
     float aaBiasCorrectionScale;
 
-    template <typename T, size_t Elements>
+    template <typename T>
     void createConsensProfile(simd_int *profile, const int8_t *consens_sequence, const int32_t query_length, const int32_t offset);
 
     void createTargetProfile(simd_int *profile, const int8_t *mat, const int target_length, const int32_t aaSize, uint8_t bias);
 
-    template <typename T, size_t Elements>
+    template <typename T>
     void updateQueryProfile(simd_int *profile, const int32_t query_length, const int32_t aaSize, uint8_t shift);
 
     uint8_t computeBias(const int32_t target_length, const int8_t *mat, const int32_t aaSize);
@@ -0,0 +1,924 @@
+/* The MIT License
+   Copyright (c) 2012-1015 Boston College.
+   Permission is hereby granted, free of charge, to any person obtaining
+   a copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+   BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+   ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+   CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+*/
+
+/*
+   Written by Michael Farrar, 2006 (alignment), Mengyao Zhao (SSW Library) and Martin Steinegger (change structure add aa composition, profile and AVX2 support).
+   Please send bug reports and/or suggestions to martin.steinegger@snu.ac.kr.
+*/
+// Compiled once per instruction set: StripedSmithWatermanKernelAvx2.cpp and StripedSmithWatermanKernelAvx512.cpp
+// include this file again with -mavx2 and -mavx512bw.
+// Do not call inline functions or templates shared with the rest of the program here, the linker
+// could otherwise pick their AVX2 or AVX-512 copy for every caller.
+#ifndef SIMD_DISPATCH_NAMESPACE
+#define SIMD_DISPATCH_NAMESPACE simd_baseline
+#endif
+
+#include "StripedSmithWatermanKernel.h"
+#include "simd.h"
+
+#include <cstring>
+#include <climits>
+
+#ifndef LIKELY
+#  define LIKELY(x) __builtin_expect((x),1)
+#  define UNLIKELY(x) __builtin_expect((x),0)
+#endif
+
+namespace SIMD_DISPATCH_NAMESPACE {
+
+typedef SmithWatermanKernel::alignment_end alignment_end;
+
+#if defined(AVX512)
+// 32 entry byte lookup, the table is stored in the lower 256 bits of value
+static __m512i Shuffle(const __m512i & value, const __m512i & shuffle) {
+    const __m512i lower = _mm512_broadcast_i32x4(_mm512_castsi512_si128(value));
+    const __m512i upper = _mm512_broadcast_i32x4(_mm512_extracti32x4_epi32(value, 1));
+    const __mmask64 isUpper = _mm512_cmpgt_epi8_mask(shuffle, _mm512_set1_epi8(15));
+    return _mm512_mask_shuffle_epi8(_mm512_shuffle_epi8(lower, shuffle), isUpper, upper, shuffle);
+}
+#elif defined(AVX2)
+static __m256i Shuffle(const __m256i & value, const __m256i & shuffle) {
+    const __m256i K0 = _mm256_setr_epi8(
+            (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70,
+            (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0);
+    const __m256i K1 = _mm256_setr_epi8(
+            (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0,
+            (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70);
+    return _mm256_or_si256(_mm256_shuffle_epi8(value, _mm256_add_epi8(shuffle, K0)),
+                           _mm256_shuffle_epi8(_mm256_permute4x64_epi64(value, 0x4E), _mm256_add_epi8(shuffle, K1)));
+}
+#endif
+
+template <const bool profileProfile, const bool posSpecificGaps>
+static void sw_sse2_byte(const SmithWatermanKernel::Buffers &buffers,
+														   const unsigned char *db_sequence,
+														   const simd_int* db_profile_byte,
+														   int8_t ref_dir,	// 0: forward ref; 1: reverse ref
+														   int32_t db_length,
+														   int32_t query_length,
+														   const uint8_t gap_open, /* will be used as - */
+														   const uint8_t gap_extend, /* will be used as - */
+														   const simd_int* query_profile_byte, /* profile_byte loaded in ssw_init */
+														   const simd_int* query_consens_byte, /* profile_consens_byte loaded in ssw_init */
+#ifdef GAP_POS_SCORING
+                                                           const simd_int *gap_open_del,
+                                                           const simd_int *gap_close_del,
+                                                           const simd_int *gap_open_ins,
+#endif
+														   uint8_t terminate,	/* the best alignment score: used to terminate
+                                                         the matrix calculation when locating the
+                                                         alignment beginning point. If this score
+                                                         is set to 0, it will not be used */
+														   uint8_t bias,  /* Shift 0 point to a positive value. */
+														   int32_t maskLen,
+														   alignment_end *bests) {
+#define max16(m, vm) ((m) = simdi8_hmax((vm)));
+
+	uint8_t max = 0;		                     /* the max alignment score */
+	int32_t end_query = query_length - 1;
+	int32_t end_db = -1; /* 0_based best alignment ending point; Initialized as isn't aligned -1. */
+	const int SIMD_SIZE = VECSIZE_INT * 4;
+	int32_t segLen = (query_length + SIMD_SIZE-1) / SIMD_SIZE; /* number of segment */
+	/* array to record the largest score of each reference position */
+	memset(buffers.maxColumn, 0, db_length * sizeof(uint8_t));
+	uint8_t * maxColumn = (uint8_t *) buffers.maxColumn;
+
+	/* Define 16 byte 0 vector. */
+	simd_int vZero = simdi32_set(0);
+	simd_int* pvHStore = (simd_int*) buffers.vHStore;
+	simd_int* pvHLoad = (simd_int*) buffers.vHLoad;
+	simd_int* pvE = (simd_int*) buffers.vE;
+	simd_int* pvHmax = (simd_int*) buffers.vHmax;
+
+    memset(pvHStore,0,segLen*sizeof(simd_int));
+	memset(pvHLoad,0,segLen*sizeof(simd_int));
+	memset(pvE,0,segLen*sizeof(simd_int));
+	memset(pvHmax,0,segLen*sizeof(simd_int));
+
+	int32_t i, j;
+    /* 16 byte insertion begin vector */
+	simd_int vGapO = simdi8_set(gap_open);
+
+    /* 16 byte insertion extension vector */
+	simd_int vGapE = simdi8_set(gap_extend);
+
+	/* 16 byte bias vector */
+	simd_int vBias = simdi8_set(bias);
+
+	simd_int vMaxScore = vZero; /* Trace the highest score of the whole SW matrix. */
+	simd_int vMaxMark = vZero; /* Trace the highest score till the previous column. */
+	simd_int vTemp;
+	int32_t edge, begin = 0, end = db_length, step = 1;
+
+    //fprintf(stderr, "start alignment of length %d [%u]\n", query_length, segLen * SIMD_SIZE);
+
+	/* outer loop to process the reference sequence */
+	if (ref_dir == 1) {
+		begin = db_length - 1;
+		end = -1;
+		step = -1;
+	}
+
+#ifndef AVX2
+    const simd_int sixten  = simdi8_set(16);
+    const simd_int fiveten = simdi8_set(15);
+#endif
+
+    // store the query consensus profile
+    const simd_int* vQueryCons = query_consens_byte;
+	for (i = begin; LIKELY(i != end); i += step) {
+//	    cnt = i;
+		simd_int e, vF = vZero, vMaxColumn = vZero; /* Initialize F value to 0.
+                                                    Any errors to vH values will be corrected in the Lazy_F loop.
+                                                    */
+
+		simd_int vH = pvHStore[segLen - 1];
+		vH = simdi8_shiftl (vH, 1); /* Shift the 128-bit value in vH left by 1 byte. */
+		const simd_int* vP = query_profile_byte + db_sequence[i] * segLen; /* Right part of the query_profile_byte */
+
+#if defined(AVX512)
+        simd_int target_scores1 = simdi8_set(0);
+        if (profileProfile) {
+            // target profile columns are 32 bytes wide
+            target_scores1 = _mm512_zextsi256_si512(_mm256_load_si256((const __m256i *) db_profile_byte + i));
+        }
+#elif defined(AVX2)
+        simd_int target_scores1 = simdi8_set(0);
+        if (profileProfile) {
+            target_scores1 = simdi_load(&db_profile_byte[i]);
+        }
+#else
+        simd_int target_scores1 = simdi8_set(0);
+        simd_int target_scores2 = simdi8_set(0);
+        if (profileProfile) {
+            target_scores1 = simdi_load(&db_profile_byte[i]);
+            target_scores2 = simdi_load(&db_profile_byte[i + 16]);
+        }
+#endif
+
+		/* Swap the 2 H buffers. */
+		simd_int* pv = pvHLoad;
+		pvHLoad = pvHStore;
+		pvHStore = pv;
+
+		/* inner loop to process the query sequence */
+		for (j = 0; LIKELY(j < segLen); ++j) {
+		    simd_int score = simdi8_set(0);
+		    if (profileProfile) {
+#ifdef AVX2
+                simd_int scoreLookup = Shuffle(target_scores1, simdi_load(vQueryCons + j));
+#else
+		        const __m128i vQueryConsJ = _mm_load_si128(vQueryCons + j);
+                __m128i score01 = _mm_shuffle_epi8(target_scores1, vQueryConsJ);
+                __m128i score16 = _mm_shuffle_epi8(target_scores2, vQueryConsJ);
+                __m128i lookup_mask01 = _mm_cmplt_epi8(vQueryConsJ, sixten);
+                __m128i lookup_mask16 = _mm_cmplt_epi8(fiveten, vQueryConsJ);
+                score01 = _mm_and_si128(lookup_mask01, score01);
+                score16 = _mm_and_si128(lookup_mask16, score16);
+                __m128i scoreLookup = _mm_add_epi8(score01, score16);
+#endif
+                //score = simdui8_max(scoreLookup, simdi_load(vP + j));
+                score = simdui8_avg(scoreLookup, simdi_load(vP + j));
+		    } else {
+		        score = simdi_load(vP + j);
+		    }
+
+
+            vH = simdui8_adds(vH, score);
+            vH = simdui8_subs(vH, vBias);   /* vH will be always > 0 */
+
+            /* Get max from vH, vE and vF. */
+			e = simdi_load(pvE + j);
+            vH = simdui8_max(vH, e);
+#ifdef GAP_POS_SCORING
+            if (posSpecificGaps) {
+                vH = simdui8_max(vH, simdui8_subs(vF, simdi_load(gap_close_del + j)));
+            } else {
+#endif
+                vH = simdui8_max(vH, vF);
+#ifdef GAP_POS_SCORING
+            }
+#endif
+			vMaxColumn = simdui8_max(vMaxColumn, vH);
+
+			/* Save vH values. */
+			simdi_store(pvHStore + j, vH);
+
+			/* Update vE value. */
+#ifdef GAP_POS_SCORING
+            if (posSpecificGaps) {
+                // copy vH for update of vF
+                vTemp = vH;
+                vH = simdui8_subs(vH, simdi_load(gap_open_ins + j)); /* saturation arithmetic, result >= 0 */
+            } else {
+#endif
+                vH = simdui8_subs(vH, vGapO); /* saturation arithmetic, result >= 0 */
+#ifdef GAP_POS_SCORING
+            }
+#endif
+
+			e = simdui8_subs(e, vGapE);
+			e = simdui8_max(e, vH);
+			simdi_store(pvE + j, e);
+
+			/* Update vF value. */
+			vF = simdui8_subs(vF, vGapE);
+#ifdef GAP_POS_SCORING
+            if (posSpecificGaps) {
+                vF = simdui8_max(vF, simdui8_subs(vTemp, simdi_load(gap_open_del + j)));
+            } else {
+#endif
+                vF = simdui8_max(vF, vH);
+#ifdef GAP_POS_SCORING
+            }
+#endif
+
+			/* Load the next vH. */
+			vH = simdi_load(pvHLoad + j);
+
+        }
+
+		/* Lazy_F loop: has been revised to disallow adjecent insertion and then deletion, so don't update E(i, j), learn from SWPS3 */
+		/* reset pointers to the start of the saved data */
+		j = 0;
+		vH = simdi_load (pvHStore + j);
+		/*  the computed vF value is for the given column.  since */
+		/*  we are at the end, we need to shift the vF value over */
+		/*  to the next column. */
+		vF = simdi8_shiftl (vF, 1);
+#ifdef GAP_POS_SCORING
+        if (posSpecificGaps) {
+            vTemp = simdui8_subs(vH, simdi_load(gap_open_del + j));
+        } else {
+#endif
+            vTemp = simdui8_subs(vH, vGapO);
+#ifdef GAP_POS_SCORING
+        }
+#endif
+		vTemp = simdui8_subs (vF, vTemp);
+		vTemp = simdi8_eq (vTemp, vZero);
+		simd_movemask_t cmp = simdi8_movemask (vTemp);
+		while (cmp != SIMD_MOVEMASK_MAX) {
+#ifdef GAP_POS_SCORING
+            if (posSpecificGaps) {
+                vH = simdui8_max (vH, simdui8_subs(vF, simdi_load(gap_close_del + j)));
+                simdi_store(pvE + j, simdui8_max(simdi_load(pvE + j), simdui8_subs(vH, simdi_load(gap_open_ins + j))));
+            } else {
+#endif
+                vH = simdui8_max (vH, vF);
+#ifdef GAP_POS_SCORING
+            }
+#endif
+
+			vMaxColumn = simdui8_max(vMaxColumn, vH);
+			simdi_store (pvHStore + j, vH);
+
+			vF = simdui8_subs (vF, vGapE);
+			j++;
+			if (j >= segLen)
+			{
+				j = 0;
+				vF = simdi8_shiftl (vF, 1);
+			}
+			vH = simdi_load (pvHStore + j);
+
+#ifdef GAP_POS_SCORING
+            if (posSpecificGaps) {
+                vTemp = simdui8_subs(vH, simdi_load(gap_open_del + j));
+            } else {
+#endif
+                vTemp = simdui8_subs(vH, vGapO);
+#ifdef GAP_POS_SCORING
+            }
+#endif
+			vTemp = simdui8_subs (vF, vTemp);
+			vTemp = simdi8_eq (vTemp, vZero);
+			cmp  = simdi8_movemask (vTemp);
+		}
+
+		vMaxScore = simdui8_max(vMaxScore, vMaxColumn);
+		vTemp = simdi8_eq(vMaxMark, vMaxScore);
+		cmp = simdi8_movemask(vTemp);
+		if (cmp != SIMD_MOVEMASK_MAX) {
+			uint8_t temp;
+			vMaxMark = vMaxScore;
+			max16(temp, vMaxScore);
+			vMaxScore = vMaxMark;
+
+
+			if (LIKELY(temp > max)) {
+			    max = temp;
+				if (max + bias >= 255) {
+				    break;	//overflow
+				}
+				end_db = i;
+
+				/* Store the column with the highest alignment score in order to trace the alignment ending position on read. */
+				for (j = 0; LIKELY(j < segLen); ++j) pvHmax[j] = pvHStore[j];
+			}
+		}
+
+        //uint8_t *t = (uint8_t *)pvHStore;
+        //for (int ti = 0; ti < segLen * SIMD_SIZE; ++ti) {
+        //    fprintf(stderr, "%d ", t[ti / segLen + ti % segLen * SIMD_SIZE]);
+        //}
+        //fprintf(stderr, "\n");
+
+		/* Record the max score of current column. */
+		max16(maxColumn[i], vMaxColumn);
+		//		fprintf(stderr, "maxColumn[%d]: %d\n", i, maxColumn[i]);
+		if (maxColumn[i] == terminate) break;
+	}
+
+	/* Trace the alignment ending position on read. */
+	uint8_t *t = (uint8_t*)pvHmax;
+	int32_t column_len = segLen * SIMD_SIZE;
+	for (i = 0; LIKELY(i < column_len); ++i, ++t) {
+		int32_t temp;
+		if (*t == max) {
+			temp = i / SIMD_SIZE + i % SIMD_SIZE * segLen;
+			if (temp < end_query) end_query = temp;
+		}
+	}
+
+	/* Find the most possible 2nd best alignment. */
+	alignment_end best0;
+    best0.score = max + bias >= 255 ? 255 : max;
+    best0.ref = end_db;
+    best0.read = end_query;
+
+    alignment_end best1;
+    best1.score = 0;
+    best1.ref = 0;
+    best1.read = 0;
+
+	edge = (end_db - maskLen) > 0 ? (end_db - maskLen) : 0;
+	for (i = 0; i < edge; i ++) {
+		if (maxColumn[i] > best1.score) {
+            best1.score = maxColumn[i];
+            best1.ref = i;
+		}
+	}
+	edge = (end_db + maskLen) > db_length ? db_length : (end_db + maskLen);
+	for (i = edge + 1; i < db_length; i ++) {
+		if (maxColumn[i] > best1.score) {
+            best1.score = maxColumn[i];
+            best1.ref = i;
+		}
+	}
+	bests[0] = best0;
+	bests[1] = best1;
+#undef max16
+}
+
+template <const bool profileProfile, const bool posSpecificGaps>
+static void sw_sse2_word(const SmithWatermanKernel::Buffers &buffers,
+                                                           const unsigned char* db_sequence,
+														   const simd_int* db_profile_byte,
+														   int8_t ref_dir,	// 0: forward ref; 1: reverse ref
+														   int32_t db_length,
+														   int32_t query_length,
+														   const uint8_t gap_open, /* will be used as - */
+														   const uint8_t gap_extend, /* will be used as - */
+														   const simd_int* query_profile_word,
+														   const simd_int* query_consens_word,
+#ifdef GAP_POS_SCORING
+                                                           const simd_int *gap_open_del,
+                                                           const simd_int *gap_close_del,
+                                                           const simd_int *gap_open_ins,
+#endif
+														   uint16_t terminate,
+                                                           const uint16_t bias,
+                                                           int32_t maskLen,
+                                                           alignment_end *bests) {
+
+#define max8(m, vm) ((m) = simdi16_hmax((vm)));
+
+	uint16_t max = 0;		                     /* the max alignment score */
+	int32_t end_read = query_length - 1;
+	int32_t end_ref = 0; /* 1_based best alignment ending point; Initialized as isn't aligned - 0. */
+	const unsigned int SIMD_SIZE = VECSIZE_INT * 2;
+	int32_t segLen = (query_length + SIMD_SIZE-1) / SIMD_SIZE; /* number of segment */
+	/* array to record the alignment read ending position of the largest score of each reference position */
+	memset(buffers.maxColumn, 0, db_length * sizeof(uint16_t));
+	uint16_t * maxColumn = (uint16_t *) buffers.maxColumn;
+
+	/* Define 16 byte 0 vector. */
+	simd_int vZero = simdi32_set(0);
+	simd_int* pvHStore = (simd_int*) buffers.vHStore;
+	simd_int* pvHLoad = (simd_int*) buffers.vHLoad;
+	simd_int* pvE = (simd_int*) buffers.vE;
+	simd_int* pvHmax = (simd_int*) buffers.vHmax;
+	memset(pvHStore,0,segLen*sizeof(simd_int));
+	memset(pvHLoad,0, segLen*sizeof(simd_int));
+	memset(pvE,0,     segLen*sizeof(simd_int));
+	memset(pvHmax,0,  segLen*sizeof(simd_int));
+
+	int32_t i, j, k;
+
+    /* 16 byte insertion begin vector */
+    simd_int vGapO = simdi16_set(gap_open);
+
+	/* 16 byte insertion extension vector */
+	simd_int vGapE = simdi16_set(gap_extend);
+
+	/* 16 byte bias vector */
+	simd_int vBias = simdi16_set(bias);
+	//simd_int vBias = simdi16_set(-bias);    // set as a negative value for simd use
+	simd_int vMaxScore = vZero; /* Trace the highest score of the whole SW matrix. */
+	simd_int vMaxMark = vZero; /* Trace the highest score till the previous column. */
+	simd_int vTemp;
+	int32_t edge, begin = 0, end = db_length, step = 1;
+
+    //fprintf(stderr, "start alignment of length %d [%d]\n", query_length, segLen * SIMD_SIZE);
+
+	/* outer loop to process the reference sequence */
+	if (ref_dir == 1) {
+		begin = db_length - 1;
+		end = -1;
+		step = -1;
+	}
+
+    // store the query consensus profile
+	const simd_int* vQueryCons = query_consens_word;
+
+#ifndef AVX2
+    const simd_int sixten  = simdi8_set(16);
+    const simd_int fiveten = simdi8_set(15);
+#endif
+
+	for (i = begin; LIKELY(i != end); i += step) {
+		simd_int e, vF = vZero, vMaxColumn = vZero; /* Initialize F value to 0.
+                                Any errors to vH values will be corrected in the Lazy_F loop.
+                                */
+
+		simd_int vH = pvHStore[segLen - 1];
+		vH = simdi8_shiftl (vH, 2); /* Shift the 128-bit value in vH left by 2 byte. */
+		const simd_int* vP = query_profile_word + db_sequence[i] * segLen; /* Right part of the query_profile_byte */
+
+#if defined(AVX512)
+        simd_int target_scores1 = simdi16_set(0);
+        if (profileProfile) {
+            target_scores1 = _mm512_zextsi256_si512(_mm256_load_si256((const __m256i *) db_profile_byte + i));
+        }
+#elif defined(AVX2)
+        simd_int target_scores1 = simdi16_set(0);
+        if (profileProfile) {
+            target_scores1 = simdi_load(&db_profile_byte[i]);
+        }
+#else
+        simd_int target_scores1 = simdi16_set(0);
+        simd_int target_scores2 = simdi16_set(0);
+        if (profileProfile) {
+            target_scores1 = simdi_load(&db_profile_byte[i]);
+            target_scores2 = simdi_load(&db_profile_byte[i + 16]);
+        }
+#endif
+
+        /* Swap the 2 H buffers. */
+        simd_int* pv = pvHLoad;
+		pvHLoad = pvHStore;
+		pvHStore = pv;
+
+		/* inner loop to process the query sequence */
+		for (j = 0; LIKELY(j < segLen); j ++) {
+		    simd_int score = simdi16_set(0);
+		    if (profileProfile) {
+#ifdef AVX2
+                simd_int scoreLookup = Shuffle(target_scores1, simdi_load(vQueryCons + j));
+#else
+                const __m128i vQueryConsJ = _mm_load_si128(vQueryCons + j);
+                __m128i score01 = _mm_shuffle_epi8(target_scores1, vQueryConsJ);
+                __m128i score16 = _mm_shuffle_epi8(target_scores2, vQueryConsJ);
+                __m128i lookup_mask01 = _mm_cmplt_epi8(vQueryConsJ, sixten);
+                __m128i lookup_mask16 = _mm_cmplt_epi8(fiveten, vQueryConsJ);
+                score01 = _mm_and_si128(lookup_mask01, score01);
+                score16 = _mm_and_si128(lookup_mask16, score16);
+                __m128i scoreLookup = _mm_add_epi8(score01, score16);
+#endif
+                scoreLookup = simdi_and(scoreLookup, simdi16_set(0x00FF));
+                score = simdui16_avg(scoreLookup, simdi16_add(simdi_load(vP + j), vBias));
+				score = simdi16_sub(score, vBias);
+				//scoreLookup = simdi16_add(scoreLookup, vBias);
+                //score = simdi16_max(scoreLookup, simdi_load(vP + j));
+		    } else {
+		        score = simdi_load(vP + j);
+		    }
+
+			vH = simdi16_adds(vH, score);
+
+			/* Get max from vH, vE and vF. */
+			e = simdi_load(pvE + j);
+            vH = simdi16_max(vH, e);
+#ifdef GAP_POS_SCORING
+            if (posSpecificGaps) {
+                vH = simdi16_max(vH, simdui16_subs(vF, simdi_load(gap_close_del + j)));
+            } else {
+#endif
+                vH = simdi16_max(vH, vF);
+#ifdef GAP_POS_SCORING
+            }
+#endif
+
+			vMaxColumn = simdi16_max(vMaxColumn, vH);
+
+			/* Save vH values. */
+			simdi_store(pvHStore + j, vH);
+
+			/* Update vE value. */
+#ifdef GAP_POS_SCORING
+            if (posSpecificGaps) {
+                // copy vH for update of vF
+                vTemp = vH;
+                vH = simdui16_subs(vH, simdi_load(gap_open_ins + j)); /* saturation arithmetic, result >= 0 */
+            } else {
+#endif
+                vH = simdui16_subs(vH, vGapO); /* saturation arithmetic, result >= 0 */
+#ifdef GAP_POS_SCORING
+            }
+#endif
+			e = simdui16_subs(e, vGapE);
+			e = simdi16_max(e, vH);
+			simdi_store(pvE + j, e);
+
+			/* Update vF value. */
+			vF = simdui16_subs(vF, vGapE);
+#ifdef GAP_POS_SCORING
+            if (posSpecificGaps) {
+                vF = simdi16_max(vF, simdui16_subs(vTemp, simdi_load(gap_open_del + j)));
+            } else {
+#endif
+                vF = simdi16_max(vF, vH);
+#ifdef GAP_POS_SCORING
+            }
+#endif
+
+			/* Load the next vH. */
+			vH = simdi_load(pvHLoad + j);
+		}
+
+		/* Lazy_F loop: has been revised to disallow adjecent insertion and then deletion, so don't update E(i, j), learn from SWPS3 */
+		for (k = 0; LIKELY(k < (int32_t) SIMD_SIZE); ++k) {
+			vF = simdi8_shiftl (vF, 2);
+			for (j = 0; LIKELY(j < segLen); ++j) {
+				vH = simdi_load(pvHStore + j);
+#ifdef GAP_POS_SCORING
+                if (posSpecificGaps) {
+                    vH = simdi16_max(vH, simdui16_subs(vF, simdi_load(gap_close_del + j)));
+                    simdi_store(pvE + j, simdi16_max(simdi_load(pvE + j), simdui16_subs(vH, simdi_load(gap_open_ins + j))));
+                } else {
+#endif
+                    vH = simdi16_max(vH, vF);
+#ifdef GAP_POS_SCORING
+                }
+#endif
+
+				vMaxColumn = simdi16_max(vMaxColumn, vH); //newly added line
+				simdi_store(pvHStore + j, vH);
+#ifdef GAP_POS_SCORING
+                if (posSpecificGaps) {
+                    vH = simdui16_subs(vH, simdi_load(gap_open_del + j));
+                } else {
+#endif
+                    vH = simdui16_subs(vH, vGapO);
+#ifdef GAP_POS_SCORING
+                }
+#endif
+				vF = simdui16_subs(vF, vGapE);
+				if (UNLIKELY(! simdi8_movemask(simdi16_gt(vF, vH)))) goto end;
+			}
+		}
+
+		end:
+		vMaxScore = simdi16_max(vMaxScore, vMaxColumn);
+		vTemp = simdi16_eq(vMaxMark, vMaxScore);
+		simd_movemask_t cmp = simdi8_movemask(vTemp);
+		if (cmp != SIMD_MOVEMASK_MAX) {
+			uint16_t temp;
+			vMaxMark = vMaxScore;
+			max8(temp, vMaxScore);
+			vMaxScore = vMaxMark;
+
+			if (LIKELY(temp > max)) {
+				max = temp;
+				end_ref = i;
+				for (j = 0; LIKELY(j < segLen); ++j) pvHmax[j] = pvHStore[j];
+			}
+		}
+
+        //uint16_t *t = (uint16_t *)pvHStore;
+        //for (size_t ti = 0; ti < segLen * SIMD_SIZE; ++ti) {
+        //    fprintf(stderr, "%d ", t[ti / segLen + ti % segLen * SIMD_SIZE]);
+        //}
+        //fprintf(stderr, "\n");
+
+		/* Record the max score of current column. */
+		max8(maxColumn[i], vMaxColumn);
+		if (maxColumn[i] == terminate) break;
+	}
+
+	/* Trace the alignment ending position on read. */
+	uint16_t *t = (uint16_t*)pvHmax;
+	int32_t column_len = segLen * SIMD_SIZE;
+	for (i = 0; LIKELY(i < column_len); ++i, ++t) {
+		int32_t temp;
+		if (*t == max) {
+			temp = i / SIMD_SIZE + i % SIMD_SIZE * segLen;
+			if (temp < end_read) end_read = temp;
+		}
+	}
+
+	/* Find the most possible 2nd best alignment. */
+	alignment_end best0;
+    best0.score = max;
+    best0.ref = end_ref;
+    best0.read = end_read;
+
+    alignment_end best1;
+    best1.score = 0;
+    best1.ref = 0;
+    best1.read = 0;
+
+	edge = (end_ref - maskLen) > 0 ? (end_ref - maskLen) : 0;
+	for (i = 0; i < edge; i ++) {
+		if (maxColumn[i] > best1.score) {
+            best1.score = maxColumn[i];
+            best1.ref = i;
+		}
+	}
+	edge = (end_ref + maskLen) > db_length ? db_length : (end_ref + maskLen);
+	for (i = edge; i < db_length; i ++) {
+		if (maxColumn[i] > best1.score) {
+            best1.score = maxColumn[i];
+            best1.ref = i;
+		}
+	}
+
+	bests[0] = best0;
+	bests[1] = best1;
+#undef max8
+}
+
+template <typename F>
+static inline F simd_hmax(const F * in, unsigned int n) {
+    F current = std::numeric_limits<F>::min();
+    do {
+        current = (*in > current) ? *in : current;
+        in++;
+    } while(--n);
+
+    return current;
+}
+
+static int ungapped_alignment(const SmithWatermanKernel::Buffers &buffers, const void *query_profile_byte, int32_t query_length,
+                              uint8_t bias, const unsigned char *db_sequence, int32_t db_length) {
+#define SWAP(tmp, arg1, arg2) tmp = arg1; arg1 = arg2; arg2 = tmp;
+
+    int i; // position in query bands (0,..,W-1)
+    int j; // position in db sequence (0,..,dbseq_length-1)
+    int element_count = (VECSIZE_INT * 4);
+    const int W = (query_length + (element_count - 1)) /
+                  element_count; // width of bands in query and score matrix = hochgerundetes LQ/16
+
+    simd_int *p;
+    simd_int S;              // 16 unsigned bytes holding S(b*W+i,j) (b=0,..,15)
+    simd_int Smax = simdi_setzero();
+    simd_int Soffset; // all scores in query profile are shifted up by Soffset to obtain pos values
+    simd_int *s_prev, *s_curr; // pointers to Score(i-1,j-1) and Score(i,j), resp.
+    simd_int *qji;             // query profile score in row j (for residue x_j)
+    simd_int *s_prev_it, *s_curr_it;
+    simd_int *query_profile_it = (simd_int *) query_profile_byte;
+
+    // Load the score offset to all 16 unsigned byte elements of Soffset
+    Soffset = simdi8_set(bias);
+    s_curr = (simd_int *) buffers.vHStore;
+    s_prev = (simd_int *) buffers.vHLoad;
+
+    memset(s_curr, 0, W * sizeof(simd_int));
+    memset(s_prev, 0, W * sizeof(simd_int));
+
+    for (j = 0; j < db_length; ++j) // loop over db sequence positions
+    {
+
+        // Get address of query scores for row j
+        qji = query_profile_it + db_sequence[j] * W;
+
+        // Load the next S value
+        S = simdi_load(s_curr + W - 1);
+        S = simdi8_shiftl(S, 1);
+
+        // Swap s_prev and s_curr, smax_prev and smax_curr
+        SWAP(p, s_prev, s_curr);
+
+        s_curr_it = s_curr;
+        s_prev_it = s_prev;
+
+        for (i = 0; i < W; ++i) // loop over query band positions
+        {
+            // Saturated addition and subtraction to score S(i,j)
+            S = simdui8_adds(S, *(qji++)); // S(i,j) = S(i-1,j-1) + (q(i,x_j) + Soffset)
+            S = simdui8_subs(S, Soffset);       // S(i,j) = max(0, S(i,j) - Soffset)
+            simdi_store(s_curr_it++, S);       // store S to s_curr[i]
+            Smax = simdui8_max(Smax, S);       // Smax(i,j) = max(Smax(i,j), S(i,j))
+
+            // Load the next S and Smax values
+            S = simdi_load(s_prev_it++);
+        }
+    }
+    int score = simd_hmax((unsigned char *) &Smax, element_count);
+
+    /* return largest score */
+    return score;
+#undef SWAP
+}
+
+// 32 entry lookup of the biased scores of one query position for the residues in index
+static inline simd_int lookupBatchScores(const uint8_t *table, const simd_int index) {
+#if defined(AVX512)
+    return Shuffle(_mm512_zextsi256_si512(_mm256_load_si256((const __m256i *) table)), index);
+#elif defined(AVX2)
+    return Shuffle(_mm256_load_si256((const __m256i *) table), index);
+#else
+    const __m128i sixten  = _mm_set1_epi8(16);
+    const __m128i fiveten = _mm_set1_epi8(15);
+    __m128i score01 = _mm_shuffle_epi8(_mm_load_si128((const __m128i *) table), index);
+    __m128i score16 = _mm_shuffle_epi8(_mm_load_si128((const __m128i *) (table + 16)), index);
+    score01 = _mm_and_si128(_mm_cmplt_epi8(index, sixten), score01);
+    score16 = _mm_and_si128(_mm_cmplt_epi8(fiveten, index), score16);
+    return _mm_add_epi8(score01, score16);
+#endif
+}
+
+// Inter-sequence Smith-Waterman (one target per byte lane), computes the best score of each target and where it ends.
+// Uses the same saturated byte recurrences as sw_sse2_byte, so the scores are identical. The end is the first target
+// position that reaches the best score and the first query position with that score in its column, as in sw_sse2_byte.
+// Locating the end needs a pass over the column, it is only done for scores of at least end_score.
+static void sw_batch_byte(const uint8_t *query_table, int32_t query_length, const unsigned char *targets,
+                          int32_t target_length, uint8_t gap_open, uint8_t gap_extend, uint8_t bias, uint8_t end_score,
+                          void *hStore, void *fStore, uint8_t *scores, int32_t *queryEnds, int32_t *targetEnds) {
+    const simd_int vZero = simdi_setzero();
+    const simd_int vGapO = simdi8_set(gap_open);
+    const simd_int vGapE = simdi8_set(gap_extend);
+    const simd_int vBias = simdi8_set(bias);
+    const simd_int vEndScore = simdi8_set(end_score);
+    const uint64_t laneMask = (sizeof(simd_int) == 64) ? UINT64_MAX : ((1ULL << sizeof(simd_int)) - 1);
+    // H and F (gap along the target) of the previous target position for every query position
+    simd_int *pvH = (simd_int *) hStore;
+    simd_int *pvF = (simd_int *) fStore;
+    memset(pvH, 0, query_length * sizeof(simd_int));
+    memset(pvF, 0, query_length * sizeof(simd_int));
+    for (size_t lane = 0; lane < sizeof(simd_int); ++lane) {
+        queryEnds[lane] = -1;
+        targetEnds[lane] = -1;
+    }
+
+    simd_int vMaxScore = vZero;
+    for (int32_t j = 0; LIKELY(j < target_length); ++j) {
+        const simd_int vResidues = simdi_load((const simd_int *) (targets + j * sizeof(simd_int)));
+        simd_int vDiag = vZero;
+        simd_int vE = vZero;
+        simd_int vMaxColumn = vZero;
+        const uint8_t *table = query_table;
+        for (int32_t i = 0; LIKELY(i < query_length); ++i, table += 32) {
+            simd_int vH = simdui8_adds(vDiag, lookupBatchScores(table, vResidues));
+            vH = simdui8_subs(vH, vBias);
+            const simd_int vF = simdi_load(pvF + i);
+            vH = simdui8_max(vH, vE);
+            vH = simdui8_max(vH, vF);
+            vMaxColumn = simdui8_max(vMaxColumn, vH);
+
+            vDiag = simdi_load(pvH + i);
+            simdi_store(pvH + i, vH);
+
+            const simd_int vHGap = simdui8_subs(vH, vGapO);
+            vE = simdui8_max(vHGap, simdui8_subs(vE, vGapE));
+            simdi_store(pvF + i, simdui8_max(vHGap, simdui8_subs(vF, vGapE)));
+        }
+
+        const simd_int vNewMax = simdui8_max(vMaxScore, vMaxColumn);
+        uint64_t improved = ~static_cast<uint64_t>(simdi8_movemask(simdi8_eq(vNewMax, vMaxScore))) & laneMask;
+        vMaxScore = vNewMax;
+        improved &= static_cast<uint64_t>(simdi8_movemask(simdi8_eq(simdui8_max(vNewMax, vEndScore), vNewMax)));
+        if (improved != 0) {
+            for (int32_t i = 0; improved != 0 && i < query_length; ++i) {
+                uint64_t found = static_cast<uint64_t>(simdi8_movemask(simdi8_eq(simdi_load(pvH + i), vMaxColumn))) & improved;
+                improved &= ~found;
+                while (found != 0) {
+                    const int lane = __builtin_ctzll(found);
+                    queryEnds[lane] = i;
+                    targetEnds[lane] = j;
+                    found &= found - 1;
+                }
+            }
+        }
+    }
+
+    simdi_storeu((simd_int *) scores, vMaxScore);
+    for (size_t lane = 0; lane < sizeof(simd_int); ++lane) {
+        // same overflow criterion as sw_sse2_byte
+        if (scores[lane] + bias >= 255) {
+            scores[lane] = 255;
+        }
+    }
+}
+
+template <const bool profileProfile, const bool posSpecificGaps>
+static void swByte(const SmithWatermanKernel::Buffers &buffers, const unsigned char *db_sequence, const void *db_profile_byte,
+                   int8_t ref_dir, int32_t db_length, int32_t query_length, const uint8_t gap_open, const uint8_t gap_extend,
+                   const void *query_profile, const void *query_consens,
+                   const void *gap_open_del, const void *gap_close_del, const void *gap_open_ins,
+                   uint16_t terminate, uint16_t bias, int32_t maskLen, alignment_end *bests) {
+#ifndef GAP_POS_SCORING
+    (void) gap_open_del; (void) gap_close_del; (void) gap_open_ins;
+#endif
+    sw_sse2_byte<profileProfile, posSpecificGaps>(buffers, db_sequence, (const simd_int *) db_profile_byte, ref_dir, db_length, query_length,
+                                                  gap_open, gap_extend, (const simd_int *) query_profile, (const simd_int *) query_consens,
+#ifdef GAP_POS_SCORING
+                                                  (const simd_int *) gap_open_del, (const simd_int *) gap_close_del, (const simd_int *) gap_open_ins,
+#endif
+                                                  static_cast<uint8_t>(terminate), static_cast<uint8_t>(bias), maskLen, bests);
+}
+
+template <const bool profileProfile, const bool posSpecificGaps>
+static void swWord(const SmithWatermanKernel::Buffers &buffers, const unsigned char *db_sequence, const void *db_profile_byte,
+                   int8_t ref_dir, int32_t db_length, int32_t query_length, const uint8_t gap_open, const uint8_t gap_extend,
+                   const void *query_profile, const void *query_consens,
+                   const void *gap_open_del, const void *gap_close_del, const void *gap_open_ins,
+                   uint16_t terminate, uint16_t bias, int32_t maskLen, alignment_end *bests) {
+#ifndef GAP_POS_SCORING
+    (void) gap_open_del; (void) gap_close_del; (void) gap_open_ins;
+#endif
+    sw_sse2_word<profileProfile, posSpecificGaps>(buffers, db_sequence, (const simd_int *) db_profile_byte, ref_dir, db_length, query_length,
+                                                  gap_open, gap_extend, (const simd_int *) query_profile, (const simd_int *) query_consens,
+#ifdef GAP_POS_SCORING
+                                                  (const simd_int *) gap_open_del, (const simd_int *) gap_close_del, (const simd_int *) gap_open_ins,
+#endif
+                                                  terminate, bias, maskLen, bests);
+}
+
+#define SW_KERNEL_DISPATCH(kernel) \
+    if (profileProfile) { \
+        if (posSpecificGaps) { \
+            kernel<true, true>(buffers, db_sequence, db_profile_byte, ref_dir, db_length, query_length, gap_open, gap_extend, \
+                               query_profile, query_consens, gap_open_del, gap_close_del, gap_open_ins, terminate, bias, maskLen, bests); \
+        } else { \
+            kernel<true, false>(buffers, db_sequence, db_profile_byte, ref_dir, db_length, query_length, gap_open, gap_extend, \
+                                query_profile, query_consens, gap_open_del, gap_close_del, gap_open_ins, terminate, bias, maskLen, bests); \
+        } \
+    } else { \
+        if (posSpecificGaps) { \
+            kernel<false, true>(buffers, db_sequence, db_profile_byte, ref_dir, db_length, query_length, gap_open, gap_extend, \
+                                query_profile, query_consens, gap_open_del, gap_close_del, gap_open_ins, terminate, bias, maskLen, bests); \
+        } else { \
+            kernel<false, false>(buffers, db_sequence, db_profile_byte, ref_dir, db_length, query_length, gap_open, gap_extend, \
+                                 query_profile, query_consens, gap_open_del, gap_close_del, gap_open_ins, terminate, bias, maskLen, bests); \
+        } \
+    }
+
+static void swByteDispatch(bool profileProfile, bool posSpecificGaps, const SmithWatermanKernel::Buffers &buffers,
+                           const unsigned char *db_sequence, const void *db_profile_byte, int8_t ref_dir,
+                           int32_t db_length, int32_t query_length, const uint8_t gap_open, const uint8_t gap_extend,
+                           const void *query_profile, const void *query_consens,
+                           const void *gap_open_del, const void *gap_close_del, const void *gap_open_ins,
+                           uint16_t terminate, uint16_t bias, int32_t maskLen, alignment_end *bests) {
+    SW_KERNEL_DISPATCH(swByte)
+}
+
+static void swWordDispatch(bool profileProfile, bool posSpecificGaps, const SmithWatermanKernel::Buffers &buffers,
+                           const unsigned char *db_sequence, const void *db_profile_byte, int8_t ref_dir,
+                           int32_t db_length, int32_t query_length, const uint8_t gap_open, const uint8_t gap_extend,
+                           const void *query_profile, const void *query_consens,
+                           const void *gap_open_del, const void *gap_close_del, const void *gap_open_ins,
+                           uint16_t terminate, uint16_t bias, int32_t maskLen, alignment_end *bests) {
+    SW_KERNEL_DISPATCH(swWord)
+}
+#undef SW_KERNEL_DISPATCH
+
+// declared extern in StripedSmithWatermanKernel.h
+const SmithWatermanKernel smithWatermanKernel = {
+    sizeof(simd_int),
+    swByteDispatch,
+    swWordDispatch,
+    ungapped_alignment,
+    sw_batch_byte
+};
+
+}
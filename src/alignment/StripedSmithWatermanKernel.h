@@ -0,0 +1,85 @@
+#ifndef STRIPED_SMITH_WATERMAN_KERNEL_H
+#define STRIPED_SMITH_WATERMAN_KERNEL_H
+
+// Vectorized inner loops of SmithWaterman.
+// The kernels are compiled once per instruction set (see SimdDispatch). The width of simd_int differs
+// between the variants, so all vectors are passed as untyped pointers and are laid out
+// in the striped format for vectorBytes wide vectors.
+#include <cstddef>
+#include <stdint.h>
+
+struct SmithWatermanKernel {
+    typedef struct {
+        uint16_t score;
+        int32_t ref;	 //0-based position
+        int32_t read;    //alignment ending position on read, 0-based
+    } alignment_end;
+
+    // scratch memory owned by SmithWaterman
+    struct Buffers {
+        void *vHStore;
+        void *vHLoad;
+        void *vE;
+        void *vHmax;
+        uint8_t *maxColumn;
+    };
+
+    /* Striped Smith-Waterman
+     Record the highest score of each reference position.
+     Writes the alignment score and ending position of the best and 2nd best alignment to bests.
+     Gap begin and gap extension are different.
+     wight_match > 0, all other weights < 0.
+     The returned positions are 0-based.
+     gap_open_del, gap_close_del and gap_open_ins are only used with GAP_POS_SCORING.
+     */
+    typedef void (*sw_t)(bool profileProfile, bool posSpecificGaps, const Buffers &buffers,
+                         const unsigned char *db_sequence, const void *db_profile_byte,
+                         int8_t ref_dir,	// 0: forward ref; 1: reverse ref
+                         int32_t db_length, int32_t query_length,
+                         const uint8_t gap_open, /* will be used as - */
+                         const uint8_t gap_extend, /* will be used as - */
+                         const void *query_profile, const void *query_consens,
+                         const void *gap_open_del, const void *gap_close_del, const void *gap_open_ins,
+                         uint16_t terminate,	/* the best alignment score: used to terminate
+                                                 the matrix calculation when locating the
+                                                 alignment beginning point. If this score
+                                                 is set to 0, it will not be used */
+                         uint16_t bias,  /* Shift 0 point to a positive value. */
+                         int32_t maskLen, alignment_end *bests);
+
+    // max diagonal score of the byte query profile against db_sequence
+    typedef int (*ungapped_t)(const Buffers &buffers, const void *query_profile_byte, int32_t query_length,
+                              uint8_t bias, const unsigned char *db_sequence, int32_t db_length);
+
+    // inter-sequence Smith-Waterman of one query against vectorBytes targets, one target per byte lane
+    // query_table holds 32 biased byte scores per query position, residue j of target l is targets[j * vectorBytes + l]
+    // hStore and fStore need query_length vectors, scores receives the best score of each lane (255 on overflow)
+    // and queryEnds/targetEnds the 0-based end of its alignment if the score is at least end_score
+    typedef void (*sw_batch_t)(const uint8_t *query_table, int32_t query_length, const unsigned char *targets,
+                               int32_t target_length, uint8_t gap_open, uint8_t gap_extend, uint8_t bias, uint8_t end_score,
+                               void *hStore, void *fStore, uint8_t *scores, int32_t *queryEnds, int32_t *targetEnds);
+
+    // bytes per vector, byte profiles hold vectorBytes and word profiles vectorBytes / 2 elements per vector
+    size_t vectorBytes;
+    sw_t swByte;
+    sw_t swWord;
+    ungapped_t ungappedAlignment;
+    sw_batch_t swByteBatch;
+
+    // kernels for the instruction set selected by SimdDispatch
+    static const SmithWatermanKernel *get();
+};
+
+namespace simd_baseline {
+    extern const SmithWatermanKernel smithWatermanKernel;
+}
+#ifdef SIMD_DISPATCH
+namespace simd_avx2 {
+    extern const SmithWatermanKernel smithWatermanKernel;
+}
+namespace simd_avx512 {
+    extern const SmithWatermanKernel smithWatermanKernel;
+}
+#endif
+
+#endif
@@ -0,0 +1,221 @@
+#include "WavefrontAligner.h"
+
+#include <algorithm>
+#include <climits>
+
+// offsets are target positions, an offset h on diagonal k is the cell (query h - k, target h)
+static const int WF_NULL = INT_MIN / 2;
+static const int COMPONENT_M = 0;
+static const int COMPONENT_I = 1;
+static const int COMPONENT_D = 2;
+// border diagonals lagging more than this many anti-diagonals behind the furthest one are dropped
+// once the wavefront is wider than WF_MIN_REDUCE_WIDTH
+static const int WF_MAX_LAG = 50;
+static const int WF_MIN_REDUCE_WIDTH = 10;
+
+static inline int clipOffset(int offset, int k, int queryLen, int targetLen) {
+    if (offset < 0 || offset > targetLen || offset - k > queryLen) {
+        return WF_NULL;
+    }
+    return offset;
+}
+
+WavefrontAligner::WavefrontAligner(int mismatch, int gapOpen, int gapExtend, int unknownResidue)
+        : penalty(0), queryStart(0), targetStart(0), mismatch(mismatch), gapOpen(gapOpen), gapExtend(gapExtend),
+          unknownResidue(unknownResidue) {}
+
+int WavefrontAligner::Component::at(int k) const {
+    return (k >= lo && k <= hi) ? values[k] : WF_NULL;
+}
+
+WavefrontAligner::Component WavefrontAligner::getComponent(int score, int component) const {
+    Component c;
+    if (score < 0 || wavefronts[score].lo > wavefronts[score].hi) {
+        c.values = NULL;
+        c.lo = 0;
+        c.hi = -1;
+        return c;
+    }
+    const Wavefront &w = wavefronts[score];
+    c.values = &pool[w.offset + component * w.width] - w.storedLo;
+    c.lo = w.lo;
+    c.hi = w.hi;
+    return c;
+}
+
+int WavefrontAligner::get(int score, int component, int k) const {
+    if (score < 0) {
+        return WF_NULL;
+    }
+    const Wavefront &w = wavefronts[score];
+    if (k < w.lo || k > w.hi) {
+        return WF_NULL;
+    }
+    return pool[w.offset + component * w.width + (k - w.storedLo)];
+}
+
+int WavefrontAligner::mismatchSource(int score, int k, int queryLen, int targetLen) const {
+    const int offset = get(score - mismatch, COMPONENT_M, k);
+    return (offset < 0) ? WF_NULL : clipOffset(offset + 1, k, queryLen, targetLen);
+}
+
+bool WavefrontAligner::align(const unsigned char *query, int queryLen, const unsigned char *target, int targetLen,
+                             int startDiagonal, int startBand, int maxPenalty, float penaltyPerPosition) {
+    wavefronts.clear();
+    pool.clear();
+    const int gapOpenExtend = gapOpen + gapExtend;
+    // furthest distance from the start border, every diagonal starts on the first row or column
+    int progress = 0;
+    for (int score = 0; score <= maxPenalty; score++) {
+        if (score > mismatch + penaltyPerPosition * progress) {
+            return false;
+        }
+        Wavefront w;
+        if (score == 0) {
+            w.lo = startDiagonal - startBand;
+            w.hi = startDiagonal + startBand;
+        } else {
+            w.lo = INT_MAX;
+            w.hi = INT_MIN;
+            // diagonal range reachable from the source wavefronts
+            const int sources[5][2] = {{score - mismatch, 0},
+                                       {score - gapOpenExtend, 1}, {score - gapOpenExtend, -1},
+                                       {score - gapExtend, 1}, {score - gapExtend, -1}};
+            for (size_t i = 0; i < 5; i++) {
+                const int source = sources[i][0];
+                if (source >= 0 && wavefronts[source].lo <= wavefronts[source].hi) {
+                    w.lo = std::min(w.lo, wavefronts[source].lo + sources[i][1]);
+                    w.hi = std::max(w.hi, wavefronts[source].hi + sources[i][1]);
+                }
+            }
+        }
+        w.lo = std::max(w.lo, -queryLen);
+        w.hi = std::min(w.hi, targetLen);
+        w.offset = pool.size();
+        if (w.lo > w.hi) {
+            w.lo = 0;
+            w.hi = -1;
+            w.storedLo = 0;
+            w.width = 0;
+            wavefronts.push_back(w);
+            continue;
+        }
+        const int width = w.hi - w.lo + 1;
+        w.storedLo = w.lo;
+        w.width = width;
+        pool.resize(pool.size() + 3 * width, WF_NULL);
+        wavefronts.push_back(w);
+
+        int *M = &pool[w.offset];
+        int *I = M + width;
+        int *D = I + width;
+        if (score == 0) {
+            for (int k = w.lo; k <= w.hi; k++) {
+                M[k - w.lo] = std::max(k, 0);
+            }
+        } else {
+            const Component mismatchM = getComponent(score - mismatch, COMPONENT_M);
+            const Component openM = getComponent(score - gapOpenExtend, COMPONENT_M);
+            const Component extendI = getComponent(score - gapExtend, COMPONENT_I);
+            const Component extendD = getComponent(score - gapExtend, COMPONENT_D);
+            for (int k = w.lo; k <= w.hi; k++) {
+                int ins = std::max(openM.at(k - 1), extendI.at(k - 1));
+                ins = (ins < 0) ? WF_NULL : clipOffset(ins + 1, k, queryLen, targetLen);
+                int del = std::max(openM.at(k + 1), extendD.at(k + 1));
+                del = (del < 0) ? WF_NULL : clipOffset(del, k, queryLen, targetLen);
+                int mis = mismatchM.at(k);
+                mis = (mis < 0) ? WF_NULL : clipOffset(mis + 1, k, queryLen, targetLen);
+                I[k - w.lo] = ins;
+                D[k - w.lo] = del;
+                M[k - w.lo] = std::max(mis, std::max(ins, del));
+            }
+        }
+
+        int wavefrontFurthest = 0;
+        for (int k = w.lo; k <= w.hi; k++) {
+            int h = M[k - w.lo];
+            if (h < 0) {
+                continue;
+            }
+            int v = h - k;
+            while (v < queryLen && h < targetLen && query[v] == target[h] && query[v] < unknownResidue) {
+                v++;
+                h++;
+            }
+            M[k - w.lo] = h;
+            wavefrontFurthest = std::max(wavefrontFurthest, h + v);
+            progress = std::max(progress, std::min(h, v));
+            if (v == queryLen || h == targetLen) {
+                penalty = score;
+                backtrace(score, k, h, queryLen, targetLen);
+                return true;
+            }
+        }
+
+        Wavefront &reduced = wavefronts.back();
+        if (width > WF_MIN_REDUCE_WIDTH) {
+            while (reduced.lo < reduced.hi && 2 * M[reduced.lo - w.lo] - reduced.lo < wavefrontFurthest - WF_MAX_LAG) {
+                reduced.lo++;
+            }
+            while (reduced.hi > reduced.lo && 2 * M[reduced.hi - w.lo] - reduced.hi < wavefrontFurthest - WF_MAX_LAG) {
+                reduced.hi--;
+            }
+        }
+    }
+    return false;
+}
+
+void WavefrontAligner::backtrace(int score, int k, int offset, int queryLen, int targetLen) {
+    operations.clear();
+    const int gapOpenExtend = gapOpen + gapExtend;
+    int component = COMPONENT_M;
+    while (true) {
+        if (component == COMPONENT_M) {
+            if (score == 0) {
+                const int start = std::max(k, 0);
+                operations.insert(operations.end(), offset - start, OP_MATCH);
+                targetStart = start;
+                queryStart = start - k;
+                break;
+            }
+            // undo the match extension, then continue with the source the offset was taken from
+            const int mis = mismatchSource(score, k, queryLen, targetLen);
+            const int ins = get(score, COMPONENT_I, k);
+            const int del = get(score, COMPONENT_D, k);
+            const int source = std::max(mis, std::max(ins, del));
+            operations.insert(operations.end(), offset - source, OP_MATCH);
+            offset = source;
+            if (source == mis) {
+                operations.push_back(OP_MATCH);
+                offset--;
+                score -= mismatch;
+            } else if (source == ins) {
+                component = COMPONENT_I;
+            } else {
+                component = COMPONENT_D;
+            }
+        } else if (component == COMPONENT_I) {
+            operations.push_back(OP_DEL);
+            const int open = get(score - gapOpenExtend, COMPONENT_M, k - 1);
+            if (open >= 0 && open + 1 == offset) {
+                score -= gapOpenExtend;
+                component = COMPONENT_M;
+            } else {
+                score -= gapExtend;
+            }
+            k--;
+            offset--;
+        } else {
+            operations.push_back(OP_INS);
+            const int open = get(score - gapOpenExtend, COMPONENT_M, k + 1);
+            if (open >= 0 && open == offset) {
+                score -= gapOpenExtend;
+                component = COMPONENT_M;
+            } else {
+                score -= gapExtend;
+            }
+            k++;
+        }
+    }
+    std::reverse(operations.begin(), operations.end());
+}
@@ -0,0 +1,75 @@
+#ifndef MMSEQS_WAVEFRONTALIGNER_H
+#define MMSEQS_WAVEFRONTALIGNER_H
+
+// Gap-affine wavefront alignment (WFA, Marco-Sola et al. 2021).
+// Runs in O(n s) time for a penalty s, so it is much faster than a DP fill for nearly identical sequences.
+// Penalties are costs: matches cost 0, a mismatch costs mismatch and a gap of length l costs gapOpen + l * gapExtend.
+// The alignment starts on the first row or column within startBand diagonals of startDiagonal
+// and ends as soon as the end of either sequence is reached.
+// Like WFA-adaptive, diagonals at the wavefront borders that fall far behind the furthest one are dropped,
+// so the result is not guaranteed to be optimal for divergent pairs.
+#include <cstddef>
+#include <vector>
+
+class WavefrontAligner {
+public:
+    // cigar operations, same meaning as in ksw2: OP_INS consumes the query, OP_DEL the target
+    enum Operation {
+        OP_MATCH = 0,
+        OP_INS = 1,
+        OP_DEL = 2
+    };
+
+    // residues with a code of at least unknownResidue never match, not even themselves
+    WavefrontAligner(int mismatch, int gapOpen, int gapExtend, int unknownResidue = 256);
+
+    // diagonal is target position - query position
+    // returns false if no alignment with a penalty of at most maxPenalty exists or if the penalty
+    // exceeds penaltyPerPosition for each position the furthest wavefront point has advanced along the diagonal
+    bool align(const unsigned char *query, int queryLen, const unsigned char *target, int targetLen,
+               int startDiagonal, int startBand, int maxPenalty, float penaltyPerPosition);
+
+    // result of the last successful align call
+    int penalty;
+    int queryStart;
+    int targetStart;
+    // one operation per aligned column in forward direction
+    std::vector<unsigned char> operations;
+
+private:
+    struct Wavefront {
+        // diagonals that are still followed, lagging diagonals at the borders are dropped
+        int lo;
+        int hi;
+        // diagonal range and position of the stored components
+        int storedLo;
+        int width;
+        size_t offset;
+    };
+
+    int mismatch;
+    int gapOpen;
+    int gapExtend;
+    int unknownResidue;
+
+    // M, I (consumes target) and D (consumes query) offsets of all wavefronts
+    // for a wavefront w component c of diagonal k is at pool[w.offset + c * w.width + k - w.storedLo]
+    std::vector<Wavefront> wavefronts;
+    std::vector<int> pool;
+
+    // one component of a wavefront, values[k] is valid for lo <= k <= hi
+    struct Component {
+        const int *values;
+        int lo;
+        int hi;
+
+        int at(int k) const;
+    };
+
+    Component getComponent(int score, int component) const;
+    int get(int score, int component, int k) const;
+    int mismatchSource(int score, int k, int queryLen, int targetLen) const;
+    void backtrace(int score, int k, int offset, int queryLen, int targetLen);
+};
+
+#endif
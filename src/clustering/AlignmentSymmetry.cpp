@@ -5,10 +5,13 @@
 #include <climits>
 #include <new>
 #include <algorithm>
+#include <vector>
 #include "Parameters.h"
 #include "Util.h"
 #include "Debug.h"
 #include "FastSort.h"
+#include "Matcher.h"
+#include "FileUtil.h"
 #include <cmath>
 
 #ifdef OPENMP
@@ -18,9 +21,10 @@
 #define LEN(x, y) (x[y+1] - x[y])
 
 void AlignmentSymmetry::readInData(DBReader<unsigned int>*alnDbr, DBReader<unsigned int>*seqDbr,
-                                   unsigned int **elementLookupTable, unsigned short **elementScoreTable,
-                                   int scoretype, size_t *offsets) {
+                                   unsigned int *elements, unsigned short *scores,
+                                   int scoretype, size_t *offsets, size_t *elementOffsets) {
     const int alnType = alnDbr->getDbtype();
+    const bool binaryAlignment = Matcher::isBinaryAlignmentResult(alnType);
     const size_t dbSize = seqDbr->getSize();
     const size_t flushSize = 1000000;
     Debug::Progress progress(dbSize);
@@ -41,30 +45,59 @@ void AlignmentSymmetry::readInData(DBReader<unsigned int>*alnDbr, DBReader<unsig
                 // the assumption is that clustering is B -> B (not A -> B)
                 const unsigned int clusterId = seqDbr->getDbKey(i);
                 char *data = alnDbr->getDataByDBKey(clusterId, thread_idx);
+                const unsigned int binaryCount = binaryAlignment ? Matcher::getBinaryResultCount(data, alnDbr->getEntryLen(alnDbr->getId(clusterId))) : 0;
+                unsigned int *setElements = elements + elementOffsets[i];
+                unsigned short *setScores = (scores != NULL) ? scores + elementOffsets[i] : NULL;
 
-                if (*data == '\0') { // check if file contains entry
-                    elementLookupTable[i][0] = seqDbr->getId(clusterId);
-                    if (elementScoreTable != NULL) {
-                        if (Parameters::isEqualDbtype(alnType, Parameters::DBTYPE_ALIGNMENT_RES)) {
+                if (binaryAlignment ? (binaryCount == 0) : (*data == '\0')) { // check if file contains entry
+                    setElements[0] = seqDbr->getId(clusterId);
+                    if (setScores != NULL) {
+                        if (Parameters::isEqualDbtype(alnType, Parameters::DBTYPE_ALIGNMENT_RES) || binaryAlignment) {
                             if (scoretype == Parameters::APC_ALIGNMENTSCORE) {
                                 //column 1 = alignment score
-                                elementScoreTable[i][0] = (unsigned short) (USHRT_MAX);
+                                setScores[0] = (unsigned short) (USHRT_MAX);
                             } else {
                                 //column 2 = sequence identity [0-1]
-                                elementScoreTable[i][0] = (unsigned short) (1.0 * 1000.0f);
+                                setScores[0] = (unsigned short) (1.0 * 1000.0f);
                             }
                         } else if (Parameters::isEqualDbtype(alnType, Parameters::DBTYPE_PREFILTER_RES) ||
                                    Parameters::isEqualDbtype(alnType, Parameters::DBTYPE_PREFILTER_REV_RES)) {
                             //column 1 = alignment score or sequence identity [0-100]
-                            elementScoreTable[i][0] = (unsigned short) (USHRT_MAX);
+                            setScores[0] = (unsigned short) (USHRT_MAX);
                         } else if (Parameters::isEqualDbtype(alnType, Parameters::DBTYPE_CLUSTER_RES)) {
-                            elementScoreTable[i][0] = (unsigned short) (USHRT_MAX);
+                            setScores[0] = (unsigned short) (USHRT_MAX);
                         }
                     }
                     continue;
                 }
                 size_t setSize = LEN(offsets, i);
                 size_t writePos = 0;
+                if (binaryAlignment) {
+                    // records are read in place, no line parsing needed
+                    const Matcher::result_bin_t *records = Matcher::getBinaryResults(data);
+                    for (unsigned int j = 0; j < binaryCount && writePos < setSize; ++j) {
+                        const Matcher::result_bin_t &record = records[j];
+                        const size_t currElement = seqDbr->getId(record.dbKey);
+                        if (setScores != NULL) {
+                            if (scoretype == Parameters::APC_ALIGNMENTSCORE) {
+                                setScores[writePos] = (unsigned short) (record.score);
+                            } else {
+                                setScores[writePos] = (unsigned short) (record.seqId * 1000.0f);
+                            }
+                        }
+                        if (currElement == UINT_MAX || currElement > seqDbr->getSize()) {
+                            Debug(Debug::ERROR) << "Element " << record.dbKey
+                                                << " contained in some alignment list, but not contained in the sequence database!\n";
+                            EXIT(EXIT_FAILURE);
+                        }
+                        setElements[writePos] = currElement;
+                        writePos++;
+                    }
+                    if (writePos < binaryCount) {
+                        Debug(Debug::ERROR) << "Set " << i << " has more elements than allocated (" << setSize << ")!\n";
+                    }
+                    continue;
+                }
                 while (*data != '\0') {
                     if (writePos >= setSize) {
                         Debug(Debug::ERROR) << "Set " << i
@@ -77,16 +110,16 @@ void AlignmentSymmetry::readInData(DBReader<unsigned int>*alnDbr, DBReader<unsig
                     Util::parseKey(data, dbKey);
                     const unsigned int key = (unsigned int) strtoul(dbKey, NULL, 10);
                     const size_t currElement = seqDbr->getId(key);
-                    if (elementScoreTable != NULL) {
+                    if (setScores != NULL) {
                         if (Parameters::isEqualDbtype(alnType,Parameters::DBTYPE_ALIGNMENT_RES)) {
                             if (scoretype == Parameters::APC_ALIGNMENTSCORE) {
                                 //column 1 = alignment score
                                 Util::parseByColumnNumber(data, similarity, 1);
-                                elementScoreTable[i][writePos] = (unsigned short) (atof(similarity));
+                                setScores[writePos] = (unsigned short) (atof(similarity));
                             } else {
                                 //column 2 = sequence identity [0-1]
                                 Util::parseByColumnNumber(data, similarity, 2);
-                                elementScoreTable[i][writePos] = (unsigned short) (atof(similarity) * 1000.0f);
+                                setScores[writePos] = (unsigned short) (atof(similarity) * 1000.0f);
                             }
                         }
                         else if (Parameters::isEqualDbtype(alnType, Parameters::DBTYPE_PREFILTER_RES) ||
@@ -94,10 +127,10 @@ void AlignmentSymmetry::readInData(DBReader<unsigned int>*alnDbr, DBReader<unsig
                             //column 1 = alignment score or sequence identity [0-100]
                             Util::parseByColumnNumber(data, similarity, 1);
                             short sim = atoi(similarity);
-                            elementScoreTable[i][writePos] = (unsigned short) (sim >0 ? sim : -sim);
+                            setScores[writePos] = (unsigned short) (sim >0 ? sim : -sim);
                         }
                         else if (Parameters::isEqualDbtype(alnType, Parameters::DBTYPE_CLUSTER_RES)) {
-                            elementScoreTable[i][writePos] = (unsigned short) (USHRT_MAX);
+                            setScores[writePos] = (unsigned short) (USHRT_MAX);
                         }
                         else {
                             Debug(Debug::ERROR) << "Alignment format is not supported!\n";
@@ -110,7 +143,7 @@ void AlignmentSymmetry::readInData(DBReader<unsigned int>*alnDbr, DBReader<unsig
                                             << " contained in some alignment list, but not contained in the sequence database!\n";
                         EXIT(EXIT_FAILURE);
                     }
-                    elementLookupTable[i][writePos] = currElement;
+                    setElements[writePos] = currElement;
                     writePos++;
                     data = Util::skipLine(data);
                 }
@@ -120,7 +153,7 @@ void AlignmentSymmetry::readInData(DBReader<unsigned int>*alnDbr, DBReader<unsig
     }
 }
 
-size_t AlignmentSymmetry::findMissingLinks(unsigned int ** elementLookupTable, size_t * offsetTable, size_t dbSize, int threads) {
+size_t AlignmentSymmetry::findMissingLinks(unsigned int *elements, size_t *offsetTable, size_t dbSize, int threads) {
     // init memory for parallel merge
     unsigned int * tmpSize = new(std::nothrow) unsigned int[threads * dbSize];
     Util::checkAllocation(tmpSize, "Can not allocate memory in findMissingLinks");
@@ -135,10 +168,10 @@ size_t AlignmentSymmetry::findMissingLinks(unsigned int ** elementLookupTable, s
         for (size_t setId = 0; setId < dbSize; setId++) {
             const size_t elementSize = LEN(offsetTable, setId);
             for (size_t elementId = 0; elementId < elementSize; elementId++) {
-                const unsigned int currElm = elementLookupTable[setId][elementId];
+                const unsigned int currElm = elements[offsetTable[setId] + elementId];
                 const unsigned int currElementSize = LEN(offsetTable, currElm);
-                const bool elementFound = std::binary_search(elementLookupTable[currElm],
-                                                             elementLookupTable[currElm] + currElementSize, setId);
+                const bool elementFound = std::binary_search(elements + offsetTable[currElm],
+                                                             elements + offsetTable[currElm] + currElementSize, setId);
                 // this is a new connection since setId is not contained in currentElementSet
                 if (elementFound == false) {
                     tmpSize[static_cast<size_t>(currElm) * static_cast<size_t>(threads) +
@@ -164,8 +197,8 @@ size_t AlignmentSymmetry::findMissingLinks(unsigned int ** elementLookupTable, s
     return symmetricElementCount;
 }
 
-void AlignmentSymmetry::addMissingLinks(unsigned int **elementLookupTable,
-                                        size_t * offsetTableWithOutNewLinks, size_t * offsetTableWithNewLinks, size_t dbSize, unsigned short **elementScoreTable) {
+void AlignmentSymmetry::addMissingLinks(unsigned int *elements,
+                                        size_t * offsetTableWithOutNewLinks, size_t * offsetTableWithNewLinks, size_t dbSize, unsigned short *scores) {
 
     // iterate over all connections and check if it exists in the corresponding set
     // if not add it
@@ -181,25 +214,27 @@ void AlignmentSymmetry::addMissingLinks(unsigned int **elementLookupTable,
                                    " OldElementSize(" << oldElementSize <<") in addMissingLinks";
             EXIT(EXIT_FAILURE);
         }
+        const size_t setOffset = offsetTableWithNewLinks[setId];
         for(size_t elementId = 0; elementId < oldElementSize; elementId++) {
-            const unsigned int currElm = elementLookupTable[setId][elementId];
+            const unsigned int currElm = elements[setOffset + elementId];
             if(currElm == UINT_MAX || currElm > dbSize){
                 Debug(Debug::ERROR) << "currElm > dbSize in element list (addMissingLinks). This should not happen.\n";
                 EXIT(EXIT_FAILURE);
             }
             const unsigned int oldCurrElementSize = LEN(offsetTableWithOutNewLinks, currElm);
             const unsigned int newCurrElementSize = LEN(offsetTableWithNewLinks, currElm);
+            unsigned int *currElements = elements + offsetTableWithNewLinks[currElm];
 
             bool found = false;
             // check if setId is already in set of currElm
             for(size_t pos = 0; pos < oldCurrElementSize && found == false; pos++){
-                found = (elementLookupTable[currElm][pos] == setId);
+                found = (currElements[pos] == setId);
             }
             // this is a new connection
             if(found == false){ // add connection if it could not be found
                 // find pos to write
                 size_t pos = oldCurrElementSize;
-                while( pos < newCurrElementSize && elementLookupTable[currElm][pos] != UINT_MAX ){
+                while( pos < newCurrElementSize && currElements[pos] != UINT_MAX ){
                     pos++;
                 }
 
@@ -207,18 +242,79 @@ void AlignmentSymmetry::addMissingLinks(unsigned int **elementLookupTable,
                     Debug(Debug::ERROR) << "pos(" << pos << ") > newCurrElementSize(" << newCurrElementSize << "). This should not happen.\n";
                     EXIT(EXIT_FAILURE);
                 }
-                elementLookupTable[currElm][pos] = setId;
-                elementScoreTable[currElm][pos]=elementScoreTable[setId][elementId];
+                currElements[pos] = setId;
+                scores[offsetTableWithNewLinks[currElm] + pos] = scores[setOffset + elementId];
             }
         }
     }
 }
 
 // sort each element vector for bsearch
-void AlignmentSymmetry::sortElements(unsigned int **elementLookupTable, size_t *elementOffsets, size_t dbSize) {
+void AlignmentSymmetry::sortElements(unsigned int *elements, size_t *elementOffsets, size_t dbSize) {
+#pragma omp parallel for schedule(dynamic, 1000)
+    for (size_t i = 0; i < dbSize; i++) {
+        SORT_SERIAL(elements + elementOffsets[i], elements + elementOffsets[i + 1]);
+    }
+}
+static inline size_t varintSize(unsigned int value) {
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+unsigned char *AlignmentSymmetry::compressElements(unsigned int *elements, unsigned short *scores,
+                                                   size_t *elementOffsets, size_t *byteOffsets, size_t dbSize,
+                                                   const std::string &spillFile) {
+    // first pass: sort the lists and count their encoded size
+#pragma omp parallel
+    {
+        std::vector<std::pair<unsigned int, unsigned short>> set;
+#pragma omp for schedule(dynamic, 1000)
+        for (size_t i = 0; i < dbSize; i++) {
+            set.clear();
+            for (size_t j = elementOffsets[i]; j < elementOffsets[i + 1]; j++) {
+                set.emplace_back(elements[j], scores[j]);
+            }
+            SORT_SERIAL(set.begin(), set.end());
+            size_t bytes = 0;
+            unsigned int prevElement = 0;
+            for (size_t j = 0; j < set.size(); j++) {
+                elements[elementOffsets[i] + j] = set[j].first;
+                scores[elementOffsets[i] + j] = set[j].second;
+                bytes += varintSize(set[j].first - prevElement);
+                prevElement = set[j].first;
+            }
+            byteOffsets[i] = bytes;
+        }
+    }
+    byteOffsets[dbSize] = 0;
+    computeOffsetFromCounts(byteOffsets, dbSize);
+
+    // second pass: encode every list at its offset
+    unsigned char *compressed;
+    if (spillFile.empty()) {
+        compressed = new(std::nothrow) unsigned char[byteOffsets[dbSize]];
+        Util::checkAllocation(compressed, "Can not allocate compressed elements memory in AlignmentSymmetry::compressElements");
+    } else {
+        compressed = static_cast<unsigned char *>(FileUtil::mmapTemporaryFile(spillFile, byteOffsets[dbSize]));
+    }
 #pragma omp parallel for schedule(dynamic, 1000)
     for (size_t i = 0; i < dbSize; i++) {
-        SORT_SERIAL(elementLookupTable[i], elementLookupTable[i] + LEN(elementOffsets, i));
+        unsigned char *out = compressed + byteOffsets[i];
+        unsigned int prevElement = 0;
+        for (size_t j = elementOffsets[i]; j < elementOffsets[i + 1]; j++) {
+            unsigned int delta = elements[j] - prevElement;
+            prevElement = elements[j];
+            while (delta >= 0x80) {
+                *out++ = static_cast<unsigned char>(delta | 0x80);
+                delta >>= 7;
+            }
+            *out++ = static_cast<unsigned char>(delta);
+        }
     }
+    return compressed;
 }
 #undef LEN
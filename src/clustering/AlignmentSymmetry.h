@@ -13,7 +13,10 @@
 
 class AlignmentSymmetry {
 public:
-    static void readInData(DBReader<unsigned int>*pReader, DBReader<unsigned int>*pDBReader, unsigned int **pInt,unsigned short**elementScoreTable, int scoretype, size_t *offsets);
+    // The graph is stored in CSR layout: the neighbours of set i are elements[elementOffsets[i]..elementOffsets[i+1])
+    // and scores is parallel to elements. readInData fills at most LEN(offsets, i) entries of set i.
+    static void readInData(DBReader<unsigned int>*pReader, DBReader<unsigned int>*pDBReader, unsigned int *elements, unsigned short *scores,
+                           int scoretype, size_t *offsets, size_t *elementOffsets);
     template<typename T>
     static void computeOffsetFromCounts(T* elementSizes, size_t dbSize)  {
         size_t prevElementLength = elementSizes[0];
@@ -24,21 +27,38 @@ public:
             prevElementLength = currElementLength;
         }
     }
-    static size_t findMissingLinks(unsigned int **elementLookupTable, size_t *offsetTable, size_t dbSize, int threads);
-    static void addMissingLinks(unsigned int **elementLookupTable, size_t *offsetTable, size_t * newOffset, size_t dbSize,unsigned short**elementScoreTable);
-    static void sortElements(unsigned int **elementLookupTable, size_t *offsets, size_t dbSize);
+    static size_t findMissingLinks(unsigned int *elements, size_t *offsetTable, size_t dbSize, int threads);
+    static void addMissingLinks(unsigned int *elements, size_t *offsetTable, size_t * newOffset, size_t dbSize, unsigned short *scores);
+    static void sortElements(unsigned int *elements, size_t *offsets, size_t dbSize);
 
-    template <typename T>
-    static void setupPointers(T *elements, T **elementLookupTable, size_t *elementOffset,
-                                 unsigned int dbSize, size_t totalElementCount) {
-        for(size_t i = 0; i < dbSize; i++) {
-            if(totalElementCount < elementOffset[i]){
-                Debug(Debug::ERROR) << "Error in setupPointers. totalElementCount "
-                                    << "(" << totalElementCount << ") < elementOffset["<<i<<"] (" << elementOffset[i] << ")\n";
-                EXIT(EXIT_FAILURE);
+    // Compresses the graph after it is complete: every neighbour list is sorted (scores move along) and
+    // stored as LEB128 varints of the differences between consecutive neighbours. The list of set i
+    // starts at byteOffsets[i], its scores still start at elementOffsets[i].
+    // With a spillFile the compressed lists are mapped from that file instead of being allocated.
+    static unsigned char *compressElements(unsigned int *elements, unsigned short *scores,
+                                           size_t *elementOffsets, size_t *byteOffsets, size_t dbSize,
+                                           const std::string &spillFile = "");
+
+    // decodes one compressed neighbour list, the caller knows its length
+    class ElementReader {
+    public:
+        ElementReader(const unsigned char *data) : data(data), element(0) {}
+
+        unsigned int next() {
+            unsigned int delta = *data & 0x7F;
+            unsigned int shift = 7;
+            while (*data++ & 0x80) {
+                delta |= static_cast<unsigned int>(*data & 0x7F) << shift;
+                shift += 7;
             }
-            elementLookupTable[i] = elements + elementOffset[i];
+            element += delta;
+            return element;
         }
-    }
+
+    private:
+        const unsigned char *data;
+        unsigned int element;
+    };
+
 };
 #endif //MMSEQS_ALIGNMENTSYMMETRY_H
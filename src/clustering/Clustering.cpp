@@ -10,10 +10,11 @@ Clustering::Clustering(const std::string &seqDB, const std::string &seqDBIndex,
                        const std::string &alnDB, const std::string &alnDBIndex,
                        const std::string &outDB, const std::string &outDBIndex,
                        const std::string &sequenceWeightFile,
-                       unsigned int maxIteration, int similarityScoreType, int threads, int compressed) : maxIteration(maxIteration),
+                       unsigned int maxIteration, int similarityScoreType, int threads, int compressed, size_t memoryLimit) : maxIteration(maxIteration),
                                                                similarityScoreType(similarityScoreType),
                                                                threads(threads),
                                                                compressed(compressed),
+                                                               memoryLimit(memoryLimit),
                                                                outDB(outDB),
                                                                outDBIndex(outDBIndex) {
 
@@ -55,7 +56,7 @@ void Clustering::run(int mode) {
     std::pair<unsigned int, unsigned int> * ret;
     ClusteringAlgorithms *algorithm = new ClusteringAlgorithms(seqDbr, alnDbr,
                                                                threads, similarityScoreType,
-                                                               maxIteration);
+                                                               maxIteration, memoryLimit, outDB);
 
     if (mode == Parameters::GREEDY) {
         Debug(Debug::INFO) << "Clustering mode: Greedy\n";
@@ -12,7 +12,7 @@ public:
                const std::string &alnResultsDB, const std::string &alnResultsDBIndex,
                const std::string &outDB, const std::string &outDBIndex,
                const std::string &weightFileName,
-               unsigned int maxIteration, int similarityScoreType, int threads, int compressed);
+               unsigned int maxIteration, int similarityScoreType, int threads, int compressed, size_t memoryLimit);
 
     void run(int mode);
 
@@ -32,6 +32,7 @@ private:
 
     int threads;
     int compressed;
+    size_t memoryLimit;
     std::string outDB;
     std::string outDBIndex;
 };
@@ -3,6 +3,8 @@
 #include "Debug.h"
 #include "AlignmentSymmetry.h"
 #include "Timer.h"
+#include "Matcher.h"
+#include "FileUtil.h"
 
 #include <queue>
 #include <algorithm>
@@ -15,7 +17,8 @@
 #endif
 
 ClusteringAlgorithms::ClusteringAlgorithms(DBReader<unsigned int>* seqDbr, DBReader<unsigned int>* alnDbr,
-                                           int threads, int scoretype, int maxiterations){
+                                           int threads, int scoretype, int maxiterations,
+                                           size_t memoryLimit, const std::string &spillPrefix){
     this->seqDbr=seqDbr;
     if(seqDbr->getSize() != alnDbr->getSize()){
         Debug(Debug::ERROR) << "Sequence db size != result db size\n";
@@ -26,6 +29,9 @@ ClusteringAlgorithms::ClusteringAlgorithms(DBReader<unsigned int>* seqDbr, DBRea
     this->threads=threads;
     this->scoretype=scoretype;
     this->maxiterations=maxiterations;
+    this->memoryLimit=memoryLimit;
+    this->spillPrefix=spillPrefix;
+    this->spill=false;
     ///time
     this->clustersizes=new int[dbSize];
     std::fill_n(clustersizes, dbSize, 0);
@@ -35,6 +41,25 @@ ClusteringAlgorithms::~ClusteringAlgorithms(){
     delete [] clustersizes;
 }
 
+template <typename T>
+T *ClusteringAlgorithms::allocateGraph(size_t count, const char *name) {
+    if (spill) {
+        return static_cast<T *>(FileUtil::mmapTemporaryFile(spillPrefix + "_" + name, count * sizeof(T)));
+    }
+    T *data = new(std::nothrow) T[count];
+    Util::checkAllocation(data, std::string("Can not allocate ") + name + " memory in ClusteringAlgorithms");
+    return data;
+}
+
+template <typename T>
+void ClusteringAlgorithms::freeGraph(T *data, size_t count) {
+    if (spill) {
+        FileUtil::munmapData(data, std::max(count * sizeof(T), (size_t) 1));
+    } else {
+        delete [] data;
+    }
+}
+
 std::pair<unsigned int, unsigned int> * ClusteringAlgorithms::execute(int mode) {
     // init data
 
@@ -47,6 +72,7 @@ std::pair<unsigned int, unsigned int> * ClusteringAlgorithms::execute(int mode)
         greedyIncrementalLowMem(assignedcluster);
     }else {
         size_t elementCount = 0;
+        const bool binaryAlignment = Matcher::isBinaryAlignmentResult(alnDbr->getDbtype());
 #pragma omp parallel reduction (+:elementCount)
         {
             int thread_idx = 0;
@@ -57,15 +83,23 @@ std::pair<unsigned int, unsigned int> * ClusteringAlgorithms::execute(int mode)
             for (size_t i = 0; i < alnDbr->getSize(); i++) {
                 const char *data = alnDbr->getData(i, thread_idx);
                 const size_t dataSize = alnDbr->getEntryLen(i);
-                elementCount += (*data == '\0') ? 1 : Util::countLines(data, dataSize);
+                if (binaryAlignment) {
+                    elementCount += std::max(Matcher::getBinaryResultCount(data, dataSize), 1u);
+                } else {
+                    elementCount += (*data == '\0') ? 1 : Util::countLines(data, dataSize);
+                }
             }
         }
-        unsigned int * elements = new(std::nothrow) unsigned int[elementCount];
-        Util::checkAllocation(elements, "Can not allocate elements memory in ClusteringAlgorithms::execute");
-        unsigned int ** elementLookupTable = new(std::nothrow) unsigned int*[dbSize];
-        Util::checkAllocation(elementLookupTable, "Can not allocate elementLookupTable memory in ClusteringAlgorithms::execute");
-        unsigned short **scoreLookupTable = new(std::nothrow) unsigned short *[dbSize];
-        Util::checkAllocation(scoreLookupTable, "Can not allocate scoreLookupTable memory in ClusteringAlgorithms::execute");
+        // adding the missing links at most doubles the edges, each takes an element, a score and up to 5 compressed bytes
+        const size_t graphBytes = 2 * elementCount * (sizeof(unsigned int) + sizeof(unsigned short) + 5);
+        spill = graphBytes > memoryLimit;
+        if (spill) {
+            // the kernel writes pages that are not in use back to the files and reads them again when needed,
+            // which is slower than keeping the graph in memory but not limited by it
+            Debug(Debug::INFO) << "Graph needs up to " << graphBytes << " bytes, more than the memory limit of "
+                               << memoryLimit << " bytes. Spilling it to " << spillPrefix << "_*\n";
+        }
+        unsigned int * elements = allocateGraph<unsigned int>(elementCount, "elements");
         unsigned short *score = NULL;
         size_t *elementOffsets = new(std::nothrow) size_t[dbSize + 1];
         Util::checkAllocation(elementOffsets, "Can not allocate elementOffsets memory in ClusteringAlgorithms::execute");
@@ -74,12 +108,18 @@ std::pair<unsigned int, unsigned int> * ClusteringAlgorithms::execute(int mode)
         Util::checkAllocation(bestscore, "Can not allocate bestscore memory in ClusteringAlgorithms::execute");
         std::fill_n(bestscore, dbSize, SHRT_MIN);
 
-        readInClusterData(elementLookupTable, elements, scoreLookupTable, score, elementOffsets, elementCount);
-        ClusteringAlgorithms::initClustersizes();
+        readInClusterData(elements, score, elementOffsets, elementCount);
+        size_t *byteOffsets = new(std::nothrow) size_t[dbSize + 1];
+        Util::checkAllocation(byteOffsets, "Can not allocate byteOffsets memory in ClusteringAlgorithms::execute");
+        unsigned char *compressedElements = AlignmentSymmetry::compressElements(elements, score, elementOffsets, byteOffsets, dbSize,
+                                                                                spill ? spillPrefix + "_compressed" : "");
+        freeGraph(elements, elementOffsets[dbSize]);
+        Debug(Debug::INFO) << "Compressed " << elementOffsets[dbSize] << " edges to " << byteOffsets[dbSize] << " bytes\n";
         if (mode == 1) {
-            setCover(elementLookupTable, scoreLookupTable, assignedcluster, bestscore, elementOffsets);
+            setCover(compressedElements, score, assignedcluster, bestscore, elementOffsets, byteOffsets);
         } else if (mode == 3) {
             Debug(Debug::INFO) << "connected component mode" << "\n";
+            ClusteringAlgorithms::initClustersizes();
             for (int cl_size = dbSize - 1; cl_size >= 0; cl_size--) {
                 unsigned int representative = sorted_clustersizes[cl_size];
                 if (assignedcluster[representative] == UINT_MAX) {
@@ -96,8 +136,9 @@ std::pair<unsigned int, unsigned int> * ClusteringAlgorithms::execute(int mode)
                         myqueue.pop();
                         iterationcutoffs.pop();
                         size_t elementSize = (elementOffsets[currentid + 1] - elementOffsets[currentid]);
+                        AlignmentSymmetry::ElementReader reader(compressedElements + byteOffsets[currentid]);
                         for (size_t elementId = 0; elementId < elementSize; elementId++) {
-                            unsigned int elementtodelete = elementLookupTable[currentid][elementId];
+                            unsigned int elementtodelete = reader.next();
                             if (assignedcluster[elementtodelete] == UINT_MAX && iterationcutoff < maxiterations) {
                                 myqueue.push(elementtodelete);
                                 iterationcutoffs.push((iterationcutoff + 1));
@@ -108,18 +149,13 @@ std::pair<unsigned int, unsigned int> * ClusteringAlgorithms::execute(int mode)
 
                 }
             }
+            delete [] sorted_clustersizes;
         }
-        //delete unnecessary datastructures
-        delete [] sorted_clustersizes;
-        delete [] clusterid_to_arrayposition;
-        delete [] borders_of_set;
-
 
-        delete [] elementLookupTable;
-        delete [] elements;
+        freeGraph(compressedElements, byteOffsets[dbSize]);
+        freeGraph(score, elementOffsets[dbSize]);
+        delete [] byteOffsets;
         delete [] elementOffsets;
-        delete [] scoreLookupTable;
-        delete [] score;
         delete [] bestscore;
     }
 
@@ -145,6 +181,7 @@ std::pair<unsigned int, unsigned int> * ClusteringAlgorithms::execute(int mode)
     return assignment;
 }
 
+// sorts the set ids by set size for the connected component mode, the set cover does not need the order
 void ClusteringAlgorithms::initClustersizes(){
     unsigned int * setsize_abundance = new unsigned int[maxClustersize+1];
 
@@ -154,124 +191,290 @@ void ClusteringAlgorithms::initClustersizes(){
         setsize_abundance[clustersizes[i]]++;
     }
     //compute offsets
-    borders_of_set = new unsigned int[maxClustersize+1];
-    borders_of_set[0] = 0;
-    for (unsigned int i = 1; i < maxClustersize+1; ++i) {
-        borders_of_set[i] = borders_of_set[i-1] + setsize_abundance[i-1];
+    unsigned int offset = 0;
+    for (unsigned int i = 0; i < maxClustersize+1; ++i) {
+        unsigned int count = setsize_abundance[i];
+        setsize_abundance[i] = offset;
+        offset += count;
     }
     //fill array
     sorted_clustersizes = new(std::nothrow) unsigned int[dbSize + 1];
     Util::checkAllocation(sorted_clustersizes, "Can not allocate sorted_clustersizes memory in ClusteringAlgorithms::initClustersizes");
-
-    std::fill_n(sorted_clustersizes, dbSize+1, 0);
-    clusterid_to_arrayposition = new(std::nothrow) unsigned int[dbSize + 1];
-    Util::checkAllocation(clusterid_to_arrayposition, "Can not allocate sorted_clustersizes memory in ClusteringAlgorithms::initClustersizes");
-
-    std::fill_n(clusterid_to_arrayposition, dbSize + 1, 0);
-    //reuse setsize_abundance as offset counter
-    std::fill_n(setsize_abundance, maxClustersize + 1, 0);
+    sorted_clustersizes[dbSize] = 0;
     for (unsigned int i = 0; i < dbSize; ++i) {
-        unsigned int position = borders_of_set[clustersizes[i]] + setsize_abundance[clustersizes[i]];
-        sorted_clustersizes[position] = i;
-        clusterid_to_arrayposition[i] = position;
-        setsize_abundance[clustersizes[i]]++;
+        sorted_clustersizes[setsize_abundance[clustersizes[i]]++] = i;
     }
     delete [] setsize_abundance;
 }
 
 
-void ClusteringAlgorithms::removeClustersize(unsigned int clusterid){
-    clustersizes[clusterid]=0;
-    sorted_clustersizes[clusterid_to_arrayposition[clusterid]] = UINT_MAX;
-    clusterid_to_arrayposition[clusterid]=UINT_MAX;
+// a set is a better representative if it has more uncovered elements, ties go to the larger id
+static inline bool isBetterSet(const int *clustersizes, unsigned int a, unsigned int b) {
+    return clustersizes[a] > clustersizes[b] || (clustersizes[a] == clustersizes[b] && a > b);
 }
 
-void ClusteringAlgorithms::decreaseClustersize(unsigned int clusterid){
-    const unsigned int oldposition=clusterid_to_arrayposition[clusterid];
-    const unsigned int newposition=borders_of_set[clustersizes[clusterid]];
-    const unsigned int swapid=sorted_clustersizes[newposition];
-    if(swapid != UINT_MAX){
-        clusterid_to_arrayposition[swapid]=oldposition;
+static inline void offerSet(unsigned int *bestSet, const int *clustersizes, unsigned int element, unsigned int set) {
+    unsigned int current = bestSet[element];
+    while (current == UINT_MAX || isBetterSet(clustersizes, set, current)) {
+        if (__sync_bool_compare_and_swap(&bestSet[element], current, set)) {
+            break;
+        }
+        current = bestSet[element];
     }
-    sorted_clustersizes[oldposition]=swapid;
-
-    sorted_clustersizes[newposition]=clusterid;
-    clusterid_to_arrayposition[clusterid]=newposition;
-    borders_of_set[clustersizes[clusterid]]++;
-    clustersizes[clusterid]--;
 }
 
-void ClusteringAlgorithms::setCover(unsigned int **elementLookupTable, unsigned short ** elementScoreLookupTable,
-                                    unsigned int *assignedcluster, short *bestscore, size_t *newElementOffsets) {
-    for (int64_t cl_size = dbSize - 1; cl_size >= 0; cl_size--) {
-        const unsigned int representative = sorted_clustersizes[cl_size];
-        if (representative == UINT_MAX) {
-            continue;
+// Greedy set cover: the set with the most uncovered elements becomes the next representative.
+// Instead of picking one set at a time, every round considers a window of the largest sets and picks all sets
+// that are better than every other uncovered set sharing an uncovered element with them. Picking such a set
+// cannot change the size of any other set picked in the same round, so the representatives and their order
+// are the same as when picking the sets one by one.
+// Sets of equal size are picked by decreasing id. The earlier sequential version kept the sets in size buckets
+// whose order changed as sets moved between buckets, so clusterings can differ from it where sets tie.
+void ClusteringAlgorithms::setCover(const unsigned char *elements, unsigned short *scores,
+                                    unsigned int *assignedcluster, short *bestscore, size_t *newElementOffsets,
+                                    size_t *byteOffsets) {
+    // clustersizes holds the number of uncovered elements of uncovered sets,
+    // -1 for covered sets and -2 for sets covered in the current round
+    const size_t minWindowElements = std::max((size_t) 1 << 20, newElementOffsets[dbSize] / 64);
+
+    unsigned int *bestSet = new(std::nothrow) unsigned int[dbSize];
+    Util::checkAllocation(bestSet, "Can not allocate bestSet memory in ClusteringAlgorithms::setCover");
+    std::fill_n(bestSet, dbSize, UINT_MAX);
+    // size of each representative when it was picked
+    unsigned int *pickedSize = new(std::nothrow) unsigned int[dbSize];
+    Util::checkAllocation(pickedSize, "Can not allocate pickedSize memory in ClusteringAlgorithms::setCover");
+    std::fill_n(pickedSize, dbSize, 0);
+
+    std::vector<unsigned int> active;
+    active.reserve(dbSize);
+    for (unsigned int i = 0; i < dbSize; i++) {
+        active.push_back(i);
+    }
+    std::vector<unsigned int> window;
+    std::vector<unsigned int> picked;
+    std::vector<unsigned int> roundPicked;
+    unsigned int * histogram = new unsigned int[maxClustersize + 1];
+    int threshold = INT_MAX;
+    size_t windowElements = 0;
+    size_t rounds = 0;
+    while (true) {
+        if (threshold > 1 && windowElements < minWindowElements / 2) {
+            // the window contains all uncovered sets with at least threshold elements
+            size_t activeCount = 0;
+            std::fill_n(histogram, maxClustersize + 1, 0);
+            for (size_t i = 0; i < active.size(); i++) {
+                if (clustersizes[active[i]] > 0) {
+                    active[activeCount++] = active[i];
+                    histogram[clustersizes[active[i]]]++;
+                }
+            }
+            active.resize(activeCount);
+            if (active.empty()) {
+                break;
+            }
+            size_t elements = 0;
+            for (threshold = maxClustersize; threshold > 1; threshold--) {
+                elements += (size_t) histogram[threshold] * threshold;
+                if (elements >= minWindowElements) {
+                    break;
+                }
+            }
+            window.clear();
+            windowElements = 0;
+            for (size_t i = 0; i < active.size(); i++) {
+                if (clustersizes[active[i]] >= threshold) {
+                    window.push_back(active[i]);
+                    windowElements += clustersizes[active[i]];
+                }
+            }
         }
-//          Debug(Debug::INFO)<<alnDbr->getDbKey(representative)<<"\n";
-        removeClustersize(representative);
-        assignedcluster[representative] = representative;
-        //delete clusters of members;
-        size_t elementSize = (newElementOffsets[representative + 1] - newElementOffsets[representative]);
-        for (size_t elementId = 0; elementId < elementSize; elementId++) {
-            const unsigned int elementtodelete = elementLookupTable[representative][elementId];
-            // float seqId = elementScoreTable[representative][elementId];
-            const short seqId = elementScoreLookupTable[representative][elementId];
-            //  Debug(Debug::INFO)<<seqId<<"\t"<<bestscore[elementtodelete]<<"\n";
-            // becareful of this criteria
-            if (seqId > bestscore[elementtodelete]) {
-                assignedcluster[elementtodelete] = representative;
-                bestscore[elementtodelete] = seqId;
+        if (window.empty()) {
+            break;
+        }
+        rounds++;
+
+        // every uncovered element remembers the best window set containing it
+#pragma omp parallel for schedule(dynamic, 64)
+        for (size_t i = 0; i < window.size(); i++) {
+            const unsigned int set = window[i];
+            offerSet(bestSet, clustersizes, set, set);
+            const size_t elementSize = (newElementOffsets[set + 1] - newElementOffsets[set]);
+            AlignmentSymmetry::ElementReader reader(elements + byteOffsets[set]);
+            for (size_t elementId = 0; elementId < elementSize; elementId++) {
+                const unsigned int element = reader.next();
+                if (clustersizes[element] > 0) {
+                    offerSet(bestSet, clustersizes, element, set);
+                }
             }
-            //Debug(Debug::INFO)<<bestscore[elementtodelete]<<"\n";
-            if (elementtodelete == representative) {
-                continue;
+        }
+
+        roundPicked.clear();
+#pragma omp parallel
+        {
+            std::vector<unsigned int> localPicked;
+#pragma omp for schedule(dynamic, 64)
+            for (size_t i = 0; i < window.size(); i++) {
+                const unsigned int set = window[i];
+                bool isBest = bestSet[set] == set;
+                const size_t elementSize = (newElementOffsets[set + 1] - newElementOffsets[set]);
+                AlignmentSymmetry::ElementReader reader(elements + byteOffsets[set]);
+                for (size_t elementId = 0; elementId < elementSize && isBest; elementId++) {
+                    const unsigned int element = reader.next();
+                    isBest = clustersizes[element] <= 0 || bestSet[element] == set;
+                }
+                if (isBest) {
+                    pickedSize[set] = clustersizes[set];
+                    localPicked.push_back(set);
+                }
             }
-            if (clustersizes[elementtodelete] < 1) {
-                continue;
+#pragma omp critical
+            roundPicked.insert(roundPicked.end(), localPicked.begin(), localPicked.end());
+        }
+
+#pragma omp parallel for schedule(dynamic, 64)
+        for (size_t i = 0; i < window.size(); i++) {
+            const unsigned int set = window[i];
+            bestSet[set] = UINT_MAX;
+            const size_t elementSize = (newElementOffsets[set + 1] - newElementOffsets[set]);
+            AlignmentSymmetry::ElementReader reader(elements + byteOffsets[set]);
+            for (size_t elementId = 0; elementId < elementSize; elementId++) {
+                bestSet[reader.next()] = UINT_MAX;
+            }
+        }
+
+        // picked sets do not share uncovered elements, each covers its own
+#pragma omp parallel for schedule(dynamic, 16)
+        for (size_t i = 0; i < roundPicked.size(); i++) {
+            const unsigned int representative = roundPicked[i];
+            const size_t elementSize = (newElementOffsets[representative + 1] - newElementOffsets[representative]);
+            AlignmentSymmetry::ElementReader reader(elements + byteOffsets[representative]);
+            for (size_t elementId = 0; elementId < elementSize; elementId++) {
+                const unsigned int element = reader.next();
+                if (clustersizes[element] > 0) {
+                    clustersizes[element] = -2;
+                }
             }
-            removeClustersize(elementtodelete);
+            clustersizes[representative] = -2;
         }
 
+        //decrease clustersize of sets that contain the newly covered elements
+#pragma omp parallel for schedule(dynamic, 16)
+        for (size_t i = 0; i < roundPicked.size(); i++) {
+            const unsigned int representative = roundPicked[i];
+            const size_t elementSize = (newElementOffsets[representative + 1] - newElementOffsets[representative]);
+            AlignmentSymmetry::ElementReader reader(elements + byteOffsets[representative]);
+            for (size_t elementId = 0; elementId < elementSize; elementId++) {
+                const unsigned int elementtodelete = reader.next();
+                if (elementtodelete == representative || clustersizes[elementtodelete] != -2) {
+                    continue;
+                }
+                bool representativefound = false;
+                const size_t currElementSize = (newElementOffsets[elementtodelete + 1] - newElementOffsets[elementtodelete]);
+                AlignmentSymmetry::ElementReader currReader(elements + byteOffsets[elementtodelete]);
+                for (size_t elementId2 = 0; elementId2 < currElementSize; elementId2++) {
+                    const unsigned int elementtodecrease = currReader.next();
+                    if (representative == elementtodecrease) {
+                        representativefound = true;
+                    }
+                    int size = clustersizes[elementtodecrease];
+                    while (size > 1 && __sync_bool_compare_and_swap(&clustersizes[elementtodecrease], size, size - 1) == false) {
+                        size = clustersizes[elementtodecrease];
+                    }
+                    if (size == 1) {
+                        Debug(Debug::ERROR) << "there must be an error: " << seqDbr->getDbKey(elementtodelete) <<
+                                            " deleted from " << seqDbr->getDbKey(elementtodecrease) <<
+                                            " that now is empty, but not assigned to a cluster\n";
+                    }
+                }
+                if (!representativefound) {
+                    Debug(Debug::ERROR) << "error with cluster:\t" << seqDbr->getDbKey(representative) <<
+                                        "\tis not contained in set:\t" << seqDbr->getDbKey(elementtodelete) << ".\n";
+                }
+            }
+        }
+
+#pragma omp parallel for schedule(dynamic, 16)
+        for (size_t i = 0; i < roundPicked.size(); i++) {
+            const unsigned int representative = roundPicked[i];
+            const size_t elementSize = (newElementOffsets[representative + 1] - newElementOffsets[representative]);
+            AlignmentSymmetry::ElementReader reader(elements + byteOffsets[representative]);
+            for (size_t elementId = 0; elementId < elementSize; elementId++) {
+                const unsigned int element = reader.next();
+                if (clustersizes[element] == -2) {
+                    clustersizes[element] = -1;
+                }
+            }
+            clustersizes[representative] = -1;
+        }
+        picked.insert(picked.end(), roundPicked.begin(), roundPicked.end());
+
+        // sets that dropped below the threshold could now be worse than sets outside of the window
+        size_t windowCount = 0;
+        windowElements = 0;
+        for (size_t i = 0; i < window.size(); i++) {
+            if (clustersizes[window[i]] >= threshold) {
+                window[windowCount++] = window[i];
+                windowElements += clustersizes[window[i]];
+            }
+        }
+        window.resize(windowCount);
+    }
+    delete[] histogram;
+    delete[] bestSet;
+    Debug(Debug::INFO) << "Picked " << picked.size() << " representatives in " << rounds << " rounds\n";
+
+    // assign every element to the representative with the best score,
+    // ties go to the representative that would have been picked first
+#pragma omp parallel for schedule(dynamic, 16)
+    for (size_t i = 0; i < picked.size(); i++) {
+        const unsigned int representative = picked[i];
+        const size_t elementSize = (newElementOffsets[representative + 1] - newElementOffsets[representative]);
+        AlignmentSymmetry::ElementReader reader(elements + byteOffsets[representative]);
         for (size_t elementId = 0; elementId < elementSize; elementId++) {
-            bool representativefound = false;
-            const unsigned int elementtodelete = elementLookupTable[representative][elementId];
-            const unsigned int currElementSize = (newElementOffsets[elementtodelete + 1] -
-                                                  newElementOffsets[elementtodelete]);
-            if (elementtodelete == representative) {
-                clustersizes[elementtodelete] = -1;
-                continue;
+            const unsigned int element = reader.next();
+            const short seqId = scores[newElementOffsets[representative] + elementId];
+            short current = bestscore[element];
+            while (seqId > current && __sync_bool_compare_and_swap(&bestscore[element], current, seqId) == false) {
+                current = bestscore[element];
             }
-            if (clustersizes[elementtodelete] < 0) {
+        }
+    }
+#pragma omp parallel for schedule(dynamic, 16)
+    for (size_t i = 0; i < picked.size(); i++) {
+        const unsigned int representative = picked[i];
+        const size_t elementSize = (newElementOffsets[representative + 1] - newElementOffsets[representative]);
+        AlignmentSymmetry::ElementReader reader(elements + byteOffsets[representative]);
+        for (size_t elementId = 0; elementId < elementSize; elementId++) {
+            const unsigned int element = reader.next();
+            const short seqId = scores[newElementOffsets[representative] + elementId];
+            if (seqId == SHRT_MIN || seqId != bestscore[element]) {
                 continue;
             }
-            clustersizes[elementtodelete] = -1;
-            //decrease clustersize of sets that contain the element
-            for (size_t elementId2 = 0; elementId2 < currElementSize; elementId2++) {
-                const unsigned int elementtodecrease = elementLookupTable[elementtodelete][elementId2];
-                if (representative == elementtodecrease) {
-                    representativefound = true;
-                }
-                if (clustersizes[elementtodecrease] == 1) {
-                    Debug(Debug::ERROR) << "there must be an error: " << seqDbr->getDbKey(elementtodelete) <<
-                                        " deleted from " << seqDbr->getDbKey(elementtodecrease) <<
-                                        " that now is empty, but not assigned to a cluster\n";
-                } else if (clustersizes[elementtodecrease] > 0) {
-                    decreaseClustersize(elementtodecrease);
+            unsigned int current = assignedcluster[element];
+            while (current == UINT_MAX || pickedSize[representative] > pickedSize[current]
+                   || (pickedSize[representative] == pickedSize[current] && representative > current)) {
+                if (__sync_bool_compare_and_swap(&assignedcluster[element], current, representative)) {
+                    break;
                 }
+                current = assignedcluster[element];
             }
-            if (!representativefound) {
-                Debug(Debug::ERROR) << "error with cluster:\t" << seqDbr->getDbKey(representative) <<
-                                    "\tis not contained in set:\t" << seqDbr->getDbKey(elementtodelete) << ".\n";
-            }
         }
     }
+    // no earlier representative contains a representative, so it stays in its own cluster unless a later one
+    // scores it higher than its own entry, or contains it while it has no entry for itself
+    for (size_t i = 0; i < picked.size(); i++) {
+        if (assignedcluster[picked[i]] == UINT_MAX) {
+            assignedcluster[picked[i]] = picked[i];
+        }
+    }
+    delete[] pickedSize;
 }
 
 void ClusteringAlgorithms::greedyIncrementalLowMem( unsigned int *assignedcluster) {
 
     const long BUFFER_SIZE = 100000; // Set this to a suitable value.
     const long numBuffers = (dbSize + BUFFER_SIZE - 1) / BUFFER_SIZE;
+    const bool binaryAlignment = Matcher::isBinaryAlignmentResult(alnDbr->getDbtype());
 
     // Pre-allocate buffer outside the loop to reuse it
     std::vector<std::pair<unsigned int, std::vector<unsigned int>>> buffer(BUFFER_SIZE);
@@ -293,12 +496,20 @@ void ClusteringAlgorithms::greedyIncrementalLowMem( unsigned int *assignedcluste
             char* data = alnDbr->getData(alnId, 0);
 
             std::vector<unsigned int>& keys = buffer[i - start].second;
-            while (*data != '\0') {
-                char dbKey[255 + 1];
-                Util::parseKey(data, dbKey);
-                const unsigned int key = (unsigned int)strtoul(dbKey, NULL, 10);
-                keys.push_back(key);
-                data = Util::skipLine(data);
+            if (binaryAlignment) {
+                const unsigned int count = Matcher::getBinaryResultCount(data, alnDbr->getEntryLen(alnId));
+                const Matcher::result_bin_t *records = Matcher::getBinaryResults(data);
+                for (unsigned int j = 0; j < count; ++j) {
+                    keys.push_back(records[j].dbKey);
+                }
+            } else {
+                while (*data != '\0') {
+                    char dbKey[255 + 1];
+                    Util::parseKey(data, dbKey);
+                    const unsigned int key = (unsigned int)strtoul(dbKey, NULL, 10);
+                    keys.push_back(key);
+                    data = Util::skipLine(data);
+                }
             }
 
             buffer[i - start].first = i;
@@ -337,10 +548,10 @@ void ClusteringAlgorithms::greedyIncrementalLowMem( unsigned int *assignedcluste
     }
 }
 
-void ClusteringAlgorithms::readInClusterData(unsigned int **elementLookupTable, unsigned int *&elements,
-                                             unsigned short **scoreLookupTable, unsigned short *&scores,
+void ClusteringAlgorithms::readInClusterData(unsigned int *&elements, unsigned short *&scores,
                                              size_t *elementOffsets, size_t totalElementCount) {
     Timer timer;
+    const bool binaryAlignment = Matcher::isBinaryAlignmentResult(alnDbr->getDbtype());
 #pragma omp parallel
     {
         int thread_idx = 0;
@@ -353,47 +564,49 @@ void ClusteringAlgorithms::readInClusterData(unsigned int **elementLookupTable,
             const size_t alnId = alnDbr->getId(clusterId);
             const char *data = alnDbr->getData(alnId, thread_idx);
             const size_t dataSize = alnDbr->getEntryLen(alnId);
-            elementOffsets[i] = (*data == '\0') ? 1 : Util::countLines(data, dataSize);
+            if (binaryAlignment) {
+                elementOffsets[i] = std::max(Matcher::getBinaryResultCount(data, dataSize), 1u);
+            } else {
+                elementOffsets[i] = (*data == '\0') ? 1 : Util::countLines(data, dataSize);
+            }
         }
     }
 
     // make offset table
     AlignmentSymmetry::computeOffsetFromCounts(elementOffsets, dbSize);
-    // set element edge pointers by using the offset table
-    AlignmentSymmetry::setupPointers<unsigned int>(elements, elementLookupTable, elementOffsets, dbSize,
-                                                   totalElementCount);
+    if (elementOffsets[dbSize] > totalElementCount) {
+        Debug(Debug::ERROR) << "Error in readInClusterData. totalElementCount "
+                            << "(" << totalElementCount << ") < elementOffsets[" << dbSize << "] (" << elementOffsets[dbSize] << ")\n";
+        EXIT(EXIT_FAILURE);
+    }
     // fill elements
-    AlignmentSymmetry::readInData(alnDbr, seqDbr, elementLookupTable, NULL, 0, elementOffsets);
+    AlignmentSymmetry::readInData(alnDbr, seqDbr, elements, NULL, 0, elementOffsets, elementOffsets);
     Debug(Debug::INFO) << "Sort entries\n";
-    AlignmentSymmetry::sortElements(elementLookupTable, elementOffsets, dbSize);
+    AlignmentSymmetry::sortElements(elements, elementOffsets, dbSize);
     Debug(Debug::INFO) << "Find missing connections\n";
 
     size_t *newElementOffsets = new size_t[dbSize + 1];
     memcpy(newElementOffsets, elementOffsets, sizeof(size_t) * (dbSize + 1));
 
     // findMissingLinks detects new possible connections and updates the elementOffsets with new sizes
-    const size_t symmetricElementCount = AlignmentSymmetry::findMissingLinks(elementLookupTable,
+    const size_t symmetricElementCount = AlignmentSymmetry::findMissingLinks(elements,
                                                                              newElementOffsets, dbSize,
                                                                              threads);
     // resize elements
-    delete[] elements;
-    elements = new(std::nothrow) unsigned int[symmetricElementCount];
-    Util::checkAllocation(elements, "Can not allocate elements memory in readInClusterData");
+    freeGraph(elements, totalElementCount);
+    elements = allocateGraph<unsigned int>(symmetricElementCount, "elements");
     std::fill_n(elements, symmetricElementCount, UINT_MAX);
     // init score vector
-    scores = new(std::nothrow) unsigned short[symmetricElementCount];
-    Util::checkAllocation(scores, "Can not allocate scores memory in readInClusterData");
+    scores = allocateGraph<unsigned short>(symmetricElementCount, "scores");
     std::fill_n(scores, symmetricElementCount, 0);
     Debug(Debug::INFO) << "Found " << symmetricElementCount - totalElementCount << " new connections.\n";
-    AlignmentSymmetry::setupPointers<unsigned int>  (elements, elementLookupTable, newElementOffsets, dbSize, symmetricElementCount);
-    AlignmentSymmetry::setupPointers<unsigned short>(scores, scoreLookupTable, newElementOffsets, dbSize, symmetricElementCount);
     //time
     Debug(Debug::INFO) << "Reconstruct initial order\n";
     alnDbr->remapData(); // need to free memory
-    AlignmentSymmetry::readInData(alnDbr, seqDbr, elementLookupTable, scoreLookupTable, scoretype, elementOffsets);
+    AlignmentSymmetry::readInData(alnDbr, seqDbr, elements, scores, scoretype, elementOffsets, newElementOffsets);
     alnDbr->remapData(); // need to free memory
     Debug(Debug::INFO) << "Add missing connections\n";
-    AlignmentSymmetry::addMissingLinks(elementLookupTable, elementOffsets, newElementOffsets, dbSize, scoreLookupTable);
+    AlignmentSymmetry::addMissingLinks(elements, elementOffsets, newElementOffsets, dbSize, scores);
     maxClustersize = 0;
     for (size_t i = 0; i < dbSize; i++) {
         size_t elementCount = newElementOffsets[i + 1] - newElementOffsets[i];
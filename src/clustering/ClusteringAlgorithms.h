@@ -8,13 +8,16 @@
 #include <set>
 #include <list>
 #include <vector>
+#include <string>
 #include <unordered_map>
 
 #include "DBReader.h"
 
 class ClusteringAlgorithms {
 public:
-    ClusteringAlgorithms(DBReader<unsigned int>* seqDbr, DBReader<unsigned int>* alnDbr, int threads,int scoretype, int maxiterations);
+    // the graph arrays are mapped from temporary files starting with spillPrefix when they would exceed memoryLimit bytes
+    ClusteringAlgorithms(DBReader<unsigned int>* seqDbr, DBReader<unsigned int>* alnDbr, int threads,int scoretype, int maxiterations,
+                         size_t memoryLimit, const std::string &spillPrefix);
     ~ClusteringAlgorithms();
     std::pair<unsigned int, unsigned int> * execute(int mode);
 private:
@@ -25,39 +28,42 @@ private:
 
     int threads;
     int scoretype;
+    size_t memoryLimit;
+    std::string spillPrefix;
+    // the graph does not fit into memoryLimit
+    bool spill;
 //datastructures
     unsigned int maxClustersize;
     unsigned int dbSize;
     int * clustersizes;
     unsigned int* sorted_clustersizes;
-    unsigned int* clusterid_to_arrayposition;
-    unsigned int* borders_of_set;
 
 //methods
 
     void initClustersizes();
-
-    void removeClustersize(unsigned int clusterid);
-
-    void decreaseClustersize(unsigned int clusterid);
 //for connected component
     int maxiterations;
 
 
-    void setCover(unsigned int **elementLookup, unsigned short ** elementScoreLookupTable,
-                  unsigned int *assignedcluster, short *bestscore, size_t *offsets);
+    void setCover(const unsigned char *elements, unsigned short *scores,
+                  unsigned int *assignedcluster, short *bestscore, size_t *offsets, size_t *byteOffsets);
 
-    void greedyIncremental(unsigned int **elementLookupTable, size_t *elementOffsets,
+    void greedyIncremental(unsigned int *elements, size_t *elementOffsets,
                            size_t n, unsigned int *assignedcluster) ;
 
 
     void greedyIncrementalLowMem(unsigned int *assignedcluster) ;
 
 
-    void readInClusterData(unsigned int **elementLookupTable, unsigned int *&elements,
-                           unsigned short **scoreLookupTable, unsigned short *&scores,
+    void readInClusterData(unsigned int *&elements, unsigned short *&scores,
                            size_t *elementOffsets, size_t totalElementCount)  ;
 
+    template <typename T>
+    T *allocateGraph(size_t count, const char *name);
+
+    template <typename T>
+    void freeGraph(T *data, size_t count);
+
 };
 
 
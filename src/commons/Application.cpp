@@ -4,6 +4,7 @@
 #include "DistanceCalculator.h"
 #include "FileUtil.h"
 #include "Timer.h"
+#include "Telemetry.h"
 
 #include <iomanip>
 
@@ -42,8 +43,10 @@ Command *getCommandByName(const char *s) {
 
 int runCommand(Command *p, int argc, const char **argv) {
     Timer timer;
+    Telemetry::setCommand(p->cmd);
     int status = p->commandFunction(argc, argv, *p);
     Debug(Debug::INFO) << "Time for processing: " << timer.lap() << "\n";
+    Telemetry::writeModuleRecord(argc, argv, status, timer.getTimediff());
     return status;
 }
 
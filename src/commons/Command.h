@@ -50,9 +50,12 @@ struct DbValidator {
     static std::vector<int> taxSequenceDb;
     static std::vector<int> nuclAaDb;
     static std::vector<int> alignmentDb;
+    static std::vector<int> alignmentOrBinPrefDb;
     static std::vector<int> prefilterDb;
     static std::vector<int> clusterDb;
     static std::vector<int> resultDb;
+    static std::vector<int> resultOrBinPrefDb;
+    static std::vector<int> resultOrBinAlnDb;
     static std::vector<int> ppResultDb;
     static std::vector<int> ca3mDb;
     static std::vector<int> msaDb;
@@ -1,6 +1,7 @@
 #include "CommandCaller.h"
 #include "Util.h"
 #include "Debug.h"
+#include "Telemetry.h"
 
 #include <strings.h>
 #include <cstdlib>
@@ -78,6 +79,13 @@ void CommandCaller::execProgram(const char* program, const std::vector<std::stri
     }
     pArgv[argv.size() + 1] = NULL;
 
+    // the outermost workflow waits for its script to aggregate the telemetry records of all called modules
+    if (Telemetry::isEnabled() && getenv("MMSEQS_TELEMETRY_RUN") == NULL) {
+        int status = Telemetry::runWorkflow(program, (char * const *) pArgv);
+        delete[] pArgv;
+        EXIT(status);
+    }
+
     int res = execvp(program, (char * const *) pArgv);
 
     if (res == -1) {
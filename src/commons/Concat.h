@@ -14,6 +14,10 @@
 #include <algorithm>
 #include <fcntl.h>
 #include <limits.h>
+#include <errno.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 
 #include "Debug.h"
 #include "Util.h"
@@ -135,6 +139,11 @@ public:
                 Debug(Debug::ERROR) << "posix_fadvise returned an error\n";
             }
 #endif
+            // let the kernel copy the file if it can, the fallback continues at the current offsets
+            if (copyFileRange(input_desc, output_desc)) {
+                free(inbuf);
+                continue;
+            }
             /* Loop until the end of the file.  */
 //            std::cout << "(size_t) p1 % alignment=" << (size_t) (inbuf + page_size - 1) % page_size << std::endl;
 //            static char const *buf = (char *) ptr_align(inbuf, page_size);
@@ -144,6 +153,29 @@ public:
     }
 
 
+    // copy_file_range keeps the data in the kernel and lets filesystems with reflinks (btrfs, XFS)
+    // share the blocks instead of copying them. Returns false if the rest of the file still has to be copied.
+    static bool copyFileRange(int input_desc, int out_desc) {
+#if defined(__linux__) && defined(SYS_copy_file_range)
+        while (true) {
+            ssize_t copied = syscall(SYS_copy_file_range, input_desc, NULL, out_desc, NULL, (size_t) (INT_MAX & ~8191), 0u);
+            if (copied == 0) {
+                return true;
+            }
+            if (copied < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+        }
+#else
+        (void) input_desc;
+        (void) out_desc;
+        return false;
+#endif
+    }
+
     static bool doConcat(int input_desc, int out_desc, const char *buf, size_t bufsize) {
         while (true) {
             /* Read a block of input.  */
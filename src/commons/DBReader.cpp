@@ -10,8 +10,10 @@
 #include <sys/stat.h>
 
 #include <fcntl.h>
+#include <unistd.h>
 
 #include "MemoryMapped.h"
+#include "Telemetry.h"
 #include "Debug.h"
 #include "Util.h"
 #include "FileUtil.h"
@@ -21,12 +23,17 @@
 #include <omp.h>
 #endif
 
+// older C libraries do not expose the flag of Linux 6.1
+#if defined(__linux__) && !defined(MADV_COLLAPSE) && (defined(__x86_64__) || defined(__aarch64__))
+#define MADV_COLLAPSE 25
+#endif
+
 template <typename T>
 DBReader<T>::DBReader(const char* dataFileName_, const char* indexFileName_, int threads, int dataMode) :
 threads(threads), dataMode(dataMode), dataFileName(strdup(dataFileName_)),
         indexFileName(strdup(indexFileName_)), size(0), dataFiles(NULL), dataSizeOffset(NULL), dataFileCnt(0),
         totalDataSize(0), dataSize(0), lastKey(T()), closed(1), dbtype(Parameters::DBTYPE_GENERIC_DB),
-        compressedBuffers(NULL), compressedBufferSizes(NULL), index(NULL), id2local(NULL), local2id(NULL),
+        compressedBuffers(NULL), compressedBufferSizes(NULL), index(NULL), indexMapping(NULL), indexMappingSize(0), id2local(NULL), local2id(NULL),
         dataMapped(false), accessType(0), externalData(false), didMlock(false)
 {}
 
@@ -35,8 +42,8 @@ DBReader<T>::DBReader(DBReader<T>::Index *index, size_t size, size_t dataSize, T
         int dbType, unsigned int maxSeqLen, int threads) :
         threads(threads), dataMode(USE_INDEX), dataFileName(NULL), indexFileName(NULL),
         size(size), dataFiles(NULL), dataSizeOffset(NULL), dataFileCnt(0), totalDataSize(0), dataSize(dataSize), lastKey(lastKey),
-        maxSeqLen(maxSeqLen), closed(1), dbtype(dbType), compressedBuffers(NULL), compressedBufferSizes(NULL), index(index), sortedByOffset(true),
-        id2local(NULL), local2id(NULL), dataMapped(false), accessType(NOSORT), externalData(true), didMlock(false)
+        maxSeqLen(maxSeqLen), closed(1), dbtype(dbType), compressedBuffers(NULL), compressedBufferSizes(NULL), index(index), indexMapping(NULL), indexMappingSize(0),
+        sortedByOffset(true), id2local(NULL), local2id(NULL), dataMapped(false), accessType(NOSORT), externalData(true), didMlock(false)
 {}
 
 template <typename T>
@@ -130,6 +137,7 @@ template <typename T> bool DBReader<T>::open(int accessType){
             }
         }
         dataSizeOffset[dataFileNames.size()]=totalDataSize;
+        Telemetry::addBytesRead(totalDataSize);
         dataMapped = true;
         if (accessType == LINEAR_ACCCESS || accessType == SORT_BY_OFFSET) {
             setSequentialAdvice();
@@ -156,7 +164,11 @@ template <typename T> bool DBReader<T>::open(int accessType){
         lookupData.close();
     }
     bool isSortedById = false;
-    if (externalData == false) {
+    if (externalData == false && readBinaryIndex()) {
+        // the binary index is only written for indices sorted by id
+        sortIndex(true);
+        sortedByOffset = sortedByOffset || accessType == SORT_BY_OFFSET;
+    } else if (externalData == false) {
         MemoryMapped indexData(indexFileName, MemoryMapped::WholeFile, MemoryMapped::SequentialScan);
         if (!indexData.isValid()){
             Debug(Debug::ERROR) << "Cannot open index file " << indexFileName << "\n";
@@ -444,12 +456,51 @@ template <typename T> char* DBReader<T>::mmapData(FILE * file, size_t *dataSize)
             } else {
                 mode = PROT_READ;
             }
-            ret = static_cast<char*>(mmap(NULL, *dataSize, mode, MAP_PRIVATE, fd, 0));
+            char *address = NULL;
+            int flags = MAP_PRIVATE;
+#ifdef __linux__
+            // reserve address space to place the mapping at a huge page boundary,
+            // huge page aligned data in the file then ends up on huge page aligned addresses
+            const size_t hugePageSize = Util::getHugePageSize();
+            char *reserved = NULL;
+            size_t reservedSize = 0;
+            if (dataMode & USE_HUGEPAGES) {
+                reservedSize = *dataSize + hugePageSize;
+                reserved = static_cast<char*>(mmap(NULL, reservedSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0));
+                if (reserved != MAP_FAILED) {
+                    address = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(reserved) + hugePageSize - 1) & ~(hugePageSize - 1));
+                    flags |= MAP_FIXED;
+                } else {
+                    reserved = NULL;
+                }
+            }
+#endif
+            ret = static_cast<char*>(mmap(address, *dataSize, mode, flags, fd, 0));
             if (ret == MAP_FAILED){
                 int errsv = errno;
                 Debug(Debug::ERROR) << "Failed to mmap memory dataSize=" << *dataSize <<" File=" << dataFileName << ". Error " << errsv << ".\n";
                 EXIT(EXIT_FAILURE);
             }
+#ifdef __linux__
+            if (reserved != NULL) {
+                // release the unused parts of the reservation
+                const size_t pageSize = Util::getPageSize();
+                char *mappedEnd = ret + ((*dataSize + pageSize - 1) & ~(pageSize - 1));
+                if (ret > reserved) {
+                    munmap(reserved, ret - reserved);
+                }
+                if (reserved + reservedSize > mappedEnd) {
+                    munmap(mappedEnd, (reserved + reservedSize) - mappedEnd);
+                }
+            }
+#ifdef MADV_HUGEPAGE
+            if (dataMode & USE_HUGEPAGES) {
+                if (madvise(ret, *dataSize, MADV_HUGEPAGE) != 0) {
+                    Debug(Debug::WARNING) << "Huge pages are not available for " << dataFileName << "\n";
+                }
+            }
+#endif
+#endif
         } else {
             ret = static_cast<char*>(malloc(*dataSize));
             Util::checkAllocation(ret, "Not enough system memory to read in the whole data file.");
@@ -516,7 +567,11 @@ template <typename T> void DBReader<T>::close(){
         delete [] dstream;
     }
 
-    if(externalData == false) {
+    if (indexMapping != NULL) {
+        munmap(indexMapping, indexMappingSize);
+        indexMapping = NULL;
+        index = NULL;
+    } else if(externalData == false) {
         delete[] index;
         decrementMemory(size*sizeof(Index));
     }
@@ -621,6 +676,18 @@ void DBReader<T>::touchData(size_t id) {
         size_t nextDataOffset = findNextOffsetid(id);
         size_t dataSize = nextDataOffset-currDataOffset;
         magicBytes = Util::touchMemory(data, dataSize);
+#if defined(__linux__) && defined(MADV_COLLAPSE)
+        if (dataMode & USE_HUGEPAGES) {
+            // page cache pages that were read before the mapping was advised are still small pages
+            // collapse them in place, this fails silently if the kernel can not back files with huge pages
+            const size_t hugePageSize = Util::getHugePageSize();
+            uintptr_t start = (reinterpret_cast<uintptr_t>(data) + hugePageSize - 1) & ~(hugePageSize - 1);
+            uintptr_t end = (reinterpret_cast<uintptr_t>(data) + dataSize) & ~(hugePageSize - 1);
+            if (end > start) {
+                madvise(reinterpret_cast<void*>(start), end - start, MADV_COLLAPSE);
+            }
+        }
+#endif
     }
 }
 
@@ -855,6 +922,132 @@ bool DBReader<T>::readIndex(char *data, size_t indexDataSize, Index *index, size
     return isSortedById;
 }
 
+// The binary index starts with this header followed by the index entries as they are laid out in memory.
+// It records the stat of the text index when it was written, any later change to the text index marks it as stale.
+struct BinaryIndexHeader {
+    char magic[8];
+    uint32_t entrySize;
+    uint32_t maxSeqLen;
+    uint64_t entries;
+    uint64_t dataSize;
+    uint32_t lastKey;
+    uint32_t sortedByOffset;
+    uint64_t indexSize;
+    uint64_t indexInode;
+    int64_t indexMtimeSec;
+    int64_t indexMtimeNsec;
+};
+static const char BINARY_INDEX_MAGIC[8] = { 'M', 'M', 'S', 'I', 'D', 'X', 'B', '1' };
+
+static bool setIndexStat(const char *indexFileName, BinaryIndexHeader &header) {
+    struct stat sb;
+    if (::stat(indexFileName, &sb) != 0) {
+        return false;
+    }
+    header.indexSize = sb.st_size;
+    header.indexInode = sb.st_ino;
+#ifdef __APPLE__
+    header.indexMtimeSec = sb.st_mtimespec.tv_sec;
+    header.indexMtimeNsec = sb.st_mtimespec.tv_nsec;
+#else
+    header.indexMtimeSec = sb.st_mtim.tv_sec;
+    header.indexMtimeNsec = sb.st_mtim.tv_nsec;
+#endif
+    return true;
+}
+
+template<typename T>
+bool DBReader<T>::readBinaryIndex() {
+    return false;
+}
+
+template<>
+bool DBReader<unsigned int>::readBinaryIndex() {
+    std::string binaryName = binaryIndexFileName(indexFileName);
+    int fd = ::open(binaryName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    BinaryIndexHeader header;
+    BinaryIndexHeader current;
+    struct stat sb;
+    bool valid = fstat(fd, &sb) == 0
+                 && pread(fd, &header, sizeof(BinaryIndexHeader), 0) == (ssize_t) sizeof(BinaryIndexHeader)
+                 && memcmp(header.magic, BINARY_INDEX_MAGIC, sizeof(BINARY_INDEX_MAGIC)) == 0
+                 && header.entrySize == sizeof(Index)
+                 && (size_t) sb.st_size == sizeof(BinaryIndexHeader) + header.entries * sizeof(Index)
+                 && setIndexStat(indexFileName, current)
+                 && header.indexSize == current.indexSize && header.indexInode == current.indexInode
+                 && header.indexMtimeSec == current.indexMtimeSec && header.indexMtimeNsec == current.indexMtimeNsec;
+    char *mapping = NULL;
+    if (valid) {
+        // private writable mapping, sorting modes reorder the index in place
+        mapping = static_cast<char*>(mmap(NULL, sb.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0));
+        valid = mapping != MAP_FAILED;
+    }
+    ::close(fd);
+    if (valid == false) {
+        return false;
+    }
+    indexMapping = mapping;
+    indexMappingSize = sb.st_size;
+    index = reinterpret_cast<Index*>(mapping + sizeof(BinaryIndexHeader));
+    size = header.entries;
+    dataSize = header.dataSize;
+    maxSeqLen = header.maxSeqLen;
+    lastKey = header.lastKey;
+    sortedByOffset = header.sortedByOffset != 0;
+    return true;
+}
+
+template<typename T>
+void DBReader<T>::writeBinaryIndex(const char *, const Index *, size_t) {
+}
+
+template<>
+void DBReader<unsigned int>::writeBinaryIndex(const char *indexFileName, const Index *index, size_t size) {
+    BinaryIndexHeader header;
+    memset(&header, 0, sizeof(BinaryIndexHeader));
+    memcpy(header.magic, BINARY_INDEX_MAGIC, sizeof(BINARY_INDEX_MAGIC));
+    header.entrySize = sizeof(Index);
+    header.entries = size;
+    if (setIndexStat(indexFileName, header) == false) {
+        Debug(Debug::ERROR) << "Cannot stat index file " << indexFileName << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    bool sortedByOffset = true;
+    size_t prevOffset = 0;
+    for (size_t i = 0; i < size; i++) {
+        header.dataSize += index[i].length;
+        header.maxSeqLen = std::max(header.maxSeqLen, index[i].length);
+        header.lastKey = std::max(header.lastKey, index[i].id);
+        sortedByOffset = sortedByOffset && index[i].offset >= prevOffset;
+        prevOffset = index[i].offset;
+    }
+    header.sortedByOffset = sortedByOffset;
+
+    std::string binaryName = binaryIndexFileName(indexFileName);
+    FILE *file = FileUtil::openAndDelete(binaryName.c_str(), "wb");
+    bool written = fwrite(&header, sizeof(BinaryIndexHeader), 1, file) == 1;
+    for (size_t i = 0; i < size && written; i++) {
+        // zero the padding for reproducible files
+        Index entry;
+        memset(&entry, 0, sizeof(Index));
+        entry.id = index[i].id;
+        entry.offset = index[i].offset;
+        entry.length = index[i].length;
+        written = fwrite(&entry, sizeof(Index), 1, file) == 1;
+    }
+    if (written == false) {
+        Debug(Debug::ERROR) << "Cannot write binary index file " << binaryName << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    if (fclose(file) != 0) {
+        Debug(Debug::ERROR) << "Cannot close file " << binaryName << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+}
+
 template<typename T> T DBReader<T>::getLastKey() {
     return lastKey;
 }
@@ -1079,6 +1272,9 @@ void DBReader<T>::moveDb(const std::string &srcDbName, const std::string &dstDbN
     if (FileUtil::fileExists((srcDbName + ".index").c_str())) {
         FileUtil::move((srcDbName + ".index").c_str(), (dstDbName + ".index").c_str());
     }
+    if (FileUtil::fileExists((srcDbName + ".index.bin").c_str())) {
+        FileUtil::move((srcDbName + ".index.bin").c_str(), (dstDbName + ".index.bin").c_str());
+    }
     if (FileUtil::fileExists((srcDbName + ".dbtype").c_str())) {
         FileUtil::move((srcDbName + ".dbtype").c_str(), (dstDbName + ".dbtype").c_str());
     }
@@ -1097,6 +1293,10 @@ void DBReader<T>::removeDb(const std::string &databaseName){
     if (FileUtil::fileExists(index.c_str())) {
         FileUtil::remove(index.c_str());
     }
+    std::string binaryIndex = binaryIndexFileName(index);
+    if (FileUtil::fileExists(binaryIndex.c_str())) {
+        FileUtil::remove(binaryIndex.c_str());
+    }
     std::string dbTypeFile = databaseName + ".dbtype";
     if (FileUtil::fileExists(dbTypeFile.c_str())) {
         FileUtil::remove(dbTypeFile.c_str());
@@ -1140,9 +1340,11 @@ void copyLinkDb(const std::string &databaseName, const std::string &outDb, DBFil
 
     const DBSuffix suffices[] = {
         { DBFiles::DATA_INDEX,    ".index"            },
+        { DBFiles::DATA_INDEX,    ".index.bin"        },
         { DBFiles::DATA_DBTYPE,   ".dbtype"           },
         { DBFiles::HEADER,        "_h"                },
         { DBFiles::HEADER_INDEX,  "_h.index"          },
+        { DBFiles::HEADER_INDEX,  "_h.index.bin"      },
         { DBFiles::HEADER_DBTYPE, "_h.dbtype"         },
         { DBFiles::LOOKUP,        ".lookup"           },
         { DBFiles::SOURCE,        ".source"           },
@@ -266,6 +266,8 @@ public:
     static const unsigned int USE_FREAD      = 4;
     static const unsigned int USE_LOOKUP     = 8;
     static const unsigned int USE_LOOKUP_REV = 16;
+    // map data files at huge page aligned addresses and advise transparent huge pages
+    static const unsigned int USE_HUGEPAGES  = 32;
 
 
     // compressed
@@ -307,6 +309,13 @@ public:
 
     bool readIndex(char *data, size_t indexDataSize, Index *index, size_t & dataSize);
 
+    // binary copy of a sorted text index, open maps it instead of parsing the text index
+    static std::string binaryIndexFileName(const std::string &indexFileName) {
+        return indexFileName + ".bin";
+    }
+
+    static void writeBinaryIndex(const char *indexFileName, const Index *index, size_t size);
+
     void readLookup(char *data, size_t dataSize, LookupEntry *lookup);
 
     void readIndexId(T* id, char * line, const char** cols);
@@ -450,6 +459,8 @@ public:
 private:
     void checkClosed() const;
 
+    bool readBinaryIndex();
+
     int threads;
 
     int dataMode;
@@ -484,6 +495,9 @@ private:
     ZSTD_DStream ** dstream;
 
     Index * index;
+    // mapping of the binary index, index points into it
+    char * indexMapping;
+    size_t indexMappingSize;
     size_t lookupSize;
     LookupEntry * lookup;
     bool sortedByOffset;
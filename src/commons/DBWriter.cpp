@@ -6,6 +6,7 @@
 #include "Concat.h"
 #include "itoa.h"
 #include "Timer.h"
+#include "Telemetry.h"
 #include "Parameters.h"
 
 #define SIMDE_ENABLE_NATIVE_ALIASES
@@ -213,9 +214,18 @@ void DBWriter::writeDbtypeFile(const char* path, int dbtype, bool isCompressed)
 }
 
 
+void DBWriter::removeIndex(const char* indexFileName) {
+    FileUtil::remove(indexFileName);
+    std::string binaryIndex = DBReader<unsigned int>::binaryIndexFileName(indexFileName);
+    if (FileUtil::fileExists(binaryIndex.c_str())) {
+        FileUtil::remove(binaryIndex.c_str());
+    }
+}
+
 void DBWriter::close(bool merge, bool needsSort) {
     // close all datafiles
     for (unsigned int i = 0; i < threads; i++) {
+        Telemetry::addBytesWritten(offsets[i]);
         if (fclose(dataFiles[i]) != 0) {
             Debug(Debug::ERROR) << "Cannot close data file " << dataFileNames[i] << "\n";
             EXIT(EXIT_FAILURE);
@@ -419,13 +429,17 @@ size_t DBWriter::indexToBuffer(char *buff1, unsigned int key, size_t offsetStart
 }
 
 void DBWriter::alignToPageSize(int thrIdx) {
+    alignTo(Util::getPageSize(), thrIdx);
+}
+
+void DBWriter::alignTo(size_t alignment, int thrIdx) {
     size_t currentOffset = offsets[thrIdx];
-    size_t pageSize = Util::getPageSize();
-    size_t newOffset = ((pageSize - 1) & currentOffset) ? ((currentOffset + pageSize) & ~(pageSize - 1)) : currentOffset;
-    char nullByte = '\0';
-    for (size_t i = currentOffset; i < newOffset; ++i) {
-        size_t written = fwrite(&nullByte, sizeof(char), 1, dataFiles[thrIdx]);
-        if (written != 1) {
+    size_t newOffset = ((alignment - 1) & currentOffset) ? ((currentOffset + alignment) & ~(alignment - 1)) : currentOffset;
+    const char nullBytes[4096] = { 0 };
+    for (size_t i = currentOffset; i < newOffset; i += sizeof(nullBytes)) {
+        size_t toWrite = std::min(sizeof(nullBytes), newOffset - i);
+        size_t written = fwrite(nullBytes, sizeof(char), toWrite, dataFiles[thrIdx]);
+        if (written != toWrite) {
             Debug(Debug::ERROR) << "Can not write to data file " << dataFileNames[thrIdx] << "\n";
             EXIT(EXIT_FAILURE);
         }
@@ -532,11 +546,13 @@ void DBWriter::mergeResults(const char *outFileName, const char *outFileNameInde
     // merge results into one result file
     if (dataFilenames.size() > 1) {
         std::vector<FILE*> datafiles;
+        std::vector<std::string> datafileNames;
         std::vector<size_t> mergedSizes;
         for (unsigned int i = 0; i < dataFilenames.size(); i++) {
             std::vector<std::string>& filenames = dataFilenames[i];
             size_t cumulativeSize = 0;
             for (size_t j = 0; j < filenames.size(); ++j) {
+                datafileNames.emplace_back(filenames[j]);
                 FILE* fh = fopen(filenames[j].c_str(), "r");
                 if (fh == NULL) {
                     Debug(Debug::ERROR) << "Can not open result file " << filenames[j] << "!\n";
@@ -555,8 +571,15 @@ void DBWriter::mergeResults(const char *outFileName, const char *outFileNameInde
         }
 
         if (mergeDatafiles) {
-            FILE *outFh = FileUtil::openAndDelete(outFileName, "w");
-            Concat::concatFiles(datafiles, outFh);
+            // the first data file becomes the merged file, only the remaining files are appended to it
+            FileUtil::move(datafileNames[0].c_str(), outFileName);
+            FILE *outFh = fopen(outFileName, "r+");
+            if (outFh == NULL || fseek(outFh, 0, SEEK_END) != 0) {
+                Debug(Debug::ERROR) << "Cannot open data file " << outFileName << " for appending\n";
+                EXIT(EXIT_FAILURE);
+            }
+            std::vector<FILE*> remaining(datafiles.begin() + 1, datafiles.end());
+            Concat::concatFiles(remaining, outFh);
             if (fclose(outFh) != 0) {
                 Debug(Debug::ERROR) << "Cannot close data file " << outFileName << "\n";
                 EXIT(EXIT_FAILURE);
@@ -571,11 +594,8 @@ void DBWriter::mergeResults(const char *outFileName, const char *outFileNameInde
         }
 
         if (mergeDatafiles) {
-            for (unsigned int i = 0; i < dataFilenames.size(); i++) {
-                std::vector<std::string>& filenames = dataFilenames[i];
-                for (size_t j = 0; j < filenames.size(); ++j) {
-                    FileUtil::remove(filenames[j].c_str());
-                }
+            for (size_t i = 1; i < datafileNames.size(); i++) {
+                FileUtil::remove(datafileNames[i].c_str());
             }
         }
 
@@ -602,6 +622,18 @@ void DBWriter::mergeResults(const char *outFileName, const char *outFileNameInde
             EXIT(EXIT_FAILURE);
         }
     }
+    // a binary index of a previous database at this path would be stale now
+    std::string binaryIndex = DBReader<unsigned int>::binaryIndexFileName(outFileNameIndex);
+    if (FileUtil::fileExists(binaryIndex.c_str())) {
+        FileUtil::remove(binaryIndex.c_str());
+    }
+    // the input indices are consumed below, their binary indices have to go with them
+    for (unsigned int i = 0; i < fileCount; ++i) {
+        binaryIndex = DBReader<unsigned int>::binaryIndexFileName(indexFileNames[i]);
+        if (FileUtil::fileExists(binaryIndex.c_str())) {
+            FileUtil::remove(binaryIndex.c_str());
+        }
+    }
     if (dataFilenames.size() > 0) {
         if (indexNeedsToBeSorted) {
             DBWriter::sortIndex(indexFileNames[0], outFileNameIndex, lexicographicOrder);
@@ -654,6 +686,7 @@ void DBWriter::sortIndex(const char *inFileNameIndex, const char *outFileNameInd
             Debug(Debug::ERROR) << "Cannot close index file " << outFileNameIndex << "\n";
             EXIT(EXIT_FAILURE);
         }
+        DBReader<unsigned int>::writeBinaryIndex(outFileNameIndex, index, indexReader.getSize());
         indexReader.close();
 
     } else {
@@ -699,8 +732,12 @@ void DBWriter::createRenumberedDB(const std::string& dataFile, const std::string
     if (lookupReader != NULL) {
         lookup = lookupReader->getLookup();
     }
+    std::vector<DBReader<unsigned int>::Index> renumbered(reader.getSize());
     for (size_t i = 0; i < reader.getSize(); i++) {
         DBReader<unsigned int>::Index *idx = (reader.getIndex(i));
+        renumbered[i].id = i;
+        renumbered[i].offset = idx->offset;
+        renumbered[i].length = idx->length;
         size_t len = DBWriter::indexToBuffer(buffer, i, idx->offset, idx->length);
         int written = fwrite(buffer, sizeof(char), len, sIndex);
         if (written != (int) len) {
@@ -727,6 +764,7 @@ void DBWriter::createRenumberedDB(const std::string& dataFile, const std::string
     }
     reader.close();
     std::rename(indexTmp.c_str(), indexFile.c_str());
+    DBReader<unsigned int>::writeBinaryIndex(indexFile.c_str(), renumbered.data(), renumbered.size());
 
     if (lookupReader != NULL) {
         if (fclose(sLookup) != 0) {
@@ -35,6 +35,9 @@ public:
 
     void alignToPageSize(int thrIdx = 0);
 
+    // pads the data file of thrIdx so that the next entry starts at a multiple of alignment
+    void alignTo(size_t alignment, int thrIdx = 0);
+
     void sortDatafileByIdOrder(DBReader<unsigned int>& qdbr);
 
     static void mergeResults(const std::string &outFileName, const std::string &outFileNameIndex,
@@ -45,6 +48,9 @@ public:
 
     static void writeDbtypeFile(const char* path, int dbtype, bool isCompressed);
 
+    // removes the index of a merged flat file output together with its binary index
+    static void removeIndex(const char* indexFileName);
+
     size_t getStart(unsigned int threadIdx){
         return starts[threadIdx];
     }
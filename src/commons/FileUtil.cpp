@@ -53,6 +53,32 @@ void* FileUtil::mmapFile(FILE * file, size_t *dataSize){
     return ret;
 }
 
+void* FileUtil::mmapTemporaryFile(const std::string &fileName, size_t dataSize) {
+    // mmap does not map 0 bytes
+    dataSize = std::max(dataSize, (size_t) 1);
+    int fd = open(fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        int errsv = errno;
+        Debug(Debug::ERROR) << "Can not create " << fileName << ". Error " << errsv << ".\n";
+        EXIT(EXIT_FAILURE);
+    }
+    if (ftruncate(fd, dataSize) < 0) {
+        int errsv = errno;
+        Debug(Debug::ERROR) << "Can not resize " << fileName << " to " << dataSize << " bytes. Error " << errsv << ".\n";
+        EXIT(EXIT_FAILURE);
+    }
+    void *ret = mmap(NULL, dataSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ret == MAP_FAILED) {
+        int errsv = errno;
+        Debug(Debug::ERROR) << "Failed to mmap memory dataSize=" << dataSize << " File=" << fileName << ". Error " << errsv << ".\n";
+        EXIT(EXIT_FAILURE);
+    }
+    // the mapping keeps the file alive until it is unmapped
+    close(fd);
+    FileUtil::remove(fileName.c_str());
+    return ret;
+}
+
 void FileUtil::munmapData(void * ptr, size_t dataSize){
     if(munmap(ptr, dataSize) < 0){
         Debug(Debug::ERROR) << "Failed to munmap memory\n";
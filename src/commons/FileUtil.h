@@ -32,6 +32,10 @@ public:
 
     static void munmapData(void * ptr, size_t dataSize);
 
+    // maps a new file of dataSize bytes writable and shared and removes it from the directory,
+    // so its pages are written back to the file instead of being held in memory
+    static void* mmapTemporaryFile(const std::string &fileName, size_t dataSize);
+
     static void writeFile(const std::string &pathToFile, const unsigned char *sh, size_t len);
 
     static std::string dirName(const std::string &file);
@@ -22,10 +22,11 @@ public:
     ) : sequenceReader(NULL), index(NULL) {
         int targetDbtype = FileUtil::parseDbType(dataName.c_str());
         if (Parameters::isEqualDbtype(targetDbtype, Parameters::DBTYPE_INDEX_DB)) {
-            index = new DBReader<unsigned int>(dataName.c_str(), (dataName + ".index").c_str(), 1, DBReader<unsigned int>::USE_DATA|DBReader<unsigned int>::USE_INDEX);
+            index = new DBReader<unsigned int>(dataName.c_str(), (dataName + ".index").c_str(), 1, DBReader<unsigned int>::USE_DATA|DBReader<unsigned int>::USE_INDEX|(dataMode & DBReader<unsigned int>::USE_HUGEPAGES));
             index->open(DBReader<unsigned int>::NOSORT);
             if (PrefilteringIndexReader::checkIfIndexFile(index)) {
                 PrefilteringIndexReader::printSummary(index);
+                PrefilteringIndexReader::loadEvalueParameters(index);
                 PrefilteringIndexData data = PrefilteringIndexReader::getMetadata(index);
                 seqType = data.seqType;
                 bool touchIndex = preloadMode & PRELOAD_INDEX;
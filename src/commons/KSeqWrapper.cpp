@@ -4,6 +4,7 @@
 #include "Util.h"
 #include "Debug.h"
 #include <unistd.h>
+#include <vector>
 
 namespace KSEQFILE {
     KSEQ_INIT(int, read)
@@ -106,6 +107,183 @@ KSeqGzip::~KSeqGzip() {
     kseq_destroy((KSEQGZIP::kseq_t*)seq);
     gzclose(file);
 }
+
+// gzip member header up to the extra field
+static const size_t BGZF_FIXED_HEADER = 12;
+// CRC32 and ISIZE
+static const size_t BGZF_TRAILER = 8;
+// blocks inflated together, about 16 MB of decompressed data
+static const size_t BGZF_BATCH_BLOCKS = 256;
+
+// returns the BSIZE field (total block size - 1) or -1 if the header has no BC subfield
+static int parseBgzfBlockSize(const unsigned char *extra, size_t extraLength) {
+    size_t pos = 0;
+    while (pos + 4 <= extraLength) {
+        const size_t subfieldLength = extra[pos + 2] | (extra[pos + 3] << 8);
+        if (extra[pos] == 'B' && extra[pos + 1] == 'C' && subfieldLength == 2 && pos + 6 <= extraLength) {
+            return extra[pos + 4] | (extra[pos + 5] << 8);
+        }
+        pos += 4 + subfieldLength;
+    }
+    return -1;
+}
+
+struct KSeqBgzf::Stream {
+    FILE *file;
+    std::string fileName;
+    // compressed blocks of the current batch
+    std::vector<unsigned char> blocks;
+    std::vector<size_t> blockOffsets;
+    // decompressed data of the current batch
+    std::vector<char> data;
+    std::vector<size_t> dataOffsets;
+    size_t dataPos;
+
+    // reads the next batch of blocks and inflates them, returns false at the end of the file
+    bool refill() {
+        blocks.clear();
+        blockOffsets.clear();
+        dataOffsets.clear();
+        dataOffsets.push_back(0);
+        unsigned char header[BGZF_FIXED_HEADER + 256];
+        while (blockOffsets.size() < BGZF_BATCH_BLOCKS) {
+            size_t read = fread(header, 1, BGZF_FIXED_HEADER, file);
+            if (read == 0) {
+                break;
+            }
+            if (read != BGZF_FIXED_HEADER || header[0] != 31 || header[1] != 139 || header[2] != 8 || (header[3] & 4) == 0) {
+                Debug(Debug::ERROR) << "Invalid BGZF block header in " << fileName << "\n";
+                EXIT(EXIT_FAILURE);
+            }
+            const size_t extraLength = header[10] | (header[11] << 8);
+            if (extraLength > sizeof(header) - BGZF_FIXED_HEADER || fread(header + BGZF_FIXED_HEADER, 1, extraLength, file) != extraLength) {
+                Debug(Debug::ERROR) << "Invalid BGZF extra field in " << fileName << "\n";
+                EXIT(EXIT_FAILURE);
+            }
+            const int blockSize = parseBgzfBlockSize(header + BGZF_FIXED_HEADER, extraLength);
+            const size_t headerLength = BGZF_FIXED_HEADER + extraLength;
+            if (blockSize < 0 || static_cast<size_t>(blockSize) + 1 < headerLength + BGZF_TRAILER) {
+                Debug(Debug::ERROR) << "Gzip member without BGZF block size in " << fileName << "\n";
+                EXIT(EXIT_FAILURE);
+            }
+            // keep only the deflate payload and the trailer
+            const size_t payloadLength = static_cast<size_t>(blockSize) + 1 - headerLength;
+            const size_t offset = blocks.size();
+            blocks.resize(offset + payloadLength);
+            if (fread(blocks.data() + offset, 1, payloadLength, file) != payloadLength) {
+                Debug(Debug::ERROR) << "Truncated BGZF block in " << fileName << "\n";
+                EXIT(EXIT_FAILURE);
+            }
+            const unsigned char *trailer = blocks.data() + offset + payloadLength - 4;
+            const size_t inflatedSize = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | ((size_t) trailer[3] << 24);
+            blockOffsets.push_back(offset);
+            dataOffsets.push_back(dataOffsets.back() + inflatedSize);
+        }
+        blockOffsets.push_back(blocks.size());
+        const size_t blockCount = blockOffsets.size() - 1;
+        data.resize(dataOffsets.back());
+        dataPos = 0;
+
+#pragma omp taskloop grainsize(1)
+        for (size_t i = 0; i < blockCount; i++) {
+            const unsigned char *block = blocks.data() + blockOffsets[i];
+            const size_t deflateLength = blockOffsets[i + 1] - blockOffsets[i] - BGZF_TRAILER;
+            const size_t inflatedSize = dataOffsets[i + 1] - dataOffsets[i];
+            z_stream strm;
+            memset(&strm, 0, sizeof(z_stream));
+            // raw deflate, the gzip header was already consumed
+            if (inflateInit2(&strm, -15) != Z_OK) {
+                Debug(Debug::ERROR) << "Cannot initialize zlib\n";
+                EXIT(EXIT_FAILURE);
+            }
+            unsigned char *out = reinterpret_cast<unsigned char *>(data.data() + dataOffsets[i]);
+            strm.next_in = const_cast<unsigned char *>(block);
+            strm.avail_in = static_cast<unsigned int>(deflateLength);
+            strm.next_out = out;
+            strm.avail_out = static_cast<unsigned int>(inflatedSize);
+            const int status = inflate(&strm, Z_FINISH);
+            const size_t written = strm.total_out;
+            inflateEnd(&strm);
+            const unsigned char *trailer = block + deflateLength;
+            const unsigned long expectedCrc = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | ((unsigned long) trailer[3] << 24);
+            if (status != Z_STREAM_END || written != inflatedSize
+                || crc32(crc32(0L, Z_NULL, 0), out, static_cast<unsigned int>(written)) != expectedCrc) {
+                Debug(Debug::ERROR) << "Corrupt BGZF block in " << fileName << "\n";
+                EXIT(EXIT_FAILURE);
+            }
+        }
+        return blockCount > 0;
+    }
+};
+
+static int bgzfRead(KSeqBgzf::Stream *stream, void *buffer, unsigned int length) {
+    // empty blocks (e.g. the BGZF end-of-file marker) decompress to nothing
+    while (stream->dataPos == stream->data.size()) {
+        if (stream->refill() == false) {
+            return 0;
+        }
+    }
+    const size_t count = std::min(static_cast<size_t>(length), stream->data.size() - stream->dataPos);
+    memcpy(buffer, stream->data.data() + stream->dataPos, count);
+    stream->dataPos += count;
+    return static_cast<int>(count);
+}
+
+namespace KSEQBGZF {
+    KSEQ_INIT(KSeqBgzf::Stream*, bgzfRead)
+}
+
+bool KSeqBgzf::isBgzf(const char* fileName) {
+    FILE *file = fopen(fileName, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    unsigned char header[BGZF_FIXED_HEADER + 256];
+    bool isBgzf = false;
+    if (fread(header, 1, BGZF_FIXED_HEADER, file) == BGZF_FIXED_HEADER
+        && header[0] == 31 && header[1] == 139 && header[2] == 8 && (header[3] & 4) != 0) {
+        const size_t extraLength = header[10] | (header[11] << 8);
+        if (extraLength <= sizeof(header) - BGZF_FIXED_HEADER && fread(header + BGZF_FIXED_HEADER, 1, extraLength, file) == extraLength) {
+            isBgzf = parseBgzfBlockSize(header + BGZF_FIXED_HEADER, extraLength) >= 0;
+        }
+    }
+    fclose(file);
+    return isBgzf;
+}
+
+KSeqBgzf::KSeqBgzf(const char* fileName) {
+    stream = new Stream();
+    stream->file = FileUtil::openFileOrDie(fileName, "rb", true);
+    stream->fileName = fileName;
+    stream->dataPos = 0;
+    seq = (void*) KSEQBGZF::kseq_init(stream);
+    type = KSEQ_BGZF;
+}
+
+bool KSeqBgzf::ReadEntry() {
+    KSEQBGZF::kseq_t* s = (KSEQBGZF::kseq_t*) seq;
+    if (KSEQBGZF::kseq_read(s) < 0)
+        return false;
+
+    entry.name = s->name;
+    entry.comment = s->comment;
+    entry.sequence = s->seq;
+    entry.qual = s->qual;
+    entry.headerOffset = 0;
+    entry.sequenceOffset = 0;
+    entry.newlineCount = s->newlineCount;
+
+    return true;
+}
+
+KSeqBgzf::~KSeqBgzf() {
+    kseq_destroy((KSEQBGZF::kseq_t*)seq);
+    if (fclose(stream->file) != 0) {
+        Debug(Debug::ERROR) << "Cannot close KSeq input file\n";
+        EXIT(EXIT_FAILURE);
+    }
+    delete stream;
+}
 #endif
 
 
@@ -166,7 +344,11 @@ KSeqWrapper* KSeqFactory(const char* file) {
     }
 #ifdef HAVE_ZLIB
     else if(Util::endsWith(".gz", file) == true) {
-        kseq = new KSeqGzip(file);
+        if (KSeqBgzf::isBgzf(file)) {
+            kseq = new KSeqBgzf(file);
+        } else {
+            kseq = new KSeqGzip(file);
+        }
         return kseq;
     }
 #else
@@ -22,6 +22,7 @@ public:
         KSEQ_FILE,
         KSEQ_STREAM,
         KSEQ_GZIP,
+        KSEQ_BGZF,
         KSEQ_BZIP,
         KSEQ_BUFFER
     };
@@ -62,6 +63,22 @@ public:
 private:
     gzFile file;
 };
+
+// BGZF (blocked gzip as written by bgzip) consists of independent gzip members of at most 64 KB,
+// batches of them are inflated in parallel by the tasks of the enclosing OpenMP parallel region
+class KSeqBgzf : public KSeqWrapper {
+public:
+    KSeqBgzf(const char* file);
+    bool ReadEntry();
+    ~KSeqBgzf();
+
+    // checks if the first member of file carries the BGZF block size field
+    static bool isBgzf(const char* file);
+
+    struct Stream;
+private:
+    Stream* stream;
+};
 #endif
 
 #ifdef HAVE_BZLIB
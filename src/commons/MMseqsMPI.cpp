@@ -23,6 +23,30 @@ void MMseqsMPI::init(int argc, const char **argv) {
     Debug(Debug::INFO) << "MPI Init\n";
     Debug(Debug::INFO) << "Rank: " << rank << " Size: " << numProc << "\n";
 }
+
+MPIWorkQueue::MPIWorkQueue(size_t size) : size(size), counter(NULL) {
+    const MPI_Aint windowSize = MMseqsMPI::isMaster() ? sizeof(long) : 0;
+    MPI_Win_allocate(windowSize, sizeof(long), MPI_INFO_NULL, MPI_COMM_WORLD, &counter, &window);
+    if (MMseqsMPI::isMaster()) {
+        MPI_Win_lock(MPI_LOCK_EXCLUSIVE, MMseqsMPI::MASTER, 0, window);
+        *counter = 0;
+        MPI_Win_unlock(MMseqsMPI::MASTER, window);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+}
+
+MPIWorkQueue::~MPIWorkQueue() {
+    MPI_Win_free(&window);
+}
+
+size_t MPIWorkQueue::next() {
+    const long increment = 1;
+    long item;
+    MPI_Win_lock(MPI_LOCK_SHARED, MMseqsMPI::MASTER, 0, window);
+    MPI_Fetch_and_op(&increment, &item, MPI_LONG, MMseqsMPI::MASTER, 0, MPI_SUM, window);
+    MPI_Win_unlock(MMseqsMPI::MASTER, window);
+    return (item < 0 || static_cast<size_t>(item) >= size) ? size : static_cast<size_t>(item);
+}
 #else
 void MMseqsMPI::init(int, const char **) {
     rank = 0;
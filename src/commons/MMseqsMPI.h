@@ -23,6 +23,28 @@ public:
     };
 };
 
+#ifdef HAVE_MPI
+#include <cstddef>
+
+// Hands out the items 0..size-1 to the ranks on demand, so fast ranks take over work
+// from slow ones instead of idling at the next barrier.
+// The next free item is an atomic counter at the master rank, updated with one-sided MPI operations.
+// Construction and destruction are collective.
+class MPIWorkQueue {
+public:
+    explicit MPIWorkQueue(size_t size);
+    ~MPIWorkQueue();
+
+    // returns size once all items are handed out
+    size_t next();
+
+private:
+    size_t size;
+    long *counter;
+    MPI_Win window;
+};
+#endif
+
 // if we are in an error case, do not call MPI_Finalize, it might still be in a Barrier
 #ifdef HAVE_MPI
 #define EXIT(exitCode) do {                  \
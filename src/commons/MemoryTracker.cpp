@@ -4,4 +4,5 @@
 
 #include "MemoryTracker.h"
 size_t MemoryTracker::totalMemorySizeInst = 0;
+size_t MemoryTracker::peakMemorySizeInst = 0;
 
@@ -5,6 +5,7 @@
 #include "CommandCaller.h"
 #include "ByteParser.h"
 #include "FileUtil.h"
+#include "SimdDispatch.h"
 
 #include <map>
 #include <iomanip>
@@ -63,9 +64,11 @@ Parameters::Parameters():
         PARAM_SPACED_KMER_MODE(PARAM_SPACED_KMER_MODE_ID, "--spaced-kmer-mode", "Spaced k-mers", "0: use consecutive positions in k-mers; 1: use spaced k-mers", typeid(int), (void *) &spacedKmer, "^[0-1]{1}", MMseqsParameter::COMMAND_PREFILTER | MMseqsParameter::COMMAND_EXPERT),
         PARAM_REMOVE_TMP_FILES(PARAM_REMOVE_TMP_FILES_ID, "--remove-tmp-files", "Remove temporary files", "Delete temporary files", typeid(bool), (void *) &removeTmpFiles, "", MMseqsParameter::COMMAND_COMMON | MMseqsParameter::COMMAND_EXPERT),
         PARAM_INCLUDE_IDENTITY(PARAM_INCLUDE_IDENTITY_ID, "--add-self-matches", "Include identical seq. id.", "Artificially add entries of queries with themselves (for clustering)", typeid(bool), (void *) &includeIdentity, "", MMseqsParameter::COMMAND_PREFILTER | MMseqsParameter::COMMAND_ALIGN | MMseqsParameter::COMMAND_EXPERT),
-        PARAM_PRELOAD_MODE(PARAM_PRELOAD_MODE_ID, "--db-load-mode", "Preload mode", "Database preload mode 0: auto, 1: fread, 2: mmap, 3: mmap+touch", typeid(int), (void *) &preloadMode, "[0-3]{1}", MMseqsParameter::COMMAND_COMMON | MMseqsParameter::COMMAND_EXPERT),
+        PARAM_PRELOAD_MODE(PARAM_PRELOAD_MODE_ID, "--db-load-mode", "Preload mode", "Database preload mode 0: auto, 1: fread, 2: mmap, 3: mmap+touch, 4: mmap+touch with huge pages (target databases and indexes)", typeid(int), (void *) &preloadMode, "[0-4]{1}", MMseqsParameter::COMMAND_COMMON | MMseqsParameter::COMMAND_EXPERT),
         PARAM_SPACED_KMER_PATTERN(PARAM_SPACED_KMER_PATTERN_ID, "--spaced-kmer-pattern", "Spaced k-mer pattern", "User-specified spaced k-mer pattern", typeid(std::string), (void *) &spacedKmerPattern, "^1[01]*1$", MMseqsParameter::COMMAND_PREFILTER | MMseqsParameter::COMMAND_EXPERT),
         PARAM_LOCAL_TMP(PARAM_LOCAL_TMP_ID, "--local-tmp", "Local temporary path", "Path where some of the temporary files will be created", typeid(std::string), (void *) &localTmp, "", MMseqsParameter::COMMAND_PREFILTER | MMseqsParameter::COMMAND_EXPERT),
+        PARAM_BINARY_RESULT(PARAM_BINARY_RESULT_ID, "--binary-result", "Binary result", "Write results as fixed-width binary records instead of text (range 0-1)", typeid(int), (void *) &binaryResult, "^[0-1]{1}$", MMseqsParameter::COMMAND_PREFILTER | MMseqsParameter::COMMAND_ALIGN | MMseqsParameter::COMMAND_EXPERT),
+        PARAM_QUERY_BATCH_SIZE(PARAM_QUERY_BATCH_SIZE_ID, "--query-batch-size", "Query batch size", "Number of queries whose similar k-mers are looked up in the index table together (1: each query on its own)", typeid(int), (void *) &queryBatchSize, "^[1-9]{1}[0-9]*$", MMseqsParameter::COMMAND_PREFILTER | MMseqsParameter::COMMAND_EXPERT),
         // alignment
         PARAM_ALIGNMENT_MODE(PARAM_ALIGNMENT_MODE_ID, "--alignment-mode", "Alignment mode", "How to compute the alignment:\n0: automatic\n1: only score and end_pos\n2: also start_pos and cov\n3: also seq.id\n4: only ungapped alignment", typeid(int), (void *) &alignmentMode, "^[0-5]{1}$", MMseqsParameter::COMMAND_ALIGN),
         PARAM_ALIGNMENT_OUTPUT_MODE(PARAM_ALIGNMENT_OUTPUT_MODE_ID, "--alignment-output-mode", "Alignment mode", "How to compute the alignment:\n0: automatic\n1: only score and end_pos\n2: also start_pos and cov\n3: also seq.id\n4: only ungapped alignment\n5: score only (output) cluster format", typeid(int), (void *) &alignmentOutputMode, "^[0-1]{1}$", MMseqsParameter::COMMAND_ALIGN),
@@ -90,6 +93,7 @@ Parameters::Parameters():
         PARAM_GAP_PSEUDOCOUNT(PARAM_GAP_PSEUDOCOUNT_ID, "--gap-pc", "Gap pseudo count", "Pseudo count for calculating position-specific gap opening penalties", typeid(int), &gapPseudoCount, "^[0-9]+$", MMseqsParameter::COMMAND_ALIGN|MMseqsParameter::COMMAND_EXPERT),
 #endif
         PARAM_ZDROP(PARAM_ZDROP_ID, "--zdrop", "Zdrop", "Maximal allowed difference between score values before alignment is truncated  (nucleotide alignment only)", typeid(int), (void*) &zdrop, "^[0-9]{1}[0-9]*$", MMseqsParameter::COMMAND_ALIGN | MMseqsParameter::COMMAND_EXPERT),
+        PARAM_NUCL_ALIGNER(PARAM_NUCL_ALIGNER_ID, "--nucl-aligner", "Nucleotide aligner", "Gapped aligner for nucleotide alignments:\n0: banded ksw2\n1: wavefront for high identity pairs and match/mismatch matrices, falls back to ksw2", typeid(int), (void*) &nuclAligner, "^[0-1]{1}$", MMseqsParameter::COMMAND_ALIGN | MMseqsParameter::COMMAND_EXPERT),
         // clustering
         PARAM_CLUSTER_MODE(PARAM_CLUSTER_MODE_ID, "--cluster-mode", "Cluster mode", "0: Set-Cover (greedy)\n1: Connected component (BLASTclust)\n2,3: Greedy clustering by sequence length (CDHIT)", typeid(int), (void *) &clusteringMode, "[0-3]{1}$", MMseqsParameter::COMMAND_CLUST),
         PARAM_CLUSTER_STEPS(PARAM_CLUSTER_STEPS_ID, "--cluster-steps", "Cascaded clustering steps", "Cascaded clustering steps from 1 to -s", typeid(int), (void *) &clusterSteps, "^[1-9]{1}$", MMseqsParameter::COMMAND_CLUST | MMseqsParameter::COMMAND_EXPERT),
@@ -156,6 +160,8 @@ Parameters::Parameters():
         PARAM_RESULT_DIRECTION(PARAM_RESULT_DIRECTION_ID, "--result-direction", "Result direction", "result is 0: query, 1: target centric", typeid(int), (void *) &resultDirection, "^[0-1]{1}$", MMseqsParameter::COMMAND_CLUSTLINEAR | MMseqsParameter::COMMAND_EXPERT),
         PARAM_WEIGHT_FILE(PARAM_WEIGHT_FILE_ID, "--weights", "Weight file name", "Weights used for cluster priorization", typeid(std::string), (void*) &weightFile, "", MMseqsParameter::COMMAND_CLUSTLINEAR | MMseqsParameter::COMMAND_EXPERT ),
         PARAM_WEIGHT_THR(PARAM_WEIGHT_THR_ID, "--cluster-weight-threshold", "Cluster Weight threshold", "Weight threshold used for cluster priorization", typeid(float), (void*) &weightThr, "^[0-9]*(\\.[0-9]+)?$", MMseqsParameter::COMMAND_CLUSTLINEAR | MMseqsParameter::COMMAND_EXPERT ),
+        // clusthash
+        PARAM_CLUST_HASH_MODE(PARAM_CLUST_HASH_MODE_ID, "--hash-mode", "Hash mode", "0: exact hash of the full sequence\n1: MinHash sketches, writes candidate pairs of similar sequences as prefilter result", typeid(int), (void *) &clustHashMode, "^[0-1]{1}$", MMseqsParameter::COMMAND_CLUSTLINEAR | MMseqsParameter::COMMAND_EXPERT),
         // workflow
         PARAM_RUNNER(PARAM_RUNNER_ID, "--mpi-runner", "MPI runner", "Use MPI on compute cluster with this MPI command (e.g. \"mpirun -np 42\")", typeid(std::string), (void *) &runner, "", MMseqsParameter::COMMAND_COMMON | MMseqsParameter::COMMAND_EXPERT),
         PARAM_REUSELATEST(PARAM_REUSELATEST_ID, "--force-reuse", "Force restart with latest tmp", "Reuse tmp filse in tmp/latest folder ignoring parameters and version changes", typeid(bool), (void *) &reuseLatest, "", MMseqsParameter::COMMAND_COMMON | MMseqsParameter::COMMAND_EXPERT),
@@ -172,6 +178,7 @@ Parameters::Parameters():
         PARAM_ORF_FILTER_S(PARAM_ORF_FILTER_S_ID, "--orf-filter-s", "ORF filter sensitivity", "Sensitivity used for query ORF prefiltering", typeid(float), (void *) &orfFilterSens, "^[0-9]*(\\.[0-9]+)?$"),
         PARAM_ORF_FILTER_E(PARAM_ORF_FILTER_E_ID, "--orf-filter-e", "ORF filter e-value", "E-value threshold used for query ORF prefiltering", typeid(double), (void *) &orfFilterEval, "^([-+]?[0-9]*\\.?[0-9]+([eE][-+]?[0-9]+)?)|[0-9]*(\\.[0-9]+)?$"),
         PARAM_LCA_SEARCH(PARAM_LCA_SEARCH_ID, "--lca-search", "LCA search mode", "Efficient search for LCA candidates", typeid(bool), (void *) &lcaSearch, "", MMseqsParameter::COMMAND_PROFILE | MMseqsParameter::COMMAND_EXPERT),
+        PARAM_FUSED_SEARCH(PARAM_FUSED_SEARCH_ID, "--fused-search", "Fused search mode", "Align the prefilter hits in the same process without writing a prefilter database (k-mer prefilter only)", typeid(bool), (void *) &fusedSearch, "", MMseqsParameter::COMMAND_MISC | MMseqsParameter::COMMAND_EXPERT),
         // easysearch
         PARAM_GREEDY_BEST_HITS(PARAM_GREEDY_BEST_HITS_ID, "--greedy-best-hits", "Greedy best hits", "Choose the best hits greedily to cover the query", typeid(bool), (void *) &greedyBestHits, ""),
         // extractorfs
@@ -190,6 +197,7 @@ Parameters::Parameters():
         PARAM_CHECK_COMPATIBLE(PARAM_CHECK_COMPATIBLE_ID, "--check-compatible", "Check compatible", "0: Always recreate index, 1: Check if recreating index is needed, 2: Fail if index is incompatible", typeid(int), (void *) &checkCompatible, "^[0-2]{1}$", MMseqsParameter::COMMAND_MISC),
         PARAM_SEARCH_TYPE(PARAM_SEARCH_TYPE_ID, "--search-type", "Search type", "Search type 0: auto 1: amino acid, 2: translated, 3: nucleotide, 4: translated nucleotide alignment", typeid(int), (void *) &searchType, "^[0-4]{1}"),
         PARAM_INDEX_SUBSET(PARAM_INDEX_SUBSET_ID, "--index-subset", "Index subset", "Create specialized index with subset of entries\n0: normal index\n1: index without headers\n2: index without prefiltering data\n4: index without aln (for cluster db)\nFlags can be combined bit wise", typeid(int), (void *) &indexSubset, "^[0-7]{1}", MMseqsParameter::COMMAND_EXPERT),
+        PARAM_PACK_INDEX_ENTRIES(PARAM_PACK_INDEX_ENTRIES_ID, "--pack-index-entries", "Pack index entries", "Store the k-mer lists of the index delta encoded with variable byte lengths. The index needs less memory, but searching it is slower", typeid(bool), (void *) &packIndexEntries, "", MMseqsParameter::COMMAND_EXPERT),
         PARAM_INDEX_DBSUFFIX(PARAM_INDEX_DBSUFFIX_ID, "--index-dbsuffix", "Index dbsuffix", "A suffix of the db (used for cluster dbs)", typeid(std::string), (void *) &indexDbsuffix, "", MMseqsParameter::COMMAND_HIDDEN),
         // createdb
         PARAM_USE_HEADER(PARAM_USE_HEADER_ID, "--use-fasta-header", "Use fasta header", "Use the id parsed from the fasta header as the index key instead of using incrementing numeric identifiers", typeid(bool), (void *) &useHeader, ""),
@@ -244,7 +252,7 @@ Parameters::Parameters():
         PARAM_CHAIN_ALIGNMENT(PARAM_CHAIN_ALIGNMENT_ID, "--chain-alignments", "Chain overlapping alignments", "Chain overlapping alignments", typeid(int), (void *) &chainAlignment, "^[0-1]{1}", MMseqsParameter::COMMAND_EXPERT),
         PARAM_MERGE_QUERY(PARAM_MERGE_QUERY_ID, "--merge-query", "Merge query", "Combine ORFs/split sequences to a single entry", typeid(int), (void *) &mergeQuery, "^[0-1]{1}", MMseqsParameter::COMMAND_EXPERT),
         // tsv2db
-        PARAM_OUTPUT_DBTYPE(PARAM_OUTPUT_DBTYPE_ID, "--output-dbtype", "Output database type", "Set database type for resulting database: Amino acid sequences 0, Nucl. seq. 1, Profiles 2, Alignment result 5, Clustering result 6, Prefiltering result 7, Taxonomy result 8, Indexed database 9, cA3M MSAs 10, FASTA or A3M MSAs 11, Generic database 12, Omit dbtype file 13, Bi-directional prefiltering result 14, Offsetted headers 15", typeid(int), (void *) &outputDbType, "^(0|[1-9]{1}[0-9]*)$"),
+        PARAM_OUTPUT_DBTYPE(PARAM_OUTPUT_DBTYPE_ID, "--output-dbtype", "Output database type", "Set database type for resulting database: Amino acid sequences 0, Nucl. seq. 1, Profiles 2, Alignment result 5, Clustering result 6, Prefiltering result 7, Taxonomy result 8, Indexed database 9, cA3M MSAs 10, FASTA or A3M MSAs 11, Generic database 12, Omit dbtype file 13, Bi-directional prefiltering result 14, Offsetted headers 15, Binary prefiltering result 21, Binary alignment result 22", typeid(int), (void *) &outputDbType, "^(0|[1-9]{1}[0-9]*)$"),
         //diff
         PARAM_USESEQID(PARAM_USESEQID_ID, "--use-seq-id", "Match sequences by their ID", "Sequence ID (Uniprot, GenBank, ...) is used for identifying matches between the old and the new DB", typeid(bool), (void *) &useSequenceId, ""),
         // prefixid
@@ -361,6 +369,7 @@ Parameters::Parameters():
     alignall.push_back(&PARAM_GAP_OPEN);
     alignall.push_back(&PARAM_GAP_EXTEND);
     alignall.push_back(&PARAM_ZDROP);
+    alignall.push_back(&PARAM_NUCL_ALIGNER);
     alignall.push_back(&PARAM_THREADS);
     alignall.push_back(&PARAM_COMPRESSED);
     alignall.push_back(&PARAM_V);
@@ -396,6 +405,8 @@ Parameters::Parameters():
     align.push_back(&PARAM_GAP_OPEN);
     align.push_back(&PARAM_GAP_EXTEND);
     align.push_back(&PARAM_ZDROP);
+    align.push_back(&PARAM_NUCL_ALIGNER);
+    align.push_back(&PARAM_BINARY_RESULT);
     align.push_back(&PARAM_THREADS);
     align.push_back(&PARAM_COMPRESSED);
     align.push_back(&PARAM_V);
@@ -431,6 +442,8 @@ Parameters::Parameters():
     prefilter.push_back(&PARAM_PCB);
     prefilter.push_back(&PARAM_SPACED_KMER_PATTERN);
     prefilter.push_back(&PARAM_LOCAL_TMP);
+    prefilter.push_back(&PARAM_BINARY_RESULT);
+    prefilter.push_back(&PARAM_QUERY_BATCH_SIZE);
     prefilter.push_back(&PARAM_THREADS);
     prefilter.push_back(&PARAM_COMPRESSED);
     prefilter.push_back(&PARAM_V);
@@ -472,6 +485,7 @@ Parameters::Parameters():
     clust.push_back(&PARAM_MAXITERATIONS);
     clust.push_back(&PARAM_SIMILARITYSCORE);
     clust.push_back(&PARAM_THREADS);
+    clust.push_back(&PARAM_SPLIT_MEMORY_LIMIT);
     clust.push_back(&PARAM_COMPRESSED);
     clust.push_back(&PARAM_V);
     clust.push_back(&PARAM_WEIGHT_FILE);
@@ -767,6 +781,9 @@ Parameters::Parameters():
 
     // create index
     indexdb.push_back(&PARAM_SEED_SUB_MAT);
+    indexdb.push_back(&PARAM_SUB_MAT);
+    indexdb.push_back(&PARAM_GAP_OPEN);
+    indexdb.push_back(&PARAM_GAP_EXTEND);
     indexdb.push_back(&PARAM_K);
     indexdb.push_back(&PARAM_ALPH_SIZE);
     indexdb.push_back(&PARAM_NO_COMP_BIAS_CORR);
@@ -786,6 +803,7 @@ Parameters::Parameters():
     indexdb.push_back(&PARAM_SPLIT);
     indexdb.push_back(&PARAM_SPLIT_MEMORY_LIMIT);
     indexdb.push_back(&PARAM_INDEX_SUBSET);
+    indexdb.push_back(&PARAM_PACK_INDEX_ENTRIES);
     indexdb.push_back(&PARAM_V);
     indexdb.push_back(&PARAM_THREADS);
 
@@ -818,6 +836,7 @@ Parameters::Parameters():
     createdb.push_back(&PARAM_WRITE_LOOKUP);
     createdb.push_back(&PARAM_ID_OFFSET);
     createdb.push_back(&PARAM_COMPRESSED);
+    createdb.push_back(&PARAM_THREADS);
     createdb.push_back(&PARAM_V);
 
     // convert2fasta
@@ -948,6 +967,8 @@ Parameters::Parameters():
     clusthash.push_back(&PARAM_SUB_MAT);
     clusthash.push_back(&PARAM_ALPH_SIZE);
     clusthash.push_back(&PARAM_MIN_SEQ_ID);
+    clusthash.push_back(&PARAM_CLUST_HASH_MODE);
+    clusthash.push_back(&PARAM_K);
     clusthash.push_back(&PARAM_MAX_SEQ_LEN);
     clusthash.push_back(&PARAM_PRELOAD_MODE);
     clusthash.push_back(&PARAM_THREADS);
@@ -1241,6 +1262,8 @@ Parameters::Parameters():
     sortresult.push_back(&PARAM_THREADS);
     sortresult.push_back(&PARAM_V);
 
+    prefilteralign = combineList(prefilter, align);
+
     // WORKFLOWS
     searchworkflow = combineList(align, prefilter);
     searchworkflow = combineList(searchworkflow, rescorediagonal);
@@ -1259,6 +1282,7 @@ Parameters::Parameters():
     searchworkflow.push_back(&PARAM_EXHAUSTIVE_SEARCH_FILTER);
     searchworkflow.push_back(&PARAM_STRAND);
     searchworkflow.push_back(&PARAM_LCA_SEARCH);
+    searchworkflow.push_back(&PARAM_FUSED_SEARCH);
     searchworkflow.push_back(&PARAM_DISK_SPACE_LIMIT);
     searchworkflow.push_back(&PARAM_RUNNER);
     searchworkflow.push_back(&PARAM_REUSELATEST);
@@ -2191,6 +2215,7 @@ void Parameters::printParameters(const std::string &module, int argc, const char
     ss << std::boolalpha;
 
     ss << std::setw(maxWidth) << std::left  << "MMseqs Version:" << "\t" << version << "\n";
+    ss << std::setw(maxWidth) << std::left  << "SIMD instruction set:" << "\t" << SimdDispatch::getLevelName() << "\n";
 
 
     for (size_t i = 0; i < par.size(); i++) {
@@ -2259,6 +2284,8 @@ void Parameters::setDefaults() {
     splitAA = false;
     spacedKmerPattern = "";
     localTmp = "";
+    binaryResult = 0;
+    queryBatchSize = 1;
 
     // search workflow
     numIterations = 1;
@@ -2272,6 +2299,7 @@ void Parameters::setDefaults() {
     orfFilterSens = 2.0;
     orfFilterEval = 100;
     lcaSearch = false;
+    fusedSearch = false;
 
     greedyBestHits = false;
 
@@ -2318,6 +2346,7 @@ void Parameters::setDefaults() {
     gapPseudoCount = 10;
 #endif
     zdrop = 40;
+    nuclAligner = NUCL_ALIGNER_KSW2;
     addBacktrace = false;
     realign = false;
     clusteringMode = SET_COVER;
@@ -2349,6 +2378,7 @@ void Parameters::setDefaults() {
     checkCompatible = 0;
     searchType = SEARCH_TYPE_AUTO;
     indexSubset = INDEX_SUBSET_NORMAL;
+    packIndexEntries = false;
     indexDbsuffix = "";
 
     // createdb
@@ -2509,6 +2539,9 @@ void Parameters::setDefaults() {
     weightThr = 0.9;
     weightFile = "";
 
+    // clusthash
+    clustHashMode = CLUST_HASH_MODE_EXACT;
+
     // result2stats
     stat = "";
 
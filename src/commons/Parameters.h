@@ -84,6 +84,8 @@ public:
     static const int DBTYPE_SEQTAXDB = 18; // needed for verification
     static const int DBTYPE_STDIN = 19; // needed for verification
     static const int DBTYPE_URI = 20; // needed for verification
+    static const int DBTYPE_PREFILTER_BIN_RES = 21;
+    static const int DBTYPE_ALIGNMENT_BIN_RES = 22;
 
     static const unsigned int DBTYPE_EXTENDED_COMPRESSED = 1;
     static const unsigned int DBTYPE_EXTENDED_INDEX_NEED_SRC = 2;
@@ -112,6 +114,9 @@ public:
     static const unsigned int ALIGNMENT_MODE_SCORE_COV_SEQID = 3;
     static const unsigned int ALIGNMENT_MODE_UNGAPPED = 4;
 
+    static const int NUCL_ALIGNER_KSW2 = 0;
+    static const int NUCL_ALIGNER_WAVEFRONT = 1;
+
     static const unsigned int ALIGNMENT_OUTPUT_ALIGNMENT = 0;
     static const unsigned int ALIGNMENT_OUTPUT_CLUSTER = 1;
 
@@ -240,6 +245,7 @@ public:
     static const int PRELOAD_MODE_FREAD = 1;
     static const int PRELOAD_MODE_MMAP = 2;
     static const int PRELOAD_MODE_MMAP_TOUCH = 3;
+    static const int PRELOAD_MODE_MMAP_HUGEPAGE = 4;
 
     static std::string getSplitModeName(int splitMode) {
         switch (splitMode) {
@@ -261,6 +267,8 @@ public:
 
     static const int CLUST_HASH_DEFAULT_ALPH_SIZE = 3;
     static const int CLUST_HASH_DEFAULT_MIN_SEQ_ID = 99;
+    static const int CLUST_HASH_MODE_EXACT = 0;
+    static const int CLUST_HASH_MODE_SKETCH = 1;
     static const int CLUST_LINEAR_DEFAULT_ALPH_SIZE = 13;
     static const int CLUST_LINEAR_DEFAULT_K = 0;
     static const int CLUST_LINEAR_KMER_PER_SEQ = 0;
@@ -417,6 +425,8 @@ public:
     int    realignMaxSeqs;               // Max alignments to realign
     std::string spacedKmerPattern;       // User-specified kmer pattern
     std::string localTmp;                // Local temporary path
+    int    binaryResult;                 // write fixed-width binary result records
+    int    queryBatchSize;               // queries whose similar k-mers are matched together
 
 
     // ALIGNMENT
@@ -442,6 +452,7 @@ public:
     int    gapPseudoCount;               // for calculation of position-specific gap opening penalties
 #endif
     int    zdrop;                        // zdrop
+    int    nuclAligner;                  // gapped nucleotide aligner
 
     // workflow
     std::string runner;
@@ -465,6 +476,7 @@ public:
     float orfFilterSens;
     double orfFilterEval;
     bool lcaSearch;
+    bool fusedSearch;
 
     // easysearch
     bool greedyBestHits;
@@ -551,10 +563,14 @@ public:
     float weightThr;
     std::string weightFile;
 
+    // clusthash
+    int clustHashMode;
+
     // indexdb
     int checkCompatible;
     int searchType;
     int indexSubset;
+    bool packIndexEntries;
     std::string indexDbsuffix;
 
     // createdb
@@ -763,6 +779,8 @@ public:
     PARAMETER(PARAM_PRELOAD_MODE)
     PARAMETER(PARAM_SPACED_KMER_PATTERN)
     PARAMETER(PARAM_LOCAL_TMP)
+    PARAMETER(PARAM_BINARY_RESULT)
+    PARAMETER(PARAM_QUERY_BATCH_SIZE)
     std::vector<MMseqsParameter*> prefilter;
     std::vector<MMseqsParameter*> ungappedprefilter;
     std::vector<MMseqsParameter*> gappedprefilter;
@@ -791,6 +809,7 @@ public:
     PARAMETER(PARAM_GAP_PSEUDOCOUNT)
 #endif
     PARAMETER(PARAM_ZDROP)
+    PARAMETER(PARAM_NUCL_ALIGNER)
 
     // clustering
     PARAMETER(PARAM_CLUSTER_MODE)
@@ -870,6 +889,9 @@ public:
     PARAMETER(PARAM_WEIGHT_FILE)
     PARAMETER(PARAM_WEIGHT_THR)
 
+    // clusthash
+    PARAMETER(PARAM_CLUST_HASH_MODE)
+
     // workflow
     PARAMETER(PARAM_RUNNER)
     PARAMETER(PARAM_REUSELATEST)
@@ -886,6 +908,7 @@ public:
     PARAMETER(PARAM_ORF_FILTER_S)
     PARAMETER(PARAM_ORF_FILTER_E)
     PARAMETER(PARAM_LCA_SEARCH)
+    PARAMETER(PARAM_FUSED_SEARCH)
 
     // easysearch
     PARAMETER(PARAM_GREEDY_BEST_HITS)
@@ -907,6 +930,7 @@ public:
     PARAMETER(PARAM_CHECK_COMPATIBLE)
     PARAMETER(PARAM_SEARCH_TYPE)
     PARAMETER(PARAM_INDEX_SUBSET)
+    PARAMETER(PARAM_PACK_INDEX_ENTRIES)
     PARAMETER(PARAM_INDEX_DBSUFFIX)
 
     // createdb
@@ -1079,6 +1103,7 @@ public:
 
     std::vector<MMseqsParameter*> alignall;
     std::vector<MMseqsParameter*> align;
+    std::vector<MMseqsParameter*> prefilteralign;
     std::vector<MMseqsParameter*> rescorediagonal;
     std::vector<MMseqsParameter*> alignbykmer;
     std::vector<MMseqsParameter*> createFasta;
@@ -1215,6 +1240,8 @@ public:
             case DBTYPE_FLATFILE: return "Flatfile";
             case DBTYPE_STDIN: return "stdin";
             case DBTYPE_URI: return "uri";
+            case DBTYPE_PREFILTER_BIN_RES: return "Binary prefilter";
+            case DBTYPE_ALIGNMENT_BIN_RES: return "Binary alignment";
 
             default: return "Unknown";
         }
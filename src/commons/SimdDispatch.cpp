@@ -0,0 +1,68 @@
+#include "SimdDispatch.h"
+#include "Debug.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+SimdDispatch::Level SimdDispatch::getLevel() {
+    // function local static initialization is thread-safe
+    static const Level level = detectLevel();
+    return level;
+}
+
+const char *SimdDispatch::getLevelName() {
+    switch (getLevel()) {
+        case LEVEL_AVX512:
+            return "avx512bw";
+        case LEVEL_AVX2:
+            return "avx2";
+        default:
+            return getBaselineName();
+    }
+}
+
+SimdDispatch::Level SimdDispatch::detectLevel() {
+    Level level = LEVEL_BASELINE;
+#if defined(SIMD_DISPATCH) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+        level = LEVEL_AVX512;
+    } else if (__builtin_cpu_supports("avx2")) {
+        level = LEVEL_AVX2;
+    }
+#endif
+
+    const char *requested = getenv("MMSEQS_SIMD_LEVEL");
+    if (requested != NULL) {
+        if (strcmp(requested, "baseline") == 0 || strcmp(requested, getBaselineName()) == 0) {
+            level = LEVEL_BASELINE;
+        } else if (strcmp(requested, "avx2") == 0) {
+            level = std::min(level, LEVEL_AVX2);
+        } else if (strcmp(requested, "avx512bw") != 0) {
+            Debug(Debug::WARNING) << "Ignoring unknown MMSEQS_SIMD_LEVEL " << requested << "\n";
+        }
+    }
+    return level;
+}
+
+const char *SimdDispatch::getBaselineName() {
+#if defined(AVX2)
+    return "avx2";
+#elif defined(SIMDE_X86_SSE4_1_NATIVE)
+    return "sse4.1";
+#elif defined(SIMDE_X86_SSE2_NATIVE)
+    return "sse2";
+#elif defined(SIMDE_ARM_NEON_A32V7_NATIVE)
+    return "neon";
+#elif defined(SIMDE_POWER_ALTIVEC_P6_NATIVE)
+    return "altivec";
+#elif defined(SIMDE_ZARCH_ZVECTOR_13_NATIVE)
+    return "zvector";
+#elif defined(SIMDE_WASM_SIMD128_NATIVE)
+    return "wasm-simd128";
+#else
+    return "generic";
+#endif
+}
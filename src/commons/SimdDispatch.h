@@ -0,0 +1,27 @@
+#ifndef MMSEQS_SIMDDISPATCH_H
+#define MMSEQS_SIMDDISPATCH_H
+
+// Runtime selection of SIMD kernels.
+// Builds configured with HAVE_SIMD_DISPATCH compile the hot alignment kernels again for AVX2 and AVX-512BW
+// (into the simd_avx2 and simd_avx512 namespaces) next to the baseline variant (simd_baseline namespace).
+// The best variant supported by the CPU is picked once at startup. The environment variable
+// MMSEQS_SIMD_LEVEL can lower the selection, e.g. MMSEQS_SIMD_LEVEL=avx2 or MMSEQS_SIMD_LEVEL=baseline.
+class SimdDispatch {
+public:
+    enum Level {
+        LEVEL_BASELINE = 0,
+        LEVEL_AVX2 = 1,
+        LEVEL_AVX512 = 2
+    };
+
+    static Level getLevel();
+
+    // name of the instruction set used by the selected kernels
+    static const char *getLevelName();
+
+private:
+    static Level detectLevel();
+    static const char *getBaselineName();
+};
+
+#endif
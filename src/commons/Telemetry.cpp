@@ -0,0 +1,264 @@
+#include "Telemetry.h"
+#include "CommandCaller.h"
+#include "MemoryTracker.h"
+#include "Parameters.h"
+#include "Debug.h"
+#include "Util.h"
+#include "Timer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+const char *Telemetry::command = "";
+std::map<std::string, size_t> Telemetry::counters;
+size_t Telemetry::bytesRead = 0;
+size_t Telemetry::bytesWritten = 0;
+
+static std::string escapeJson(const char *in) {
+    std::string out;
+    for (const char *c = in; *c != '\0'; ++c) {
+        switch (*c) {
+            case '"':
+                out.append("\\\"");
+                break;
+            case '\\':
+                out.append("\\\\");
+                break;
+            case '\n':
+                out.append("\\n");
+                break;
+            case '\t':
+                out.append("\\t");
+                break;
+            default:
+                if (static_cast<unsigned char>(*c) >= 0x20) {
+                    out.push_back(*c);
+                }
+                break;
+        }
+    }
+    return out;
+}
+
+static const char *getEnvOrEmpty(const char *name) {
+    const char *value = getenv(name);
+    return value == NULL ? "" : value;
+}
+
+static void writeCounters(std::ostringstream &ss, const std::map<std::string, size_t> &counters) {
+    ss << "\"counters\":{";
+    for (std::map<std::string, size_t>::const_iterator it = counters.begin(); it != counters.end(); ++it) {
+        if (it != counters.begin()) {
+            ss << ",";
+        }
+        ss << "\"" << escapeJson(it->first.c_str()) << "\":" << it->second;
+    }
+    ss << "}";
+}
+
+// only understands the records written by this class
+static double findNumber(const std::string &line, const char *key) {
+    std::string pattern = std::string("\"") + key + "\":";
+    size_t pos = line.find(pattern);
+    if (pos == std::string::npos) {
+        return 0.0;
+    }
+    return strtod(line.c_str() + pos + pattern.size(), NULL);
+}
+
+static std::string findString(const std::string &line, const char *key) {
+    std::string pattern = std::string("\"") + key + "\":\"";
+    size_t pos = line.find(pattern);
+    if (pos == std::string::npos) {
+        return "";
+    }
+    pos += pattern.size();
+    size_t end = pos;
+    while (end < line.size() && line[end] != '"') {
+        end += (line[end] == '\\') ? 2 : 1;
+    }
+    return line.substr(pos, end - pos);
+}
+
+static void addCounters(const std::string &line, std::map<std::string, size_t> &counters) {
+    const char *pattern = "\"counters\":{";
+    size_t pos = line.find(pattern);
+    if (pos == std::string::npos) {
+        return;
+    }
+    pos += strlen(pattern);
+    while (pos < line.size() && line[pos] == '"') {
+        size_t keyEnd = line.find('"', pos + 1);
+        if (keyEnd == std::string::npos) {
+            return;
+        }
+        std::string key = line.substr(pos + 1, keyEnd - pos - 1);
+        char *rest;
+        counters[key] += strtoull(line.c_str() + keyEnd + 2, &rest, 10);
+        pos = rest - line.c_str();
+        if (pos < line.size() && line[pos] == ',') {
+            pos++;
+        }
+    }
+}
+
+bool Telemetry::isEnabled() {
+    const char *file = getenv("MMSEQS_TELEMETRY");
+    return file != NULL && file[0] != '\0';
+}
+
+void Telemetry::setCommand(const char *name) {
+    command = name;
+}
+
+void Telemetry::addCounter(const std::string &name, size_t value) {
+#pragma omp critical(telemetry)
+    counters[name] += value;
+}
+
+void Telemetry::addBytesRead(size_t bytes) {
+    __sync_fetch_and_add(&bytesRead, bytes);
+}
+
+void Telemetry::addBytesWritten(size_t bytes) {
+    __sync_fetch_and_add(&bytesWritten, bytes);
+}
+
+void Telemetry::appendLine(const std::string &line) {
+    const char *file = getenv("MMSEQS_TELEMETRY");
+    int fd = ::open(file, O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (fd == -1) {
+        Debug(Debug::WARNING) << "Cannot open telemetry file " << file << "\n";
+        return;
+    }
+    // a single append write keeps lines of concurrent processes intact
+    if (::write(fd, line.c_str(), line.size()) != static_cast<ssize_t>(line.size())) {
+        Debug(Debug::WARNING) << "Cannot write to telemetry file " << file << "\n";
+    }
+    ::close(fd);
+}
+
+void Telemetry::writeModuleRecord(int argc, const char **argv, int status, double wallTime) {
+    if (isEnabled() == false) {
+        return;
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(3);
+    ss << "{\"type\":\"module\"";
+    ss << ",\"run\":\"" << escapeJson(getEnvOrEmpty("MMSEQS_TELEMETRY_RUN")) << "\"";
+    ss << ",\"workflow\":\"" << escapeJson(getEnvOrEmpty("MMSEQS_TELEMETRY_WORKFLOW")) << "\"";
+    ss << ",\"depth\":" << CommandCaller::getCallDepth();
+    ss << ",\"command\":\"" << escapeJson(command) << "\"";
+    ss << ",\"args\":\"";
+    for (int i = 0; i < argc; ++i) {
+        ss << (i > 0 ? " " : "") << escapeJson(argv[i]);
+    }
+    ss << "\"";
+    ss << ",\"status\":" << status;
+    ss << ",\"threads\":" << Parameters::getInstance().threads;
+    ss << ",\"wall_s\":" << wallTime;
+    ss << ",\"user_s\":" << (usage.ru_utime.tv_sec + 1e-6 * usage.ru_utime.tv_usec);
+    ss << ",\"sys_s\":" << (usage.ru_stime.tv_sec + 1e-6 * usage.ru_stime.tv_usec);
+    ss << ",\"max_rss_kb\":" << usage.ru_maxrss;
+    ss << ",\"tracked_peak_bytes\":" << MemoryTracker::getPeakSize();
+    ss << ",\"bytes_read\":" << bytesRead;
+    ss << ",\"bytes_written\":" << bytesWritten;
+    ss << ",";
+    writeCounters(ss, counters);
+    ss << "}\n";
+    appendLine(ss.str());
+}
+
+int Telemetry::runWorkflow(const char *program, char *const *argv) {
+    const std::string run = SSTR(getpid()) + "-" + SSTR(time(NULL));
+    setenv("MMSEQS_TELEMETRY_RUN", run.c_str(), true);
+    setenv("MMSEQS_TELEMETRY_WORKFLOW", command, true);
+
+    Timer timer;
+    pid_t pid = fork();
+    if (pid == -1) {
+        Debug(Debug::ERROR) << "Failed to fork " << program << " with error " << errno << ".\n";
+        return EXIT_FAILURE;
+    }
+    if (pid == 0) {
+        execvp(program, argv);
+        Debug(Debug::ERROR) << "Failed to execute " << program << " with error " << errno << ".\n";
+        _exit(EXIT_FAILURE);
+    }
+    int childStatus;
+    while (waitpid(pid, &childStatus, 0) == -1) {
+        if (errno != EINTR) {
+            Debug(Debug::ERROR) << "Failed to wait for " << program << " with error " << errno << ".\n";
+            return EXIT_FAILURE;
+        }
+    }
+    const int status = WIFEXITED(childStatus) ? WEXITSTATUS(childStatus) : EXIT_FAILURE;
+    const double wallTime = timer.getTimediff();
+
+    size_t modules = 0;
+    double userTime = 0.0;
+    double sysTime = 0.0;
+    double maxRss = 0.0;
+    double trackedPeak = 0.0;
+    double totalRead = 0.0;
+    double totalWritten = 0.0;
+    std::map<std::string, double> stageTimes;
+    std::map<std::string, size_t> totalCounters;
+    std::ifstream records(getenv("MMSEQS_TELEMETRY"));
+    std::string line;
+    const std::string runPattern = "\"run\":\"" + run + "\"";
+    while (std::getline(records, line)) {
+        if (line.find("\"type\":\"module\"") == std::string::npos || line.find(runPattern) == std::string::npos) {
+            continue;
+        }
+        modules++;
+        stageTimes[findString(line, "command")] += findNumber(line, "wall_s");
+        userTime += findNumber(line, "user_s");
+        sysTime += findNumber(line, "sys_s");
+        maxRss = std::max(maxRss, findNumber(line, "max_rss_kb"));
+        trackedPeak = std::max(trackedPeak, findNumber(line, "tracked_peak_bytes"));
+        totalRead += findNumber(line, "bytes_read");
+        totalWritten += findNumber(line, "bytes_written");
+        addCounters(line, totalCounters);
+    }
+
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(3);
+    ss << "{\"type\":\"workflow\"";
+    ss << ",\"run\":\"" << run << "\"";
+    ss << ",\"workflow\":\"" << escapeJson(command) << "\"";
+    ss << ",\"status\":" << status;
+    ss << ",\"threads\":" << Parameters::getInstance().threads;
+    ss << ",\"wall_s\":" << wallTime;
+    ss << ",\"modules\":" << modules;
+    ss << ",\"user_s\":" << userTime;
+    ss << ",\"sys_s\":" << sysTime;
+    ss << std::setprecision(0);
+    ss << ",\"max_rss_kb\":" << maxRss;
+    ss << ",\"tracked_peak_bytes\":" << trackedPeak;
+    ss << ",\"bytes_read\":" << totalRead;
+    ss << ",\"bytes_written\":" << totalWritten;
+    ss << std::setprecision(3);
+    ss << ",\"stages\":{";
+    for (std::map<std::string, double>::const_iterator it = stageTimes.begin(); it != stageTimes.end(); ++it) {
+        ss << (it != stageTimes.begin() ? "," : "") << "\"" << it->first << "\":" << it->second;
+    }
+    ss << "},";
+    writeCounters(ss, totalCounters);
+    ss << "}\n";
+    appendLine(ss.str());
+    return status;
+}
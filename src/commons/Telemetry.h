@@ -0,0 +1,41 @@
+#ifndef MMSEQS_TELEMETRY_H
+#define MMSEQS_TELEMETRY_H
+
+// Machine readable performance records.
+// If MMSEQS_TELEMETRY is set to a file name, every module appends one JSON line with its wall and
+// CPU time, peak memory, database bytes read and written and the counters added during the run.
+// Workflows tag the records of all modules they call with a run id and append one aggregated
+// workflow record once their script is done.
+#include <cstddef>
+#include <map>
+#include <string>
+
+class Telemetry {
+public:
+    static bool isEnabled();
+
+    // name of the running module
+    static void setCommand(const char *command);
+
+    // counters with the same name are summed
+    static void addCounter(const std::string &name, size_t value);
+    // data size of databases opened by DBReader
+    static void addBytesRead(size_t bytes);
+    static void addBytesWritten(size_t bytes);
+
+    static void writeModuleRecord(int argc, const char **argv, int status, double wallTime);
+
+    // runs the workflow script in a child process and appends the workflow record after it finished
+    // returns the exit status of the script
+    static int runWorkflow(const char *program, char *const *argv);
+
+private:
+    static const char *command;
+    static std::map<std::string, size_t> counters;
+    static size_t bytesRead;
+    static size_t bytesWritten;
+
+    static void appendLine(const std::string &line);
+};
+
+#endif
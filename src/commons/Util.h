@@ -84,6 +84,10 @@ public:
 
     static size_t getTotalSystemMemory();
     static size_t getPageSize();
+    // huge page size used for aligning data that should be mapped with transparent huge pages
+    static size_t getHugePageSize() {
+        return 2 * 1024 * 1024;
+    }
     static size_t getTotalMemoryPages();
     static uint64_t getL2CacheSize();
 
@@ -16,6 +16,7 @@
 #include "FileUtil.h"
 #include "FastSort.h"
 #include "SequenceWeights.h"
+#include "Telemetry.h"
 
 #include <sys/stat.h>
 #include <sys/mman.h>
@@ -38,22 +39,55 @@ uint64_t hashUInt64(uint64_t in, uint64_t seed) {
     return XXH64(&in, sizeof(uint64_t), seed);
 }
 
-template <typename T>
-KmerPosition<T> *initKmerPositionMemory(size_t size) {
-    KmerPosition<T> * hashSeqPair = new(std::nothrow) KmerPosition<T>[size + 1];
+template <typename T, template <typename> class KmerType>
+KmerType<T> *initKmerPositionMemory(size_t size) {
+    KmerType<T> * hashSeqPair = new(std::nothrow) KmerType<T>[size + 1];
     Util::checkAllocation(hashSeqPair, "Can not allocate memory");
-    size_t pageSize = Util::getPageSize()/sizeof(KmerPosition<T>);
+    size_t pageSize = Util::getPageSize()/sizeof(KmerType<T>);
 #pragma omp parallel
     {
 #pragma omp for schedule(static)
         for (size_t page = 0; page < size+1; page += pageSize) {
             size_t readUntil = std::min(size+1, page + pageSize) - page;
-            memset(hashSeqPair+page, 0xFF, sizeof(KmerPosition<T>)* readUntil);
+            memset(hashSeqPair+page, 0xFF, sizeof(KmerType<T>)* readUntil);
         }
     }
     return hashSeqPair;
 }
 
+template <typename T>
+KmerSequenceOrder<T>::KmerSequenceOrder(DBReader<unsigned int> &seqDbr) {
+    const size_t size = seqDbr.getSize();
+    std::vector<unsigned int> keyById(size);
+    std::vector<T> seqLenById(size);
+    for (size_t id = 0; id < size; id++) {
+        keyById[id] = seqDbr.getDbKey(id);
+        seqLenById[id] = static_cast<T>(seqDbr.getSeqLen(id));
+    }
+    std::vector<unsigned int> ids(size);
+    for (size_t id = 0; id < size; id++) {
+        ids[id] = id;
+    }
+    SORT_PARALLEL(ids.begin(), ids.end(), [&keyById, &seqLenById](unsigned int first, unsigned int second) {
+        if (seqLenById[first] != seqLenById[second]) {
+            return seqLenById[first] > seqLenById[second];
+        }
+        return keyById[first] < keyById[second];
+    });
+    indexById.resize(size);
+    keys.resize(size);
+    seqLens.resize(size);
+    for (size_t index = 0; index < size; index++) {
+        const unsigned int id = ids[index];
+        indexById[id] = index;
+        keys[index] = keyById[id];
+        seqLens[index] = seqLenById[id];
+    }
+}
+
+template class KmerSequenceOrder<short>;
+template class KmerSequenceOrder<int>;
+
 void maskSequence(int maskMode, int maskLowerCase, float maskProb, Sequence &seq, int maskLetter, ProbabilityMatrix * probMatrix){
     if (maskMode == 1) {
         tantan::maskSequences((char*)seq.numSequence,
@@ -75,10 +109,12 @@ void maskSequence(int maskMode, int maskLowerCase, float maskProb, Sequence &seq
     }
 }
 
-template <int TYPE, typename T>
-std::pair<size_t, size_t> fillKmerPositionArray(KmerPosition<T> * kmerArray, size_t kmerArraySize, DBReader<unsigned int> &seqDbr,
+template <int TYPE, typename T, template <typename> class KmerType>
+std::pair<size_t, size_t> fillKmerPositionArray(KmerType<T> * kmerArray, size_t kmerArraySize, DBReader<unsigned int> &seqDbr,
                                                 Parameters & par, BaseMatrix * subMat, bool hashWholeSequence,
-                                                size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution){
+                                                size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution,
+                                                KmerBucketWriter<KmerType<T>> * bucketWriter,
+                                                const KmerSequenceOrder<T> * sequenceOrder){
     size_t offset = 0;
     int querySeqType  =  seqDbr.getDbtype();
     size_t longestKmer = par.kmerSize;
@@ -114,7 +150,14 @@ std::pair<size_t, size_t> fillKmerPositionArray(KmerPosition<T> * kmerArray, siz
         Indexer idxer(subMat->alphabetSize - 1,  par.kmerSize);
         const unsigned int BUFFER_SIZE = 1048576;
         size_t bufferPos = 0;
-        KmerPosition<T> * threadKmerBuffer = new KmerPosition<T>[BUFFER_SIZE];
+        KmerType<T> * threadKmerBuffer = new KmerType<T>[BUFFER_SIZE];
+        // hash of every buffered k-mer and scratch space to group them by bucket
+        unsigned short * threadHashBuffer = NULL;
+        KmerType<T> * threadBucketBuffer = NULL;
+        if (bucketWriter != NULL) {
+            threadHashBuffer = new unsigned short[BUFFER_SIZE];
+            threadBucketBuffer = new KmerType<T>[BUFFER_SIZE];
+        }
         SequencePosition * kmers = (SequencePosition *) malloc((par.pickNbest * (par.maxSeqLen + 1) + 1) * sizeof(SequencePosition));
         size_t kmersArraySize = par.maxSeqLen;
         const size_t flushSize = 100000000;
@@ -142,6 +185,7 @@ std::pair<size_t, size_t> fillKmerPositionArray(KmerPosition<T> * kmerArray, siz
 
                 size_t seqKmerCount = 0;
                 unsigned int seqId = seq.getDbKey();
+                unsigned int seqIdx = (sequenceOrder != NULL) ? sequenceOrder->getIndex(id) : static_cast<unsigned int>(id);
                 while (seq.hasNextKmer()) {
                     unsigned char *kmer = (unsigned char*) seq.nextKmer();
                     if(seq.kmerContainsX()){
@@ -241,18 +285,23 @@ std::pair<size_t, size_t> fillKmerPositionArray(KmerPosition<T> * kmerArray, siz
                 // add k-mer to represent the identity
                 if (static_cast<unsigned short>(seqHash) >= hashStartRange && static_cast<unsigned short>(seqHash) <= hashEndRange) {
                     threadKmerBuffer[bufferPos].kmer = seqHash;
-                    threadKmerBuffer[bufferPos].id = seqId;
+                    threadKmerBuffer[bufferPos].setSequence(seqId, seqIdx, seq.L);
                     threadKmerBuffer[bufferPos].pos = 0;
-                    threadKmerBuffer[bufferPos].seqLen = seq.L;
                     if(hashDistribution != NULL){
                         __sync_fetch_and_add(&hashDistribution[static_cast<unsigned short>(seqHash)], 1);
                     }
+                    if(threadHashBuffer != NULL){
+                        threadHashBuffer[bufferPos] = static_cast<unsigned short>(seqHash);
+                    }
                     bufferPos++;
                     if (bufferPos >= BUFFER_SIZE) {
                         size_t writeOffset = __sync_fetch_and_add(&offset, bufferPos);
                         if(writeOffset + bufferPos < kmerArraySize){
                             if(kmerArray!=NULL){
-                                memcpy(kmerArray + writeOffset, threadKmerBuffer, sizeof(KmerPosition<T>) * bufferPos);
+                                memcpy(kmerArray + writeOffset, threadKmerBuffer, sizeof(KmerType<T>) * bufferPos);
+                            }
+                            if(bucketWriter != NULL){
+                                bucketWriter->write(threadKmerBuffer, threadHashBuffer, bufferPos, threadBucketBuffer);
                             }
                         } else{
                             Debug(Debug::ERROR) << "Kmer array overflow. currKmerArrayOffset="<< writeOffset
@@ -318,9 +367,11 @@ std::pair<size_t, size_t> fillKmerPositionArray(KmerPosition<T> * kmerArray, siz
 //                                std::cout << seqId << "\t" << (kmers + kmerIdx)->score << "\t" << tmpKmerIdx << std::endl;
 //                            }
                             threadKmerBuffer[bufferPos].kmer = (kmers + kmerIdx)->kmer;
-                            threadKmerBuffer[bufferPos].id = seqId;
+                            threadKmerBuffer[bufferPos].setSequence(seqId, seqIdx, seq.L);
                             threadKmerBuffer[bufferPos].pos = (kmers + kmerIdx)->pos;
-                            threadKmerBuffer[bufferPos].seqLen = seq.L;
+                            if(threadHashBuffer != NULL){
+                                threadHashBuffer[bufferPos] = (kmers + kmerIdx)->score;
+                            }
                             bufferPos++;
                             if(hashDistribution != NULL){
                                 __sync_fetch_and_add(&hashDistribution[(kmers + kmerIdx)->score], 1);
@@ -331,7 +382,10 @@ std::pair<size_t, size_t> fillKmerPositionArray(KmerPosition<T> * kmerArray, siz
                                 if(writeOffset + bufferPos < kmerArraySize){
                                     if(kmerArray!=NULL) {
                                         memcpy(kmerArray + writeOffset, threadKmerBuffer,
-                                               sizeof(KmerPosition<T>) * bufferPos);
+                                               sizeof(KmerType<T>) * bufferPos);
+                                    }
+                                    if(bucketWriter != NULL){
+                                        bucketWriter->write(threadKmerBuffer, threadHashBuffer, bufferPos, threadBucketBuffer);
                                     }
                                 } else{
                                     Debug(Debug::ERROR) << "Kmer array overflow. currKmerArrayOffset="<< writeOffset
@@ -362,11 +416,18 @@ std::pair<size_t, size_t> fillKmerPositionArray(KmerPosition<T> * kmerArray, siz
         if(bufferPos > 0){
             size_t writeOffset = __sync_fetch_and_add(&offset, bufferPos);
             if(kmerArray != NULL){
-                memcpy(kmerArray+writeOffset, threadKmerBuffer, sizeof(KmerPosition<T>) * bufferPos);
+                memcpy(kmerArray+writeOffset, threadKmerBuffer, sizeof(KmerType<T>) * bufferPos);
+            }
+            if(bucketWriter != NULL){
+                bucketWriter->write(threadKmerBuffer, threadHashBuffer, bufferPos, threadBucketBuffer);
             }
         }
         free(kmers);
         delete[] threadKmerBuffer;
+        if (bucketWriter != NULL) {
+            delete[] threadHashBuffer;
+            delete[] threadBucketBuffer;
+        }
         delete[] hierarchicalScoreDist;
         delete[] scoreDist;
         if (TYPE == Parameters::DBTYPE_HMM_PROFILE) {
@@ -387,9 +448,13 @@ std::pair<size_t, size_t> fillKmerPositionArray(KmerPosition<T> * kmerArray, siz
 
 
 template <int TYPE, typename T>
-void swapCenterSequence(KmerPosition<T> *hashSeqPair, size_t splitKmerCount, SequenceWeights &seqWeights) {
+void swapCenterSequence(CompactKmerPosition<T> *hashSeqPair, size_t splitKmerCount, SequenceWeights &seqWeights,
+                        const KmerSequenceOrder<T> &sequenceOrder) {
 
 
+    if (hashSeqPair[0].kmer == SIZE_T_MAX) {
+        return;
+    }
     size_t prevHash = hashSeqPair[0].kmer;
     if(TYPE == Parameters::DBTYPE_NUCLEOTIDES){
         prevHash = BIT_SET(prevHash, 63);
@@ -397,7 +462,7 @@ void swapCenterSequence(KmerPosition<T> *hashSeqPair, size_t splitKmerCount, Seq
 
     size_t repSeqPos = 0;
     size_t prevHashStart = 0;
-    float repSeqWeight = seqWeights.getWeightById(hashSeqPair[repSeqPos].id);
+    float repSeqWeight = seqWeights.getWeightById(sequenceOrder.getKey(hashSeqPair[repSeqPos].id));
     for (size_t elementIdx = 0; elementIdx < splitKmerCount; elementIdx++) {
 
         size_t currKmer = hashSeqPair[elementIdx].kmer;
@@ -409,6 +474,9 @@ void swapCenterSequence(KmerPosition<T> *hashSeqPair, size_t splitKmerCount, Seq
             // swap sequence with heighest weigtht to the front of the block
             if (repSeqPos != prevHashStart)
                 std::swap(hashSeqPair[repSeqPos],hashSeqPair[prevHashStart]);
+            if (hashSeqPair[elementIdx].kmer == SIZE_T_MAX) {
+                break;
+            }
 
             prevHashStart = elementIdx;
             prevHash = hashSeqPair[elementIdx].kmer;
@@ -416,10 +484,10 @@ void swapCenterSequence(KmerPosition<T> *hashSeqPair, size_t splitKmerCount, Seq
                 prevHash = BIT_SET(prevHash, 63);
             }
             repSeqPos = elementIdx;
-            repSeqWeight = seqWeights.getWeightById(hashSeqPair[repSeqPos].id);
+            repSeqWeight = seqWeights.getWeightById(sequenceOrder.getKey(hashSeqPair[repSeqPos].id));
         }
         else {
-            float currWeight = seqWeights.getWeightById(hashSeqPair[elementIdx].id);
+            float currWeight = seqWeights.getWeightById(sequenceOrder.getKey(hashSeqPair[elementIdx].id));
             if (currWeight > repSeqWeight) {
                 repSeqWeight = currWeight;
                 repSeqPos = elementIdx;
@@ -433,36 +501,255 @@ void swapCenterSequence(KmerPosition<T> *hashSeqPair, size_t splitKmerCount, Seq
     }
 }
 
-template void swapCenterSequence<0, short>(KmerPosition<short> *kmers, size_t splitKmerCount, SequenceWeights &seqWeights);
-template void swapCenterSequence<0, int>(KmerPosition<int> *kmers, size_t splitKmerCount, SequenceWeights &seqWeights);
-template void swapCenterSequence<1, short>(KmerPosition<short> *kmers, size_t splitKmerCount, SequenceWeights &seqWeights);
-template void swapCenterSequence<1, int>(KmerPosition<int> *kmers, size_t splitKmerCount, SequenceWeights &seqWeights);
+template void swapCenterSequence<0, short>(CompactKmerPosition<short> *kmers, size_t splitKmerCount, SequenceWeights &seqWeights, const KmerSequenceOrder<short> &sequenceOrder);
+template void swapCenterSequence<0, int>(CompactKmerPosition<int> *kmers, size_t splitKmerCount, SequenceWeights &seqWeights, const KmerSequenceOrder<int> &sequenceOrder);
+template void swapCenterSequence<1, short>(CompactKmerPosition<short> *kmers, size_t splitKmerCount, SequenceWeights &seqWeights, const KmerSequenceOrder<short> &sequenceOrder);
+template void swapCenterSequence<1, int>(CompactKmerPosition<int> *kmers, size_t splitKmerCount, SequenceWeights &seqWeights, const KmerSequenceOrder<int> &sequenceOrder);
+
+template <typename KmerType>
+const unsigned int KmerBucketWriter<KmerType>::BUCKET_BITS;
+template <typename KmerType>
+const size_t KmerBucketWriter<KmerType>::BUCKETS;
+
+template <typename KmerType>
+KmerBucketWriter<KmerType>::KmerBucketWriter(const std::string &prefix) : prefix(prefix) {
+    for (size_t bucket = 0; bucket < BUCKETS; bucket++) {
+        fileNames.emplace_back(getFileName(bucket));
+        counts.emplace_back(0);
+        // left over by an interrupted run
+        if (FileUtil::fileExists(fileNames[bucket].c_str())) {
+            FileUtil::remove(fileNames[bucket].c_str());
+        }
+        files[bucket] = FileUtil::openFileOrDie(fileNames[bucket].c_str(), "wb", false);
+    }
+}
 
-template <typename T>
-KmerPosition<T> * doComputation(size_t totalKmers, size_t hashStartRange, size_t hashEndRange, std::string splitFile,
-                                DBReader<unsigned int> & seqDbr, Parameters & par, BaseMatrix  * subMat) {
+template <typename KmerType>
+KmerBucketWriter<KmerType>::~KmerBucketWriter() {
+    close();
+    for (size_t bucket = 0; bucket < fileNames.size(); bucket++) {
+        if (FileUtil::fileExists(fileNames[bucket].c_str())) {
+            FileUtil::remove(fileNames[bucket].c_str());
+        }
+    }
+}
 
-    KmerPosition<T> * hashSeqPair = initKmerPositionMemory<T>(totalKmers);
-    size_t elementsToSort;
-    if(Parameters::isEqualDbtype(seqDbr.getDbtype(), Parameters::DBTYPE_NUCLEOTIDES)){
-        std::pair<size_t, size_t > ret = fillKmerPositionArray<Parameters::DBTYPE_NUCLEOTIDES, T>(hashSeqPair, totalKmers, seqDbr, par, subMat, true, hashStartRange, hashEndRange, NULL);
-        elementsToSort = ret.first;
-        par.kmerSize = ret.second;
-        Debug(Debug::INFO) << "\nAdjusted k-mer length " << par.kmerSize << "\n";
-    }else{
-        std::pair<size_t, size_t > ret = fillKmerPositionArray<Parameters::DBTYPE_AMINO_ACIDS, T>(hashSeqPair, totalKmers, seqDbr, par, subMat, true, hashStartRange, hashEndRange, NULL);
-        elementsToSort = ret.first;
+template <typename KmerType>
+std::string KmerBucketWriter<KmerType>::getFileName(size_t bucket) {
+    return prefix + "_bucket_" + SSTR(bucket);
+}
+
+template <typename KmerType>
+void KmerBucketWriter<KmerType>::write(const KmerType *kmers, const unsigned short *hashes, size_t count, KmerType *buffer) {
+    // counting sort by bucket, so that every bucket is written with a single large write
+    size_t bucketStart[BUCKETS + 1];
+    memset(bucketStart, 0, sizeof(size_t) * (BUCKETS + 1));
+    for (size_t i = 0; i < count; i++) {
+        bucketStart[getBucket(hashes[i]) + 1]++;
     }
-    if(hashEndRange == SIZE_T_MAX){
-        seqDbr.unmapData();
+    for (size_t bucket = 0; bucket < BUCKETS; bucket++) {
+        bucketStart[bucket + 1] += bucketStart[bucket];
+    }
+    size_t writePos[BUCKETS];
+    memcpy(writePos, bucketStart, sizeof(size_t) * BUCKETS);
+    for (size_t i = 0; i < count; i++) {
+        buffer[writePos[getBucket(hashes[i])]++] = kmers[i];
+    }
+#pragma omp critical(kmer_bucket_write)
+    {
+        for (size_t bucket = 0; bucket < BUCKETS; bucket++) {
+            const size_t bucketSize = bucketStart[bucket + 1] - bucketStart[bucket];
+            if (bucketSize == 0) {
+                continue;
+            }
+            if (fwrite(buffer + bucketStart[bucket], sizeof(KmerType), bucketSize, files[bucket]) != bucketSize) {
+                Debug(Debug::ERROR) << "Cannot write to file " << fileNames[bucket] << "\n";
+                EXIT(EXIT_FAILURE);
+            }
+            counts[bucket] += bucketSize;
+        }
+    }
+}
+
+template <typename KmerType>
+void KmerBucketWriter<KmerType>::close() {
+    for (size_t bucket = 0; bucket < BUCKETS; bucket++) {
+        if (files[bucket] == NULL) {
+            continue;
+        }
+        if (fclose(files[bucket]) != 0) {
+            Debug(Debug::ERROR) << "Cannot close file " << fileNames[bucket] << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+        files[bucket] = NULL;
+    }
+}
+
+template <typename KmerType>
+void KmerBucketWriter<KmerType>::splitLargeBuckets(size_t maxKmers, KmerType *buffer) {
+    size_t largeBuckets = 0;
+    size_t bucket = 0;
+    while (bucket < counts.size()) {
+        if (counts[bucket] > maxKmers) {
+            bucket += splitBucket(bucket, maxKmers, buffer, 0);
+            largeBuckets++;
+        } else {
+            bucket++;
+        }
+    }
+    if (largeBuckets > 0) {
+        Debug(Debug::INFO) << "Split " << largeBuckets << " buckets that do not fit into memory into " << counts.size() - BUCKETS + largeBuckets << " parts\n";
+    }
+}
+
+// replaces the bucket by parts that are split by a second hash of the k-mer, members of a k-mer group
+// stay together. Parts that are still too large are split again with another seed.
+// Returns the number of buckets that replaced the bucket.
+template <typename KmerType>
+size_t KmerBucketWriter<KmerType>::splitBucket(size_t bucket, size_t maxKmers, KmerType *buffer, unsigned int round) {
+    const unsigned int MAX_ROUNDS = 4;
+    if (round >= MAX_ROUNDS) {
+        Debug(Debug::ERROR) << "Not enough memory to run the kmermatcher. Minimum is at least "
+                            << counts[bucket] * sizeof(KmerType) << " bytes\n";
+        EXIT(EXIT_FAILURE);
+    }
+    // twice the minimum number of parts leaves room for an uneven distribution, the count is limited by open files
+    const size_t parts = std::min(static_cast<size_t>(BUCKETS), 2 * ((counts[bucket] + maxKmers - 1) / maxKmers));
+
+    std::vector<std::string> partNames;
+    std::vector<FILE *> partFiles;
+    std::vector<size_t> partCounts(parts, 0);
+    for (size_t part = 0; part < parts; part++) {
+        partNames.emplace_back(fileNames[bucket] + "_" + SSTR(part));
+        if (FileUtil::fileExists(partNames[part].c_str())) {
+            FileUtil::remove(partNames[part].c_str());
+        }
+        partFiles.emplace_back(FileUtil::openFileOrDie(partNames[part].c_str(), "wb", false));
+    }
+
+    // the first half of the buffer holds the input, the second half the k-mers grouped by part
+    const size_t chunkSize = maxKmers / 2;
+    KmerType *grouped = buffer + chunkSize;
+    std::vector<size_t> partStart(parts + 1);
+    std::vector<size_t> writePos(parts);
+    FILE *file = FileUtil::openFileOrDie(fileNames[bucket].c_str(), "rb", true);
+    size_t remaining = counts[bucket];
+    while (remaining > 0) {
+        const size_t chunk = std::min(chunkSize, remaining);
+        if (fread(buffer, sizeof(KmerType), chunk, file) != chunk) {
+            Debug(Debug::ERROR) << "Cannot read file " << fileNames[bucket] << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+        std::fill(partStart.begin(), partStart.end(), 0);
+        for (size_t i = 0; i < chunk; i++) {
+            partStart[hashUInt64(BIT_SET(buffer[i].kmer, 63), round + 1) % parts + 1]++;
+        }
+        for (size_t part = 0; part < parts; part++) {
+            partStart[part + 1] += partStart[part];
+        }
+        std::copy(partStart.begin(), partStart.end() - 1, writePos.begin());
+        for (size_t i = 0; i < chunk; i++) {
+            grouped[writePos[hashUInt64(BIT_SET(buffer[i].kmer, 63), round + 1) % parts]++] = buffer[i];
+        }
+        for (size_t part = 0; part < parts; part++) {
+            const size_t partSize = partStart[part + 1] - partStart[part];
+            if (fwrite(grouped + partStart[part], sizeof(KmerType), partSize, partFiles[part]) != partSize) {
+                Debug(Debug::ERROR) << "Cannot write to file " << partNames[part] << "\n";
+                EXIT(EXIT_FAILURE);
+            }
+            partCounts[part] += partSize;
+        }
+        remaining -= chunk;
+    }
+    if (fclose(file) != 0) {
+        Debug(Debug::ERROR) << "Cannot close file " << fileNames[bucket] << "\n";
+        EXIT(EXIT_FAILURE);
     }
+    for (size_t part = 0; part < parts; part++) {
+        if (fclose(partFiles[part]) != 0) {
+            Debug(Debug::ERROR) << "Cannot close file " << partNames[part] << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+    }
+    FileUtil::remove(fileNames[bucket].c_str());
+    fileNames.erase(fileNames.begin() + bucket);
+    counts.erase(counts.begin() + bucket);
+    fileNames.insert(fileNames.begin() + bucket, partNames.begin(), partNames.end());
+    counts.insert(counts.begin() + bucket, partCounts.begin(), partCounts.end());
+
+    size_t buckets = 0;
+    for (size_t part = 0; part < parts; part++) {
+        if (counts[bucket + buckets] > maxKmers) {
+            buckets += splitBucket(bucket + buckets, maxKmers, buffer, round + 1);
+        } else {
+            buckets++;
+        }
+    }
+    return buckets;
+}
+
+template <typename KmerType>
+std::vector<std::pair<size_t, size_t>> KmerBucketWriter<KmerType>::getBucketRanges(size_t maxKmers) {
+    std::vector<std::pair<size_t, size_t>> ranges;
+    size_t rangeStart = 0;
+    size_t rangeSize = 0;
+    for (size_t bucket = 0; bucket < counts.size(); bucket++) {
+        if (counts[bucket] > maxKmers) {
+            Debug(Debug::ERROR) << "Not enough memory to run the kmermatcher. Minimum is at least "
+                                << counts[bucket] * sizeof(KmerType) << " bytes\n";
+            EXIT(EXIT_FAILURE);
+        }
+        if (rangeSize + counts[bucket] > maxKmers) {
+            ranges.emplace_back(rangeStart, bucket);
+            rangeStart = bucket;
+            rangeSize = 0;
+        }
+        rangeSize += counts[bucket];
+    }
+    ranges.emplace_back(rangeStart, counts.size());
+    return ranges;
+}
+
+template <typename KmerType>
+size_t KmerBucketWriter<KmerType>::read(size_t from, size_t to, KmerType *kmers) {
+    size_t offset = 0;
+    for (size_t bucket = from; bucket < to; bucket++) {
+        FILE *file = FileUtil::openFileOrDie(fileNames[bucket].c_str(), "rb", true);
+        if (fread(kmers + offset, sizeof(KmerType), counts[bucket], file) != counts[bucket]) {
+            Debug(Debug::ERROR) << "Cannot read file " << fileNames[bucket] << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+        if (fclose(file) != 0) {
+            Debug(Debug::ERROR) << "Cannot close file " << fileNames[bucket] << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+        FileUtil::remove(fileNames[bucket].c_str());
+        offset += counts[bucket];
+    }
+    return offset;
+}
+
+template <typename KmerType>
+void KmerBucketWriter<KmerType>::remove(size_t from, size_t to) {
+    for (size_t bucket = from; bucket < to; bucket++) {
+        FileUtil::remove(fileNames[bucket].c_str());
+    }
+}
 
+template class KmerBucketWriter<CompactKmerPosition<short>>;
+template class KmerBucketWriter<CompactKmerPosition<int>>;
+
+// sorts the filled k-mer table, assigns every k-mer group to its rep. sequence and sorts the table by rep. sequence
+// returns the number of entries left in the table
+template <typename T>
+size_t sortAndAssignGroups(CompactKmerPosition<T> *hashSeqPair, size_t elementsToSort, size_t totalKmers,
+                           DBReader<unsigned int> &seqDbr, Parameters &par, const KmerSequenceOrder<T> &sequenceOrder) {
     Debug(Debug::INFO) << "Sort kmer ";
     Timer timer;
     if(Parameters::isEqualDbtype(seqDbr.getDbtype(), Parameters::DBTYPE_NUCLEOTIDES)) {
-        SORT_PARALLEL(hashSeqPair, hashSeqPair + elementsToSort, KmerPosition<T>::compareRepSequenceAndIdAndPosReverse);
+        SORT_PARALLEL(hashSeqPair, hashSeqPair + elementsToSort, CompactKmerPosition<T>::compareRepSequenceAndIdAndPosReverse);
     }else{
-        SORT_PARALLEL(hashSeqPair, hashSeqPair + elementsToSort, KmerPosition<T>::compareRepSequenceAndIdAndPos);
+        SORT_PARALLEL(hashSeqPair, hashSeqPair + elementsToSort, CompactKmerPosition<T>::compareRepSequenceAndIdAndPos);
     }
     Debug(Debug::INFO) << timer.lap() << "\n";
 
@@ -472,37 +759,61 @@ KmerPosition<T> * doComputation(size_t totalKmers, size_t hashStartRange, size_t
         sequenceWeights = new SequenceWeights(par.weightFile.c_str());
         if (sequenceWeights != NULL) {
             if (Parameters::isEqualDbtype(seqDbr.getDbtype(), Parameters::DBTYPE_NUCLEOTIDES)) {
-                swapCenterSequence<Parameters::DBTYPE_NUCLEOTIDES, T>(hashSeqPair, totalKmers, *sequenceWeights);
+                swapCenterSequence<Parameters::DBTYPE_NUCLEOTIDES, T>(hashSeqPair, totalKmers, *sequenceWeights, sequenceOrder);
             } else {
-                swapCenterSequence<Parameters::DBTYPE_AMINO_ACIDS, T>(hashSeqPair, totalKmers, *sequenceWeights);
+                swapCenterSequence<Parameters::DBTYPE_AMINO_ACIDS, T>(hashSeqPair, totalKmers, *sequenceWeights, sequenceOrder);
             }
         }
     }
 
     // assign rep. sequence to same kmer members
-    // The longest sequence is the first since we sorted by kmer, seq.Len and id
+    // The longest sequence is the first since we sorted by kmer and sequence order (seq.Len and key)
     size_t writePos;
     if(Parameters::isEqualDbtype(seqDbr.getDbtype(), Parameters::DBTYPE_NUCLEOTIDES)){
-        writePos = assignGroup<Parameters::DBTYPE_NUCLEOTIDES, T>(hashSeqPair, totalKmers, par.includeOnlyExtendable, par.covMode, par.covThr, sequenceWeights, par.weightThr);
+        writePos = assignGroup<Parameters::DBTYPE_NUCLEOTIDES, T>(hashSeqPair, totalKmers, par.includeOnlyExtendable, par.covMode, par.covThr, sequenceWeights, par.weightThr, sequenceOrder);
     }else{
-        writePos = assignGroup<Parameters::DBTYPE_AMINO_ACIDS, T>(hashSeqPair, totalKmers, par.includeOnlyExtendable, par.covMode, par.covThr, sequenceWeights, par.weightThr);
+        writePos = assignGroup<Parameters::DBTYPE_AMINO_ACIDS, T>(hashSeqPair, totalKmers, par.includeOnlyExtendable, par.covMode, par.covThr, sequenceWeights, par.weightThr, sequenceOrder);
     }
 
     delete sequenceWeights;
 
-    // sort by rep. sequence (stored in kmer) and sequence id
+    // sort by rep. sequence (stored in kmer), sequence key (stored in id) and diagonal (stored in pos)
     Debug(Debug::INFO) << "Sort by rep. sequence ";
     timer.reset();
     if(Parameters::isEqualDbtype(seqDbr.getDbtype(), Parameters::DBTYPE_NUCLEOTIDES)){
-        SORT_PARALLEL(hashSeqPair, hashSeqPair + writePos, KmerPosition<T>::compareRepSequenceAndIdAndDiagReverse);
+        SORT_PARALLEL(hashSeqPair, hashSeqPair + writePos, CompactKmerPosition<T>::compareRepSequenceAndIdAndPosReverse);
     }else{
-        SORT_PARALLEL(hashSeqPair, hashSeqPair + writePos, KmerPosition<T>::compareRepSequenceAndIdAndDiag);
+        SORT_PARALLEL(hashSeqPair, hashSeqPair + writePos, CompactKmerPosition<T>::compareRepSequenceAndIdAndPos);
     }
     //kx::radix_sort(hashSeqPair, hashSeqPair + elementsToSort, SequenceComparision());
 //    for(size_t i = 0; i < writePos; i++){
 //        std::cout << BIT_CLEAR(hashSeqPair[i].kmer, 63) << "\t" << hashSeqPair[i].id << "\t" << hashSeqPair[i].pos << std::endl;
 //    }
     Debug(Debug::INFO) << timer.lap() << "\n";
+    return writePos;
+}
+
+template <typename T>
+CompactKmerPosition<T> * doComputation(size_t totalKmers, size_t hashStartRange, size_t hashEndRange, std::string splitFile,
+                                       DBReader<unsigned int> & seqDbr, Parameters & par, BaseMatrix  * subMat,
+                                       const KmerSequenceOrder<T> &sequenceOrder) {
+
+    CompactKmerPosition<T> * hashSeqPair = initKmerPositionMemory<T, CompactKmerPosition>(totalKmers);
+    size_t elementsToSort;
+    if(Parameters::isEqualDbtype(seqDbr.getDbtype(), Parameters::DBTYPE_NUCLEOTIDES)){
+        std::pair<size_t, size_t > ret = fillKmerPositionArray<Parameters::DBTYPE_NUCLEOTIDES, T, CompactKmerPosition>(hashSeqPair, totalKmers, seqDbr, par, subMat, true, hashStartRange, hashEndRange, NULL, NULL, &sequenceOrder);
+        elementsToSort = ret.first;
+        par.kmerSize = ret.second;
+        Debug(Debug::INFO) << "\nAdjusted k-mer length " << par.kmerSize << "\n";
+    }else{
+        std::pair<size_t, size_t > ret = fillKmerPositionArray<Parameters::DBTYPE_AMINO_ACIDS, T, CompactKmerPosition>(hashSeqPair, totalKmers, seqDbr, par, subMat, true, hashStartRange, hashEndRange, NULL, NULL, &sequenceOrder);
+        elementsToSort = ret.first;
+    }
+    if(hashEndRange == SIZE_T_MAX){
+        seqDbr.unmapData();
+    }
+
+    size_t writePos = sortAndAssignGroups<T>(hashSeqPair, elementsToSort, totalKmers, seqDbr, par, sequenceOrder);
 
     if(hashEndRange != SIZE_T_MAX){
         if(Parameters::isEqualDbtype(seqDbr.getDbtype(), Parameters::DBTYPE_NUCLEOTIDES)){
@@ -518,12 +829,16 @@ KmerPosition<T> * doComputation(size_t totalKmers, size_t hashStartRange, size_t
 
 
 
+// the sequence index in id is replaced by the key of the sequence
 template <int TYPE, typename T>
-size_t assignGroup(KmerPosition<T> *hashSeqPair, size_t splitKmerCount, bool includeOnlyExtendable, int covMode, float covThr,
-        SequenceWeights * sequenceWeights, float weightThr) {
+size_t assignGroup(CompactKmerPosition<T> *hashSeqPair, size_t splitKmerCount, bool includeOnlyExtendable, int covMode, float covThr,
+        SequenceWeights * sequenceWeights, float weightThr, const KmerSequenceOrder<T> &sequenceOrder) {
     size_t writePos=0;
+    if (hashSeqPair[0].kmer == SIZE_T_MAX) {
+        return writePos;
+    }
     size_t prevHash = hashSeqPair[0].kmer;
-    size_t repSeqId = hashSeqPair[0].id;
+    size_t repSeqId = sequenceOrder.getKey(hashSeqPair[0].id);
     if(TYPE == Parameters::DBTYPE_NUCLEOTIDES){
         bool isReverse = (BIT_CHECK(hashSeqPair[0].kmer, 63) == false);
         repSeqId = (isReverse) ? BIT_CLEAR(repSeqId, 63) : BIT_SET(repSeqId, 63);
@@ -532,7 +847,7 @@ size_t assignGroup(KmerPosition<T> *hashSeqPair, size_t splitKmerCount, bool inc
     size_t prevHashStart = 0;
     size_t prevSetSize = 0;
     size_t skipByWeightCount = 0;
-    T queryLen=hashSeqPair[0].seqLen;
+    T queryLen=sequenceOrder.getSeqLen(hashSeqPair[0].id);
     bool repIsReverse = false;
     T repSeq_i_pos = hashSeqPair[0].pos;
     for (size_t elementIdx = 0; elementIdx < splitKmerCount+1; elementIdx++) {
@@ -542,9 +857,11 @@ size_t assignGroup(KmerPosition<T> *hashSeqPair, size_t splitKmerCount, bool inc
         }
         if (prevHash != currKmer) {
             for (size_t i = prevHashStart; i < elementIdx; i++) {
+                const unsigned int targetKey = sequenceOrder.getKey(hashSeqPair[i].id);
+                const T targetLen = sequenceOrder.getSeqLen(hashSeqPair[i].id);
                 // skip target sequences if weight > weightThr
                 if(i > prevHashStart && sequenceWeights != NULL
-                   && sequenceWeights->getWeightById(hashSeqPair[i].id) > weightThr)
+                   && sequenceWeights->getWeightById(targetKey) > weightThr)
                     continue;
                 size_t kmer = hashSeqPair[i].kmer;
                 if(TYPE == Parameters::DBTYPE_NUCLEOTIDES) {
@@ -577,13 +894,13 @@ size_t assignGroup(KmerPosition<T> *hashSeqPair, size_t splitKmerCount, bool inc
                             // we just need to offset the position to the forward strand
                         }else if (repIsReverse == true && targetIsReverse == true){
                             queryPos = (queryLen - 1) - repSeq_i_pos;
-                            targetPos = (hashSeqPair[i].seqLen - 1) - hashSeqPair[i].pos;
+                            targetPos = (targetLen - 1) - hashSeqPair[i].pos;
                             queryNeedsToBeRev = false;
                             // query is not revers but target k-mer is reverse
                             // instead of reverting the target, we revert the query and offset the the query/target position
                         }else if (repIsReverse == false && targetIsReverse == true){
                             queryPos = (queryLen - 1) - repSeq_i_pos;
-                            targetPos = (hashSeqPair[i].seqLen - 1) - hashSeqPair[i].pos;
+                            targetPos = (targetLen - 1) - hashSeqPair[i].pos;
                             queryNeedsToBeRev = true;
                             // both are forward, everything is good here
                         }else{
@@ -597,15 +914,14 @@ size_t assignGroup(KmerPosition<T> *hashSeqPair, size_t splitKmerCount, bool inc
 //                    std::cout << diagonal << "\t" << repSeq_i_pos << "\t" << hashSeqPair[i].pos << std::endl;
 
 
-                    bool canBeExtended = diagonal < 0 || (diagonal > (queryLen - hashSeqPair[i].seqLen));
+                    bool canBeExtended = diagonal < 0 || (diagonal > (queryLen - targetLen));
                     bool canBecovered = Util::canBeCovered(covThr, covMode,
                                                            static_cast<float>(queryLen),
-                                                           static_cast<float>(hashSeqPair[i].seqLen));
+                                                           static_cast<float>(targetLen));
                     if((includeOnlyExtendable == false && canBecovered) || (canBeExtended && includeOnlyExtendable ==true )){
                         hashSeqPair[writePos].kmer = rId;
                         hashSeqPair[writePos].pos = diagonal;
-                        hashSeqPair[writePos].seqLen = hashSeqPair[i].seqLen;
-                        hashSeqPair[writePos].id = hashSeqPair[i].id;
+                        hashSeqPair[writePos].id = targetKey;
                         writePos++;
                     }
                 }
@@ -615,12 +931,15 @@ size_t assignGroup(KmerPosition<T> *hashSeqPair, size_t splitKmerCount, bool inc
             prevSetSize = 0;
             skipByWeightCount = 0;
             prevHashStart = elementIdx;
-            repSeqId = hashSeqPair[elementIdx].id;
+            if (hashSeqPair[elementIdx].kmer == SIZE_T_MAX) {
+                break;
+            }
+            repSeqId = sequenceOrder.getKey(hashSeqPair[elementIdx].id);
             if(TYPE == Parameters::DBTYPE_NUCLEOTIDES){
                 repIsReverse = (BIT_CHECK(hashSeqPair[elementIdx].kmer, 63) == 0);
                 repSeqId = (repIsReverse) ? repSeqId : BIT_SET(repSeqId, 63);
             }
-            queryLen = hashSeqPair[elementIdx].seqLen;
+            queryLen = sequenceOrder.getSeqLen(hashSeqPair[elementIdx].id);
             repSeq_i_pos = hashSeqPair[elementIdx].pos;
         }
         if (hashSeqPair[elementIdx].kmer == SIZE_T_MAX) {
@@ -628,7 +947,7 @@ size_t assignGroup(KmerPosition<T> *hashSeqPair, size_t splitKmerCount, bool inc
         }
         prevSetSize++;
         if(prevSetSize > 1 && sequenceWeights != NULL
-           && sequenceWeights->getWeightById(hashSeqPair[elementIdx].id) > weightThr)
+           && sequenceWeights->getWeightById(sequenceOrder.getKey(hashSeqPair[elementIdx].id)) > weightThr)
             skipByWeightCount++;
         prevHash = hashSeqPair[elementIdx].kmer;
         if(TYPE == Parameters::DBTYPE_NUCLEOTIDES){
@@ -639,10 +958,10 @@ size_t assignGroup(KmerPosition<T> *hashSeqPair, size_t splitKmerCount, bool inc
     return writePos;
 }
 
-template size_t assignGroup<0, short>(KmerPosition<short> *kmers, size_t splitKmerCount, bool includeOnlyExtendable, int covMode, float covThr, SequenceWeights *sequenceWeights, float weightThr);
-template size_t assignGroup<0, int>(KmerPosition<int> *kmers, size_t splitKmerCount, bool includeOnlyExtendable, int covMode, float covThr, SequenceWeights *sequenceWeights, float weightThr);
-template size_t assignGroup<1, short>(KmerPosition<short> *kmers, size_t splitKmerCount, bool includeOnlyExtendable, int covMode, float covThr, SequenceWeights *sequenceWeights, float weightThr);
-template size_t assignGroup<1, int>(KmerPosition<int> *kmers, size_t splitKmerCount, bool includeOnlyExtendable, int covMode, float covThr, SequenceWeights *sequenceWeights, float weightThr);
+template size_t assignGroup<0, short>(CompactKmerPosition<short> *kmers, size_t splitKmerCount, bool includeOnlyExtendable, int covMode, float covThr, SequenceWeights *sequenceWeights, float weightThr, const KmerSequenceOrder<short> &sequenceOrder);
+template size_t assignGroup<0, int>(CompactKmerPosition<int> *kmers, size_t splitKmerCount, bool includeOnlyExtendable, int covMode, float covThr, SequenceWeights *sequenceWeights, float weightThr, const KmerSequenceOrder<int> &sequenceOrder);
+template size_t assignGroup<1, short>(CompactKmerPosition<short> *kmers, size_t splitKmerCount, bool includeOnlyExtendable, int covMode, float covThr, SequenceWeights *sequenceWeights, float weightThr, const KmerSequenceOrder<short> &sequenceOrder);
+template size_t assignGroup<1, int>(CompactKmerPosition<int> *kmers, size_t splitKmerCount, bool includeOnlyExtendable, int covMode, float covThr, SequenceWeights *sequenceWeights, float weightThr, const KmerSequenceOrder<int> &sequenceOrder);
 
 
 void setLinearFilterDefault(Parameters *p) {
@@ -697,21 +1016,27 @@ int kmermatcherInner(Parameters& par, DBReader<unsigned int>& seqDbr) {
     float kmersPerSequenceScale = (Parameters::isEqualDbtype(querySeqType, Parameters::DBTYPE_NUCLEOTIDES)) ?
                                         par.kmersPerSequenceScale.values.nucleotide() : par.kmersPerSequenceScale.values.aminoacid();
     size_t totalKmers = computeKmerCount(seqDbr, par.kmerSize, par.kmersPerSequence, kmersPerSequenceScale);
-    size_t totalSizeNeeded = computeMemoryNeededLinearfilter<T>(totalKmers);
+    // k-mers store the sequence index, sequence length and key are looked up from the sequence order
+    KmerSequenceOrder<T> sequenceOrder(seqDbr);
+    memoryLimit -= std::min(memoryLimit / 2, sequenceOrder.getMemoryNeeded());
+    size_t totalSizeNeeded = sizeof(CompactKmerPosition<T>) * totalKmers;
     // compute splits
     size_t splits = static_cast<size_t>(std::ceil(static_cast<float>(totalSizeNeeded) / memoryLimit));
     size_t totalKmersPerSplit = std::max(static_cast<size_t>(1024+1),
-                                         static_cast<size_t>(std::min(totalSizeNeeded, memoryLimit)/sizeof(KmerPosition<T>))+1);
+                                         static_cast<size_t>(std::min(totalSizeNeeded, memoryLimit)/sizeof(CompactKmerPosition<T>))+1);
+
+    Telemetry::addCounter("kmermatcher_kmers", totalKmers);
+    Telemetry::addCounter("kmermatcher_splits", splits);
 
-    std::vector<std::pair<size_t, size_t>> hashRanges = setupKmerSplits<T>(par, subMat, seqDbr, totalKmersPerSplit, splits);
-    if(splits > 1){
-        Debug(Debug::INFO) << "Process file into " << hashRanges.size() << " parts\n";
-    }
     std::vector<std::string> splitFiles;
-    KmerPosition<T> *hashSeqPair = NULL;
+    CompactKmerPosition<T> *hashSeqPair = NULL;
 
     size_t mpiRank = 0;
 #ifdef HAVE_MPI
+    std::vector<std::pair<size_t, size_t>> hashRanges = setupKmerSplits<T>(par, subMat, seqDbr, totalKmersPerSplit, splits);
+    if(splits > 1){
+        Debug(Debug::INFO) << "Process file into " << hashRanges.size() << " parts\n";
+    }
     splits = hashRanges.size();
     size_t fromSplit = 0;
     size_t splitCount = 1;
@@ -731,7 +1056,7 @@ int kmermatcherInner(Parameters& par, DBReader<unsigned int>& seqDbr) {
 
     for(size_t split = fromSplit; split < fromSplit+splitCount; split++) {
         std::string splitFileName = par.db2 + "_split_" +SSTR(split);
-        hashSeqPair = doComputation<T>(totalKmers, hashRanges[split].first, hashRanges[split].second, splitFileName, seqDbr, par, subMat);
+        hashSeqPair = doComputation<T>(totalKmers, hashRanges[split].first, hashRanges[split].second, splitFileName, seqDbr, par, subMat, sequenceOrder);
     }
     MPI_Barrier(MPI_COMM_WORLD);
     if(mpiRank == 0){
@@ -741,16 +1066,80 @@ int kmermatcherInner(Parameters& par, DBReader<unsigned int>& seqDbr) {
         }
     }
 #else
-    for(size_t split = 0; split < hashRanges.size(); split++) {
-        std::string splitFileName = par.db2 + "_split_" +SSTR(split);
-        Debug(Debug::INFO) << "Generate k-mers list for " << (split+1) <<" split\n";
-
-        std::string splitFileNameDone = splitFileName + ".done";
-        if(FileUtil::fileExists(splitFileNameDone.c_str()) == false){
-            hashSeqPair = doComputation<T>(totalKmersPerSplit, hashRanges[split].first, hashRanges[split].second, splitFileName, seqDbr, par, subMat);
+    if(splits > 1){
+        // a previous run that finished all splits stored the split count, it can continue with the merge
+        std::string splitsDone = par.db2 + "_splits.done";
+        size_t doneSplits = 0;
+        if(FileUtil::fileExists(splitsDone.c_str())){
+            FILE *file = FileUtil::openFileOrDie(splitsDone.c_str(), "r", true);
+            if(fscanf(file, "%zu", &doneSplits) != 1){
+                doneSplits = 0;
+            }
+            fclose(file);
+            for(size_t split = 0; split < doneSplits; split++) {
+                std::string splitFileNameDone = par.db2 + "_split_" + SSTR(split) + ".done";
+                if(FileUtil::fileExists(splitFileNameDone.c_str()) == false){
+                    doneSplits = 0;
+                    break;
+                }
+            }
         }
+        if(doneSplits > 0){
+            for(size_t split = 0; split < doneSplits; split++) {
+                splitFiles.push_back(par.db2 + "_split_" + SSTR(split));
+            }
+        }else{
+            // read the sequences only once: spill all k-mers into hash buckets
+            // and process groups of consecutive buckets that fit into memory
+            Debug(Debug::INFO) << "Not enough memory to process at once need to split\n";
+            KmerBucketWriter<CompactKmerPosition<T>> bucketWriter(par.db2);
+            if(Parameters::isEqualDbtype(seqDbr.getDbtype(), Parameters::DBTYPE_NUCLEOTIDES)){
+                std::pair<size_t, size_t > ret = fillKmerPositionArray<Parameters::DBTYPE_NUCLEOTIDES, T, CompactKmerPosition>(NULL, SIZE_T_MAX, seqDbr, par, subMat, true, 0, SIZE_T_MAX, NULL, &bucketWriter, &sequenceOrder);
+                par.kmerSize = ret.second;
+                Debug(Debug::INFO) << "\nAdjusted k-mer length " << par.kmerSize << "\n";
+            }else{
+                fillKmerPositionArray<Parameters::DBTYPE_AMINO_ACIDS, T, CompactKmerPosition>(NULL, SIZE_T_MAX, seqDbr, par, subMat, true, 0, SIZE_T_MAX, NULL, &bucketWriter, &sequenceOrder);
+            }
+            seqDbr.unmapData();
+            bucketWriter.close();
+
+            hashSeqPair = initKmerPositionMemory<T, CompactKmerPosition>(totalKmersPerSplit);
+            bucketWriter.splitLargeBuckets(totalKmersPerSplit - 1, hashSeqPair);
+            std::vector<std::pair<size_t, size_t>> bucketRanges = bucketWriter.getBucketRanges(totalKmersPerSplit - 1);
+            Debug(Debug::INFO) << "Process file into " << bucketRanges.size() << " parts\n";
+            // splitting used the k-mer array as scratch space
+            memset(hashSeqPair, 0xFF, sizeof(CompactKmerPosition<T>) * (totalKmersPerSplit + 1));
+            // the splits are the same for the same input, finished splits of a previous run are kept
+            size_t prevKmerCount = 0;
+            for(size_t split = 0; split < bucketRanges.size(); split++) {
+                std::string splitFileName = par.db2 + "_split_" +SSTR(split);
+                splitFiles.push_back(splitFileName);
+                std::string splitFileNameDone = splitFileName + ".done";
+                if(FileUtil::fileExists(splitFileNameDone.c_str())){
+                    bucketWriter.remove(bucketRanges[split].first, bucketRanges[split].second);
+                    continue;
+                }
+                Debug(Debug::INFO) << "Generate k-mers list for " << (split+1) <<" split\n";
+                // restore the end marker behind the k-mers of the previous split
+                memset(hashSeqPair, 0xFF, sizeof(CompactKmerPosition<T>) * (prevKmerCount + 1));
+                size_t kmerCount = bucketWriter.read(bucketRanges[split].first, bucketRanges[split].second, hashSeqPair);
+                size_t writePos = sortAndAssignGroups<T>(hashSeqPair, kmerCount, totalKmersPerSplit, seqDbr, par, sequenceOrder);
+                if(Parameters::isEqualDbtype(seqDbr.getDbtype(), Parameters::DBTYPE_NUCLEOTIDES)){
+                    writeKmersToDisk<Parameters::DBTYPE_NUCLEOTIDES, KmerEntryRev, T>(splitFileName, hashSeqPair, writePos + 1);
+                }else{
+                    writeKmersToDisk<Parameters::DBTYPE_AMINO_ACIDS, KmerEntry, T>(splitFileName, hashSeqPair, writePos + 1);
+                }
+                prevKmerCount = kmerCount;
+            }
+            delete [] hashSeqPair;
+            hashSeqPair = NULL;
 
-        splitFiles.push_back(splitFileName);
+            FILE *file = FileUtil::openFileOrDie(splitsDone.c_str(), "w", false);
+            fprintf(file, "%zu\n", bucketRanges.size());
+            fclose(file);
+        }
+    }else{
+        hashSeqPair = doComputation<T>(totalKmersPerSplit, 0, SIZE_T_MAX, "", seqDbr, par, subMat, sequenceOrder);
     }
 #endif
     if(mpiRank == 0){
@@ -774,6 +1163,10 @@ int kmermatcherInner(Parameters& par, DBReader<unsigned int>& seqDbr) {
                 std::string splitFilesDone = splitFiles[i] + ".done";
                 FileUtil::remove(splitFilesDone.c_str());
             }
+#ifndef HAVE_MPI
+            std::string splitsDone = par.db2 + "_splits.done";
+            FileUtil::remove(splitsDone.c_str());
+#endif
         } else {
             if(Parameters::isEqualDbtype(seqDbr.getDbtype(), Parameters::DBTYPE_NUCLEOTIDES)) {
                 writeKmerMatcherResult<Parameters::DBTYPE_NUCLEOTIDES>(dbw, hashSeqPair, totalKmersPerSplit, repSequence, 1);
@@ -824,9 +1217,9 @@ std::vector<std::pair<size_t, size_t>> setupKmerSplits(Parameters &par, BaseMatr
         size_t * hashDist = new size_t[USHRT_MAX+1];
         memset(hashDist, 0 , sizeof(size_t) * (USHRT_MAX+1));
         if(Parameters::isEqualDbtype(seqDbr.getDbtype(), Parameters::DBTYPE_NUCLEOTIDES)){
-            fillKmerPositionArray<Parameters::DBTYPE_NUCLEOTIDES, T>(NULL, SIZE_T_MAX, seqDbr, par, subMat, true, 0, SIZE_T_MAX, hashDist);
+            fillKmerPositionArray<Parameters::DBTYPE_NUCLEOTIDES, T, KmerPosition>(NULL, SIZE_T_MAX, seqDbr, par, subMat, true, 0, SIZE_T_MAX, hashDist);
         }else{
-            fillKmerPositionArray<Parameters::DBTYPE_AMINO_ACIDS, T>(NULL, SIZE_T_MAX, seqDbr, par, subMat, true, 0, SIZE_T_MAX, hashDist);
+            fillKmerPositionArray<Parameters::DBTYPE_AMINO_ACIDS, T, KmerPosition>(NULL, SIZE_T_MAX, seqDbr, par, subMat, true, 0, SIZE_T_MAX, hashDist);
         }
         seqDbr.remapData();
         // figure out if machine has enough memory to run this job
@@ -890,7 +1283,7 @@ int kmermatcher(int argc, const char **argv, const Command &command) {
 
 template <int TYPE, typename T>
 void writeKmerMatcherResult(DBWriter & dbw,
-                            KmerPosition<T> *hashSeqPair, size_t totalKmers,
+                            CompactKmerPosition<T> *hashSeqPair, size_t totalKmers,
                             std::vector<char> &repSequence, size_t threads) {
     std::vector<size_t> threadOffsets;
     size_t splitSize = totalKmers/threads;
@@ -1186,8 +1579,8 @@ void mergeKmerFilesAndOutput(DBWriter & dbw,
 }
 
 
-template <int TYPE, typename T, typename seqLenType>
-void writeKmersToDisk(std::string tmpFile, KmerPosition<seqLenType> *hashSeqPair, size_t totalKmers) {
+template <int TYPE, typename T, typename seqLenType, template <typename> class KmerType>
+void writeKmersToDisk(std::string tmpFile, KmerType<seqLenType> *hashSeqPair, size_t totalKmers) {
     size_t repSeqId = SIZE_T_MAX;
     size_t lastTargetId = SIZE_T_MAX;
     seqLenType lastDiagonal=0;
@@ -1310,20 +1703,23 @@ void setKmerLengthAndAlphabet(Parameters &parameters, size_t aaDbSize, int seqTy
 }
 
 template std::pair<size_t, size_t>  fillKmerPositionArray<0, short>(KmerPosition<short> * kmerArray, size_t kmerArraySize, DBReader<unsigned int> &seqDbr,
-                                                                    Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution);
+                                                                    Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution, KmerBucketWriter<KmerPosition<short>> * bucketWriter, const KmerSequenceOrder<short> * sequenceOrder);
 template std::pair<size_t, size_t>  fillKmerPositionArray<1, short>(KmerPosition<short> * kmerArray, size_t kmerArraySize, DBReader<unsigned int> &seqDbr,
-                                                                    Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution);
+                                                                    Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution, KmerBucketWriter<KmerPosition<short>> * bucketWriter, const KmerSequenceOrder<short> * sequenceOrder);
 template std::pair<size_t, size_t>  fillKmerPositionArray<2, short>(KmerPosition<short> * kmerArray, size_t kmerArraySize, DBReader<unsigned int> &seqDbr,
-                                                                    Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution);
+                                                                    Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution, KmerBucketWriter<KmerPosition<short>> * bucketWriter, const KmerSequenceOrder<short> * sequenceOrder);
 template std::pair<size_t, size_t>  fillKmerPositionArray<0, int>(KmerPosition<int> * kmerArray, size_t kmerArraySize, DBReader<unsigned int> &seqDbr,
-                                                                  Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution);
+                                                                  Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution, KmerBucketWriter<KmerPosition<int>> * bucketWriter, const KmerSequenceOrder<int> * sequenceOrder);
 template std::pair<size_t, size_t>  fillKmerPositionArray<1, int>(KmerPosition <int>* kmerArray, size_t kmerArraySize, DBReader<unsigned int> &seqDbr,
-                                                                  Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution);
+                                                                  Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution, KmerBucketWriter<KmerPosition<int>> * bucketWriter, const KmerSequenceOrder<int> * sequenceOrder);
 template std::pair<size_t, size_t>  fillKmerPositionArray<2, int>(KmerPosition< int> * kmerArray, size_t kmerArraySize, DBReader<unsigned int> &seqDbr,
-                                                                  Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution);
+                                                                  Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution, KmerBucketWriter<KmerPosition<int>> * bucketWriter, const KmerSequenceOrder<int> * sequenceOrder);
+
+template KmerPosition<short> *initKmerPositionMemory<short, KmerPosition>(size_t size);
+template KmerPosition<int> *initKmerPositionMemory<int, KmerPosition>(size_t size);
 
-template KmerPosition<short> *initKmerPositionMemory(size_t size);
-template KmerPosition<int> *initKmerPositionMemory(size_t size);
+template void writeKmersToDisk<Parameters::DBTYPE_AMINO_ACIDS, KmerEntry, short, KmerPosition>(std::string tmpFile, KmerPosition<short> *kmers, size_t totalKmers);
+template void writeKmersToDisk<Parameters::DBTYPE_NUCLEOTIDES, KmerEntryRev, short, KmerPosition>(std::string tmpFile, KmerPosition<short> *kmers, size_t totalKmers);
 
 template size_t computeMemoryNeededLinearfilter<short>(size_t totalKmer);
 template size_t computeMemoryNeededLinearfilter<int>(size_t totalKmer);
@@ -53,6 +53,11 @@ struct __attribute__((__packed__))KmerPosition {
     T seqLen;
     T pos;
 
+    void setSequence(unsigned int key, unsigned int, T len){
+        id = key;
+        seqLen = len;
+    }
+
     static bool compareRepSequenceAndIdAndPos(const KmerPosition<T> &first, const KmerPosition<T> &second){
         if(first.kmer < second.kmer )
             return true;
@@ -131,6 +136,128 @@ struct __attribute__((__packed__))KmerPosition {
 };
 
 
+// Numbers the sequences by decreasing length and increasing key.
+// CompactKmerPosition stores this index instead of the key, the length and the key are looked up by index.
+template <typename T>
+class KmerSequenceOrder {
+public:
+    KmerSequenceOrder(DBReader<unsigned int> &seqDbr);
+
+    // index of the sequence with the database id
+    unsigned int getIndex(size_t id) const {
+        return indexById[id];
+    }
+
+    unsigned int getKey(unsigned int index) const {
+        return keys[index];
+    }
+
+    T getSeqLen(unsigned int index) const {
+        return seqLens[index];
+    }
+
+    size_t getMemoryNeeded() const {
+        return indexById.size() * (2 * sizeof(unsigned int) + sizeof(T));
+    }
+
+private:
+    std::vector<unsigned int> indexById;
+    std::vector<unsigned int> keys;
+    std::vector<T> seqLens;
+};
+
+// Entry of the linclust k-mer table without the sequence length of KmerPosition.
+// Until assignGroup, id holds the index of the sequence in the KmerSequenceOrder. Ordering by (kmer, id, pos)
+// then puts the longest sequence first in each k-mer group. assignGroup replaces the index with the key.
+template <typename T>
+struct __attribute__((__packed__)) CompactKmerPosition {
+    size_t kmer;
+    unsigned int id;
+    T pos;
+
+    void setSequence(unsigned int, unsigned int index, T){
+        id = index;
+    }
+
+    static bool compareRepSequenceAndIdAndPos(const CompactKmerPosition<T> &first, const CompactKmerPosition<T> &second){
+        if(first.kmer < second.kmer )
+            return true;
+        if(second.kmer < first.kmer )
+            return false;
+        if(first.id < second.id )
+            return true;
+        if(second.id < first.id )
+            return false;
+        if(first.pos < second.pos )
+            return true;
+        if(second.pos < first.pos )
+            return false;
+        return false;
+    }
+
+    static bool compareRepSequenceAndIdAndPosReverse(const CompactKmerPosition<T> &first, const CompactKmerPosition<T> &second){
+        size_t firstKmer  = BIT_SET(first.kmer, 63);
+        size_t secondKmer = BIT_SET(second.kmer, 63);
+        if(firstKmer < secondKmer )
+            return true;
+        if(secondKmer < firstKmer )
+            return false;
+        if(first.id < second.id )
+            return true;
+        if(second.id < first.id )
+            return false;
+        if(first.pos < second.pos )
+            return true;
+        if(second.pos < first.pos )
+            return false;
+        return false;
+    }
+};
+
+// First pass of an out-of-core radix sort of the k-mer table.
+// K-mers are spilled into bucket files by the high bits of their 16 bit hash, all members of a k-mer group
+// share the hash and end up in the same bucket. Consecutive buckets that fit into memory are sorted together afterwards.
+// Buckets that do not fit on their own are split again by a second hash of the k-mer.
+template <typename KmerType>
+class KmerBucketWriter {
+public:
+    static const unsigned int BUCKET_BITS = 8;
+    static const size_t BUCKETS = 1 << BUCKET_BITS;
+
+    KmerBucketWriter(const std::string &prefix);
+    ~KmerBucketWriter();
+
+    static size_t getBucket(unsigned short hash) {
+        return hash >> (16 - BUCKET_BITS);
+    }
+
+    // groups the entries by bucket (using buffer as scratch space) and appends them to the bucket files
+    void write(const KmerType *kmers, const unsigned short *hashes, size_t count, KmerType *buffer);
+
+    void close();
+
+    // splits every bucket with more than maxKmers k-mers into smaller buckets, buffer has to hold maxKmers k-mers
+    void splitLargeBuckets(size_t maxKmers, KmerType *buffer);
+
+    // groups consecutive buckets into ranges [first, second) of at most maxKmers k-mers
+    std::vector<std::pair<size_t, size_t>> getBucketRanges(size_t maxKmers);
+
+    // loads the buckets [from, to) into kmers, deletes their files and returns the k-mer count
+    size_t read(size_t from, size_t to, KmerType *kmers);
+
+    // deletes the files of the buckets [from, to) without reading them
+    void remove(size_t from, size_t to);
+
+private:
+    std::string prefix;
+    FILE *files[BUCKETS];
+    // bucket files in hash order, split buckets are replaced by their parts
+    std::vector<std::string> fileNames;
+    std::vector<size_t> counts;
+
+    std::string getFileName(size_t bucket);
+    size_t splitBucket(size_t bucket, size_t maxKmers, KmerType *buffer, unsigned int round);
+};
 
 struct __attribute__((__packed__)) KmerEntry {
     unsigned int seqId;
@@ -191,9 +318,12 @@ public:
     }
 };
 
+class SequenceWeights;
 
-template  <int TYPE, typename T>
-size_t assignGroup(KmerPosition<T> *kmers, size_t splitKmerCount, bool includeOnlyExtendable, int covMode, float covThr);
+// groups the sorted k-mers by k-mer and assigns each group to its rep. sequence, returns the number of kept entries
+template <int TYPE, typename T>
+size_t assignGroup(CompactKmerPosition<T> *kmers, size_t splitKmerCount, bool includeOnlyExtendable, int covMode, float covThr,
+                   SequenceWeights *sequenceWeights, float weightThr, const KmerSequenceOrder<T> &sequenceOrder);
 
 template <int TYPE, typename T>
 void mergeKmerFilesAndOutput(DBWriter & dbw, std::vector<std::string> tmpFiles, std::vector<char> &repSequence);
@@ -205,25 +335,24 @@ size_t queueNextEntry(KmerPositionQueue &queue, int file, size_t offsetPos, T *e
 
 void setKmerLengthAndAlphabet(Parameters &parameters, size_t aaDbSize, int seqType);
 
-template <int TYPE, typename T, typename seqLenType>
-void writeKmersToDisk(std::string tmpFile, KmerPosition<seqLenType> *kmers, size_t totalKmers);
+template <int TYPE, typename T, typename seqLenType, template <typename> class KmerType>
+void writeKmersToDisk(std::string tmpFile, KmerType<seqLenType> *kmers, size_t totalKmers);
 
 template <int TYPE, typename T>
-void writeKmerMatcherResult(DBWriter & dbw, KmerPosition<T> *hashSeqPair, size_t totalKmers,
+void writeKmerMatcherResult(DBWriter & dbw, CompactKmerPosition<T> *hashSeqPair, size_t totalKmers,
                             std::vector<char> &repSequence, size_t threads);
 
+template <typename T, template <typename> class KmerType = KmerPosition>
+KmerType<T> *initKmerPositionMemory(size_t size);
 
-template <typename T>
-KmerPosition<T> * doComputation(size_t totalKmers, size_t split, size_t splits, std::string splitFile,
-                                DBReader<unsigned int> & seqDbr, Parameters & par, BaseMatrix  * subMat,
-                                size_t KMER_SIZE, size_t chooseTopKmer, float chooseTopKmerScale = 0.0);
-template <typename T>
-KmerPosition<T> *initKmerPositionMemory(size_t size);
-
-template <int TYPE, typename T>
-std::pair<size_t, size_t>  fillKmerPositionArray(KmerPosition<T> * kmerArray, size_t kmerArraySize, DBReader<unsigned int> &seqDbr,
+// kmers are either written to kmerArray or spilled to bucketWriter
+// sequenceOrder is needed for CompactKmerPosition
+template <int TYPE, typename T, template <typename> class KmerType = KmerPosition>
+std::pair<size_t, size_t>  fillKmerPositionArray(KmerType<T> * kmerArray, size_t kmerArraySize, DBReader<unsigned int> &seqDbr,
                                                  Parameters & par, BaseMatrix * subMat, bool hashWholeSequence,
-                                                 size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution);
+                                                 size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution,
+                                                 KmerBucketWriter<KmerType<T>> * bucketWriter = NULL,
+                                                 const KmerSequenceOrder<T> * sequenceOrder = NULL);
 
 
 void maskSequence(int maskMode, int maskLowerCase,
@@ -0,0 +1,137 @@
+#include "IndexTable.h"
+#include "simd.h"
+
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+// shuffle masks and data lengths for all control bytes of the StreamVByte decoder
+struct PackedDecodeTable {
+    unsigned char shuffle[256][16] __attribute__((aligned(16)));
+    unsigned char length[256];
+
+    PackedDecodeTable() {
+        for (size_t control = 0; control < 256; control++) {
+            unsigned char offset = 0;
+            for (size_t value = 0; value < 4; value++) {
+                const unsigned char bytes = ((control >> (2 * value)) & 0x3) + 1;
+                for (size_t byte = 0; byte < 4; byte++) {
+                    shuffle[control][4 * value + byte] = (byte < bytes) ? (offset + byte) : 0x80;
+                }
+                offset += bytes;
+            }
+            length[control] = offset;
+        }
+    }
+};
+
+static const PackedDecodeTable packedDecodeTable;
+
+static inline unsigned int packedValueLength(unsigned int value) {
+    return (value < (1u << 8)) ? 1 : (value < (1u << 16)) ? 2 : (value < (1u << 24)) ? 3 : 4;
+}
+
+size_t IndexTable::packDBSeqList(const IndexEntryLocal *list, size_t listSize, unsigned char *out) {
+    if (listSize == 0) {
+        return 0;
+    }
+
+    size_t headerSize = 1;
+    for (size_t rest = listSize >> 7; rest > 0; rest >>= 7) {
+        headerSize++;
+    }
+    const size_t controlSize = (listSize + 1) / 2;
+
+    if (out == NULL) {
+        size_t dataSize = 0;
+        unsigned int prevSeqId = 0;
+        for (size_t i = 0; i < listSize; i++) {
+            dataSize += packedValueLength(list[i].seqId - prevSeqId) + packedValueLength(list[i].position_j);
+            prevSeqId = list[i].seqId;
+        }
+        return headerSize + controlSize + dataSize;
+    }
+
+    size_t rest = listSize;
+    while (rest >= 0x80) {
+        *out++ = static_cast<unsigned char>(rest & 0x7F) | 0x80;
+        rest >>= 7;
+    }
+    *out++ = static_cast<unsigned char>(rest);
+
+    unsigned char *control = out;
+    unsigned char *data = out + controlSize;
+    memset(control, 0, controlSize);
+    unsigned int prevSeqId = 0;
+    for (size_t i = 0; i < listSize; i++) {
+        // lists are sorted by seqId, so the deltas are small for long lists
+        const unsigned int values[2] = { list[i].seqId - prevSeqId, list[i].position_j };
+        prevSeqId = list[i].seqId;
+        for (size_t j = 0; j < 2; j++) {
+            const unsigned int bytes = packedValueLength(values[j]);
+            control[i / 2] |= (bytes - 1) << (2 * (2 * (i % 2) + j));
+            for (size_t byte = 0; byte < bytes; byte++) {
+                *data++ = static_cast<unsigned char>(values[j] >> (8 * byte));
+            }
+        }
+    }
+    return headerSize + controlSize + (data - control - controlSize);
+}
+
+void IndexTable::unpackDBSeqList(const unsigned char *in, IndexEntryLocal *out) {
+    const unsigned char *control;
+    const size_t listSize = readPackedSize(in, &control);
+    const unsigned char *data = control + (listSize + 1) / 2;
+
+    unsigned int seqId = 0;
+    unsigned int values[4] __attribute__((aligned(16)));
+    for (size_t i = 0; i < listSize; i += 2) {
+        const unsigned char c = control[i / 2];
+        const __m128i mask = _mm_load_si128((const __m128i *) packedDecodeTable.shuffle[c]);
+        _mm_store_si128((__m128i *) values, _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) data), mask));
+        data += packedDecodeTable.length[c];
+
+        seqId += values[0];
+        out[i].seqId = seqId;
+        out[i].position_j = static_cast<unsigned short>(values[1]);
+        // the last control byte only describes one entry for odd list sizes
+        if (i + 1 < listSize) {
+            seqId += values[2];
+            out[i + 1].seqId = seqId;
+            out[i + 1].position_j = static_cast<unsigned short>(values[3]);
+        }
+    }
+}
+
+void IndexTable::packRange(size_t start, size_t end, size_t packedStart, std::vector<unsigned char> &out) {
+    std::vector<size_t> listOffsets(end - start + 1);
+#pragma omp parallel for schedule(static)
+    for (size_t i = start; i < end; i++) {
+        listOffsets[i - start] = packDBSeqList(entries + offsets[i], offsets[i + 1] - offsets[i], NULL);
+    }
+    size_t offset = 0;
+    for (size_t i = 0; i < end - start; i++) {
+        const size_t listBytes = listOffsets[i];
+        listOffsets[i] = offset;
+        offset += listBytes;
+    }
+    listOffsets[end - start] = offset;
+    out.resize(offset);
+
+#pragma omp parallel for schedule(static)
+    for (size_t i = start; i < end; i++) {
+        packDBSeqList(entries + offsets[i], offsets[i + 1] - offsets[i], out.data() + listOffsets[i - start]);
+    }
+    // offsets[end] is still needed by the next range
+    for (size_t i = start; i < end; i++) {
+        offsets[i] = packedStart + listOffsets[i - start];
+    }
+}
+
+void IndexTable::finishPacking(size_t packedSize) {
+    if (externalData == false) {
+        delete[] entries;
+    }
+    entries = NULL;
+    offsets[tableSize] = packedSize;
+}
@@ -19,6 +19,7 @@
 #include "FastSort.h"
 #include <stdlib.h>
 #include <algorithm>
+#include <vector>
 
 // IndexEntryLocal is an entry with position and seqId for a kmer
 // structure needs to be packed or it will need 8 bytes instead of 6
@@ -67,7 +68,7 @@ public:
     IndexTable(int alphabetSize, int kmerSize, bool externalData)
             : tableSize(MathUtil::ipow<size_t>(alphabetSize, kmerSize)), alphabetSize(alphabetSize),
               kmerSize(kmerSize), externalData(externalData), tableEntriesNum(0), size(0),
-              indexer(new Indexer(alphabetSize, kmerSize)), entries(NULL), offsets(NULL) {
+              indexer(new Indexer(alphabetSize, kmerSize)), entries(NULL), offsets(NULL), packedEntries(NULL) {
         if (externalData == false) {
             offsets = new(std::nothrow) size_t[tableSize + 1];
             Util::checkAllocation(offsets, "Can not allocate entries memory in IndexTable");
@@ -90,6 +91,10 @@ public:
                 delete[] offsets;
                 offsets = NULL;
             }
+            if (packedEntries != NULL) {
+                delete[] packedEntries;
+                packedEntries = NULL;
+            }
         }
     }
 
@@ -172,13 +177,55 @@ public:
         return countUniqKmer;
     }
 
-    // get list of DB sequences containing this k-mer
+    // get list of DB sequences containing this k-mer, only for tables that are not packed
     inline IndexEntryLocal *getDBSeqList(size_t kmer, size_t *matchedListSize) {
         const ptrdiff_t diff = offsets[kmer + 1] - offsets[kmer];
         *matchedListSize = static_cast<size_t>(diff);
         return (entries + offsets[kmer]);
     }
 
+    // get amount of DB sequences containing this k-mer
+    inline size_t getDBSeqListSize(size_t kmer) {
+        if (packedEntries == NULL) {
+            return offsets[kmer + 1] - offsets[kmer];
+        }
+        if (offsets[kmer + 1] == offsets[kmer]) {
+            return 0;
+        }
+        const unsigned char *data;
+        return readPackedSize(packedEntries + offsets[kmer], &data);
+    }
+
+    // copy list of DB sequences containing this k-mer to out, which needs space for getDBSeqListSize entries
+    inline void copyDBSeqList(size_t kmer, IndexEntryLocal *out) {
+        if (packedEntries == NULL) {
+            memcpy(out, entries + offsets[kmer], sizeof(IndexEntryLocal) * (offsets[kmer + 1] - offsets[kmer]));
+        } else if (offsets[kmer + 1] != offsets[kmer]) {
+            unpackDBSeqList(packedEntries + offsets[kmer], out);
+        }
+    }
+
+    // Packed tables store each sequence list as its length followed by a StreamVByte encoding of the
+    // (seqId delta, position) pairs: one control byte holds the byte lengths of two pairs, followed by
+    // the data bytes of all pairs. offsets then point to bytes in packedEntries instead of entries.
+    // The lists are packed in consecutive ranges of k-mers, so that the packed table can be written out
+    // without holding it in memory next to the unpacked one: packRange encodes the lists of k-mers [start, end)
+    // into out and turns their offsets in place into byte offsets starting at packedStart.
+    // finishPacking drops the unpacked entries once all ranges are packed.
+    void packRange(size_t start, size_t end, size_t packedStart, std::vector<unsigned char> &out);
+    void finishPacking(size_t packedSize);
+
+    bool isPacked() {
+        return packedEntries != NULL;
+    }
+
+    // the decoder reads up to PACKED_PADDING bytes past the end of the last list
+    size_t getPackedEntriesSize() {
+        return offsets[tableSize] + PACKED_PADDING;
+    }
+
+    static const size_t PACKED_PADDING = 16;
+
     void sortDBSeqLists() {
         #pragma omp parallel for
         for (size_t i = 0; i < tableSize; i++) {
@@ -248,6 +295,26 @@ public:
         memcpy(this->offsets, entryOffsets, (tableSize + 1) * sizeof(size_t));
     }
 
+    void initPackedTableByExternalData(size_t sequenceCount, size_t tableEntriesNum, unsigned char *packedEntries, size_t *entryOffsets) {
+        this->tableEntriesNum = tableEntriesNum;
+        this->size = sequenceCount;
+
+        this->packedEntries = packedEntries;
+        this->offsets = entryOffsets;
+    }
+
+    void initPackedTableByExternalDataCopy(size_t sequenceCount, size_t tableEntriesNum, unsigned char *packedEntries, size_t *entryOffsets) {
+        this->tableEntriesNum = tableEntriesNum;
+        this->size = sequenceCount;
+
+        memcpy(this->offsets, entryOffsets, (tableSize + 1) * sizeof(size_t));
+
+        const size_t packedSize = getPackedEntriesSize();
+        this->packedEntries = new(std::nothrow) unsigned char[packedSize];
+        Util::checkAllocation(this->packedEntries, "Can not allocate " + SSTR(packedSize) + " bytes for packed entries in IndexTable");
+        memcpy(this->packedEntries, packedEntries, packedSize);
+    }
+
     void revertPointer() {
         for (size_t i = tableSize; i > 0; i--) {
             offsets[i] = offsets[i - 1];
@@ -484,6 +551,26 @@ protected:
     IndexEntryLocal *entries;
     size_t *offsets;
 
+    // entries encoded by packRange, NULL if the table is not packed
+    unsigned char *packedEntries;
+
+    static inline size_t readPackedSize(const unsigned char *in, const unsigned char **data) {
+        size_t listSize = 0;
+        unsigned int shift = 0;
+        while (*in & 0x80) {
+            listSize |= static_cast<size_t>(*in & 0x7F) << shift;
+            shift += 7;
+            in++;
+        }
+        listSize |= static_cast<size_t>(*in) << shift;
+        *data = in + 1;
+        return listSize;
+    }
+
+    // returns the amount of bytes needed for the list, the list is only written if out is not NULL
+    static size_t packDBSeqList(const IndexEntryLocal *list, size_t listSize, unsigned char *out);
+    static void unpackDBSeqList(const unsigned char *in, IndexEntryLocal *out);
+
     // sequence lookup
     SequenceLookup *sequenceLookup;
 };
@@ -104,6 +104,10 @@ void KmerGenerator::initDataStructure(){
 }
 
 
+// The lists are generated for every query k-mer on purpose. Precomputed lists of frequent k-mers would have to
+// keep the generation order of the similar k-mers, which the diagonal selection of the prefilter depends on,
+// they make the index much larger without a faster search, and a per-thread cache keyed on k-mer and
+// threshold almost never hits, since k-mers rarely repeat within the lifetime of a cache.
 std::pair<size_t *, size_t> KmerGenerator::generateKmerList(const unsigned char * int_seq, bool addIdentity){
     int dividerBefore=0;
     // pre compute phase
@@ -195,19 +199,34 @@ size_t KmerGenerator::calculateArrayProduct(const short        * __restrict scor
                                             const short possibleRest,
                                             const size_t pow){
     size_t counter=0;
+    size_t array2End = 0;
     for(size_t i = 0 ; i< array1Size;i++){
         const short score_i = scoreArray1[i];
         const size_t kmer_i = indexArray1[i];
         if(score_i < cutoff1 )
             break;
         const short cutoff2=this->threshold-score_i-possibleRest;
-        for(size_t j = 0; j < array2Size && (counter+1 < (int) MAX_KMER_RESULT_SIZE) && (scoreArray2[j] >= cutoff2); j++){
-            const short score_j = scoreArray2[j];
-            const size_t kmer_j = indexArray2[j];
-            outputScoreArray[counter]=score_i+score_j;
-            outputIndexArray[counter]=kmer_i+(kmer_j*pow);
-            counter++;
+        // both arrays are sorted by decreasing score, so the elements passing cutoff2
+        // are a prefix of array2 that can only shrink with increasing i
+        if(i == 0){
+            while(array2End < array2Size && scoreArray2[array2End] >= cutoff2){
+                array2End++;
+            }
+        }
+        while(array2End > 0 && scoreArray2[array2End - 1] < cutoff2){
+            array2End--;
+        }
+        if(array2End == 0){
+            break;
+        }
+        const size_t elements = std::min(array2End, static_cast<size_t>(MAX_KMER_RESULT_SIZE - 1 - counter));
+        short  * __restrict outScore = outputScoreArray + counter;
+        size_t * __restrict outIndex = outputIndexArray + counter;
+        for(size_t j = 0; j < elements; j++){
+            outScore[j] = score_i + scoreArray2[j];
+            outIndex[j] = kmer_i + static_cast<size_t>(indexArray2[j]) * pow;
         }
+        counter += elements;
         if(counter+1 >= (int) MAX_KMER_RESULT_SIZE){
             return counter;
         }
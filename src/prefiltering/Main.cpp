@@ -5,42 +5,71 @@
 #include "DBReader.h"
 #include "Timer.h"
 #include "FileUtil.h"
+#include "Alignment.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <ctime>
+#include <sstream>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
 
 #ifdef OPENMP
 #include <omp.h>
 #endif
 
-int prefilter(int argc, const char **argv, const Command& command) {
-    MMseqsMPI::init(argc, argv);
-
-    Parameters& par = Parameters::getInstance();
-    par.parseParameters(argc, argv, command, true, 0, MMseqsParameter::COMMAND_PREFILTER);
-
-    Timer timer;
-    int queryDbType = FileUtil::parseDbType(par.db1.c_str());
-    int targetDbType = FileUtil::parseDbType(par.db2.c_str());
+// the sequence type of a target database, which might be a precomputed index
+static int getTargetDbType(const std::string &targetDB, const std::string &targetDBIndex, int threads) {
+    int targetDbType = FileUtil::parseDbType(targetDB.c_str());
     if(Parameters::isEqualDbtype(targetDbType, Parameters::DBTYPE_INDEX_DB) == true) {
-        DBReader<unsigned int> dbr(par.db2.c_str(), par.db2Index.c_str(), par.threads, DBReader<unsigned int>::USE_INDEX | DBReader<unsigned int>::USE_DATA);
+        DBReader<unsigned int> dbr(targetDB.c_str(), targetDBIndex.c_str(), threads, DBReader<unsigned int>::USE_INDEX | DBReader<unsigned int>::USE_DATA);
         dbr.open(DBReader<unsigned int>::NOSORT);
         PrefilteringIndexData data = PrefilteringIndexReader::getMetadata(&dbr);
         targetDbType = data.seqType;
         dbr.close();
     }
+    return targetDbType;
+}
+
+// resolves the sequence types of query and target database
+static bool getSearchDbTypes(const Parameters &par, int &queryDbType, int &targetDbType) {
+    queryDbType = FileUtil::parseDbType(par.db1.c_str());
+    targetDbType = getTargetDbType(par.db2, par.db2Index, par.threads);
     if (queryDbType == -1 || targetDbType == -1) {
         Debug(Debug::ERROR) << "Please recreate your database or add a .dbtype file to your sequence/profile database.\n";
-        return EXIT_FAILURE;
+        return false;
     }
     if (Parameters::isEqualDbtype(queryDbType, Parameters::DBTYPE_HMM_PROFILE) && Parameters::isEqualDbtype(targetDbType, Parameters::DBTYPE_HMM_PROFILE)) {
         Debug(Debug::ERROR) << "Only the query OR the target database can be a profile database.\n";
-        return EXIT_FAILURE;
+        return false;
     }
 
     if (Parameters::isEqualDbtype(queryDbType, Parameters::DBTYPE_AMINO_ACIDS) && Parameters::isEqualDbtype(targetDbType, Parameters::DBTYPE_NUCLEOTIDES)) {
         Debug(Debug::ERROR) << "The prefilter can not search amino acids against nucleotides. Something might got wrong while createdb or createindex.\n";
-        return EXIT_FAILURE;
+        return false;
     }
     if (Parameters::isEqualDbtype(queryDbType, Parameters::DBTYPE_NUCLEOTIDES) && Parameters::isEqualDbtype(targetDbType, Parameters::DBTYPE_AMINO_ACIDS)) {
         Debug(Debug::ERROR) << "The prefilter can not search nucleotides against amino acids. Something might got wrong while createdb or createindex.\n";
+        return false;
+    }
+    return true;
+}
+
+int prefilter(int argc, const char **argv, const Command& command) {
+    MMseqsMPI::init(argc, argv);
+
+    Parameters& par = Parameters::getInstance();
+    par.parseParameters(argc, argv, command, true, 0, MMseqsParameter::COMMAND_PREFILTER);
+
+    Timer timer;
+    int queryDbType, targetDbType;
+    if (getSearchDbTypes(par, queryDbType, targetDbType) == false) {
         return EXIT_FAILURE;
     }
 
@@ -60,3 +89,262 @@ int prefilter(int argc, const char **argv, const Command& command) {
 
     return EXIT_SUCCESS;
 }
+
+int prefilteralign(int argc, const char **argv, const Command& command) {
+    MMseqsMPI::init(argc, argv);
+
+    Parameters& par = Parameters::getInstance();
+    par.overrideParameterDescription(par.PARAM_ALIGNMENT_MODE, "How to compute the alignment:\n0: automatic\n1: only score and end_pos\n2: also start_pos and cov\n3: also seq.id", NULL, 0);
+    par.parseParameters(argc, argv, command, true, 0, MMseqsParameter::COMMAND_PREFILTER | MMseqsParameter::COMMAND_ALIGN);
+
+    int queryDbType, targetDbType;
+    if (getSearchDbTypes(par, queryDbType, targetDbType) == false) {
+        return EXIT_FAILURE;
+    }
+
+    // the prefilter hits of each query are aligned right away, no prefilter database is written
+    Prefiltering pref(par.db1, par.db1Index, par.db2, par.db2Index, queryDbType, targetDbType, par);
+    pref.initFusedSearch();
+
+    Alignment aln(par.db1, par.db2,
+                  "", "",
+                  par.db3, par.db3Index, par, false, &pref);
+
+    Debug(Debug::INFO) << "Calculation of prefilter hits and alignments\n";
+
+#ifdef HAVE_MPI
+    aln.run(MMseqsMPI::rank, MMseqsMPI::numProc);
+#else
+    aln.run();
+#endif
+
+    return EXIT_SUCCESS;
+}
+
+static bool isReadableFile(const std::string &file) {
+    struct stat st;
+    return stat(file.c_str(), &st) == 0 && S_ISREG(st.st_mode) && access(file.c_str(), R_OK) == 0;
+}
+
+// checks everything a batch reads or writes up front, errors during the search would end the server
+// returns an empty string or the error reply
+static std::string validateBatch(const std::string &queryDB, const std::string &alnDB, const std::string &targetDB, int queryDbType) {
+    const std::string queryIndex = queryDB + ".index";
+    if (isReadableFile(queryIndex) == false) {
+        return "ERROR Query database index " + queryIndex + " not found or not readable\n";
+    }
+    std::vector<std::string> dataFiles = FileUtil::findDatafiles(queryDB.c_str());
+    if (dataFiles.empty()) {
+        return "ERROR Query database " + queryDB + " not found\n";
+    }
+    for (size_t i = 0; i < dataFiles.size(); i++) {
+        if (isReadableFile(dataFiles[i]) == false) {
+            return "ERROR Query database file " + dataFiles[i] + " is not readable\n";
+        }
+    }
+    const std::string queryDbtype = queryDB + ".dbtype";
+    if (isReadableFile(queryDbtype) == false || FileUtil::getFileSize(queryDbtype) != sizeof(int)) {
+        return "ERROR Query database type file " + queryDbtype + " is missing or invalid\n";
+    }
+    const int dbtype = FileUtil::parseDbType(queryDB.c_str());
+    if (Parameters::isEqualDbtype(dbtype, queryDbType) == false) {
+        return "ERROR Query database " + queryDB + " is of type " + Parameters::getDbTypeName(dbtype)
+               + ", but the server expects " + Parameters::getDbTypeName(queryDbType) + "\n";
+    }
+
+    if (alnDB == queryDB || alnDB == targetDB) {
+        return "ERROR Alignment database " + alnDB + " would overwrite an input database\n";
+    }
+    std::string alnDir = FileUtil::dirName(alnDB);
+    if (alnDir.empty()) {
+        alnDir = "/";
+    }
+    if (FileUtil::directoryExists(alnDir.c_str()) == false || access(alnDir.c_str(), W_OK | X_OK) != 0) {
+        return "ERROR Directory " + alnDir + " of the alignment database does not exist or is not writable\n";
+    }
+    const std::string outputs[] = { alnDB, alnDB + ".index", alnDB + ".dbtype" };
+    for (size_t i = 0; i < ARRAY_SIZE(outputs); i++) {
+        struct stat st;
+        if (stat(outputs[i].c_str(), &st) == 0 && (S_ISREG(st.st_mode) == false || access(outputs[i].c_str(), W_OK) != 0)) {
+            return "ERROR " + outputs[i] + " exists and cannot be overwritten\n";
+        }
+    }
+    return "";
+}
+
+// searches the query database named in a request line and writes the alignment database named after it
+// returns the reply to the client
+static std::string searchBatch(const std::string &request, int queryDbType, const std::string &targetDB, Prefiltering &pref, Alignment &aln) {
+    std::istringstream words(request);
+    std::string queryDB, alnDB, rest;
+    if (!(words >> queryDB >> alnDB) || (words >> rest)) {
+        return "ERROR Expected request: <queryDB> <alignmentDB>\n";
+    }
+    const std::string error = validateBatch(queryDB, alnDB, targetDB, queryDbType);
+    if (error.empty() == false) {
+        return error;
+    }
+
+    Timer timer;
+    pref.setQueryDb(queryDB, queryDB + ".index");
+    aln.setQueryDb(queryDB);
+    aln.run(alnDB, alnDB + ".index", 0, pref.getQueryDbReader()->getSize(), false);
+    Debug(Debug::INFO) << "Searched " << queryDB << " in " << timer.lap() << "\n";
+    return "OK\n";
+}
+
+// the server handles one client at a time, a client that does not send its request line in time is dropped
+static const int REQUEST_TIMEOUT_MS = 10000;
+static const size_t MAX_REQUEST_SIZE = 4096;
+
+static long monotonicMilliseconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<long>(now.tv_sec) * 1000 + now.tv_nsec / 1000000;
+}
+
+// reads the request line of a client, a request may also end with the connection
+// returns false if the client stalls or the connection fails before the request is complete
+static bool readRequest(int client, std::string &request) {
+    const long deadline = monotonicMilliseconds() + REQUEST_TIMEOUT_MS;
+    char buffer[512];
+    while (request.size() < MAX_REQUEST_SIZE) {
+        const long remaining = deadline - monotonicMilliseconds();
+        if (remaining <= 0) {
+            return false;
+        }
+        struct pollfd pfd;
+        pfd.fd = client;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        const int ready = poll(&pfd, 1, static_cast<int>(remaining));
+        if (ready == -1 && errno == EINTR) {
+            continue;
+        }
+        if (ready <= 0) {
+            return false;
+        }
+        const ssize_t n = read(client, buffer, std::min(sizeof(buffer), MAX_REQUEST_SIZE - request.size()));
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            return false;
+        }
+        if (n == 0) {
+            return true;
+        }
+        const char *newline = static_cast<const char *>(memchr(buffer, '\n', n));
+        if (newline != NULL) {
+            request.append(buffer, newline - buffer);
+            return true;
+        }
+        request.append(buffer, n);
+    }
+    return true;
+}
+
+int searchserver(int argc, const char **argv, const Command& command) {
+    Parameters& par = Parameters::getInstance();
+    par.overrideParameterDescription(par.PARAM_ALIGNMENT_MODE, "How to compute the alignment:\n0: automatic\n1: only score and end_pos\n2: also start_pos and cov\n3: also seq.id", NULL, 0);
+    par.parseParameters(argc, argv, command, true, 0, MMseqsParameter::COMMAND_PREFILTER | MMseqsParameter::COMMAND_ALIGN);
+
+    const int targetDbType = getTargetDbType(par.db1, par.db1Index, par.threads);
+    if (targetDbType == -1) {
+        Debug(Debug::ERROR) << "Please recreate your database or add a .dbtype file to your sequence/profile database.\n";
+        return EXIT_FAILURE;
+    }
+    // profile targets are searched with sequences
+    const int queryDbType = Parameters::isEqualDbtype(targetDbType, Parameters::DBTYPE_NUCLEOTIDES) ? Parameters::DBTYPE_NUCLEOTIDES : Parameters::DBTYPE_AMINO_ACIDS;
+
+    const std::string &socketPath = par.db2;
+    struct sockaddr_un address;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        Debug(Debug::ERROR) << "Socket path " << socketPath << " is too long\n";
+        return EXIT_FAILURE;
+    }
+    struct stat st;
+    if (stat(socketPath.c_str(), &st) == 0) {
+        if (S_ISSOCK(st.st_mode) == false) {
+            Debug(Debug::ERROR) << socketPath << " exists and is not a socket\n";
+            return EXIT_FAILURE;
+        }
+        // left behind by a server that was killed
+        FileUtil::remove(socketPath.c_str());
+    }
+
+    // the target index, the matrices and the alignment state are loaded once and shared by all batches
+    Prefiltering pref("", "", par.db1, par.db1Index, queryDbType, targetDbType, par);
+    pref.initFusedSearch();
+    Alignment aln("", par.db1, "", "", "", "", par, false, &pref);
+
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+    // only the user running the server may connect, the socket is created with mode 0600
+    mode_t mask = umask(0177);
+    const bool bound = server != -1 && bind(server, (struct sockaddr *) &address, sizeof(address)) == 0;
+    umask(mask);
+    if (bound == false || listen(server, 16) != 0) {
+        Debug(Debug::ERROR) << "Could not listen on " << socketPath << ": " << strerror(errno) << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+
+    // a client that disconnects before its reply must not kill the server
+    struct sigaction handler;
+    handler.sa_handler = SIG_IGN;
+    sigemptyset(&handler.sa_mask);
+    handler.sa_flags = 0;
+    sigaction(SIGPIPE, &handler, NULL);
+
+    Debug(Debug::INFO) << "Waiting for query batches on " << socketPath << "\n";
+    bool running = true;
+    while (running) {
+        int client = accept(server, NULL, NULL);
+        if (client == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            Debug(Debug::ERROR) << "Could not accept connection: " << strerror(errno) << "\n";
+            break;
+        }
+
+        // each connection sends a single request line
+        std::string request;
+        if (readRequest(client, request) == false) {
+            Debug(Debug::WARNING) << "Dropped a client that did not send a request within " << REQUEST_TIMEOUT_MS / 1000 << " s\n";
+            close(client);
+            continue;
+        }
+        // a client that does not read its reply cannot block the server either
+        struct timeval sendTimeout;
+        sendTimeout.tv_sec = REQUEST_TIMEOUT_MS / 1000;
+        sendTimeout.tv_usec = 0;
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &sendTimeout, sizeof(sendTimeout));
+
+        std::string reply;
+        if (request == "SHUTDOWN") {
+            reply = "OK\n";
+            running = false;
+        } else {
+            reply = searchBatch(request, queryDbType, par.db1, pref, aln);
+        }
+        if (reply.compare(0, 5, "ERROR") == 0) {
+            Debug(Debug::WARNING) << "Rejected request \"" << request << "\": " << reply.substr(6);
+        }
+        size_t written = 0;
+        while (written < reply.size()) {
+            ssize_t n = write(client, reply.c_str() + written, reply.size() - written);
+            if (n <= 0) {
+                break;
+            }
+            written += n;
+        }
+        close(client);
+    }
+
+    close(server);
+    FileUtil::remove(socketPath.c_str());
+    return EXIT_SUCCESS;
+}
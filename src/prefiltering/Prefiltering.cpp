@@ -9,6 +9,7 @@
 #include "FileUtil.h"
 #include "IndexBuilder.h"
 #include "Timer.h"
+#include "Telemetry.h"
 #include "ByteParser.h"
 #include "Parameters.h"
 #include "MemoryMapped.h"
@@ -53,8 +54,11 @@ Prefiltering::Prefiltering(const std::string &queryDB,
         covThr(par.covThr), covMode(par.covMode), includeIdentical(par.includeIdentity),
         preloadMode(par.preloadMode),
         threads(static_cast<unsigned int>(par.threads)),
-        compressed(par.compressed) {
-    sameQTDB = isSameQTDB();
+        compressed(par.compressed),
+        resultDbtype(par.binaryResult ? Parameters::DBTYPE_PREFILTER_BIN_RES : Parameters::DBTYPE_PREFILTER_RES),
+        queryBatchSize(static_cast<size_t>(par.queryBatchSize)) {
+    // searchserver passes no query database and sets one per batch with setQueryDb
+    sameQTDB = (queryDB.empty() == false) && isSameQTDB();
 
     // init the substitution matrices
     switch (querySeqType & Parameters::DBTYPE_MASK) {
@@ -88,7 +92,11 @@ Prefiltering::Prefiltering(const std::string &queryDB,
             }
         }
 
-        tidxdbr = new DBReader<unsigned int>(targetDB.c_str(), targetDBIndex.c_str(), threads, DBReader<unsigned int>::USE_INDEX | DBReader<unsigned int>::USE_DATA);
+        int indexDataMode = DBReader<unsigned int>::USE_INDEX | DBReader<unsigned int>::USE_DATA;
+        if (preloadMode == Parameters::PRELOAD_MODE_MMAP_HUGEPAGE) {
+            indexDataMode |= DBReader<unsigned int>::USE_HUGEPAGES;
+        }
+        tidxdbr = new DBReader<unsigned int>(targetDB.c_str(), targetDBIndex.c_str(), threads, indexDataMode);
         tidxdbr->open(DBReader<unsigned int>::NOSORT);
 
         templateDBIsIndex = PrefilteringIndexReader::checkIfIndexFile(tidxdbr);
@@ -158,7 +166,11 @@ Prefiltering::Prefiltering(const std::string &queryDB,
             EXIT(EXIT_FAILURE);
         }
     } else {
-        tdbr = new DBReader<unsigned int>(targetDB.c_str(), targetDBIndex.c_str(), threads, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
+        int targetDataMode = DBReader<unsigned int>::USE_INDEX | DBReader<unsigned int>::USE_DATA;
+        if (preloadMode == Parameters::PRELOAD_MODE_MMAP_HUGEPAGE) {
+            targetDataMode |= DBReader<unsigned int>::USE_HUGEPAGES;
+        }
+        tdbr = new DBReader<unsigned int>(targetDB.c_str(), targetDBIndex.c_str(), threads, targetDataMode);
         tdbr->open(DBReader<unsigned int>::LINEAR_ACCCESS);
         templateDBIsIndex = false;
     }
@@ -180,16 +192,20 @@ Prefiltering::Prefiltering(const std::string &queryDB,
     // memoryLimit in bytes
     size_t memoryLimit=Util::computeMemory(par.splitMemoryLimit);
 
-    if (templateDBIsIndex == false && sameQTDB == true) {
+    if (queryDB.empty()) {
+        qdbr = NULL;
+    } else if (templateDBIsIndex == false && sameQTDB == true) {
         qdbr = tdbr;
     } else {
         qdbr = new DBReader<unsigned int>(queryDB.c_str(), queryDBIndex.c_str(), threads, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
         qdbr->open(DBReader<unsigned int>::LINEAR_ACCCESS);
     }
-    Debug(Debug::INFO) << "Query database size: " << qdbr->getSize() << " type: " << Parameters::getDbTypeName(querySeqType) << "\n";
+    if (qdbr != NULL) {
+        Debug(Debug::INFO) << "Query database size: " << qdbr->getSize() << " type: " << Parameters::getDbTypeName(querySeqType) << "\n";
+    }
 
     setupSplit(*tdbr, alphabetSize - 1, querySeqType,
-               threads, templateDBIsIndex, memoryLimit, qdbr->getSize(),
+               threads, templateDBIsIndex, memoryLimit, (qdbr != NULL) ? qdbr->getSize() : 1,
                maxResListLen, kmerSize, splits, splitMode);
 
     if(Parameters::isEqualDbtype(targetSeqType, Parameters::DBTYPE_NUCLEOTIDES) == false){
@@ -237,7 +253,7 @@ Prefiltering::~Prefiltering() {
         delete taxonomyHook;
     }
 
-    if (sameQTDB == false) {
+    if (sameQTDB == false && qdbr != NULL) {
         qdbr->close();
         delete qdbr;
     }
@@ -375,7 +391,7 @@ void Prefiltering::setupSplit(DBReader<unsigned int>& tdbr, const int alphabetSi
     }
 }
 
-void Prefiltering::mergeTargetSplits(const std::string &outDB, const std::string &outDBIndex, const std::vector<std::pair<std::string, std::string>> &fileNames, unsigned int threads) {
+void Prefiltering::mergeTargetSplits(const std::string &outDB, const std::string &outDBIndex, const std::vector<std::pair<std::string, std::string>> &fileNames, unsigned int threads, int resultDbtype) {
     // we assume that the hits are in the same order
     const size_t splits = fileNames.size();
 
@@ -387,6 +403,11 @@ void Prefiltering::mergeTargetSplits(const std::string &outDB, const std::string
 
     Timer timer;
     Debug(Debug::INFO) << "Merging " << splits << " target splits to " << FileUtil::baseName(outDB) << "\n";
+    if (QueryMatcher::isBinaryPrefilterResult(resultDbtype)) {
+        mergeBinaryTargetSplits(outDB, outDBIndex, fileNames, threads);
+        Debug(Debug::INFO) << "Time for merging target splits: " << timer.lap() << "\n";
+        return;
+    }
     DBReader<unsigned int> reader1(fileNames[0].first.c_str(), fileNames[0].second.c_str(), 1, DBReader<unsigned int>::USE_INDEX);
     reader1.open(DBReader<unsigned int>::NOSORT);
     DBReader<unsigned int>::Index *index1 = reader1.getIndex();
@@ -494,6 +515,57 @@ void Prefiltering::mergeTargetSplits(const std::string &outDB, const std::string
     Debug(Debug::INFO) << "Time for merging target splits: " << timer.lap() << "\n";
 }
 
+void Prefiltering::mergeBinaryTargetSplits(const std::string &outDB, const std::string &outDBIndex, const std::vector<std::pair<std::string, std::string>> &fileNames, unsigned int threads) {
+    const size_t splits = fileNames.size();
+    std::vector<DBReader<unsigned int>*> readers;
+    for (size_t i = 0; i < splits; ++i) {
+        DBReader<unsigned int> *reader = new DBReader<unsigned int>(fileNames[i].first.c_str(), fileNames[i].second.c_str(), threads, DBReader<unsigned int>::USE_INDEX | DBReader<unsigned int>::USE_DATA);
+        reader->open(DBReader<unsigned int>::NOSORT);
+        reader->setSequentialAdvice();
+        readers.push_back(reader);
+    }
+
+    // the splits were written with the compression of the final result
+    DBWriter writer(outDB.c_str(), outDBIndex.c_str(), threads, readers[0]->isCompressed(), Parameters::DBTYPE_PREFILTER_BIN_RES);
+    writer.open();
+
+    const size_t entries = readers[0]->getSize();
+    Debug::Progress progress(entries);
+#pragma omp parallel num_threads(threads)
+    {
+        unsigned int thread_idx = 0;
+#ifdef OPENMP
+        thread_idx = static_cast<unsigned int>(omp_get_thread_num());
+#endif
+        std::vector<hit_t> hits;
+        hits.reserve(300);
+        std::string result;
+
+#pragma omp for schedule(dynamic, 100)
+        for (size_t id = 0; id < entries; id++) {
+            progress.updateProgress();
+            // the splits were sorted by id order, so the same local id refers to the same query in every split
+            for (size_t file = 0; file < splits; file++) {
+                char *data = readers[file]->getData(id, thread_idx);
+                QueryMatcher::parsePrefilterHits(data, readers[file]->getEntryLen(id), true, hits);
+            }
+            if (hits.size() > 1) {
+                SORT_SERIAL(hits.begin(), hits.end(), hit_t::compareHitsByScoreAndId);
+            }
+            QueryMatcher::prefilterHitsToBinaryBuffer(result, hits.data(), hits.size());
+            writer.writeData(result.c_str(), result.size(), readers[0]->getDbKey(id), thread_idx);
+            result.clear();
+            hits.clear();
+        }
+    }
+    writer.close();
+
+    for (size_t i = 0; i < splits; ++i) {
+        readers[i]->close();
+        delete readers[i];
+        DBReader<unsigned int>::removeDb(fileNames[i].first);
+    }
+}
 
 ScoreMatrix Prefiltering::getScoreMatrix(const BaseMatrix& matrix, const size_t kmerSize) {
     if (templateDBIsIndex == true) {
@@ -579,22 +651,6 @@ void Prefiltering::runMpiSplits(const std::string &resultDB, const std::string &
             compressed = false;
     }
 
-    // if split size is great than nodes than we have to
-    // distribute all splits equally over all nodes
-    unsigned int * splitCntPerProc = new unsigned int[MMseqsMPI::numProc];
-    memset(splitCntPerProc, 0, sizeof(unsigned int) * MMseqsMPI::numProc);
-    for(int i = 0; i < splits; i++){
-        splitCntPerProc[i % MMseqsMPI::numProc] += 1;
-    }
-
-    size_t fromSplit = 0;
-    for(int i = 0; i < MMseqsMPI::rank; i++){
-        fromSplit += splitCntPerProc[i];
-    }
-
-    size_t splitCount = splitCntPerProc[MMseqsMPI::rank];
-    delete[] splitCntPerProc;
-
     // setting names in case of localTmp path
     std::string procTmpResultDB = localTmpPath;
     std::string procTmpResultDBIndex = localTmpPath;
@@ -619,7 +675,61 @@ void Prefiltering::runMpiSplits(const std::string &resultDB, const std::string &
     std::pair<std::string, std::string> result = Util::createTmpFileNames(procTmpResultDB, procTmpResultDBIndex, MMseqsMPI::rank + runRandomId);
     bool merge = (splitMode == Parameters::QUERY_DB_SPLIT);
 
-    int hasResult = runSplits(result.first, result.second, fromSplit, splitCount, merge) == true ? 1 : 0;
+    // splits differ a lot in runtime, so each rank asks for the next split when it is done with the previous one
+    // every rank merges its own splits while the others are still busy
+    std::vector<std::pair<std::string, std::string>> splitFiles;
+    // split index and runtime of each processed split
+    std::vector<double> splitTimes;
+    {
+        MPIWorkQueue queue(splits);
+        for (size_t split = queue.next(); split < static_cast<size_t>(splits); split = queue.next()) {
+            Timer timer;
+            std::pair<std::string, std::string> splitResult = Util::createTmpFileNames(result.first, result.second, split);
+            if (runSplit(splitResult.first, splitResult.second, split, merge)) {
+                splitFiles.push_back(splitResult);
+            }
+            splitTimes.push_back(split);
+            splitTimes.push_back(timer.getTimediff());
+        }
+        if (splitFiles.size() == 1) {
+            DBReader<unsigned int>::moveDb(splitFiles[0].first, result.first);
+        } else if (splitFiles.size() > 1) {
+            mergeSplitResults(result.first, result.second, splitFiles);
+        }
+    }
+    int hasResult = splitFiles.empty() ? 0 : 1;
+
+    int timeCount = static_cast<int>(splitTimes.size());
+    int *timeCounts = NULL;
+    int *timeOffsets = NULL;
+    double *allTimes = NULL;
+    if (MMseqsMPI::isMaster()) {
+        timeCounts = new int[MMseqsMPI::numProc];
+        timeOffsets = new int[MMseqsMPI::numProc];
+    }
+    MPI_Gather(&timeCount, 1, MPI_INT, timeCounts, 1, MPI_INT, MMseqsMPI::MASTER, MPI_COMM_WORLD);
+    if (MMseqsMPI::isMaster()) {
+        int totalCount = 0;
+        for (int i = 0; i < MMseqsMPI::numProc; ++i) {
+            timeOffsets[i] = totalCount;
+            totalCount += timeCounts[i];
+        }
+        allTimes = new double[std::max(totalCount, 1)];
+    }
+    MPI_Gatherv(splitTimes.data(), timeCount, MPI_DOUBLE, allTimes, timeCounts, timeOffsets, MPI_DOUBLE, MMseqsMPI::MASTER, MPI_COMM_WORLD);
+    if (MMseqsMPI::isMaster()) {
+        for (int i = 0; i < MMseqsMPI::numProc; ++i) {
+            double busy = 0;
+            for (int j = timeOffsets[i]; j < timeOffsets[i] + timeCounts[i]; j += 2) {
+                Debug(Debug::INFO) << "Split " << static_cast<size_t>(allTimes[j]) << " on rank " << i << ": " << allTimes[j + 1] << "s\n";
+                busy += allTimes[j + 1];
+            }
+            Debug(Debug::INFO) << "Rank " << i << " processed " << (timeCounts[i] / 2) << " splits in " << busy << "s\n";
+        }
+        delete[] allTimes;
+        delete[] timeOffsets;
+        delete[] timeCounts;
+    }
 
     if (localTmpPath != "") {
         std::pair<std::string, std::string> resultShared = Util::createTmpFileNames(resultDB, resultDBIndex, MMseqsMPI::rank);
@@ -649,7 +759,7 @@ void Prefiltering::runMpiSplits(const std::string &resultDB, const std::string &
             // merge output databases
             mergePrefilterSplits(resultDB, resultDBIndex, splitFiles);
         } else {
-            DBWriter writer(resultDB.c_str(), resultDBIndex.c_str(), 1, compressed, Parameters::DBTYPE_PREFILTER_RES);
+            DBWriter writer(resultDB.c_str(), resultDBIndex.c_str(), 1, compressed, resultDbtype);
             writer.open();
             writer.close();
         }
@@ -692,20 +802,7 @@ int Prefiltering::runSplits(const std::string &resultDB, const std::string &resu
             }
         }
         if (splitFiles.size() > 0) {
-            mergePrefilterSplits(resultDB, resultDBIndex, splitFiles);
-            if (splitFiles.size() > 1) {
-                DBReader<unsigned int> resultReader(resultDB.c_str(), resultDBIndex.c_str(), threads, DBReader<unsigned int>::USE_INDEX | DBReader<unsigned int>::USE_DATA);
-                resultReader.open(DBReader<unsigned int>::NOSORT);
-                resultReader.readMmapedDataInMemory();
-                const std::pair<std::string, std::string> tempDb = Util::databaseNames(resultDB + "_tmp");
-                DBWriter resultWriter(tempDb.first.c_str(), tempDb.second.c_str(), threads, compressed, Parameters::DBTYPE_PREFILTER_RES);
-                resultWriter.open();
-                resultWriter.sortDatafileByIdOrder(resultReader);
-                resultWriter.close(true);
-                resultReader.close();
-                DBReader<unsigned int>::removeDb(resultDB);
-                DBReader<unsigned int>::moveDb(tempDb.first, resultDB);
-            }
+            mergeSplitResults(resultDB, resultDBIndex, splitFiles);
             hasResult = true;
         }
     } else if (splitProcessCount == 1) {
@@ -713,7 +810,7 @@ int Prefiltering::runSplits(const std::string &resultDB, const std::string &resu
             hasResult = true;
         }
     } else if (splitProcessCount == 0) {
-        DBWriter writer(resultDB.c_str(), resultDBIndex.c_str(), 1, compressed, Parameters::DBTYPE_PREFILTER_RES);
+        DBWriter writer(resultDB.c_str(), resultDBIndex.c_str(), 1, compressed, resultDbtype);
         writer.open();
         writer.close();
         hasResult = false;
@@ -722,6 +819,24 @@ int Prefiltering::runSplits(const std::string &resultDB, const std::string &resu
     return hasResult;
 }
 
+void Prefiltering::mergeSplitResults(const std::string &resultDB, const std::string &resultDBIndex,
+                                     const std::vector<std::pair<std::string, std::string>> &splitFiles) {
+    mergePrefilterSplits(resultDB, resultDBIndex, splitFiles);
+    if (splitFiles.size() > 1) {
+        DBReader<unsigned int> resultReader(resultDB.c_str(), resultDBIndex.c_str(), threads, DBReader<unsigned int>::USE_INDEX | DBReader<unsigned int>::USE_DATA);
+        resultReader.open(DBReader<unsigned int>::NOSORT);
+        resultReader.readMmapedDataInMemory();
+        const std::pair<std::string, std::string> tempDb = Util::databaseNames(resultDB + "_tmp");
+        DBWriter resultWriter(tempDb.first.c_str(), tempDb.second.c_str(), threads, compressed, resultDbtype);
+        resultWriter.open();
+        resultWriter.sortDatafileByIdOrder(resultReader);
+        resultWriter.close(true);
+        resultReader.close();
+        DBReader<unsigned int>::removeDb(resultDB);
+        DBReader<unsigned int>::moveDb(tempDb.first, resultDB);
+    }
+}
+
 bool Prefiltering::runSplit(const std::string &resultDB, const std::string &resultDBIndex, size_t split, bool merge) {
     Debug(Debug::INFO) << "Process prefiltering step " << (split + 1) << " of " << splits << "\n\n";
 
@@ -765,13 +880,15 @@ bool Prefiltering::runSplit(const std::string &resultDB, const std::string &resu
     size_t realResSize = 0;
     size_t diagonalOverflow = 0;
     size_t totalQueryDBSize = querySize;
+    const bool collectStatistics = Debug::debugLevel >= Debug::INFO || Telemetry::isEnabled();
 
     size_t localThreads = 1;
 #ifdef OPENMP
     localThreads = std::max(std::min((size_t)threads, querySize), (size_t)1);
 #endif
 
-    DBWriter tmpDbw(resultDB.c_str(), resultDBIndex.c_str(), localThreads, compressed, Parameters::DBTYPE_PREFILTER_RES);
+    DBWriter tmpDbw(resultDB.c_str(), resultDBIndex.c_str(), localThreads, compressed, resultDbtype);
+    const bool binaryResult = QueryMatcher::isBinaryPrefilterResult(resultDbtype);
     tmpDbw.open();
 
     // init all thread-specific data structures
@@ -787,6 +904,7 @@ bool Prefiltering::runSplit(const std::string &resultDB, const std::string &resu
     Debug(Debug::INFO) << "Query db start " << (queryFrom + 1) << " to " << queryFrom + querySize << "\n";
     Debug(Debug::INFO) << "Target db start " << (dbFrom + 1) << " to " << dbFrom + dbSize << "\n";
     Debug::Progress progress(querySize);
+    const size_t blockCount = (querySize + queryBatchSize - 1) / queryBatchSize;
 
 #pragma omp parallel num_threads(localThreads)
     {
@@ -794,100 +912,80 @@ bool Prefiltering::runSplit(const std::string &resultDB, const std::string &resu
 #ifdef OPENMP
         thread_idx = static_cast<unsigned int>(omp_get_thread_num());
 #endif
-        Sequence seq(qdbr->getMaxSeqLen(), querySeqType, kmerSubMat, kmerSize, spacedKmer, aaBiasCorrection, true, spacedKmerPattern);
-        QueryMatcher matcher(indexTable, sequenceLookup, kmerSubMat,  ungappedSubMat,
-                             kmerThr, kmerSize, dbSize, std::max(tdbr->getMaxSeqLen(),qdbr->getMaxSeqLen()), maxResListLen, aaBiasCorrection, aaBiasCorrectionScale,
-                             diagonalScoring, minDiagScoreThr, takeOnlyBestKmer, targetSeqType==Parameters::DBTYPE_NUCLEOTIDES);
-
-        if (seq.profile_matrix != NULL) {
-            matcher.setProfileMatrix(seq.profile_matrix);
-        } else if (_3merSubMatrix.isValid() && _2merSubMatrix.isValid()) {
-            matcher.setSubstitutionMatrix(&_3merSubMatrix, &_2merSubMatrix);
-        } else {
-            matcher.setSubstitutionMatrix(NULL, NULL);
-        }
-
-        if (taxonomyHook != NULL) {
-            matcher.setQueryMatcherHook(taxonomyHook);
-        }
+        Sequence *seq = createQuerySequence();
+        QueryMatcher *matcher = createQueryMatcher(seq, dbSize);
 
         char buffer[128];
         std::string result;
         result.reserve(1000000);
 
 #pragma omp for schedule(dynamic, 1) reduction (+: kmersPerPos, resSize, dbMatches, doubleMatches, querySeqLenSum, diagonalOverflow)
-        for (size_t id = queryFrom; id < queryFrom + querySize; id++) {
-            progress.updateProgress();
-            // get query sequence
-            char *seqData = qdbr->getData(id, thread_idx);
-            unsigned int qKey = qdbr->getDbKey(id);
-            seq.mapSequence(id, qKey, seqData, qdbr->getSeqLen(id));
-            size_t targetSeqId = UINT_MAX;
-            if (sameQTDB || includeIdentical) {
-                targetSeqId = tdbr->getId(seq.getDbKey());
-                // only the corresponding split should include the id (hack for the hack)
-                if (targetSeqId >= dbFrom && targetSeqId < (dbFrom + dbSize) && targetSeqId != UINT_MAX) {
-                    targetSeqId = targetSeqId - dbFrom;
-                    if(targetSeqId > tdbr->getSize()){
-                        Debug(Debug::ERROR) << "targetSeqId: " << targetSeqId << " > target database size: "  << tdbr->getSize() <<  "\n";
-                        EXIT(EXIT_FAILURE);
+        for (size_t block = 0; block < blockCount; block++) {
+            const size_t blockTo = std::min(queryFrom + (block + 1) * queryBatchSize, queryFrom + querySize);
+            size_t batchFrom = 0;
+            size_t batchTo = 0;
+            for (size_t id = queryFrom + block * queryBatchSize; id < blockTo; id++) {
+                progress.updateProgress();
+                size_t batchIdx = QueryMatcher::NO_BATCH;
+                if (queryBatchSize > 1) {
+                    if (id >= batchTo) {
+                        // look up the k-mers of as many of the following queries together as fit into a batch
+                        matcher->clearBatch();
+                        for (batchTo = id; batchTo < blockTo; batchTo++) {
+                            seq->mapSequence(batchTo, qdbr->getDbKey(batchTo), qdbr->getData(batchTo, thread_idx), qdbr->getSeqLen(batchTo));
+                            if (matcher->addBatchQuery(seq) == false) {
+                                break;
+                            }
+                        }
+                        batchFrom = id;
+                        matcher->fillBatch();
+                    }
+                    // a query that does not fit into a batch on its own is matched alone
+                    if (id < batchTo) {
+                        batchIdx = id - batchFrom;
                     }
-                }else{
-                    targetSeqId = UINT_MAX;
-                }
-            }
-            // calculate prefiltering results
-            if (taxonomyHook != NULL) {
-                taxonomyHook->setDbFrom(dbFrom);
-            }
-            std::pair<hit_t *, size_t> prefResults = matcher.matchQuery(&seq, targetSeqId, targetSeqType==Parameters::DBTYPE_NUCLEOTIDES);
-            size_t resultSize = prefResults.second;
-            const float queryLength = static_cast<float>(qdbr->getSeqLen(id));
-            for (size_t i = 0; i < resultSize; i++) {
-                hit_t *res = prefResults.first + i;
-                // correct the 0 indexed sequence id again to its real identifier
-                size_t targetSeqId1 = res->seqId + dbFrom;
-                // replace id with key
-                res->seqId = tdbr->getDbKey(targetSeqId1);
-                if (UNLIKELY(targetSeqId1 >= tdbr->getSize())) {
-                    Debug(Debug::WARNING) << "Wrong prefiltering result for query: " << qdbr->getDbKey(id) << " -> " << targetSeqId1 << "\t" << res->prefScore << "\n";
                 }
-
-                // TODO: check if this should happen when diagonalScoring == false
-                if (covThr > 0.0 && (covMode == Parameters::COV_MODE_BIDIRECTIONAL
-                                               || covMode == Parameters::COV_MODE_QUERY
-                                               || covMode == Parameters::COV_MODE_LENGTH_SHORTER )) {
-                    const float targetLength = static_cast<float>(tdbr->getSeqLen(targetSeqId1));
-                    if (Util::canBeCovered(covThr, covMode, queryLength, targetLength) == false) {
-                        continue;
+                size_t resultSize = 0;
+                std::pair<hit_t *, size_t> prefResults = matchQuery(*matcher, *seq, id, dbFrom, dbSize, thread_idx, resultSize, batchIdx);
+                if (binaryResult) {
+                    QueryMatcher::prefilterHitsToBinaryBuffer(result, prefResults.first, prefResults.second);
+                } else {
+                    for (size_t i = 0; i < prefResults.second; i++) {
+                        // write prefiltering results to a string
+                        size_t len = QueryMatcher::prefilterHitToBuffer(buffer, prefResults.first[i]);
+                        result.append(buffer, len);
                     }
                 }
+                tmpDbw.writeData(result.c_str(), result.length(), seq->getDbKey(), thread_idx);
+                result.clear();
 
-                // write prefiltering results to a string
-                int len = QueryMatcher::prefilterHitToBuffer(buffer, *res);
-                result.append(buffer, len);
-            }
-            tmpDbw.writeData(result.c_str(), result.length(), qKey, thread_idx);
-            result.clear();
-
-            // update statistics counters
-            if (resultSize != 0) {
-                notEmpty[id - queryFrom] = 1;
-            }
+                // update statistics counters
+                if (resultSize != 0) {
+                    notEmpty[id - queryFrom] = 1;
+                }
 
-            if (Debug::debugLevel >= Debug::INFO) {
-                kmersPerPos += matcher.getStatistics()->kmersPerPos;
-                dbMatches += matcher.getStatistics()->dbMatches;
-                doubleMatches += matcher.getStatistics()->doubleMatches;
-                querySeqLenSum += seq.L;
-                diagonalOverflow += matcher.getStatistics()->diagonalOverflow;
-                resSize += resultSize;
-                realResSize += std::min(resultSize, maxResListLen);
-                reslens[thread_idx]->emplace_back(resultSize);
+                if (collectStatistics) {
+                    kmersPerPos += matcher->getStatistics()->kmersPerPos;
+                    dbMatches += matcher->getStatistics()->dbMatches;
+                    doubleMatches += matcher->getStatistics()->doubleMatches;
+                    querySeqLenSum += seq->L;
+                    diagonalOverflow += matcher->getStatistics()->diagonalOverflow;
+                    resSize += resultSize;
+                    realResSize += std::min(resultSize, maxResListLen);
+                    reslens[thread_idx]->emplace_back(resultSize);
+                }
             }
         } // step end
+        delete matcher;
+        delete seq;
     }
 
+    Telemetry::addCounter("prefilter_queries", querySize);
+    Telemetry::addCounter("prefilter_db_matches", dbMatches);
+    Telemetry::addCounter("prefilter_double_matches", doubleMatches);
+    Telemetry::addCounter("prefilter_diagonal_overflows", diagonalOverflow);
+    Telemetry::addCounter("prefilter_results", resSize);
+
     if (Debug::debugLevel >= Debug::INFO) {
         statistics_t stats(kmersPerPos / static_cast<double>(totalQueryDBSize),
                            dbMatches / totalQueryDBSize,
@@ -933,7 +1031,7 @@ bool Prefiltering::runSplit(const std::string &resultDB, const std::string &resu
         resultReader.open(DBReader<unsigned int>::NOSORT);
         resultReader.readMmapedDataInMemory();
         const std::pair<std::string, std::string> tempDb = Util::databaseNames((resultDB + "_tmp"));
-        DBWriter resultWriter(tempDb.first.c_str(), tempDb.second.c_str(), localThreads, compressed, Parameters::DBTYPE_PREFILTER_RES);
+        DBWriter resultWriter(tempDb.first.c_str(), tempDb.second.c_str(), localThreads, compressed, resultDbtype);
         resultWriter.open();
         resultWriter.sortDatafileByIdOrder(resultReader);
         resultWriter.close(true);
@@ -952,6 +1050,106 @@ bool Prefiltering::runSplit(const std::string &resultDB, const std::string &resu
     return true;
 }
 
+Sequence *Prefiltering::createQuerySequence() {
+    return new Sequence(qdbr->getMaxSeqLen(), querySeqType, kmerSubMat, kmerSize, spacedKmer, aaBiasCorrection, true, spacedKmerPattern);
+}
+
+QueryMatcher *Prefiltering::createQueryMatcher(Sequence *seq, size_t dbSize) {
+    QueryMatcher *matcher = new QueryMatcher(indexTable, sequenceLookup, kmerSubMat,  ungappedSubMat,
+                                             kmerThr, kmerSize, dbSize, std::max(tdbr->getMaxSeqLen(),qdbr->getMaxSeqLen()), maxResListLen, aaBiasCorrection, aaBiasCorrectionScale,
+                                             diagonalScoring, minDiagScoreThr, takeOnlyBestKmer, targetSeqType==Parameters::DBTYPE_NUCLEOTIDES);
+
+    if (seq->profile_matrix != NULL) {
+        matcher->setProfileMatrix(seq->profile_matrix);
+    } else if (_3merSubMatrix.isValid() && _2merSubMatrix.isValid()) {
+        matcher->setSubstitutionMatrix(&_3merSubMatrix, &_2merSubMatrix);
+    } else {
+        matcher->setSubstitutionMatrix(NULL, NULL);
+    }
+
+    if (taxonomyHook != NULL) {
+        matcher->setQueryMatcherHook(taxonomyHook);
+    }
+    return matcher;
+}
+
+std::pair<hit_t *, size_t> Prefiltering::matchQuery(QueryMatcher &matcher, Sequence &seq, size_t id, size_t dbFrom, size_t dbSize,
+                                                    unsigned int thread_idx, size_t &resultSize, size_t batchIdx) {
+    // get query sequence
+    char *seqData = qdbr->getData(id, thread_idx);
+    unsigned int qKey = qdbr->getDbKey(id);
+    seq.mapSequence(id, qKey, seqData, qdbr->getSeqLen(id));
+    size_t targetSeqId = UINT_MAX;
+    if (sameQTDB || includeIdentical) {
+        targetSeqId = tdbr->getId(seq.getDbKey());
+        // only the corresponding split should include the id (hack for the hack)
+        if (targetSeqId >= dbFrom && targetSeqId < (dbFrom + dbSize) && targetSeqId != UINT_MAX) {
+            targetSeqId = targetSeqId - dbFrom;
+            if(targetSeqId > tdbr->getSize()){
+                Debug(Debug::ERROR) << "targetSeqId: " << targetSeqId << " > target database size: "  << tdbr->getSize() <<  "\n";
+                EXIT(EXIT_FAILURE);
+            }
+        }else{
+            targetSeqId = UINT_MAX;
+        }
+    }
+    // calculate prefiltering results
+    if (taxonomyHook != NULL) {
+        taxonomyHook->setDbFrom(dbFrom);
+    }
+    std::pair<hit_t *, size_t> prefResults = matcher.matchQuery(&seq, targetSeqId, targetSeqType==Parameters::DBTYPE_NUCLEOTIDES, batchIdx);
+    resultSize = prefResults.second;
+    size_t passedSize = 0;
+    const float queryLength = static_cast<float>(qdbr->getSeqLen(id));
+    for (size_t i = 0; i < resultSize; i++) {
+        hit_t *res = prefResults.first + i;
+        // correct the 0 indexed sequence id again to its real identifier
+        size_t targetSeqId1 = res->seqId + dbFrom;
+        // replace id with key
+        res->seqId = tdbr->getDbKey(targetSeqId1);
+        if (UNLIKELY(targetSeqId1 >= tdbr->getSize())) {
+            Debug(Debug::WARNING) << "Wrong prefiltering result for query: " << qKey << " -> " << targetSeqId1 << "\t" << res->prefScore << "\n";
+        }
+
+        // TODO: check if this should happen when diagonalScoring == false
+        if (covThr > 0.0 && (covMode == Parameters::COV_MODE_BIDIRECTIONAL
+                                       || covMode == Parameters::COV_MODE_QUERY
+                                       || covMode == Parameters::COV_MODE_LENGTH_SHORTER )) {
+            const float targetLength = static_cast<float>(tdbr->getSeqLen(targetSeqId1));
+            if (Util::canBeCovered(covThr, covMode, queryLength, targetLength) == false) {
+                continue;
+            }
+        }
+        prefResults.first[passedSize++] = *res;
+    }
+    return std::make_pair(prefResults.first, passedSize);
+}
+
+void Prefiltering::initFusedSearch() {
+    if (splitMode == Parameters::TARGET_DB_SPLIT) {
+        if (splits > 1) {
+            Debug(Debug::ERROR) << "Fused search needs the index table of the whole target database, but it was split into " << splits << " parts.\n"
+                                << "Increase --split-memory-limit or run prefilter and align separately.\n";
+            EXIT(EXIT_FAILURE);
+        }
+        if (indexTable == NULL) {
+            getIndexTable(0, 0, tdbr->getSize());
+        }
+    }
+    Debug(Debug::INFO) << "k-mer similarity threshold: " << kmerThr << "\n";
+}
+
+void Prefiltering::setQueryDb(const std::string &queryDB, const std::string &queryDBIndex) {
+    if (qdbr != NULL && qdbr != tdbr) {
+        qdbr->close();
+        delete qdbr;
+    }
+    qdbr = new DBReader<unsigned int>(queryDB.c_str(), queryDBIndex.c_str(), threads, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
+    qdbr->open(DBReader<unsigned int>::LINEAR_ACCCESS);
+    // the query batches are always read separately, even if they name the target database
+    sameQTDB = false;
+}
+
 void Prefiltering::printStatistics(const statistics_t &stats, std::list<int> **reslens,
                                    unsigned int resLensSize, size_t empty, size_t maxResults) {
     // sort and merge the result list lengths (for median calculation)
@@ -998,7 +1196,7 @@ BaseMatrix *Prefiltering::getSubstitutionMatrix(const MultiParam<NuclAA<std::str
 void Prefiltering::mergePrefilterSplits(const std::string &outDB, const std::string &outDBIndex,
                               const std::vector<std::pair<std::string, std::string>> &splitFiles) {
     if (splitMode == Parameters::TARGET_DB_SPLIT) {
-        mergeTargetSplits(outDB, outDBIndex, splitFiles, threads);
+        mergeTargetSplits(outDB, outDBIndex, splitFiles, threads, resultDbtype);
     } else if (splitMode == Parameters::QUERY_DB_SPLIT) {
         DBWriter::mergeResults(outDB, outDBIndex, splitFiles);
     }
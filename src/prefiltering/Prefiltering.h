@@ -60,7 +60,35 @@ public:
                                 const SeqProf<int> kmerScore, const int kmerSize);
 
     static void mergeTargetSplits(const std::string &outDB, const std::string &outDBIndex,
-                                  const std::vector<std::pair<std::string, std::string>> &fileNames, unsigned int threads);
+                                  const std::vector<std::pair<std::string, std::string>> &fileNames, unsigned int threads,
+                                  int resultDbtype = Parameters::DBTYPE_PREFILTER_RES);
+
+    // fused prefilter and alignment (prefilteralign) keeps the hits in memory instead of writing them
+    // the index table has to cover the whole target database
+    void initFusedSearch();
+
+    DBReader<unsigned int> *getQueryDbReader() {
+        return qdbr;
+    }
+
+    int getQuerySeqType() const {
+        return querySeqType;
+    }
+
+    // replaces the query database, the target index and the matrices stay loaded (used by searchserver)
+    void setQueryDb(const std::string &queryDB, const std::string &queryDBIndex);
+
+    Sequence *createQuerySequence();
+
+    QueryMatcher *createFusedQueryMatcher(Sequence *seq) {
+        return createQueryMatcher(seq, tdbr->getSize());
+    }
+
+    // hits of query id against the whole target database, only valid until the next call with the same matcher
+    std::pair<hit_t *, size_t> matchFusedQuery(QueryMatcher &matcher, Sequence &seq, size_t id, unsigned int thread_idx) {
+        size_t resultSize = 0;
+        return matchQuery(matcher, seq, id, 0, tdbr->getSize(), thread_idx, resultSize);
+    }
 
 private:
     const std::string queryDB;
@@ -112,10 +140,30 @@ private:
     int preloadMode;
     const unsigned int threads;
     int compressed;
+    // DBTYPE_PREFILTER_RES or DBTYPE_PREFILTER_BIN_RES
+    int resultDbtype;
+    const size_t queryBatchSize;
     QueryMatcherTaxonomyHook* taxonomyHook;
 
     bool runSplit(const std::string &resultDB, const std::string &resultDBIndex, size_t split, bool merge);
 
+    // merges the results of several splits and sorts them by query id
+    void mergeSplitResults(const std::string &resultDB, const std::string &resultDBIndex,
+                           const std::vector<std::pair<std::string, std::string>> &splitFiles);
+
+    QueryMatcher *createQueryMatcher(Sequence *seq, size_t dbSize);
+
+    // maps query id and computes its prefilter hits against the current index table
+    // target ids are replaced by keys and hits that cannot pass the coverage threshold are dropped
+    // resultSize is set to the number of hits before the coverage check
+    // batchIdx selects hits gathered by QueryMatcher::fillBatch
+    std::pair<hit_t *, size_t> matchQuery(QueryMatcher &matcher, Sequence &seq, size_t id, size_t dbFrom, size_t dbSize,
+                                          unsigned int thread_idx, size_t &resultSize, size_t batchIdx = QueryMatcher::NO_BATCH);
+
+    // binary records may contain null bytes, so the splits are merged through their index instead of scanning the data
+    static void mergeBinaryTargetSplits(const std::string &outDB, const std::string &outDBIndex,
+                                        const std::vector<std::pair<std::string, std::string>> &fileNames, unsigned int threads);
+
     // compute kmer size and split size for index table
     static std::pair<int, int> optimizeSplit(size_t totalMemoryInByte, DBReader<unsigned int> *tdbr, int alphabetSize, int kmerSize,
                                              unsigned int querySeqType, unsigned int threads);
@@ -5,8 +5,10 @@
 #include "FileUtil.h"
 #include "IndexBuilder.h"
 #include "Parameters.h"
+#include "EvalueComputation.h"
 
 extern const char* index_version_compatible;
+extern const char* MMSEQS_PACKED_INDEX_VERSION;
 unsigned int PrefilteringIndexReader::VERSION = 0;
 unsigned int PrefilteringIndexReader::META = 1;
 unsigned int PrefilteringIndexReader::SCOREMATRIXNAME = 2;
@@ -32,6 +34,8 @@ unsigned int PrefilteringIndexReader::GENERATOR = 22;
 unsigned int PrefilteringIndexReader::SPACEDPATTERN = 23;
 unsigned int PrefilteringIndexReader::ALNINDEX = 24;
 unsigned int PrefilteringIndexReader::ALNDATA = 25;
+unsigned int PrefilteringIndexReader::EVALUEPARAMS = 26;
+unsigned int PrefilteringIndexReader::ENTRIESPACKED = 27;
 
 extern const char* version;
 
@@ -40,7 +44,8 @@ bool PrefilteringIndexReader::checkIfIndexFile(DBReader<unsigned int>* reader) {
     if(version == NULL){
         return false;
     }
-    return (strncmp(version, index_version_compatible, strlen(index_version_compatible)) == 0 ) ? true : false;
+    return (strncmp(version, index_version_compatible, strlen(index_version_compatible)) == 0
+            || strncmp(version, MMSEQS_PACKED_INDEX_VERSION, strlen(MMSEQS_PACKED_INDEX_VERSION)) == 0) ? true : false;
 }
 
 std::string PrefilteringIndexReader::indexName(const std::string &outDB) {
@@ -57,7 +62,7 @@ void PrefilteringIndexReader::createIndexFile(const std::string &outDB,
                                               bool hasSpacedKmer, const std::string &spacedKmerPattern,
                                               bool compBiasCorrection, int alphabetSize, int kmerSize, int maskMode,
                                               int maskLowerCase, float maskProb, int kmerThr, int targetSearchMode, int splits,
-                                              int indexSubset) {
+                                              int indexSubset, const std::string &evalueParameters, bool packEntries) {
 
     const int SPLIT_META = splits > 1 ? 0 : 0;
     const int SPLIT_SEQS = splits > 1 ? 1 : 0;
@@ -67,7 +72,8 @@ void PrefilteringIndexReader::createIndexFile(const std::string &outDB,
     writer.open();
 
     Debug(Debug::INFO) << "Write VERSION (" << VERSION << ")\n";
-    writer.writeData((char *) index_version_compatible, strlen(index_version_compatible) * sizeof(char), VERSION, SPLIT_META);
+    const char *indexVersion = packEntries ? MMSEQS_PACKED_INDEX_VERSION : index_version_compatible;
+    writer.writeData((char *) indexVersion, strlen(indexVersion) * sizeof(char), VERSION, SPLIT_META);
     writer.alignToPageSize(SPLIT_META);
 
     Debug(Debug::INFO) << "Write META (" << META << ")\n";
@@ -100,6 +106,12 @@ void PrefilteringIndexReader::createIndexFile(const std::string &outDB,
     writer.writeData(version, strlen(version), GENERATOR, SPLIT_META);
     writer.alignToPageSize(SPLIT_META);
 
+    if (evalueParameters.empty() == false) {
+        Debug(Debug::INFO) << "Write EVALUEPARAMS (" << EVALUEPARAMS << ")\n";
+        writer.writeData(evalueParameters.c_str(), evalueParameters.length(), EVALUEPARAMS, SPLIT_META);
+        writer.alignToPageSize(SPLIT_META);
+    }
+
     Debug(Debug::INFO) << "Write DBR1INDEX (" << DBR1INDEX << ")\n";
     char* data = DBReader<unsigned int>::serialize(*dbr1);
     size_t offsetIndex = writer.getOffset(SPLIT_SEQS);
@@ -240,12 +252,44 @@ void PrefilteringIndexReader::createIndexFile(const std::string &outDB,
         }
 
         // save the entries
+        // the large tables start at huge page boundaries to allow mapping them with huge pages
         unsigned int keyOffset = 1000 * s;
-        Debug(Debug::INFO) << "Write ENTRIES (" << (keyOffset + ENTRIES) << ")\n";
-        char *entries = (char *) indexTable.getEntries();
-        size_t entriesSize = indexTable.getTableEntriesNum() * indexTable.getSizeOfEntry();
-        writer.writeData(entries, entriesSize, (keyOffset + ENTRIES), SPLIT_INDX + s);
-        writer.alignToPageSize(SPLIT_INDX + s);
+        writer.alignTo(Util::getHugePageSize(), SPLIT_INDX + s);
+        if (packEntries) {
+            // pack and write the lists in chunks, the packed table is never held in memory as a whole
+            // and the offsets are converted in place
+            const size_t tableSize = indexTable.getTableSize();
+            const size_t *offsets = indexTable.getOffsets();
+            const size_t chunkEntries = 8 * 1024 * 1024;
+            const size_t chunkKmers = 8 * 1024 * 1024;
+            Debug(Debug::INFO) << "Write ENTRIESPACKED (" << (keyOffset + ENTRIESPACKED) << ")\n";
+            std::vector<unsigned char> chunk;
+            size_t packedSize = 0;
+            writer.writeStart(SPLIT_INDX + s);
+            for (size_t start = 0; start < tableSize;) {
+                const size_t *last = offsets + std::min(start + chunkKmers, tableSize);
+                size_t end = std::upper_bound(offsets + start + 1, last + 1, offsets[start] + chunkEntries) - offsets - 1;
+                end = std::max(end, start + 1);
+                indexTable.packRange(start, end, packedSize, chunk);
+                writer.writeAdd((char *) chunk.data(), chunk.size(), SPLIT_INDX + s);
+                packedSize += chunk.size();
+                start = end;
+            }
+            // the decoder reads up to PACKED_PADDING bytes past the end of the last list
+            chunk.assign(IndexTable::PACKED_PADDING, 0);
+            writer.writeAdd((char *) chunk.data(), chunk.size(), SPLIT_INDX + s);
+            writer.writeEnd((keyOffset + ENTRIESPACKED), SPLIT_INDX + s);
+            indexTable.finishPacking(packedSize);
+            const size_t entriesSize = packedSize + IndexTable::PACKED_PADDING;
+            Debug(Debug::INFO) << "Packed entries:   " << entriesSize / 1024 / 1024 << " MB ("
+                               << ((double) entriesSize) / std::max(indexTable.getTableEntriesNum(), (uint64_t) 1) << " bytes per entry)\n";
+        } else {
+            Debug(Debug::INFO) << "Write ENTRIES (" << (keyOffset + ENTRIES) << ")\n";
+            char *entries = (char *) indexTable.getEntries();
+            size_t entriesSize = indexTable.getTableEntriesNum() * indexTable.getSizeOfEntry();
+            writer.writeData(entries, entriesSize, (keyOffset + ENTRIES), SPLIT_INDX + s);
+        }
+        writer.alignTo(Util::getHugePageSize(), SPLIT_INDX + s);
 
         // save the size
         Debug(Debug::INFO) << "Write ENTRIESOFFSETS (" << (keyOffset + ENTRIESOFFSETS) << ")\n";
@@ -265,7 +309,7 @@ void PrefilteringIndexReader::createIndexFile(const std::string &outDB,
         size_t sequenceCount = sequenceLookup->getSequenceCount();
         Debug(Debug::INFO) << "Write SEQINDEXSEQOFFSET (" << (keyOffset + SEQINDEXSEQOFFSET) << ")\n";
         writer.writeData((char *) sequenceOffsets, (sequenceCount + 1) * sizeof(size_t), (keyOffset + SEQINDEXSEQOFFSET), SPLIT_INDX + s);
-        writer.alignToPageSize(SPLIT_INDX + s);
+        writer.alignTo(Util::getHugePageSize(), SPLIT_INDX + s);
 
         Debug(Debug::INFO) << "Write SEQINDEXDATA (" << (keyOffset + SEQINDEXDATA) << ")\n";
         writer.writeData(sequenceLookup->getData(), (sequenceLookup->getDataSize() + 1) * sizeof(char), (keyOffset + SEQINDEXDATA), SPLIT_INDX + s);
@@ -351,6 +395,40 @@ DBReader<unsigned int> *PrefilteringIndexReader::openNewReader(DBReader<unsigned
     return reader;
 }
 
+std::pair<size_t, size_t> PrefilteringIndexReader::getHugePageMappedSize(const char *address) {
+    size_t hugePageSize = 0;
+    size_t residentSize = 0;
+#ifdef __linux__
+    FILE *smaps = fopen("/proc/self/smaps", "r");
+    if (smaps == NULL) {
+        return std::make_pair(hugePageSize, residentSize);
+    }
+    const uintptr_t target = reinterpret_cast<uintptr_t>(address);
+    bool inMapping = false;
+    char line[1024];
+    while (fgets(line, sizeof(line), smaps) != NULL) {
+        unsigned long start, end;
+        if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+            inMapping = (target >= start && target < end);
+            continue;
+        }
+        if (inMapping == false) {
+            continue;
+        }
+        unsigned long kb;
+        if (sscanf(line, "FilePmdMapped: %lu kB", &kb) == 1 || sscanf(line, "AnonHugePages: %lu kB", &kb) == 1) {
+            hugePageSize += kb * 1024;
+        } else if (sscanf(line, "Rss: %lu kB", &kb) == 1) {
+            residentSize += kb * 1024;
+        }
+    }
+    fclose(smaps);
+#else
+    (void) address;
+#endif
+    return std::make_pair(hugePageSize, residentSize);
+}
+
 SequenceLookup *PrefilteringIndexReader::getSequenceLookup(unsigned int split, DBReader<unsigned int> *dbr, int preloadMode) {
     PrefilteringIndexData data = getMetadata(dbr);
     if (split >= (unsigned int)data.splits) {
@@ -382,7 +460,7 @@ SequenceLookup *PrefilteringIndexReader::getSequenceLookup(unsigned int split, D
         return sequenceLookup;
     }
 
-    if (preloadMode == Parameters::PRELOAD_MODE_MMAP_TOUCH) {
+    if (preloadMode == Parameters::PRELOAD_MODE_MMAP_TOUCH || preloadMode == Parameters::PRELOAD_MODE_MMAP_HUGEPAGE) {
         dbr->touchData(id);
         dbr->touchData(seqOffsetsId);
     }
@@ -405,7 +483,12 @@ IndexTable *PrefilteringIndexReader::getIndexTable(unsigned int split, DBReader<
     size_t sequenceCountId = dbr->getId(splitOffset +SEQCOUNT);
     size_t sequenceCount = *((size_t *)dbr->getDataUncompressed(sequenceCountId));
 
-    size_t entriesDataId = dbr->getId(splitOffset + ENTRIES);
+    // packed indexes store ENTRIESPACKED instead of ENTRIES
+    size_t entriesDataId = dbr->getId(splitOffset + ENTRIESPACKED);
+    const bool packed = (entriesDataId != UINT_MAX);
+    if (packed == false) {
+        entriesDataId = dbr->getId(splitOffset + ENTRIES);
+    }
     char *entriesData = dbr->getDataUncompressed(entriesDataId);
 
     size_t entriesOffsetsDataId = dbr->getId(splitOffset + ENTRIESOFFSETS);
@@ -420,19 +503,33 @@ IndexTable *PrefilteringIndexReader::getIndexTable(unsigned int split, DBReader<
 
     if (preloadMode == Parameters::PRELOAD_MODE_FREAD) {
         IndexTable* table = new IndexTable(adjustAlphabetSize, data.kmerSize, false);
-        table->initTableByExternalDataCopy(sequenceCount, entriesNum, (IndexEntryLocal*) entriesData, (size_t *)entriesOffsetsData);
+        if (packed) {
+            table->initPackedTableByExternalDataCopy(sequenceCount, entriesNum, (unsigned char *) entriesData, (size_t *)entriesOffsetsData);
+        } else {
+            table->initTableByExternalDataCopy(sequenceCount, entriesNum, (IndexEntryLocal*) entriesData, (size_t *)entriesOffsetsData);
+        }
         return table;
     }
 
-    if (preloadMode == Parameters::PRELOAD_MODE_MMAP_TOUCH) {
+    if (preloadMode == Parameters::PRELOAD_MODE_MMAP_TOUCH || preloadMode == Parameters::PRELOAD_MODE_MMAP_HUGEPAGE) {
         dbr->touchData(entriesNumId);
         dbr->touchData(sequenceCountId);
         dbr->touchData(entriesDataId);
         dbr->touchData(entriesOffsetsDataId);
     }
 
+    if (preloadMode == Parameters::PRELOAD_MODE_MMAP_HUGEPAGE) {
+        std::pair<size_t, size_t> mapped = getHugePageMappedSize(entriesData);
+        Debug(Debug::INFO) << "Index mapped with huge pages: " << (mapped.first >> 20) << " MB of "
+                           << (mapped.second >> 20) << " MB resident\n";
+    }
+
     IndexTable* table = new IndexTable(adjustAlphabetSize, data.kmerSize, true);
-    table->initTableByExternalData(sequenceCount, entriesNum, (IndexEntryLocal*) entriesData, (size_t *)entriesOffsetsData);
+    if (packed) {
+        table->initPackedTableByExternalData(sequenceCount, entriesNum, (unsigned char *) entriesData, (size_t *)entriesOffsetsData);
+    } else {
+        table->initTableByExternalData(sequenceCount, entriesNum, (IndexEntryLocal*) entriesData, (size_t *)entriesOffsetsData);
+    }
     return table;
 }
 
@@ -534,6 +631,14 @@ std::string PrefilteringIndexReader::getSpacedPattern(DBReader<unsigned int> *db
     return std::string(dbr->getDataUncompressed(id));
 }
 
+void PrefilteringIndexReader::loadEvalueParameters(DBReader<unsigned int> *dbr) {
+    size_t id = dbr->getId(EVALUEPARAMS);
+    if (id == UINT_MAX) {
+        return;
+    }
+    EvalueComputation::addCacheEntries(dbr->getDataUncompressed(id), dbr->getEntryLen(id));
+}
+
 ScoreMatrix PrefilteringIndexReader::get2MerScoreMatrix(DBReader<unsigned int> *dbr, int preloadMode) {
     size_t id = dbr->getId(SCOREMATRIX2MER);
     if (id == UINT_MAX) {
@@ -548,7 +653,7 @@ ScoreMatrix PrefilteringIndexReader::get2MerScoreMatrix(DBReader<unsigned int> *
         return ScoreMatrix::unserializeCopy(data, meta.alphabetSize-1, 2);
     }
 
-    if (preloadMode == Parameters::PRELOAD_MODE_MMAP_TOUCH) {
+    if (preloadMode == Parameters::PRELOAD_MODE_MMAP_TOUCH || preloadMode == Parameters::PRELOAD_MODE_MMAP_HUGEPAGE) {
         dbr->touchData(id);
     }
     return ScoreMatrix::unserialize(data, meta.alphabetSize-1, 2);
@@ -568,7 +673,7 @@ ScoreMatrix PrefilteringIndexReader::get3MerScoreMatrix(DBReader<unsigned int> *
         return ScoreMatrix::unserializeCopy(data, meta.alphabetSize-1, 3);
     }
 
-    if (preloadMode == Parameters::PRELOAD_MODE_MMAP_TOUCH) {
+    if (preloadMode == Parameters::PRELOAD_MODE_MMAP_TOUCH || preloadMode == Parameters::PRELOAD_MODE_MMAP_HUGEPAGE) {
         dbr->touchData(id);
     }
     return ScoreMatrix::unserialize(data, meta.alphabetSize-1, 3);
@@ -50,6 +50,8 @@ public:
     static unsigned int SPACEDPATTERN;
     static unsigned int ALNINDEX;
     static unsigned int ALNDATA;
+    static unsigned int EVALUEPARAMS;
+    static unsigned int ENTRIESPACKED;
 
     static bool checkIfIndexFile(DBReader<unsigned int> *reader);
     static std::string indexName(const std::string &outDB);
@@ -60,7 +62,8 @@ public:
                                 DBReader<unsigned int> *alndbr,
                                 BaseMatrix *seedSubMat, int maxSeqLen, bool spacedKmer, const std::string &spacedKmerPattern,
                                 bool compBiasCorrection, int alphabetSize, int kmerSize, int maskMode,
-                                int maskLowerCase, float maskProb, int kmerThr, int targetSearchMode, int splits, int indexSubset = 0);
+                                int maskLowerCase, float maskProb, int kmerThr, int targetSearchMode, int splits, int indexSubset = 0,
+                                const std::string &evalueParameters = "", bool packEntries = false);
 
     static DBReader<unsigned int> *openNewHeaderReader(DBReader<unsigned int>*dbr, unsigned int dataIdx, unsigned int indexIdx, int threads, bool touchIndex, bool touchData);
 
@@ -68,6 +71,9 @@ public:
 
     static SequenceLookup *getSequenceLookup(unsigned int split, DBReader<unsigned int> *dbr, int preloadMode);
 
+    // bytes of the mapping containing address that are backed by huge pages and that are resident
+    static std::pair<size_t, size_t> getHugePageMappedSize(const char *address);
+
     static IndexTable *getIndexTable(unsigned int split, DBReader<unsigned int> *dbr, int preloadMode);
 
     static void printSummary(DBReader<unsigned int> *dbr);
@@ -80,6 +86,9 @@ public:
 
     static std::string getSpacedPattern(DBReader<unsigned int> *dbr);
 
+    // makes the E-value parameters stored by createindex available to EvalueComputation
+    static void loadEvalueParameters(DBReader<unsigned int> *dbr);
+
     static ScoreMatrix get2MerScoreMatrix(DBReader<unsigned int> *dbr, int preloadMode);
 
     static ScoreMatrix get3MerScoreMatrix(DBReader<unsigned int> *dbr, int preloadMode);
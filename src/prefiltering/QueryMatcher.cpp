@@ -49,6 +49,9 @@ QueryMatcher::QueryMatcher(IndexTable *indexTable, SequenceLookup *sequenceLooku
     this->foundDiagonals = (CounterResult*)calloc(foundDiagonalsSize, sizeof(CounterResult));
     Util::checkAllocation(foundDiagonals, "Can not allocate foundDiagonals memory in QueryMatcher");
     this->lastSequenceHit = this->databaseHits + maxDbMatches;
+    // batch k-mers need at most as much memory as databaseHits
+    this->maxBatchKmers = maxDbMatches / 4;
+    this->batchHitCount = 0;
     this->indexPointer = new(std::nothrow) IndexEntryLocal*[maxSeqLen + 1];
     Util::checkAllocation(indexPointer, "Can not allocate indexPointer memory in QueryMatcher");
     this->diagonalScoring = diagonalScoring;
@@ -82,12 +85,7 @@ QueryMatcher::~QueryMatcher(){
     delete kmerGenerator;
 }
 
-std::pair<hit_t*, size_t> QueryMatcher::matchQuery(Sequence *querySeq, unsigned int identityId, bool isNucleotide) {
-    querySeq->resetCurrPos();
-//    std::cout << "Id: " << querySeq->getId() << std::endl;
-    memset(scoreSizes, 0, SCORE_RANGE * sizeof(unsigned int));
-
-    // bias correction
+void QueryMatcher::computeCompositionBias(Sequence *querySeq) {
     if(aaBiasCorrection == true){
         if(Parameters::isEqualDbtype(querySeq->getSeqType(), Parameters::DBTYPE_AMINO_ACIDS)) {
             SubstitutionMatrix::calcLocalAaBiasCorrection(kmerSubMat, querySeq->numSequence, querySeq->L, compositionBias, scaleBiasCorr);
@@ -97,8 +95,17 @@ std::pair<hit_t*, size_t> QueryMatcher::matchQuery(Sequence *querySeq, unsigned
     } else {
         memset(compositionBias, 0, sizeof(float) * querySeq->L);
     }
+}
+
+std::pair<hit_t*, size_t> QueryMatcher::matchQuery(Sequence *querySeq, unsigned int identityId, bool isNucleotide, size_t batchIdx) {
+    querySeq->resetCurrPos();
+//    std::cout << "Id: " << querySeq->getId() << std::endl;
+    memset(scoreSizes, 0, SCORE_RANGE * sizeof(unsigned int));
+
+    // bias correction
+    computeCompositionBias(querySeq);
 
-    size_t resultSize = match(querySeq, compositionBias);
+    size_t resultSize = (batchIdx == NO_BATCH) ? match(querySeq, compositionBias) : matchBatch(querySeq, batchIdx);
     if (hook != NULL) {
         resultSize = hook->afterDiagonalMatchingHook(*this, resultSize);
     }
@@ -262,7 +269,7 @@ size_t QueryMatcher::match(Sequence *seq, float *compositionBias) {
         kmerListLen += kmerElementSize;
 
         for (unsigned int kmerPos = 0; kmerPos < kmerElementSize; kmerPos++) {
-            const IndexEntryLocal *entries = indexTable->getDBSeqList(index[kmerPos], &seqListSize);
+            seqListSize = indexTable->getDBSeqListSize(index[kmerPos]);
             // DEBUG
             //std::cout << seq->getDbKey() << std::endl;
             //idx.printKmer(index[kmerPos], kmerSize, kmerSubMat->num2aa);
@@ -310,7 +317,7 @@ size_t QueryMatcher::match(Sequence *seq, float *compositionBias) {
                     goto outer;
                 }
             }
-            memcpy(sequenceHits, entries, sizeof(IndexEntryLocal) * seqListSize);
+            indexTable->copyDBSeqList(index[kmerPos], sequenceHits);
             sequenceHits += seqListSize;
             numMatches += seqListSize;
         }
@@ -338,6 +345,114 @@ size_t QueryMatcher::match(Sequence *seq, float *compositionBias) {
     return hitCount;
 }
 
+void QueryMatcher::clearBatch() {
+    batchKmers.clear();
+    batchPositions.clear();
+    batchQueries.clear();
+    batchHitCount = 0;
+}
+
+bool QueryMatcher::addBatchQuery(Sequence *seq) {
+    seq->resetCurrPos();
+    computeCompositionBias(seq);
+
+    const size_t kmerFrom = batchKmers.size();
+    const size_t positionFrom = batchPositions.size();
+    size_t hitOffset = batchHitCount;
+    size_t kmerListLen = 0;
+    unsigned short indexTo = 0;
+    // same k-mer generation as in match, but the lists are only reserved in databaseHits
+    while (seq->hasNextKmer()) {
+        const unsigned char *kmer = seq->nextKmer();
+        const unsigned char *pos = seq->getAAPosInSpacedPattern();
+        const unsigned short current_i = seq->getCurrentPosition();
+
+        float biasCorrection = 0;
+        for (int i = 0; i < kmerSize; i++){
+            biasCorrection += compositionBias[current_i + static_cast<short>(pos[i])];
+        }
+        batchPositions.emplace_back(current_i, hitOffset);
+        indexTo = current_i;
+        if (seq->kmerContainsX()) {
+            continue;
+        }
+        short bias = static_cast<short>((biasCorrection < 0.0) ? biasCorrection - 0.5: biasCorrection + 0.5);
+        short kmerMatchScore = std::max(kmerThr - bias, 0);
+        kmerGenerator->setThreshold(kmerMatchScore);
+
+        const size_t *index;
+        size_t exactKmer;
+        size_t kmerElementSize;
+        if (takeOnlyBestKmer) {
+            kmerElementSize = 1;
+            exactKmer = idx.int2index(kmer);
+            index = &exactKmer;
+        } else {
+            std::pair<size_t*, size_t> kmerList = kmerGenerator->generateKmerList(kmer);
+            kmerElementSize = kmerList.second;
+            index = kmerList.first;
+        }
+        kmerListLen += kmerElementSize;
+        for (size_t kmerPos = 0; kmerPos < kmerElementSize; kmerPos++) {
+            const size_t seqListSize = indexTable->getDBSeqListSize(index[kmerPos]);
+            if (seqListSize == 0) {
+                continue;
+            }
+            BatchKmer entry = { index[kmerPos], hitOffset };
+            batchKmers.push_back(entry);
+            hitOffset += seqListSize;
+        }
+    }
+
+    // a query that overflows databaseHits on its own has to go through match
+    if (hitOffset >= maxDbMatches || batchKmers.size() > maxBatchKmers) {
+        batchKmers.resize(kmerFrom);
+        batchPositions.resize(positionFrom);
+        return false;
+    }
+    BatchQuery query = { positionFrom, batchPositions.size(), batchHitCount, hitOffset, kmerListLen, indexTo };
+    batchQueries.push_back(query);
+    batchHitCount = hitOffset;
+    return true;
+}
+
+void QueryMatcher::fillBatch() {
+    // visit the index table lists in memory order, each list is read once per batch
+    SORT_SERIAL(batchKmers.begin(), batchKmers.end(), BatchKmer::compareByKmer);
+    const IndexEntryLocal *entries = NULL;
+    size_t seqListSize = 0;
+    for (size_t i = 0; i < batchKmers.size(); i++) {
+        IndexEntryLocal *hits = databaseHits + batchKmers[i].hitOffset;
+        if (i == 0 || batchKmers[i].kmer != batchKmers[i - 1].kmer) {
+            // packed lists are decoded once and copied from the first decoded list for repeated k-mers
+            seqListSize = indexTable->getDBSeqListSize(batchKmers[i].kmer);
+            indexTable->copyDBSeqList(batchKmers[i].kmer, hits);
+            entries = hits;
+        } else {
+            memcpy(hits, entries, sizeof(IndexEntryLocal) * seqListSize);
+        }
+    }
+}
+
+size_t QueryMatcher::matchBatch(Sequence *seq, size_t batchIdx) {
+    const BatchQuery &query = batchQueries[batchIdx];
+    for (size_t i = query.positionFrom; i < query.positionTo; i++) {
+        indexPointer[batchPositions[i].first] = databaseHits + batchPositions[i].second;
+    }
+    indexPointer[query.indexTo + 1] = databaseHits + query.hitTo;
+    stats->diagonalOverflow = false;
+    size_t hitCount = findDuplicates(indexPointer, foundDiagonals, foundDiagonalsSize, 0, query.indexTo, (diagonalScoring == false));
+    stats->doubleMatches = 0;
+    if (diagonalScoring == false) {
+        updateScoreBins(foundDiagonals, hitCount);
+        stats->doubleMatches = getDoubleDiagonalMatches();
+    }
+    stats->kmersPerPos = ((double)query.kmerListLen/(double)seq->L);
+    stats->querySeqLen = seq->L;
+    stats->dbMatches   = query.hitTo - query.hitFrom;
+    return hitCount;
+}
+
 size_t QueryMatcher::getDoubleDiagonalMatches(){
     size_t retValue = 0;
     for(size_t i = 1; i < SCORE_RANGE; i++){
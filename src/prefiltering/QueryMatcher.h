@@ -6,6 +6,7 @@
 #define MMSEQS_QUERYTEMPLATEMATCHEREXACTMATCH_H
 
 #include <cstdlib>
+#include <vector>
 #include "itoa.h"
 #include "EvalueComputation.h"
 #include "CacheFriendlyOperations.h"
@@ -48,6 +49,13 @@ struct hit_t {
     }
 };
 
+// on-disk record of binary prefilter results, packed so that it needs 10 bytes instead of 12
+struct __attribute__((__packed__)) hit_bin_t {
+    unsigned int seqId;
+    int prefScore;
+    unsigned short diagonal;
+};
+
 class QueryMatcherHook;
 
 class QueryMatcher {
@@ -59,9 +67,22 @@ public:
                  unsigned int minDiagScoreThr, bool takeOnlyBestKmer, bool isNucleotide);
     ~QueryMatcher();
 
+    static const size_t NO_BATCH = static_cast<size_t>(-1);
+
     // returns result for the sequence
     // identityId is the id of the identitical sequence in the target database if there is any, UINT_MAX otherwise
-    std::pair<hit_t*, size_t> matchQuery(Sequence *querySeq, unsigned int identityId,  bool isNucleotide);
+    // batchIdx selects the hits gathered by fillBatch for this query, otherwise the query is matched on its own
+    std::pair<hit_t*, size_t> matchQuery(Sequence *querySeq, unsigned int identityId, bool isNucleotide, size_t batchIdx = NO_BATCH);
+
+    // batched k-mer matching: the similar k-mers of several queries are sorted so that each
+    // index table list is read once for all of them instead of once per query
+    void clearBatch();
+
+    // generates the similar k-mers of querySeq, returns false without adding it if its hits do not fit into the batch
+    bool addBatchQuery(Sequence *querySeq);
+
+    // copies the index table hits of the added queries into databaseHits
+    void fillBatch();
 
     void setQueryMatcherHook(QueryMatcherHook* hook) {
         this->hook = hook;
@@ -129,6 +150,62 @@ public:
         return tmpBuff - basePos;
     }
 
+    // binary prefilter results (DBTYPE_PREFILTER_BIN_RES) store an unsigned int hit count followed by hit_bin_t records
+    static bool isBinaryPrefilterResult(int dbtype) {
+        return Parameters::isEqualDbtype(dbtype, Parameters::DBTYPE_PREFILTER_BIN_RES);
+    }
+
+    // appends a complete binary entry, nothing is appended for an empty hit list
+    static void prefilterHitsToBinaryBuffer(std::string &out, const hit_t *hits, size_t hitCount) {
+        if (hitCount == 0) {
+            return;
+        }
+        const unsigned int count = static_cast<unsigned int>(hitCount);
+        out.append(reinterpret_cast<const char *>(&count), sizeof(unsigned int));
+        for (size_t i = 0; i < hitCount; ++i) {
+            hit_bin_t record = { hits[i].seqId, hits[i].prefScore, hits[i].diagonal };
+            out.append(reinterpret_cast<const char *>(&record), sizeof(hit_bin_t));
+        }
+    }
+
+    // entryLength as returned by DBReader::getEntryLen, the count is read from the (decompressed) data
+    static unsigned int getBinaryPrefilterHitCount(const char *data, size_t entryLength) {
+        if (entryLength <= sizeof(unsigned int)) {
+            return 0;
+        }
+        unsigned int count;
+        memcpy(&count, data, sizeof(unsigned int));
+        return count;
+    }
+
+    static const hit_bin_t *getBinaryPrefilterHits(const char *data) {
+        return reinterpret_cast<const hit_bin_t *>(data + sizeof(unsigned int));
+    }
+
+    static void parsePrefilterHits(char *data, size_t entryLength, bool isBinary, std::vector<hit_t> &entries) {
+        if (isBinary) {
+            const hit_bin_t *hits = getBinaryPrefilterHits(data);
+            const unsigned int hitCount = getBinaryPrefilterHitCount(data, entryLength);
+            for (unsigned int i = 0; i < hitCount; ++i) {
+                hit_t hit = { hits[i].seqId, hits[i].prefScore, hits[i].diagonal };
+                entries.push_back(hit);
+            }
+        } else {
+            parsePrefilterHits(data, entries);
+        }
+    }
+
+    static void binaryPrefilterHitsToText(const char *data, size_t entryLength, std::string &result) {
+        char buffer[64];
+        const hit_bin_t *hits = getBinaryPrefilterHits(data);
+        const unsigned int hitCount = getBinaryPrefilterHitCount(data, entryLength);
+        for (unsigned int i = 0; i < hitCount; ++i) {
+            hit_t hit = { hits[i].seqId, hits[i].prefScore, hits[i].diagonal };
+            size_t len = prefilterHitToBuffer(buffer, hit);
+            result.append(buffer, len);
+        }
+    }
+
 protected:
     const static int KMER_SCORE = 0;
     const static int UNGAPPED_DIAGONAL_SCORE = 1;
@@ -201,6 +278,44 @@ protected:
 
     QueryMatcherHook* hook;
 
+    struct BatchKmer {
+        size_t kmer;
+        // where its index table list is copied to in databaseHits
+        size_t hitOffset;
+
+        static bool compareByKmer(const BatchKmer &first, const BatchKmer &second) {
+            if (first.kmer < second.kmer)
+                return true;
+            if (second.kmer < first.kmer)
+                return false;
+            return first.hitOffset < second.hitOffset;
+        }
+    };
+
+    struct BatchQuery {
+        // range of the query in batchPositions
+        size_t positionFrom;
+        size_t positionTo;
+        // range of the query hits in databaseHits
+        size_t hitFrom;
+        size_t hitTo;
+        size_t kmerListLen;
+        unsigned short indexTo;
+    };
+
+    // similar k-mers with non-empty lists of the batch queries, sorted by k-mer in fillBatch
+    std::vector<BatchKmer> batchKmers;
+    // query position and the offset of its first hit in databaseHits
+    std::vector<std::pair<unsigned short, size_t>> batchPositions;
+    std::vector<BatchQuery> batchQueries;
+    size_t batchHitCount;
+    size_t maxBatchKmers;
+
+    void computeCompositionBias(Sequence *querySeq);
+
+    // sets up indexPointer from the gathered hits of a batch query and computes the diagonal hits
+    size_t matchBatch(Sequence *seq, size_t batchIdx);
+
     void updateScoreBins(CounterResult *result, size_t elementCount);
 
     static unsigned int computeScoreThreshold(unsigned int * scoreSizes, size_t maxHitsPerQuery) {
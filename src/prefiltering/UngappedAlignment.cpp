@@ -2,16 +2,19 @@
 // Created by mad on 12/15/15.
 
 #include "UngappedAlignment.h"
+#include "SimdDispatch.h"
 
 UngappedAlignment::UngappedAlignment(const unsigned int maxSeqLen,
                                      BaseMatrix *substitutionMatrix, SequenceLookup *sequenceLookup)
         : subMatrix(substitutionMatrix), sequenceLookup(sequenceLookup) {
-    score_arr = new unsigned int[DIAGONALBINSIZE];
+    kernel = UngappedAlignmentKernel::get();
+    binSize = kernel->binSize;
+    score_arr = new unsigned int[binSize];
     diagonalCounter = new unsigned char[DIAGONALCOUNT];
     queryProfile   = (char *) malloc_simd_int((Sequence::PROFILE_AA_SIZE + 1) * maxSeqLen);
     memset(queryProfile, 0, (Sequence::PROFILE_AA_SIZE + 1) * maxSeqLen);
     aaCorrectionScore = (char *) malloc_simd_int(maxSeqLen);
-    diagonalMatches = new CounterResult*[DIAGONALCOUNT * DIAGONALBINSIZE];
+    diagonalMatches = new CounterResult*[DIAGONALCOUNT * binSize];
 }
 
 UngappedAlignment::~UngappedAlignment() {
@@ -47,176 +50,6 @@ int UngappedAlignment::scalarDiagonalScoring(const char * profile,
     return max;
 }
 
-template <unsigned int T>
-void UngappedAlignment::unrolledDiagonalScoring(const char * profile,
-                                                const unsigned int * seqLen,
-                                                const unsigned char ** dbSeq,
-                                                unsigned int * max) {
-    unsigned int maxScores[DIAGONALBINSIZE];
-    simd_int zero = simdi32_set(0);
-    simd_int maxVec = simdi32_set(0);
-    simd_int score = simdi32_set(0);
-    for(unsigned int pos = 0; pos < seqLen[0]; pos++){
-        const char * profileColumn = (profile + pos * T);
-        int subScore0 =  profileColumn[dbSeq[0][pos]];
-        int subScore1 =  profileColumn[dbSeq[1][pos]];
-        int subScore2 =  profileColumn[dbSeq[2][pos]];
-        int subScore3 =  profileColumn[dbSeq[3][pos]];
-
-#ifdef AVX2
-        int subScore4 =  profileColumn[dbSeq[4][pos]];
-        int subScore5 =  profileColumn[dbSeq[5][pos]];
-        int subScore6 =  profileColumn[dbSeq[6][pos]];
-        int subScore7 =  profileColumn[dbSeq[7][pos]];
-        simd_int subScores = _mm256_set_epi32(subScore7, subScore6, subScore5, subScore4, subScore3, subScore2, subScore1, subScore0);
-#else
-        simd_int subScores = _mm_set_epi32(subScore3, subScore2, subScore1, subScore0);
-#endif
-        score = simdi32_add(score, subScores);
-        score = simdi32_max(score, zero);
-        //        std::cout << (int)((char *)&template01)[0] << "\t" <<  SSTR(((char *)&score_vec_8bit)[0]) << "\t" << SSTR(((char *)&vMaxScore)[0]) << "\t" << SSTR(((char *)&vscore)[0]) << std::endl;
-        maxVec = simdui8_max(maxVec, score);
-    }
-
-    for(unsigned int pos = seqLen[0]; pos < seqLen[1]; pos++){
-        const char * profileColumn = (profile + pos * T);
-        //int subScore0 =  profileColumn[dbSeq[0][pos]];
-        int subScore1 =  profileColumn[dbSeq[1][pos]];
-        int subScore2 =  profileColumn[dbSeq[2][pos]];
-        int subScore3 =  profileColumn[dbSeq[3][pos]];
-
-#ifdef AVX2
-        int subScore4 =  profileColumn[dbSeq[4][pos]];
-        int subScore5 =  profileColumn[dbSeq[5][pos]];
-        int subScore6 =  profileColumn[dbSeq[6][pos]];
-        int subScore7 =  profileColumn[dbSeq[7][pos]];
-        simd_int subScores = _mm256_set_epi32(subScore7, subScore6, subScore5, subScore4, subScore3, subScore2, subScore1, 0);
-#else
-        simd_int subScores = _mm_set_epi32(subScore3, subScore2, subScore1, 0);
-#endif
-        score = simdi32_add(score, subScores);
-        score = simdi32_max(score, zero);
-        //        std::cout << (int)((char *)&template01)[0] << "\t" <<  SSTR(((char *)&score_vec_8bit)[0]) << "\t" << SSTR(((char *)&vMaxScore)[0]) << "\t" << SSTR(((char *)&vscore)[0]) << std::endl;
-        maxVec = simdui8_max(maxVec, score);
-    }
-
-    for(unsigned int pos = seqLen[1]; pos < seqLen[2]; pos++){
-        const char * profileColumn = (profile + pos * T);
-        //int subScore0 =  profileColumn[dbSeq[0][pos]];
-        //int subScore1 =  profileColumn[dbSeq[1][pos]];
-        int subScore2 =  profileColumn[dbSeq[2][pos]];
-        int subScore3 =  profileColumn[dbSeq[3][pos]];
-
-#ifdef AVX2
-        int subScore4 =  profileColumn[dbSeq[4][pos]];
-        int subScore5 =  profileColumn[dbSeq[5][pos]];
-        int subScore6 =  profileColumn[dbSeq[6][pos]];
-        int subScore7 =  profileColumn[dbSeq[7][pos]];
-        simd_int subScores = _mm256_set_epi32(subScore7, subScore6, subScore5, subScore4, subScore3, subScore2, 0, 0);
-#else
-        simd_int subScores = _mm_set_epi32(subScore3, subScore2, 0, 0);
-#endif
-        score = simdi32_add(score, subScores);
-        score = simdi32_max(score, zero);
-        //        std::cout << (int)((char *)&template01)[0] << "\t" <<  SSTR(((char *)&score_vec_8bit)[0]) << "\t" << SSTR(((char *)&vMaxScore)[0]) << "\t" << SSTR(((char *)&vscore)[0]) << std::endl;
-        maxVec = simdui8_max(maxVec, score);
-    }
-
-    for(unsigned int pos = seqLen[2]; pos < seqLen[3]; pos++){
-        const char * profileColumn = (profile + pos * T);
-        //int subScore0 =  profileColumn[dbSeq[0][pos]];
-        //int subScore1 =  profileColumn[dbSeq[1][pos]];
-        //int subScore2 =  profileColumn[dbSeq[2][pos]];
-        int subScore3 =  profileColumn[dbSeq[3][pos]];
-
-#ifdef AVX2
-        int subScore4 =  profileColumn[dbSeq[4][pos]];
-        int subScore5 =  profileColumn[dbSeq[5][pos]];
-        int subScore6 =  profileColumn[dbSeq[6][pos]];
-        int subScore7 =  profileColumn[dbSeq[7][pos]];
-        simd_int subScores = _mm256_set_epi32(subScore7, subScore6, subScore5, subScore4, subScore3, 0, 0, 0);
-#else
-        simd_int subScores = _mm_set_epi32(subScore3, 0, 0, 0);
-#endif
-        score = simdi32_add(score, subScores);
-        score = simdi32_max(score, zero);
-        //        std::cout << (int)((char *)&template01)[0] << "\t" <<  SSTR(((char *)&score_vec_8bit)[0]) << "\t" << SSTR(((char *)&vMaxScore)[0]) << "\t" << SSTR(((char *)&vscore)[0]) << std::endl;
-        maxVec = simdui8_max(maxVec, score);
-    }
-#ifdef AVX2
-    for(unsigned int pos = seqLen[3]; pos < seqLen[4]; pos++){
-        const char * profileColumn = (profile + pos * T);
-        //int subScore0 =  profileColumn[dbSeq[0][pos]];
-        //int subScore1 =  profileColumn[dbSeq[1][pos]];
-        //int subScore2 =  profileColumn[dbSeq[2][pos]];
-        //int subScore3 =  profileColumn[dbSeq[3][pos]];
-        int subScore4 =  profileColumn[dbSeq[4][pos]];
-        int subScore5 =  profileColumn[dbSeq[5][pos]];
-        int subScore6 =  profileColumn[dbSeq[6][pos]];
-        int subScore7 =  profileColumn[dbSeq[7][pos]];
-        simd_int subScores = _mm256_set_epi32(subScore7, subScore6, subScore5, subScore4, 0, 0, 0, 0);
-        score = simdi32_add(score, subScores);
-        score = simdi32_max(score, zero);
-        //        std::cout << (int)((char *)&template01)[0] << "\t" <<  SSTR(((char *)&score_vec_8bit)[0]) << "\t" << SSTR(((char *)&vMaxScore)[0]) << "\t" << SSTR(((char *)&vscore)[0]) << std::endl;
-        maxVec = simdui8_max(maxVec, score);
-    }
-    for(unsigned int pos = seqLen[4]; pos < seqLen[5]; pos++){
-        const char * profileColumn = (profile + pos * T);
-        //int subScore0 =  profileColumn[dbSeq[0][pos]];
-        //int subScore1 =  profileColumn[dbSeq[1][pos]];
-        //int subScore2 =  profileColumn[dbSeq[2][pos]];
-        //int subScore3 =  profileColumn[dbSeq[3][pos]];
-        //int subScore4 =  profileColumn[dbSeq[4][pos]];
-        int subScore5 =  profileColumn[dbSeq[5][pos]];
-        int subScore6 =  profileColumn[dbSeq[6][pos]];
-        int subScore7 =  profileColumn[dbSeq[7][pos]];
-        simd_int subScores = _mm256_set_epi32(subScore7, subScore6, subScore5, 0, 0, 0, 0, 0);
-        score = simdi32_add(score, subScores);
-        score = simdi32_max(score, zero);
-        //        std::cout << (int)((char *)&template01)[0] << "\t" <<  SSTR(((char *)&score_vec_8bit)[0]) << "\t" << SSTR(((char *)&vMaxScore)[0]) << "\t" << SSTR(((char *)&vscore)[0]) << std::endl;
-        maxVec = simdui8_max(maxVec, score);
-    }
-    for(unsigned int pos = seqLen[5]; pos < seqLen[6]; pos++){
-        const char * profileColumn = (profile + pos * T);
-        //int subScore0 =  profileColumn[dbSeq[0][pos]];
-        //int subScore1 =  profileColumn[dbSeq[1][pos]];
-        //int subScore2 =  profileColumn[dbSeq[2][pos]];
-        //int subScore3 =  profileColumn[dbSeq[3][pos]];
-        //int subScore4 =  profileColumn[dbSeq[4][pos]];
-        //int subScore5 =  profileColumn[dbSeq[5][pos]];
-        int subScore6 =  profileColumn[dbSeq[6][pos]];
-        int subScore7 =  profileColumn[dbSeq[7][pos]];
-        simd_int subScores = _mm256_set_epi32(subScore7, subScore6, 0, 0, 0, 0, 0, 0);
-        score = simdi32_add(score, subScores);
-        score = simdi32_max(score, zero);
-        //        std::cout << (int)((char *)&template01)[0] << "\t" <<  SSTR(((char *)&score_vec_8bit)[0]) << "\t" << SSTR(((char *)&vMaxScore)[0]) << "\t" << SSTR(((char *)&vscore)[0]) << std::endl;
-        maxVec = simdui8_max(maxVec, score);
-    }
-    for(unsigned int pos = seqLen[6]; pos < seqLen[7]; pos++){
-        const char * profileColumn = (profile + pos * T);
-        //int subScore0 =  profileColumn[dbSeq[0][pos]];
-        //int subScore1 =  profileColumn[dbSeq[1][pos]];
-        //int subScore2 =  profileColumn[dbSeq[2][pos]];
-        //int subScore3 =  profileColumn[dbSeq[3][pos]];
-        //int subScore4 =  profileColumn[dbSeq[4][pos]];
-        //int subScore5 =  profileColumn[dbSeq[5][pos]];
-        //int subScore6 =  profileColumn[dbSeq[6][pos]];
-        int subScore7 =  profileColumn[dbSeq[7][pos]];
-        simd_int subScores = _mm256_set_epi32(subScore7, 0, 0, 0, 0, 0, 0, 0);
-        score = simdi32_add(score, subScores);
-        score = simdi32_max(score, zero);
-        //        std::cout << (int)((char *)&template01)[0] << "\t" <<  SSTR(((char *)&score_vec_8bit)[0]) << "\t" << SSTR(((char *)&vMaxScore)[0]) << "\t" << SSTR(((char *)&vscore)[0]) << std::endl;
-        maxVec = simdui8_max(maxVec, score);
-    }
-#endif
-
-    extractScores(maxScores, maxVec);
-
-    for(size_t i = 0; i < DIAGONALBINSIZE; i++){
-        max[i] = std::max(maxScores[i], max[i]);
-    }
-}
-
 void UngappedAlignment::scoreDiagonalAndUpdateHits(const char * queryProfile,
                                                    const unsigned int queryLen,
                                                    const short diagonal,
@@ -236,8 +69,8 @@ void UngappedAlignment::scoreDiagonalAndUpdateHits(const char * queryProfile,
         }
         return;
     }
-    memset(score_arr, 0, sizeof(unsigned int) * DIAGONALBINSIZE);
-    if (hitSize == DIAGONALBINSIZE) {
+    memset(score_arr, 0, sizeof(unsigned int) * binSize);
+    if (hitSize == binSize) {
         struct DiagonalSeq{
             unsigned char * seq;
             unsigned int seqLen;
@@ -246,7 +79,7 @@ void UngappedAlignment::scoreDiagonalAndUpdateHits(const char * queryProfile,
                 return first.seqLen < second.seqLen;
             }
         };
-        DiagonalSeq seqs[DIAGONALBINSIZE];
+        DiagonalSeq seqs[UngappedAlignmentKernel::MAX_BINSIZE];
         for (unsigned int seqIdx = 0; seqIdx < hitSize; seqIdx++) {
             std::pair<const unsigned char *, const unsigned int> tmp = sequenceLookup->getSequence(
                     hits[seqIdx]->id);
@@ -262,29 +95,29 @@ void UngappedAlignment::scoreDiagonalAndUpdateHits(const char * queryProfile,
                 seqs[seqIdx].id = seqIdx;
             }
         }
-        std::sort(seqs, seqs+DIAGONALBINSIZE, DiagonalSeq::compareDiagonalSeqByLen);
-        unsigned int targetMaxLen = seqs[DIAGONALBINSIZE-1].seqLen;
+        std::sort(seqs, seqs+binSize, DiagonalSeq::compareDiagonalSeqByLen);
+        unsigned int targetMaxLen = seqs[binSize-1].seqLen;
         if (diagonal >= 0 && minDistToDiagonal < queryLen) {
-            const unsigned char * tmpSeqs[DIAGONALBINSIZE];
-            unsigned int seqLength[DIAGONALBINSIZE];
+            const unsigned char * tmpSeqs[UngappedAlignmentKernel::MAX_BINSIZE];
+            unsigned int seqLength[UngappedAlignmentKernel::MAX_BINSIZE];
             unsigned int minSeqLen = std::min(targetMaxLen, queryLen - minDistToDiagonal);
-            for(size_t i = 0; i < DIAGONALBINSIZE; i++) {
+            for(size_t i = 0; i < binSize; i++) {
                 tmpSeqs[i] = seqs[i].seq;
                 seqLength[i] = std::min(seqs[i].seqLen, minSeqLen);
             }
-            unrolledDiagonalScoring<Sequence::PROFILE_AA_SIZE + 1>(queryProfile + (minDistToDiagonal * (Sequence::PROFILE_AA_SIZE + 1)),
-                                                                   seqLength, tmpSeqs, score_arr);
+            kernel->diagonalScoring(queryProfile + (minDistToDiagonal * (Sequence::PROFILE_AA_SIZE + 1)),
+                                    Sequence::PROFILE_AA_SIZE + 1, seqLength, tmpSeqs, score_arr);
 
         } else if (diagonal < 0 && minDistToDiagonal < targetMaxLen) {
-            const unsigned char * tmpSeqs[DIAGONALBINSIZE];
-            unsigned int seqLength[DIAGONALBINSIZE];
+            const unsigned char * tmpSeqs[UngappedAlignmentKernel::MAX_BINSIZE];
+            unsigned int seqLength[UngappedAlignmentKernel::MAX_BINSIZE];
             unsigned int minSeqLen = std::min(targetMaxLen - minDistToDiagonal, queryLen);
-            for(size_t i = 0; i < DIAGONALBINSIZE; i++) {
+            for(size_t i = 0; i < binSize; i++) {
                 tmpSeqs[i] = seqs[i].seq + minDistToDiagonal;
                 seqLength[i] = std::min(seqs[i].seqLen - minDistToDiagonal, minSeqLen);
             }
-            unrolledDiagonalScoring<Sequence::PROFILE_AA_SIZE + 1>(queryProfile, seqLength,
-                                                                   tmpSeqs, score_arr);
+            kernel->diagonalScoring(queryProfile, Sequence::PROFILE_AA_SIZE + 1, seqLength,
+                                    tmpSeqs, score_arr);
         }
 
         // update score
@@ -344,11 +177,11 @@ void UngappedAlignment::computeScores(const char *queryProfile,
 //            continue;
 //        }
         const unsigned short currDiag = results[i].diagonal;
-        diagonalMatches[currDiag * DIAGONALBINSIZE + diagonalCounter[currDiag]] = &results[i];
+        diagonalMatches[currDiag * binSize + diagonalCounter[currDiag]] = &results[i];
         diagonalCounter[currDiag]++;
-        if(diagonalCounter[currDiag] == DIAGONALBINSIZE) {
+        if(diagonalCounter[currDiag] == binSize) {
             scoreDiagonalAndUpdateHits(queryProfile, queryLen, static_cast<short>(currDiag),
-                                       &diagonalMatches[currDiag * DIAGONALBINSIZE], diagonalCounter[currDiag]);
+                                       &diagonalMatches[currDiag * binSize], diagonalCounter[currDiag]);
             diagonalCounter[currDiag] = 0;
         }
     }
@@ -356,7 +189,7 @@ void UngappedAlignment::computeScores(const char *queryProfile,
     for(size_t i = 0; i < DIAGONALCOUNT; i++){
         if(diagonalCounter[i] > 0){
             scoreDiagonalAndUpdateHits(queryProfile, queryLen, static_cast<short>(i),
-                                       &diagonalMatches[i * DIAGONALBINSIZE], diagonalCounter[i]);
+                                       &diagonalMatches[i * binSize], diagonalCounter[i]);
         }
         diagonalCounter[i] = 0;
     }
@@ -369,19 +202,6 @@ unsigned short UngappedAlignment::distanceFromDiagonal(const unsigned short diag
     return std::min(dist1 , dist2);
 }
 
-void UngappedAlignment::extractScores(unsigned int *score_arr, simd_int score) {
-#ifdef AVX2
-    #define EXTRACT_AVX(i) score_arr[i] = _mm256_extract_epi32(score, i)
-    EXTRACT_AVX(0);  EXTRACT_AVX(1);  EXTRACT_AVX(2);  EXTRACT_AVX(3);
-    EXTRACT_AVX(4);  EXTRACT_AVX(5);  EXTRACT_AVX(6);  EXTRACT_AVX(7);
-#undef EXTRACT_AVX
-#else
-#define EXTRACT_SSE(i) score_arr[i] = _mm_extract_epi32(score, i)
-    EXTRACT_SSE(0);  EXTRACT_SSE(1);   EXTRACT_SSE(2);  EXTRACT_SSE(3);
-#undef EXTRACT_SSE
-#endif
-}
-
 
 void UngappedAlignment::createProfile(Sequence *seq,
                                       float * biasCorrection,
@@ -448,6 +268,14 @@ int UngappedAlignment::scoreSingleSequence(std::pair<const unsigned char *, cons
     }
 }
 
-
-
-
+const UngappedAlignmentKernel *UngappedAlignmentKernel::get() {
+#ifdef SIMD_DISPATCH
+    if (SimdDispatch::getLevel() >= SimdDispatch::LEVEL_AVX512) {
+        return &simd_avx512::ungappedAlignmentKernel;
+    }
+    if (SimdDispatch::getLevel() >= SimdDispatch::LEVEL_AVX2) {
+        return &simd_avx2::ungappedAlignmentKernel;
+    }
+#endif
+    return &simd_baseline::ungappedAlignmentKernel;
+}
@@ -9,6 +9,7 @@
 #include "simd.h"
 #include "CacheFriendlyOperations.h"
 #include "SequenceLookup.h"
+#include "UngappedAlignmentKernel.h"
 class UngappedAlignment {
 
 public:
@@ -33,27 +34,12 @@ public:
         return 0;
     }
 
-#ifdef AVX2
-    static __m256i Shuffle(const __m256i & value, const __m256i & shuffle)
-    {
-        const __m256i K0 = _mm256_setr_epi8(
-                (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70,
-                (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0);
-        const __m256i K1 = _mm256_setr_epi8(
-                (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0,
-                (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70);
-        return _mm256_or_si256(_mm256_shuffle_epi8(value, _mm256_add_epi8(shuffle, K0)),
-                               _mm256_shuffle_epi8(_mm256_permute4x64_epi64(value, 0x4E), _mm256_add_epi8(shuffle, K1)));
-    }
-#endif
-
 private:
     const static unsigned int DIAGONALCOUNT = 0xFFFF + 1;
-#ifdef AVX2
-    const static unsigned int DIAGONALBINSIZE = 8;
-#else
-    const static unsigned int DIAGONALBINSIZE = 4;
-#endif
+    // vectorized scoring for the instruction set selected at runtime
+    const UngappedAlignmentKernel *kernel;
+    // number of diagonals scored together by the kernel
+    unsigned int binSize;
     unsigned int *score_arr;
     char *queryProfile;
     unsigned int queryLen;
@@ -75,12 +61,6 @@ private:
                               const unsigned int seqLen,
                               const unsigned char *dbSeq);
 
-    template <unsigned int T>
-    void unrolledDiagonalScoring(const char * profile,
-                                 const unsigned int * seqLen,
-                                 const unsigned char ** dbSeq,
-                                 unsigned int * max);
-
     // calles vectorDiagonalScoring or scalarDiagonalScoring depending on the hitSize
     // and updates diagonalScore of the hit_t objects
     void scoreDiagonalAndUpdateHits(const char *queryProfile, const unsigned int queryLen,
@@ -88,8 +68,6 @@ private:
 
     unsigned short distanceFromDiagonal(const unsigned short diagonal);
 
-    void extractScores(unsigned int *score_arr, simd_int score);
-
     void createProfile(Sequence *seq, float *biasCorrection, short **subMat);
 
     int computeSingelSequenceScores(const char *queryProfile, const unsigned int queryLen,
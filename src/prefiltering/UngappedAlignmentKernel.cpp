@@ -0,0 +1,246 @@
+// Compiled once per instruction set: UngappedAlignmentKernelAvx2.cpp and UngappedAlignmentKernelAvx512.cpp
+// include this file again with -mavx2 and -mavx512bw.
+// Do not call inline functions or templates shared with the rest of the program here.
+#ifndef SIMD_DISPATCH_NAMESPACE
+#define SIMD_DISPATCH_NAMESPACE simd_baseline
+#endif
+
+#include "UngappedAlignmentKernel.h"
+#include "simd.h"
+
+namespace SIMD_DISPATCH_NAMESPACE {
+
+#if defined(AVX512)
+static const unsigned int DIAGONALBINSIZE = 16;
+#elif defined(AVX2)
+static const unsigned int DIAGONALBINSIZE = 8;
+#else
+static const unsigned int DIAGONALBINSIZE = 4;
+#endif
+
+static inline void extractScores(unsigned int *score_arr, simd_int score) {
+#if defined(AVX512)
+    _mm512_storeu_si512(score_arr, score);
+#elif defined(AVX2)
+    #define EXTRACT_AVX(i) score_arr[i] = _mm256_extract_epi32(score, i)
+    EXTRACT_AVX(0);  EXTRACT_AVX(1);  EXTRACT_AVX(2);  EXTRACT_AVX(3);
+    EXTRACT_AVX(4);  EXTRACT_AVX(5);  EXTRACT_AVX(6);  EXTRACT_AVX(7);
+#undef EXTRACT_AVX
+#else
+#define EXTRACT_SSE(i) score_arr[i] = _mm_extract_epi32(score, i)
+    EXTRACT_SSE(0);  EXTRACT_SSE(1);   EXTRACT_SSE(2);  EXTRACT_SSE(3);
+#undef EXTRACT_SSE
+#endif
+}
+
+#if defined(AVX512)
+// 16 diagonals do not unroll well, the lanes of diagonals that already ended are zeroed instead
+static void unrolledDiagonalScoring(const char * profile,
+                                    const unsigned int profileStride,
+                                    const unsigned int * seqLen,
+                                    const unsigned char ** dbSeq,
+                                    unsigned int * max) {
+    unsigned int maxScores[DIAGONALBINSIZE];
+    int subScores[DIAGONALBINSIZE] __attribute__((aligned(64)));
+    simd_int zero = simdi32_set(0);
+    simd_int maxVec = simdi32_set(0);
+    simd_int score = simdi32_set(0);
+    unsigned int pos = 0;
+    for (unsigned int lane = 0; lane < DIAGONALBINSIZE; lane++) {
+        for (; pos < seqLen[lane]; pos++) {
+            const char * profileColumn = (profile + pos * profileStride);
+            for (unsigned int i = lane; i < DIAGONALBINSIZE; i++) {
+                subScores[i] = profileColumn[dbSeq[i][pos]];
+            }
+            score = simdi32_add(score, simdi_load((const simd_int *) subScores));
+            score = simdi32_max(score, zero);
+            maxVec = simdui8_max(maxVec, score);
+        }
+        subScores[lane] = 0;
+    }
+
+    extractScores(maxScores, maxVec);
+
+    for(size_t i = 0; i < DIAGONALBINSIZE; i++){
+        max[i] = (maxScores[i] > max[i]) ? maxScores[i] : max[i];
+    }
+}
+#else
+static void unrolledDiagonalScoring(const char * profile,
+                                    const unsigned int profileStride,
+                                    const unsigned int * seqLen,
+                                    const unsigned char ** dbSeq,
+                                    unsigned int * max) {
+    unsigned int maxScores[DIAGONALBINSIZE];
+    simd_int zero = simdi32_set(0);
+    simd_int maxVec = simdi32_set(0);
+    simd_int score = simdi32_set(0);
+    for(unsigned int pos = 0; pos < seqLen[0]; pos++){
+        const char * profileColumn = (profile + pos * profileStride);
+        int subScore0 =  profileColumn[dbSeq[0][pos]];
+        int subScore1 =  profileColumn[dbSeq[1][pos]];
+        int subScore2 =  profileColumn[dbSeq[2][pos]];
+        int subScore3 =  profileColumn[dbSeq[3][pos]];
+
+#ifdef AVX2
+        int subScore4 =  profileColumn[dbSeq[4][pos]];
+        int subScore5 =  profileColumn[dbSeq[5][pos]];
+        int subScore6 =  profileColumn[dbSeq[6][pos]];
+        int subScore7 =  profileColumn[dbSeq[7][pos]];
+        simd_int subScores = _mm256_set_epi32(subScore7, subScore6, subScore5, subScore4, subScore3, subScore2, subScore1, subScore0);
+#else
+        simd_int subScores = _mm_set_epi32(subScore3, subScore2, subScore1, subScore0);
+#endif
+        score = simdi32_add(score, subScores);
+        score = simdi32_max(score, zero);
+        //        std::cout << (int)((char *)&template01)[0] << "\t" <<  SSTR(((char *)&score_vec_8bit)[0]) << "\t" << SSTR(((char *)&vMaxScore)[0]) << "\t" << SSTR(((char *)&vscore)[0]) << std::endl;
+        maxVec = simdui8_max(maxVec, score);
+    }
+
+    for(unsigned int pos = seqLen[0]; pos < seqLen[1]; pos++){
+        const char * profileColumn = (profile + pos * profileStride);
+        //int subScore0 =  profileColumn[dbSeq[0][pos]];
+        int subScore1 =  profileColumn[dbSeq[1][pos]];
+        int subScore2 =  profileColumn[dbSeq[2][pos]];
+        int subScore3 =  profileColumn[dbSeq[3][pos]];
+
+#ifdef AVX2
+        int subScore4 =  profileColumn[dbSeq[4][pos]];
+        int subScore5 =  profileColumn[dbSeq[5][pos]];
+        int subScore6 =  profileColumn[dbSeq[6][pos]];
+        int subScore7 =  profileColumn[dbSeq[7][pos]];
+        simd_int subScores = _mm256_set_epi32(subScore7, subScore6, subScore5, subScore4, subScore3, subScore2, subScore1, 0);
+#else
+        simd_int subScores = _mm_set_epi32(subScore3, subScore2, subScore1, 0);
+#endif
+        score = simdi32_add(score, subScores);
+        score = simdi32_max(score, zero);
+        //        std::cout << (int)((char *)&template01)[0] << "\t" <<  SSTR(((char *)&score_vec_8bit)[0]) << "\t" << SSTR(((char *)&vMaxScore)[0]) << "\t" << SSTR(((char *)&vscore)[0]) << std::endl;
+        maxVec = simdui8_max(maxVec, score);
+    }
+
+    for(unsigned int pos = seqLen[1]; pos < seqLen[2]; pos++){
+        const char * profileColumn = (profile + pos * profileStride);
+        //int subScore0 =  profileColumn[dbSeq[0][pos]];
+        //int subScore1 =  profileColumn[dbSeq[1][pos]];
+        int subScore2 =  profileColumn[dbSeq[2][pos]];
+        int subScore3 =  profileColumn[dbSeq[3][pos]];
+
+#ifdef AVX2
+        int subScore4 =  profileColumn[dbSeq[4][pos]];
+        int subScore5 =  profileColumn[dbSeq[5][pos]];
+        int subScore6 =  profileColumn[dbSeq[6][pos]];
+        int subScore7 =  profileColumn[dbSeq[7][pos]];
+        simd_int subScores = _mm256_set_epi32(subScore7, subScore6, subScore5, subScore4, subScore3, subScore2, 0, 0);
+#else
+        simd_int subScores = _mm_set_epi32(subScore3, subScore2, 0, 0);
+#endif
+        score = simdi32_add(score, subScores);
+        score = simdi32_max(score, zero);
+        //        std::cout << (int)((char *)&template01)[0] << "\t" <<  SSTR(((char *)&score_vec_8bit)[0]) << "\t" << SSTR(((char *)&vMaxScore)[0]) << "\t" << SSTR(((char *)&vscore)[0]) << std::endl;
+        maxVec = simdui8_max(maxVec, score);
+    }
+
+    for(unsigned int pos = seqLen[2]; pos < seqLen[3]; pos++){
+        const char * profileColumn = (profile + pos * profileStride);
+        //int subScore0 =  profileColumn[dbSeq[0][pos]];
+        //int subScore1 =  profileColumn[dbSeq[1][pos]];
+        //int subScore2 =  profileColumn[dbSeq[2][pos]];
+        int subScore3 =  profileColumn[dbSeq[3][pos]];
+
+#ifdef AVX2
+        int subScore4 =  profileColumn[dbSeq[4][pos]];
+        int subScore5 =  profileColumn[dbSeq[5][pos]];
+        int subScore6 =  profileColumn[dbSeq[6][pos]];
+        int subScore7 =  profileColumn[dbSeq[7][pos]];
+        simd_int subScores = _mm256_set_epi32(subScore7, subScore6, subScore5, subScore4, subScore3, 0, 0, 0);
+#else
+        simd_int subScores = _mm_set_epi32(subScore3, 0, 0, 0);
+#endif
+        score = simdi32_add(score, subScores);
+        score = simdi32_max(score, zero);
+        //        std::cout << (int)((char *)&template01)[0] << "\t" <<  SSTR(((char *)&score_vec_8bit)[0]) << "\t" << SSTR(((char *)&vMaxScore)[0]) << "\t" << SSTR(((char *)&vscore)[0]) << std::endl;
+        maxVec = simdui8_max(maxVec, score);
+    }
+#ifdef AVX2
+    for(unsigned int pos = seqLen[3]; pos < seqLen[4]; pos++){
+        const char * profileColumn = (profile + pos * profileStride);
+        //int subScore0 =  profileColumn[dbSeq[0][pos]];
+        //int subScore1 =  profileColumn[dbSeq[1][pos]];
+        //int subScore2 =  profileColumn[dbSeq[2][pos]];
+        //int subScore3 =  profileColumn[dbSeq[3][pos]];
+        int subScore4 =  profileColumn[dbSeq[4][pos]];
+        int subScore5 =  profileColumn[dbSeq[5][pos]];
+        int subScore6 =  profileColumn[dbSeq[6][pos]];
+        int subScore7 =  profileColumn[dbSeq[7][pos]];
+        simd_int subScores = _mm256_set_epi32(subScore7, subScore6, subScore5, subScore4, 0, 0, 0, 0);
+        score = simdi32_add(score, subScores);
+        score = simdi32_max(score, zero);
+        //        std::cout << (int)((char *)&template01)[0] << "\t" <<  SSTR(((char *)&score_vec_8bit)[0]) << "\t" << SSTR(((char *)&vMaxScore)[0]) << "\t" << SSTR(((char *)&vscore)[0]) << std::endl;
+        maxVec = simdui8_max(maxVec, score);
+    }
+    for(unsigned int pos = seqLen[4]; pos < seqLen[5]; pos++){
+        const char * profileColumn = (profile + pos * profileStride);
+        //int subScore0 =  profileColumn[dbSeq[0][pos]];
+        //int subScore1 =  profileColumn[dbSeq[1][pos]];
+        //int subScore2 =  profileColumn[dbSeq[2][pos]];
+        //int subScore3 =  profileColumn[dbSeq[3][pos]];
+        //int subScore4 =  profileColumn[dbSeq[4][pos]];
+        int subScore5 =  profileColumn[dbSeq[5][pos]];
+        int subScore6 =  profileColumn[dbSeq[6][pos]];
+        int subScore7 =  profileColumn[dbSeq[7][pos]];
+        simd_int subScores = _mm256_set_epi32(subScore7, subScore6, subScore5, 0, 0, 0, 0, 0);
+        score = simdi32_add(score, subScores);
+        score = simdi32_max(score, zero);
+        //        std::cout << (int)((char *)&template01)[0] << "\t" <<  SSTR(((char *)&score_vec_8bit)[0]) << "\t" << SSTR(((char *)&vMaxScore)[0]) << "\t" << SSTR(((char *)&vscore)[0]) << std::endl;
+        maxVec = simdui8_max(maxVec, score);
+    }
+    for(unsigned int pos = seqLen[5]; pos < seqLen[6]; pos++){
+        const char * profileColumn = (profile + pos * profileStride);
+        //int subScore0 =  profileColumn[dbSeq[0][pos]];
+        //int subScore1 =  profileColumn[dbSeq[1][pos]];
+        //int subScore2 =  profileColumn[dbSeq[2][pos]];
+        //int subScore3 =  profileColumn[dbSeq[3][pos]];
+        //int subScore4 =  profileColumn[dbSeq[4][pos]];
+        //int subScore5 =  profileColumn[dbSeq[5][pos]];
+        int subScore6 =  profileColumn[dbSeq[6][pos]];
+        int subScore7 =  profileColumn[dbSeq[7][pos]];
+        simd_int subScores = _mm256_set_epi32(subScore7, subScore6, 0, 0, 0, 0, 0, 0);
+        score = simdi32_add(score, subScores);
+        score = simdi32_max(score, zero);
+        //        std::cout << (int)((char *)&template01)[0] << "\t" <<  SSTR(((char *)&score_vec_8bit)[0]) << "\t" << SSTR(((char *)&vMaxScore)[0]) << "\t" << SSTR(((char *)&vscore)[0]) << std::endl;
+        maxVec = simdui8_max(maxVec, score);
+    }
+    for(unsigned int pos = seqLen[6]; pos < seqLen[7]; pos++){
+        const char * profileColumn = (profile + pos * profileStride);
+        //int subScore0 =  profileColumn[dbSeq[0][pos]];
+        //int subScore1 =  profileColumn[dbSeq[1][pos]];
+        //int subScore2 =  profileColumn[dbSeq[2][pos]];
+        //int subScore3 =  profileColumn[dbSeq[3][pos]];
+        //int subScore4 =  profileColumn[dbSeq[4][pos]];
+        //int subScore5 =  profileColumn[dbSeq[5][pos]];
+        //int subScore6 =  profileColumn[dbSeq[6][pos]];
+        int subScore7 =  profileColumn[dbSeq[7][pos]];
+        simd_int subScores = _mm256_set_epi32(subScore7, 0, 0, 0, 0, 0, 0, 0);
+        score = simdi32_add(score, subScores);
+        score = simdi32_max(score, zero);
+        //        std::cout << (int)((char *)&template01)[0] << "\t" <<  SSTR(((char *)&score_vec_8bit)[0]) << "\t" << SSTR(((char *)&vMaxScore)[0]) << "\t" << SSTR(((char *)&vscore)[0]) << std::endl;
+        maxVec = simdui8_max(maxVec, score);
+    }
+#endif
+
+    extractScores(maxScores, maxVec);
+
+    for(size_t i = 0; i < DIAGONALBINSIZE; i++){
+        max[i] = (maxScores[i] > max[i]) ? maxScores[i] : max[i];
+    }
+}
+
+#endif
+
+const UngappedAlignmentKernel ungappedAlignmentKernel = {
+    DIAGONALBINSIZE,
+    unrolledDiagonalScoring
+};
+
+}
@@ -0,0 +1,37 @@
+#ifndef MMSEQS_UNGAPPEDALIGNMENTKERNEL_H
+#define MMSEQS_UNGAPPEDALIGNMENTKERNEL_H
+
+// Vectorized diagonal scoring of UngappedAlignment.
+// The kernel is compiled once per instruction set (see SimdDispatch) and scores binSize diagonals at once.
+#include <cstddef>
+
+struct UngappedAlignmentKernel {
+    // largest binSize of all variants
+    static const unsigned int MAX_BINSIZE = 16;
+
+    // scores binSize target sequences against the query profile (profileStride bytes per query position)
+    // seqLen has to be sorted ascending, the maximum score of each sequence is merged into max
+    typedef void (*diagonal_scoring_t)(const char *profile, const unsigned int profileStride,
+                                       const unsigned int *seqLen, const unsigned char **dbSeq,
+                                       unsigned int *max);
+
+    unsigned int binSize;
+    diagonal_scoring_t diagonalScoring;
+
+    // kernel for the instruction set selected by SimdDispatch
+    static const UngappedAlignmentKernel *get();
+};
+
+namespace simd_baseline {
+    extern const UngappedAlignmentKernel ungappedAlignmentKernel;
+}
+#ifdef SIMD_DISPATCH
+namespace simd_avx2 {
+    extern const UngappedAlignmentKernel ungappedAlignmentKernel;
+}
+namespace simd_avx512 {
+    extern const UngappedAlignmentKernel ungappedAlignmentKernel;
+}
+#endif
+
+#endif
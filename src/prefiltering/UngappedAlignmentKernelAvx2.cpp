@@ -0,0 +1,5 @@
+// AVX2 variant of the ungapped diagonal scoring for builds with HAVE_SIMD_DISPATCH
+#ifdef SIMD_DISPATCH
+#define SIMD_DISPATCH_NAMESPACE simd_avx2
+#include "UngappedAlignmentKernel.cpp"
+#endif
@@ -0,0 +1,10 @@
+// AVX-512 variant of the ungapped diagonal scoring for builds with HAVE_SIMD_DISPATCH
+#ifdef SIMD_DISPATCH
+#define SIMD_DISPATCH_NAMESPACE simd_avx512
+#define SIMD_DISPATCH_AVX512
+#if defined(__GNUC__) && !defined(__clang__)
+// GCC 12 warns about the _mm256_undefined_si256 placeholders inside its own AVX-512 intrinsics
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+#include "UngappedAlignmentKernel.cpp"
+#endif
@@ -27,7 +27,11 @@ int prefilterInternal(int argc, const char **argv, const Command &command, int m
     resultWriter.open();
     bool sameDB = (par.db2.compare(par.db1) == 0);
     bool touch = (par.preloadMode != Parameters::PRELOAD_MODE_MMAP);
-    IndexReader tDbrIdx(par.db2, par.threads, IndexReader::SEQUENCES, (touch) ? (IndexReader::PRELOAD_INDEX | IndexReader::PRELOAD_DATA) : 0 );
+    int targetDataMode = DBReader<unsigned int>::USE_INDEX | DBReader<unsigned int>::USE_DATA;
+    if (par.preloadMode == Parameters::PRELOAD_MODE_MMAP_HUGEPAGE) {
+        targetDataMode |= DBReader<unsigned int>::USE_HUGEPAGES;
+    }
+    IndexReader tDbrIdx(par.db2, par.threads, IndexReader::SEQUENCES, (touch) ? (IndexReader::PRELOAD_INDEX | IndexReader::PRELOAD_DATA) : 0, targetDataMode);
     IndexReader * qDbrIdx = NULL;
     DBReader<unsigned int> * qdbr = NULL;
     DBReader<unsigned int> * tdbr = tDbrIdx.sequenceReader;
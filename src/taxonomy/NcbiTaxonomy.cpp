@@ -4,7 +4,6 @@
 
 #include "NcbiTaxonomy.h"
 #include "FileUtil.h"
-#include "MathUtil.h"
 #include "Debug.h"
 #include "Util.h"
 #include "sys/mman.h"
@@ -13,23 +12,22 @@
 #include <algorithm>
 #include <cassert>
 
-const int NcbiTaxonomy::SERIALIZATION_VERSION = 2;
+const int NcbiTaxonomy::SERIALIZATION_VERSION = 3;
 
-int **makeMatrix(size_t maxNodes) {
-    size_t dimension = maxNodes * 2;
-    int **M = new int*[dimension];
-    int k = (int)(MathUtil::flog2(dimension)) + 1;
-    M[0] = new int[dimension * k]();
-    for(size_t i = 1; i < dimension; i++) {
-        M[i] = M[i-1] + k;
-    }
+// the Euler tour is split into blocks of RMQ_BLOCK_SIZE positions
+// in-block queries are answered with one bit mask per position, the sparse table only covers the block minima
+const size_t RMQ_BLOCK_SIZE = 32;
+
+static inline unsigned int floorLog2(size_t x) {
+    return static_cast<unsigned int>(63 - __builtin_clzll(x));
+}
 
-    return M;
+static size_t rmqBlocks(size_t maxNodes) {
+    return (maxNodes * 2 + RMQ_BLOCK_SIZE - 1) / RMQ_BLOCK_SIZE;
 }
 
-void deleteMatrix(int** M) {
-    delete[] M[0];
-    delete[] M;
+static size_t rmqLevels(size_t blocks) {
+    return floorLog2(blocks) + 1;
 }
 
 NcbiTaxonomy::NcbiTaxonomy(const std::string &namesFile, const std::string &nodesFile, const std::string &mergedFile) : externalData(false) {
@@ -68,7 +66,9 @@ NcbiTaxonomy::NcbiTaxonomy(const std::string &namesFile, const std::string &node
     L = new int[maxNodes * 2];
     std::copy(tmpL.begin(), tmpL.end(), L);
 
-    M = makeMatrix(maxNodes);
+    const size_t blocks = rmqBlocks(maxNodes);
+    M = new int[blocks * rmqLevels(blocks)]();
+    S = new unsigned int[maxNodes * 2];
     InitRangeMinimumQuery();
 
     mmapData = NULL;
@@ -76,15 +76,14 @@ NcbiTaxonomy::NcbiTaxonomy(const std::string &namesFile, const std::string &node
 }
 
 NcbiTaxonomy::~NcbiTaxonomy() {
-    if (externalData) {
-        delete[] M;
-    } else {
+    if (externalData == false) {
         delete[] taxonNodes;
         delete[] H;
         delete[] D;
         delete[] E;
         delete[] L;
-        deleteMatrix(M);
+        delete[] M;
+        delete[] S;
     }
     delete block;
     if (mmapData != NULL) {
@@ -205,20 +204,33 @@ void NcbiTaxonomy::elh(std::vector<std::vector<TaxID>> const & children, TaxID t
 
 void NcbiTaxonomy::InitRangeMinimumQuery() {
     Debug(Debug::INFO) << "Init RMQ ...";
-
-    for (unsigned int i = 0; i < (maxNodes * 2); ++i) {
-        M[i][0] = i;
+    const size_t size = maxNodes * 2;
+    const size_t blocks = rmqBlocks(maxNodes);
+
+    // bit k of S[i] is set if position (block start + k) holds the minimum of L between it and i
+    // the lowest set bit at or above the query start then gives the in-block minimum
+    for (size_t block = 0; block < blocks; ++block) {
+        const size_t start = block * RMQ_BLOCK_SIZE;
+        const size_t end = std::min(start + RMQ_BLOCK_SIZE, size);
+        unsigned int stack = 0;
+        for (size_t i = start; i < end; ++i) {
+            while (stack != 0 && L[start + floorLog2(stack)] >= L[i]) {
+                stack &= ~(1u << floorLog2(stack));
+            }
+            stack |= 1u << (i - start);
+            S[i] = stack;
+        }
+        M[block] = static_cast<int>(start + __builtin_ctz(stack));
     }
 
-    for (unsigned int j = 1; (1ul << j) <= (maxNodes * 2); ++j) {
-        for (unsigned int i = 0; (i + (1ul << j) - 1) < (maxNodes * 2); ++i) {
-            int A = M[i][j - 1];
-            int B = M[i + (1ul << (j - 1))][j - 1];
-            if (L[A] < L[B]) {
-                M[i][j] = A;
-            } else {
-                M[i][j] = B;
-            }
+    // level j of the sparse table holds the minimum of 2^j consecutive blocks
+    for (size_t j = 1; (1ul << j) <= blocks; ++j) {
+        int *prev = M + (j - 1) * blocks;
+        int *curr = M + j * blocks;
+        for (size_t i = 0; i + (1ul << j) <= blocks; ++i) {
+            int A = prev[i];
+            int B = prev[i + (1ul << (j - 1))];
+            curr[i] = (L[A] < L[B]) ? A : B;
         }
     }
     Debug(Debug::INFO) << "Done\n";
@@ -226,9 +238,22 @@ void NcbiTaxonomy::InitRangeMinimumQuery() {
 
 int NcbiTaxonomy::RangeMinimumQuery(int i, int j) const {
     assert(j >= i);
-    int k = (int)MathUtil::flog2(j - i + 1);
-    int A = M[i][k];
-    int B = M[j - MathUtil::ipow<int>(2, k) + 1][k];
+    const size_t blockI = i / RMQ_BLOCK_SIZE;
+    const size_t blockJ = j / RMQ_BLOCK_SIZE;
+    if (blockI == blockJ) {
+        return blockI * RMQ_BLOCK_SIZE + __builtin_ctz(S[j] & (~0u << (i % RMQ_BLOCK_SIZE)));
+    }
+    int A = blockI * RMQ_BLOCK_SIZE + __builtin_ctz(S[blockI * RMQ_BLOCK_SIZE + RMQ_BLOCK_SIZE - 1] & (~0u << (i % RMQ_BLOCK_SIZE)));
+    int B = blockJ * RMQ_BLOCK_SIZE + __builtin_ctz(S[j]);
+    if (blockJ - blockI > 1) {
+        const size_t blocks = rmqBlocks(maxNodes);
+        const unsigned int k = floorLog2(blockJ - blockI - 1);
+        const int *level = M + k * blocks;
+        int left = level[blockI + 1];
+        int right = level[blockJ - (1ul << k)];
+        int C = (L[left] <= L[right]) ? left : right;
+        A = (L[A] <= L[C]) ? A : C;
+    }
     if (L[A] <= L[B]) {
         return A;
     }
@@ -529,23 +554,6 @@ NcbiTaxonomy * NcbiTaxonomy::openTaxonomy(const std::string &database){
 const TaxID ROOT_TAXID = 1;
 const int ROOT_RANK = INT_MAX;
 
-struct TaxNode {
-    TaxNode(const double weight, const bool isCandidate, const TaxID childTaxon)
-            : weight(weight), isCandidate(isCandidate), childTaxon(childTaxon) {}
-
-    void update(const double weightToAdd, const TaxID & childTaxonInput) {
-        if (childTaxon != childTaxonInput) {
-            isCandidate = true;
-            childTaxon = childTaxonInput;
-        }
-        weight += weightToAdd;
-    }
-
-    double weight;
-    bool isCandidate;
-    TaxID childTaxon;
-};
-
 const char* NcbiTaxonomy::getString(size_t blockIdx) const {
     return block->getString(blockIdx);
 }
@@ -574,9 +582,31 @@ WeightedTaxHit::WeightedTaxHit(const TaxID taxon, const float evalue, const int
     }
 }
 
-WeightedTaxResult NcbiTaxonomy::weightedMajorityLCA(const std::vector<WeightedTaxHit> &setTaxa, const float majorityCutoff) {
+// add weight to a node, a node becomes a candidate if it is the start of a path or if paths from different children meet in it
+static inline void accumulateTaxon(WeightedTaxAccumulator &acc, int id, double weight, TaxID childTaxon) {
+    if (acc.epoch[id] != acc.currentEpoch) {
+        acc.epoch[id] = acc.currentEpoch;
+        acc.weight[id] = weight;
+        acc.isCandidate[id] = (childTaxon == 0);
+        acc.childTaxon[id] = childTaxon;
+        acc.touched.push_back(id);
+        return;
+    }
+    if (acc.childTaxon[id] != childTaxon) {
+        acc.isCandidate[id] = true;
+        acc.childTaxon[id] = childTaxon;
+    }
+    acc.weight[id] += weight;
+}
+
+WeightedTaxResult NcbiTaxonomy::weightedMajorityLCA(const std::vector<WeightedTaxHit> &setTaxa, const float majorityCutoff, WeightedTaxAccumulator &acc) {
     // count num occurences of each ancestor, possibly weighted
-    std::map<TaxID, TaxNode> ancTaxIdsCounts;
+    acc.currentEpoch++;
+    if (acc.currentEpoch == 0) {
+        std::fill(acc.epoch.begin(), acc.epoch.end(), 0);
+        acc.currentEpoch = 1;
+    }
+    acc.touched.clear();
 
     // initialize counters and weights
     size_t assignedSeqs = 0;
@@ -591,8 +621,7 @@ WeightedTaxResult NcbiTaxonomy::weightedMajorityLCA(const std::vector<WeightedTa
             unassignedSeqs++;
             continue;
         }
-        TaxonNode const *node = taxonNode(currTaxId, false);
-        if (node == NULL) {
+        if (!nodeExists(currTaxId)) {
             Debug(Debug::ERROR) << "taxonid: " << currTaxId << " does not match a legal taxonomy node.\n";
             EXIT(EXIT_FAILURE);
         }
@@ -600,27 +629,17 @@ WeightedTaxResult NcbiTaxonomy::weightedMajorityLCA(const std::vector<WeightedTa
         assignedSeqs++;
 
         // each start of a path due to an orf is a candidate
-        std::map<TaxID, TaxNode>::iterator it;
-        if ((it = ancTaxIdsCounts.find(currTaxId)) != ancTaxIdsCounts.end()) {
-            it->second.update(currWeight, 0);
-        } else {
-            TaxNode current(currWeight, true, 0);
-            ancTaxIdsCounts.emplace(currTaxId, current);
-        }
+        int id = D[currTaxId];
+        accumulateTaxon(acc, id, currWeight, 0);
 
         // iterate all ancestors up to root (including). add currWeight and candidate status to each
-        TaxID currParentTaxId = node->parentTaxId;
+        TaxID currParentTaxId = taxonNodes[id].parentTaxId;
         while (currParentTaxId != currTaxId) {
-            if ((it = ancTaxIdsCounts.find(currParentTaxId)) != ancTaxIdsCounts.end()) {
-                it->second.update(currWeight, currTaxId);
-            } else {
-                TaxNode parent(currWeight, false, currTaxId);
-                ancTaxIdsCounts.emplace(currParentTaxId, parent);
-            }
+            id = D[currParentTaxId];
+            accumulateTaxon(acc, id, currWeight, currTaxId);
             // move up
             currTaxId = currParentTaxId;
-            node = taxonNode(currParentTaxId, false);
-            currParentTaxId = node->parentTaxId;
+            currParentTaxId = taxonNodes[id].parentTaxId;
         }
     }
 
@@ -629,40 +648,46 @@ WeightedTaxResult NcbiTaxonomy::weightedMajorityLCA(const std::vector<WeightedTa
         return WeightedTaxResult(selctedTaxon, assignedSeqs, unassignedSeqs, 0, 0.0);
     }
 
+    // candidates that meet the cutoff, visited in taxon id order so that ties are resolved as before
+    acc.selected.clear();
+    for (size_t i = 0; i < acc.touched.size(); ++i) {
+        const int id = acc.touched[i];
+        if (acc.isCandidate[id] && acc.weight[id] / totalAssignedSeqsWeights >= majorityCutoff) {
+            acc.selected.push_back(id);
+        }
+    }
+    std::sort(acc.selected.begin(), acc.selected.end(), [this](int a, int b) {
+        return taxonNodes[a].taxId < taxonNodes[b].taxId;
+    });
+
     // select the lowest ancestor that meets the cutoff
     int minRank = INT_MAX;
     double selectedPercent = 0;
-    for (std::map<TaxID, TaxNode>::iterator it = ancTaxIdsCounts.begin(); it != ancTaxIdsCounts.end(); it++) {
-        // consider only candidates
-        if (it->second.isCandidate == false) {
-            continue;
-        }
-
-        double currPercent = it->second.weight / totalAssignedSeqsWeights;
-        if (currPercent >= majorityCutoff) {
-            // iterate all ancestors to find lineage min rank (the candidate is a descendant of a node with this rank)
-            TaxID currTaxId = it->first;
-            TaxonNode const *node = taxonNode(currTaxId, false);
-            int currMinRank = ROOT_RANK;
-            TaxID currParentTaxId = node->parentTaxId;
-            while (currParentTaxId != currTaxId) {
-                int currRankInd = NcbiTaxonomy::findRankIndex(getString(node->rankIdx));
-                if ((currRankInd > 0) && (currRankInd < currMinRank)) {
-                    currMinRank = currRankInd;
-                    // the rank can only go up on the way to the root, so we can break
-                    break;
-                }
-                // move up:
-                currTaxId = currParentTaxId;
-                node = taxonNode(currParentTaxId, false);
-                currParentTaxId = node->parentTaxId;
+    for (size_t i = 0; i < acc.selected.size(); ++i) {
+        const int id = acc.selected[i];
+        double currPercent = acc.weight[id] / totalAssignedSeqsWeights;
+        // iterate all ancestors to find lineage min rank (the candidate is a descendant of a node with this rank)
+        TaxonNode const *node = &taxonNodes[id];
+        TaxID currTaxId = node->taxId;
+        int currMinRank = ROOT_RANK;
+        TaxID currParentTaxId = node->parentTaxId;
+        while (currParentTaxId != currTaxId) {
+            int currRankInd = NcbiTaxonomy::findRankIndex(getString(node->rankIdx));
+            if ((currRankInd > 0) && (currRankInd < currMinRank)) {
+                currMinRank = currRankInd;
+                // the rank can only go up on the way to the root, so we can break
+                break;
             }
+            // move up:
+            currTaxId = currParentTaxId;
+            node = &taxonNodes[D[currParentTaxId]];
+            currParentTaxId = node->parentTaxId;
+        }
 
-            if ((currMinRank < minRank) || ((currMinRank == minRank) && (currPercent > selectedPercent))) {
-                selctedTaxon = it->first;
-                minRank = currMinRank;
-                selectedPercent = currPercent;
-            }
+        if ((currMinRank < minRank) || ((currMinRank == minRank) && (currPercent > selectedPercent))) {
+            selctedTaxon = taxonNodes[id].taxId;
+            minRank = currMinRank;
+            selectedPercent = currPercent;
         }
     }
 
@@ -676,25 +701,16 @@ WeightedTaxResult NcbiTaxonomy::weightedMajorityLCA(const std::vector<WeightedTa
         return WeightedTaxResult(selctedTaxon, assignedSeqs, unassignedSeqs, 0, selectedPercent);
     }
     size_t seqsAgreeWithSelectedTaxon = 0;
-    // otherwise, iterate over all seqs
+    // otherwise, answer the ancestor test of each seq with the RMQ instead of walking its lineage
+    const int selectedId = D[selctedTaxon];
     for (size_t i = 0; i < setTaxa.size(); ++i) {
         TaxID currTaxId = setTaxa[i].taxon;
         // ignore unassigned sequences
         if (currTaxId == 0) {
             continue;
         }
-        TaxonNode const *node = taxonNode(currTaxId, false);
-
-        // iterate all ancestors up to the root
-        TaxID currParentTaxId = node->parentTaxId;
-        while (currParentTaxId != currTaxId) {
-            if (currTaxId == selctedTaxon) {
-                seqsAgreeWithSelectedTaxon++;
-                break;
-            }
-            currTaxId = currParentTaxId;
-            node = taxonNode(currParentTaxId, false);
-            currParentTaxId = node->parentTaxId;
+        if (lcaHelper(D[currTaxId], selectedId) == selectedId) {
+            seqsAgreeWithSelectedTaxon++;
         }
     }
 
@@ -703,9 +719,8 @@ WeightedTaxResult NcbiTaxonomy::weightedMajorityLCA(const std::vector<WeightedTa
 
 std::pair<char*, size_t> NcbiTaxonomy::serialize(const NcbiTaxonomy& t) {
     t.block->compact();
-    size_t matrixDim = (t.maxNodes * 2);
-    size_t matrixK = (int)(MathUtil::flog2(matrixDim)) + 1;
-    size_t matrixSize = matrixDim * matrixK * sizeof(int);
+    size_t rmqBlockCount = rmqBlocks(t.maxNodes);
+    size_t matrixSize = rmqBlockCount * rmqLevels(rmqBlockCount) * sizeof(int);
     size_t blockSize = StringBlock<unsigned int>::memorySize(*t.block);
     size_t memSize = sizeof(int) // SERIALIZATION_VERSION
         + sizeof(size_t) // maxNodes
@@ -715,6 +730,7 @@ std::pair<char*, size_t> NcbiTaxonomy::serialize(const NcbiTaxonomy& t) {
         + 2 * (t.maxNodes * 2) * sizeof(int) // E,L
         + t.maxNodes * sizeof(int) // H
         + matrixSize // M
+        + (t.maxNodes * 2) * sizeof(unsigned int) // S
         + blockSize; // block
 
     char* mem = (char*) malloc(memSize);
@@ -735,8 +751,10 @@ std::pair<char*, size_t> NcbiTaxonomy::serialize(const NcbiTaxonomy& t) {
     p += (t.maxNodes * 2) * sizeof(int);
     memcpy(p, t.H, t.maxNodes * sizeof(int));
     p += t.maxNodes * sizeof(int);
-    memcpy(p, t.M[0], matrixSize);
+    memcpy(p, t.M, matrixSize);
     p += matrixSize;
+    memcpy(p, t.S, (t.maxNodes * 2) * sizeof(unsigned int));
+    p += (t.maxNodes * 2) * sizeof(unsigned int);
     char* blockData = StringBlock<unsigned int>::serialize(*t.block);
     memcpy(p, blockData, blockSize);
     p += blockSize;
@@ -765,15 +783,11 @@ NcbiTaxonomy* NcbiTaxonomy::unserialize(char* mem) {
     p += (maxNodes * 2) * sizeof(int);
     int* H = (int*)p;
     p += maxNodes * sizeof(int);
-    size_t matrixDim = (maxNodes * 2);
-    size_t matrixK = (int)(MathUtil::flog2(matrixDim)) + 1;
-    size_t matrixSize = matrixDim * matrixK * sizeof(int);
-    int** M = new int*[matrixDim];
-    M[0] = (int*)p;
-    for(size_t i = 1; i < matrixDim; i++) {
-        M[i] = M[i-1] + matrixK;
-    }
-    p += matrixSize;
+    size_t rmqBlockCount = rmqBlocks(maxNodes);
+    int* M = (int*)p;
+    p += rmqBlockCount * rmqLevels(rmqBlockCount) * sizeof(int);
+    unsigned int* S = (unsigned int*)p;
+    p += (maxNodes * 2) * sizeof(unsigned int);
     StringBlock<unsigned int>* block = StringBlock<unsigned int>::unserialize(p);
-    return new NcbiTaxonomy(taxonNodes, maxNodes, maxTaxID, D, E, L, H, M, block);
+    return new NcbiTaxonomy(taxonNodes, maxNodes, maxTaxID, D, E, L, H, M, S, block);
 }
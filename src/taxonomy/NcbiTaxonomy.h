@@ -48,6 +48,21 @@ struct WeightedTaxResult {
     double selectedPercent;
 };
 
+// per thread scratch space of weightedMajorityLCA, indexed by internal node id
+// an entry is only valid if its epoch equals currentEpoch, so nothing has to be cleared between queries
+struct WeightedTaxAccumulator {
+    WeightedTaxAccumulator(size_t maxNodes)
+            : epoch(maxNodes, 0), weight(maxNodes), childTaxon(maxNodes), isCandidate(maxNodes), currentEpoch(0) {};
+
+    std::vector<unsigned int> epoch;
+    std::vector<double> weight;
+    std::vector<TaxID> childTaxon;
+    std::vector<char> isCandidate;
+    std::vector<int> touched;
+    std::vector<int> selected;
+    unsigned int currentEpoch;
+};
+
 struct TaxonCounts {
     unsigned int taxCount;       // number of reads/sequences matching to taxa
     unsigned int cladeCount;     // number of reads/sequences matching to taxa or its children
@@ -114,7 +129,7 @@ public:
 
     std::unordered_map<TaxID, TaxonCounts> getCladeCounts(std::unordered_map<TaxID, unsigned int>& taxonCounts) const;
 
-    WeightedTaxResult weightedMajorityLCA(const std::vector<WeightedTaxHit> &setTaxa, const float majorityCutoff);
+    WeightedTaxResult weightedMajorityLCA(const std::vector<WeightedTaxHit> &setTaxa, const float majorityCutoff, WeightedTaxAccumulator &acc);
 
     const char* getString(size_t blockIdx) const;
 
@@ -134,14 +149,15 @@ private:
     int RangeMinimumQuery(int i, int j) const;
     int lcaHelper(int i, int j) const;
 
-    NcbiTaxonomy(TaxonNode* taxonNodes, size_t maxNodes, int maxTaxID, int *D, int *E, int *L, int *H, int **M, StringBlock<unsigned int> *block)
-        : taxonNodes(taxonNodes), maxNodes(maxNodes), maxTaxID(maxTaxID), D(D), E(E), L(L), H(H), M(M), block(block), externalData(true), mmapData(NULL), mmapSize(0) {};
+    NcbiTaxonomy(TaxonNode* taxonNodes, size_t maxNodes, int maxTaxID, int *D, int *E, int *L, int *H, int *M, unsigned int *S, StringBlock<unsigned int> *block)
+        : taxonNodes(taxonNodes), maxNodes(maxNodes), maxTaxID(maxTaxID), D(D), E(E), L(L), H(H), M(M), S(S), block(block), externalData(true), mmapData(NULL), mmapSize(0) {};
     int maxTaxID;
     int *D; // maps from taxID to node ID in taxonNodes
     int *E; // for Euler tour sequence (size 2N-1)
     int *L; // Level of nodes in tour sequence (size 2N-1)
     int *H;
-    int **M;
+    int *M; // sparse table over the minima of blocks of the tour, one row of blocks per power of two
+    unsigned int *S; // in-block minimum candidates for each tour position
     StringBlock<unsigned int>* block;
 
     bool externalData;
@@ -58,6 +58,7 @@ int aggregate(const bool useAln, int argc, const char **argv, const Command& com
         // per thread variables
         const char *entry[255];
         std::vector<WeightedTaxHit> setTaxa;
+        WeightedTaxAccumulator accumulator(t->maxNodes);
 
         std::string setTaxStr;
         setTaxStr.reserve(4096);
@@ -115,7 +116,7 @@ int aggregate(const bool useAln, int argc, const char **argv, const Command& com
             }
 
             // aggregate - the counters will be filled by the selection function:
-            WeightedTaxResult result = t->weightedMajorityLCA(setTaxa, par.majorityThr);
+            WeightedTaxResult result = t->weightedMajorityLCA(setTaxa, par.majorityThr, accumulator);
             TaxonNode const * node = t->taxonNode(result.taxon, false);
 
             size_t totalNumSeqs = result.assignedSeqs + result.unassignedSeqs;
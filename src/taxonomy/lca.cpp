@@ -19,6 +19,7 @@ int dolca(int argc, const char **argv, const Command& command, bool majority) {
 
     DBReader<unsigned int> reader(par.db2.c_str(), par.db2Index.c_str(), par.threads, DBReader<unsigned int>::USE_DATA|DBReader<unsigned int>::USE_INDEX);
     reader.open(DBReader<unsigned int>::LINEAR_ACCCESS);
+    const bool binaryAlignment = Matcher::isBinaryAlignmentResult(reader.getDbtype());
 
     if (majority) {
         if (par.voteMode != Parameters::AGG_TAX_UNIFORM && Parameters::isEqualDbtype(reader.getDbtype(), Parameters::DBTYPE_CLUSTER_RES)) {
@@ -86,6 +87,9 @@ int dolca(int argc, const char **argv, const Command& command, bool majority) {
         const char *entry[255];
         std::string result;
         result.reserve(4096);
+        std::vector<int> taxa;
+        std::vector<WeightedTaxHit> weightedTaxa;
+        WeightedTaxAccumulator accumulator(majority ? t->maxNodes : 0);
         unsigned int thread_idx = 0;
 
 #ifdef OPENMP
@@ -100,17 +104,28 @@ int dolca(int argc, const char **argv, const Command& command, bool majority) {
             char *data = reader.getData(i, thread_idx);
             size_t length = reader.getEntryLen(i);
 
-            std::vector<int> taxa;
-            std::vector<WeightedTaxHit> weightedTaxa;
-            while (*data != '\0') {
-                const size_t columns = Util::getWordsOfLine(data, entry, 255);
-                data = Util::skipLine(data);
-                if (columns == 0) {
-                    Debug(Debug::WARNING) << "Empty entry: " << i << "!";
-                    continue;
+            taxa.clear();
+            weightedTaxa.clear();
+            const unsigned int binaryCount = binaryAlignment ? Matcher::getBinaryResultCount(data, length) : 0;
+            unsigned int binaryIdx = 0;
+            while (binaryAlignment ? (binaryIdx < binaryCount) : (*data != '\0')) {
+                const Matcher::result_bin_t *record = NULL;
+                size_t columns;
+                unsigned int id;
+                if (binaryAlignment) {
+                    record = &Matcher::getBinaryResults(data)[binaryIdx++];
+                    columns = Matcher::ALN_RES_WITHOUT_BT_COL_CNT;
+                    id = record->dbKey;
+                } else {
+                    columns = Util::getWordsOfLine(data, entry, 255);
+                    data = Util::skipLine(data);
+                    if (columns == 0) {
+                        Debug(Debug::WARNING) << "Empty entry: " << i << "!";
+                        continue;
+                    }
+                    id = Util::fast_atoi<unsigned int>(entry[0]);
                 }
 
-                unsigned int id = Util::fast_atoi<unsigned int>(entry[0]);
                 TaxID taxon = mapping.lookup(id);
                 if (taxon == 0) {
                     // TODO: Check which taxa were not found
@@ -139,13 +154,13 @@ int dolca(int argc, const char **argv, const Command& command, bool majority) {
                                 Debug(Debug::ERROR) << "No alignment result for taxon " << taxon << " found\n";
                                 EXIT(EXIT_FAILURE);
                             }
-                            weight = strtod(entry[3], NULL);
+                            weight = (record != NULL) ? record->eval : strtod(entry[3], NULL);
                         } else if (par.voteMode == Parameters::AGG_TAX_SCORE) {
                             if (columns <= 1) {
                                 Debug(Debug::ERROR) << "No alignment result for taxon " << taxon << " found\n";
                                 EXIT(EXIT_FAILURE);
                             }
-                            weight = strtod(entry[1], NULL);
+                            weight = (record != NULL) ? record->score : strtod(entry[1], NULL);
                         }
                         weightedTaxa.emplace_back(taxon, weight, par.voteMode);
                     } else {
@@ -161,7 +176,7 @@ int dolca(int argc, const char **argv, const Command& command, bool majority) {
 
             TaxonNode const * node = NULL;
             if (majority) {
-                WeightedTaxResult result = t->weightedMajorityLCA(weightedTaxa, par.majorityThr);
+                WeightedTaxResult result = t->weightedMajorityLCA(weightedTaxa, par.majorityThr, accumulator);
                 node = t->taxonNode(result.taxon, false);
             } else {
                 node = t->LCA(taxa);
@@ -0,0 +1,79 @@
+#include <iostream>
+#include <vector>
+
+#include "DBReader.h"
+#include "DBWriter.h"
+#include "Matcher.h"
+#include "Parameters.h"
+
+const char* binary_name = "test_binaryalignmentresult";
+
+bool sameResult(const Matcher::result_t &a, const Matcher::result_t &b) {
+    return a.dbKey == b.dbKey && a.score == b.score && a.seqId == b.seqId && a.eval == b.eval
+           && a.qStartPos == b.qStartPos && a.qEndPos == b.qEndPos && a.qLen == b.qLen
+           && a.dbStartPos == b.dbStartPos && a.dbEndPos == b.dbEndPos && a.dbLen == b.dbLen
+           && a.queryOrfStartPos == b.queryOrfStartPos && a.queryOrfEndPos == b.queryOrfEndPos
+           && a.dbOrfStartPos == b.dbOrfStartPos && a.dbOrfEndPos == b.dbOrfEndPos
+           && a.alnLength == b.alnLength && a.backtrace == b.backtrace;
+}
+
+// writes empty, single and large binary alignment entries with and without
+// database compression and checks that they read back unchanged
+int main (int, const char**) {
+    std::vector<std::vector<Matcher::result_t>> entries(4);
+    for (unsigned int i = 0; i < 300; i++) {
+        const int len = 50 + i % 7;
+        std::string backtrace = std::string(20, 'M') + std::string(i % 3, 'I') + std::string(len - 20, 'M');
+        const unsigned int alnLength = Matcher::computeAlnLength(2, 2 + len - 1 + i % 3, 4, 4 + len - 1);
+        entries[2].emplace_back(i, 100 + i, 0.0f, 0.0f, 0.5f + i * 0.001f, 1e-10 * (i + 1), alnLength,
+                                2, 2 + len - 1 + static_cast<int>(i % 3), 200, 4, 4 + len - 1, 300 + i,
+                                -1, -1, (i % 2) ? 10 : -1, (i % 2) ? 900 : -1, (i % 5) ? backtrace : "");
+    }
+    // a single record without backtrace
+    entries[1].emplace_back(7, 42, 0.0f, 0.0f, 0.9f, 0.001, 11, 0, 10, 20, 5, 15, 40, "");
+
+    const unsigned int modes[] = { 0, Parameters::WRITER_COMPRESSED_MODE };
+    int failed = 0;
+    for (size_t m = 0; m < 2; m++) {
+        DBWriter writer("dataBinaryAln", "dataBinaryAln.index", 1, modes[m], Parameters::DBTYPE_ALIGNMENT_BIN_RES);
+        writer.open();
+        std::string buffer;
+        for (size_t i = 0; i < entries.size(); i++) {
+            Matcher::resultsToBinaryBuffer(buffer, entries[i], true);
+            writer.writeData(buffer.c_str(), buffer.size(), i, 0);
+            buffer.clear();
+        }
+        writer.close();
+
+        DBReader<unsigned int> reader("dataBinaryAln", "dataBinaryAln.index", 1, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
+        reader.open(DBReader<unsigned int>::NOSORT);
+        std::vector<Matcher::result_t> results;
+        char line[1024 + 32768*4];
+        for (size_t i = 0; i < entries.size(); i++) {
+            size_t id = reader.getId(i);
+            char *data = reader.getData(id, 0);
+            Matcher::readAlignmentResults(results, data, reader.getEntryLen(id), true);
+            bool same = results.size() == entries[i].size();
+            for (size_t j = 0; same && j < results.size(); j++) {
+                same = sameResult(results[j], entries[i][j]);
+            }
+
+            // the text conversion has to match the text writer with compressed backtraces
+            std::string text;
+            Matcher::binaryResultsToText(data, reader.getEntryLen(id), text);
+            std::string expected;
+            for (size_t j = 0; j < entries[i].size(); j++) {
+                const Matcher::result_t &res = entries[i][j];
+                const bool hasOrfPosition = res.queryOrfStartPos != -1 || res.dbOrfStartPos != -1;
+                size_t len = Matcher::resultToBuffer(line, res, res.backtrace.empty() == false, true, hasOrfPosition);
+                expected.append(line, len);
+            }
+            same = same && text == expected;
+            std::cout << "compressed=" << m << " entry=" << i << " results=" << results.size() << (same ? " ok" : " FAILED") << std::endl;
+            failed += (same == false);
+            results.clear();
+        }
+        reader.close();
+    }
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,53 @@
+#include <iostream>
+#include <vector>
+
+#include "DBReader.h"
+#include "DBWriter.h"
+#include "Parameters.h"
+#include "QueryMatcher.h"
+
+const char* binary_name = "test_binaryprefilterresult";
+
+// writes binary prefilter entries of different sizes (empty, below the 60 byte
+// compression threshold and compressed) and checks that they read back unchanged
+int main (int, const char**) {
+    std::vector<std::vector<hit_t>> entries(4);
+    entries[1].push_back({ 7, 42, static_cast<unsigned short>(-3) });
+    for (unsigned int i = 0; i < 500; i++) {
+        entries[2].push_back({ i * 3, static_cast<int>(i % 97), static_cast<unsigned short>(i % 31) });
+    }
+
+    const unsigned int modes[] = { 0, Parameters::WRITER_COMPRESSED_MODE };
+    int failed = 0;
+    for (size_t m = 0; m < 2; m++) {
+        DBWriter writer("dataBinaryPref", "dataBinaryPref.index", 1, modes[m], Parameters::DBTYPE_PREFILTER_BIN_RES);
+        writer.open();
+        std::string buffer;
+        for (size_t i = 0; i < entries.size(); i++) {
+            QueryMatcher::prefilterHitsToBinaryBuffer(buffer, entries[i].data(), entries[i].size());
+            writer.writeData(buffer.c_str(), buffer.size(), i, 0);
+            buffer.clear();
+        }
+        writer.close();
+
+        DBReader<unsigned int> reader("dataBinaryPref", "dataBinaryPref.index", 1, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
+        reader.open(DBReader<unsigned int>::NOSORT);
+        std::vector<hit_t> hits;
+        for (size_t i = 0; i < entries.size(); i++) {
+            size_t id = reader.getId(i);
+            char *data = reader.getData(id, 0);
+            QueryMatcher::parsePrefilterHits(data, reader.getEntryLen(id), true, hits);
+            bool same = hits.size() == entries[i].size();
+            for (size_t j = 0; same && j < hits.size(); j++) {
+                same = hits[j].seqId == entries[i][j].seqId
+                       && hits[j].prefScore == entries[i][j].prefScore
+                       && hits[j].diagonal == entries[i][j].diagonal;
+            }
+            std::cout << "compressed=" << m << " entry=" << i << " hits=" << hits.size() << (same ? " ok" : " FAILED") << std::endl;
+            failed += (same == false);
+            hits.clear();
+        }
+        reader.close();
+    }
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,113 @@
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Command.h"
+#include "CommandDeclarations.h"
+#include "DBReader.h"
+#include "DBWriter.h"
+#include "Parameters.h"
+#include "QueryMatcher.h"
+
+const char* binary_name = "test_clusthashsketch";
+
+static std::string reverseComplement(const std::string &seq) {
+    std::string rc(seq.rbegin(), seq.rend());
+    for (size_t i = 0; i < rc.size(); i++) {
+        switch (rc[i]) {
+            case 'A': rc[i] = 'T'; break;
+            case 'C': rc[i] = 'G'; break;
+            case 'G': rc[i] = 'C'; break;
+            case 'T': rc[i] = 'A'; break;
+        }
+    }
+    return rc;
+}
+
+// substitutes every 50th base, so enough k-mers stay intact
+static std::string mutate(const std::string &seq, size_t offset) {
+    std::string mutated = seq;
+    for (size_t i = offset; i < mutated.size(); i += 50) {
+        mutated[i] = (mutated[i] == 'A') ? 'C' : 'A';
+    }
+    return mutated;
+}
+
+static bool findHit(const std::vector<hit_t> &hits, unsigned int key, hit_t &hit) {
+    for (size_t i = 0; i < hits.size(); i++) {
+        if (hits[i].seqId == key) {
+            hit = hits[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+// writes a sequence, a mutated copy and a mutated reverse complement, and checks that the clusthash sketch mode
+// reports the copy as a forward hit and the reverse complement as a reverse hit, both on diagonal 0
+int main (int, const char**) {
+    srand(1);
+    const char *bases = "ACGT";
+    std::string sequence;
+    for (size_t i = 0; i < 600; i++) {
+        sequence.push_back(bases[rand() % 4]);
+    }
+    std::string unrelated;
+    for (size_t i = 0; i < 600; i++) {
+        unrelated.push_back(bases[rand() % 4]);
+    }
+    const std::string seqs[] = { sequence, mutate(sequence, 7), reverseComplement(mutate(sequence, 23)), unrelated };
+    const unsigned int FORWARD = 1;
+    const unsigned int REVERSE = 2;
+    const unsigned int UNRELATED = 3;
+
+    DBWriter writer("dataSketch", "dataSketch.index", 1, 0, Parameters::DBTYPE_NUCLEOTIDES);
+    writer.open();
+    for (unsigned int i = 0; i < 4; i++) {
+        const std::string entry = seqs[i] + "\n";
+        writer.writeData(entry.c_str(), entry.size(), i, 0);
+    }
+    writer.close(true);
+
+    Parameters &par = Parameters::getInstance();
+    Command command = { "clusthash", clusthash, &par.clusthash, COMMAND_CLUSTER, "", NULL, "", "", CITATION_MMSEQS2,
+                        {{"sequenceDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::sequenceDb },
+                         {"alignmentDB", DbType::ACCESS_MODE_OUTPUT, DbType::NEED_DATA, &DbValidator::alignmentDb }}};
+    const char *argv[] = { "dataSketch", "dataSketchPref", "--hash-mode", "1", "--min-seq-id", "0.9", "--threads", "1", "-v", "1" };
+    clusthash(sizeof(argv) / sizeof(argv[0]), argv, command);
+
+    DBReader<unsigned int> reader("dataSketchPref", "dataSketchPref.index", 1, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
+    reader.open(DBReader<unsigned int>::NOSORT);
+    int failed = 0;
+    const bool isReverseDb = Parameters::isEqualDbtype(reader.getDbtype(), Parameters::DBTYPE_PREFILTER_REV_RES);
+    std::cout << "bi-directional prefilter result" << (isReverseDb ? " ok" : " FAILED") << std::endl;
+    failed += (isReverseDb == false);
+
+    const unsigned int queries[] = { 0, REVERSE };
+    for (size_t q = 0; q < 2; q++) {
+        const unsigned int queryKey = queries[q];
+        size_t id = reader.getId(queryKey);
+        std::vector<hit_t> hits;
+        if (id != UINT_MAX) {
+            hits = QueryMatcher::parsePrefilterHits(reader.getData(id, 0));
+        }
+        hit_t hit;
+        if (queryKey == 0) {
+            const bool ok = findHit(hits, FORWARD, hit) && hit.prefScore > 0 && static_cast<short>(hit.diagonal) == 0;
+            std::cout << "query " << queryKey << " forward hit" << (ok ? " ok" : " FAILED") << std::endl;
+            failed += (ok == false);
+        }
+        const unsigned int oppositeKey = (queryKey == REVERSE) ? 0 : REVERSE;
+        const bool ok = findHit(hits, oppositeKey, hit) && hit.prefScore < 0 && static_cast<short>(hit.diagonal) == 0;
+        std::cout << "query " << queryKey << " reverse hit" << (ok ? " ok" : " FAILED") << std::endl;
+        failed += (ok == false);
+        const bool noUnrelated = findHit(hits, UNRELATED, hit) == false;
+        std::cout << "query " << queryKey << " no unrelated hit" << (noUnrelated ? " ok" : " FAILED") << std::endl;
+        failed += (noUnrelated == false);
+    }
+    reader.close();
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
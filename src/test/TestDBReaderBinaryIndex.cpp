@@ -0,0 +1,89 @@
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "DBReader.h"
+#include "DBWriter.h"
+#include "FileUtil.h"
+#include "Parameters.h"
+
+const char* binary_name = "test_dbreaderbinaryindex";
+
+static bool sameIndex(DBReader<unsigned int> &a, DBReader<unsigned int> &b) {
+    if (a.getSize() != b.getSize() || a.getDataSize() != b.getDataSize()
+        || a.getMaxSeqLen() != b.getMaxSeqLen() || a.getLastKey() != b.getLastKey()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.getSize(); i++) {
+        if (a.getDbKey(i) != b.getDbKey(i) || a.getOffset(i) != b.getOffset(i) || a.getEntryLen(i) != b.getEntryLen(i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// writes a database from two threads, so that closing sorts the index and writes the binary index,
+// and checks that opening it through the binary index gives the same reader as parsing the text index
+// in all sort modes. A rewritten text index has to make the binary index stale.
+int main (int, const char**) {
+    const unsigned int entries = 5000;
+    DBWriter writer("dataBinaryIndex", "dataBinaryIndex.index", 2, 0, Parameters::DBTYPE_GENERIC_DB);
+    writer.open();
+    std::vector<std::string> expected(entries);
+    for (unsigned int i = 0; i < entries; i++) {
+        // keys are written out of order and with gaps
+        const unsigned int key = ((i * 7919) % entries) * 3;
+        expected[key / 3] = std::string(1 + (key * 13) % 97, 'A' + key % 26) + "\n";
+        writer.writeData(expected[key / 3].c_str(), expected[key / 3].size(), key, i % 2);
+    }
+    writer.close();
+
+    int failed = 0;
+    const std::string binaryIndex = DBReader<unsigned int>::binaryIndexFileName("dataBinaryIndex.index");
+    const bool hasBinaryIndex = FileUtil::fileExists(binaryIndex.c_str());
+    std::cout << "binary index written" << (hasBinaryIndex ? " ok" : " FAILED") << std::endl;
+    failed += (hasBinaryIndex == false);
+
+    // a copy of the text index has no binary index and is parsed
+    FileUtil::copyFile("dataBinaryIndex.index", "dataBinaryIndexText.index");
+    const int modes[] = { DBReader<unsigned int>::NOSORT, DBReader<unsigned int>::SORT_BY_LENGTH,
+                          DBReader<unsigned int>::LINEAR_ACCCESS, DBReader<unsigned int>::SORT_BY_OFFSET };
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        DBReader<unsigned int> binary("dataBinaryIndex", "dataBinaryIndex.index", 1, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
+        binary.open(modes[m]);
+        DBReader<unsigned int> text("dataBinaryIndex", "dataBinaryIndexText.index", 1, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
+        text.open(modes[m]);
+        bool same = sameIndex(binary, text) && binary.getSize() == entries;
+        for (size_t i = 0; same && i < binary.getSize(); i++) {
+            const unsigned int key = binary.getDbKey(i);
+            same = expected[key / 3] == binary.getData(i, 0);
+        }
+        std::cout << "mode=" << modes[m] << " entries=" << binary.getSize() << (same ? " ok" : " FAILED") << std::endl;
+        failed += (same == false);
+        text.close();
+        binary.close();
+    }
+
+    // rewrite the text index with the first half of the entries only
+    DBReader<unsigned int> full("dataBinaryIndex", "dataBinaryIndex.index", 1, DBReader<unsigned int>::USE_INDEX);
+    full.open(DBReader<unsigned int>::NOSORT);
+    FILE *index = fopen("dataBinaryIndex.index.tmp", "w");
+    char buffer[1024];
+    for (size_t i = 0; i < entries / 2; i++) {
+        size_t len = DBWriter::indexToBuffer(buffer, full.getDbKey(i), full.getOffset(i), full.getEntryLen(i));
+        fwrite(buffer, sizeof(char), len, index);
+    }
+    fclose(index);
+    full.close();
+    std::rename("dataBinaryIndex.index.tmp", "dataBinaryIndex.index");
+
+    DBReader<unsigned int> stale("dataBinaryIndex", "dataBinaryIndex.index", 1, DBReader<unsigned int>::USE_INDEX);
+    stale.open(DBReader<unsigned int>::NOSORT);
+    const bool ignored = stale.getSize() == entries / 2;
+    std::cout << "stale binary index ignored" << (ignored ? " ok" : " FAILED") << std::endl;
+    failed += (ignored == false);
+    stale.close();
+
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
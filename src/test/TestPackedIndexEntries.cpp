@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "IndexTable.h"
+
+const char* binary_name = "test_packedindexentries";
+
+// packs k-mer lists of different shapes (empty, odd and even lengths, lists longer than one
+// byte of length header, small and 4 byte seqId gaps, large positions) in several ranges and
+// checks that the packed table returns the same lists as the unpacked one
+int main (int, const char**) {
+    const int alphabetSize = 21;
+    const int kmerSize = 3;
+    IndexTable table(alphabetSize, kmerSize, true);
+    const size_t tableSize = table.getTableSize();
+
+    srand(1);
+    std::vector<size_t> offsets(tableSize + 1, 0);
+    std::vector<IndexEntryLocal> entries;
+    for (size_t kmer = 0; kmer < tableSize; kmer++) {
+        offsets[kmer] = entries.size();
+        size_t listSize;
+        switch (kmer % 5) {
+            case 0: listSize = 0; break;
+            case 1: listSize = 1; break;
+            case 2: listSize = 2 + rand() % 5; break;
+            case 3: listSize = 100 + rand() % 200; break;
+            default: listSize = (kmer % 1000 == 4) ? 20000 : rand() % 30; break;
+        }
+        unsigned int seqId = rand() % 1000;
+        for (size_t i = 0; i < listSize; i++) {
+            IndexEntryLocal entry;
+            entry.seqId = seqId;
+            entry.position_j = (i % 7 == 0) ? 65535 - rand() % 10 : rand() % 300;
+            entries.push_back(entry);
+            seqId += (i == 5) ? 20000000 : (i % 11 == 0) ? 70000 + rand() % 1000 : rand() % 3;
+        }
+    }
+    offsets[tableSize] = entries.size();
+    table.initTableByExternalData(1000000000, entries.size(), entries.data(), offsets.data());
+    // packing converts the offsets in place
+    const std::vector<size_t> expectedOffsets(offsets);
+
+    std::vector<unsigned char> packed;
+    std::vector<unsigned char> chunk;
+    // pack in uneven ranges, like createindex does in chunks
+    for (size_t start = 0; start < tableSize;) {
+        const size_t end = std::min(start + 1 + rand() % 1000, tableSize);
+        table.packRange(start, end, packed.size(), chunk);
+        packed.insert(packed.end(), chunk.begin(), chunk.end());
+        start = end;
+    }
+    table.finishPacking(packed.size());
+    packed.resize(packed.size() + IndexTable::PACKED_PADDING, 0);
+    const size_t packedSize = packed.size();
+
+    IndexTable packedTable(alphabetSize, kmerSize, true);
+    packedTable.initPackedTableByExternalData(1000000000, entries.size(), packed.data(), table.getOffsets());
+
+    size_t wrong = 0;
+    std::vector<IndexEntryLocal> list;
+    for (size_t kmer = 0; kmer < tableSize; kmer++) {
+        const size_t listSize = packedTable.getDBSeqListSize(kmer);
+        if (listSize != expectedOffsets[kmer + 1] - expectedOffsets[kmer]) {
+            wrong++;
+            continue;
+        }
+        list.resize(listSize);
+        packedTable.copyDBSeqList(kmer, list.data());
+        for (size_t i = 0; i < listSize; i++) {
+            const IndexEntryLocal &expected = entries[expectedOffsets[kmer] + i];
+            if (list[i].seqId != expected.seqId || list[i].position_j != expected.position_j) {
+                wrong++;
+                break;
+            }
+        }
+    }
+    std::cout << "entries=" << entries.size() << " bytes per entry=" << ((double) packedSize) / entries.size()
+              << " wrong lists=" << wrong << (wrong == 0 ? " ok" : " FAILED") << std::endl;
+    return wrong == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,280 @@
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <set>
+#include <vector>
+
+#include "ClusteringAlgorithms.h"
+#include "DBReader.h"
+#include "DBWriter.h"
+#include "FileUtil.h"
+#include "Parameters.h"
+
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+const char* binary_name = "test_setcover";
+
+// sequential greedy set cover with the tie-breaking of ClusteringAlgorithms: the set with the most
+// uncovered elements wins, ties go to the larger id, elements go to the first picked representative
+// with the best score
+static std::vector<std::pair<unsigned int, unsigned int>> greedySetCover(const std::vector<std::vector<std::pair<unsigned int, short>>> &sets) {
+    const size_t n = sets.size();
+    std::vector<int> size(n);
+    std::vector<bool> covered(n, false);
+    std::set<std::pair<int, unsigned int>> queue;
+    for (size_t i = 0; i < n; i++) {
+        size[i] = sets[i].size();
+        queue.emplace(size[i], i);
+    }
+    std::vector<unsigned int> picked;
+    while (queue.empty() == false) {
+        const unsigned int representative = (--queue.end())->second;
+        queue.erase(--queue.end());
+        picked.push_back(representative);
+        covered[representative] = true;
+        std::vector<unsigned int> newlyCovered;
+        for (size_t i = 0; i < sets[representative].size(); i++) {
+            const unsigned int element = sets[representative][i].first;
+            if (covered[element] == false) {
+                covered[element] = true;
+                queue.erase(std::make_pair(size[element], element));
+                newlyCovered.push_back(element);
+            }
+        }
+        for (size_t i = 0; i < newlyCovered.size(); i++) {
+            const std::vector<std::pair<unsigned int, short>> &set = sets[newlyCovered[i]];
+            for (size_t j = 0; j < set.size(); j++) {
+                const unsigned int decrease = set[j].first;
+                if (covered[decrease] == false && size[decrease] > 1) {
+                    queue.erase(std::make_pair(size[decrease], decrease));
+                    size[decrease]--;
+                    queue.emplace(size[decrease], decrease);
+                }
+            }
+        }
+    }
+
+    std::vector<unsigned int> assigned(n, UINT_MAX);
+    std::vector<short> best(n, SHRT_MIN);
+    for (size_t i = 0; i < picked.size(); i++) {
+        const std::vector<std::pair<unsigned int, short>> &set = sets[picked[i]];
+        for (size_t j = 0; j < set.size(); j++) {
+            if (set[j].second > best[set[j].first]) {
+                best[set[j].first] = set[j].second;
+                assigned[set[j].first] = picked[i];
+            }
+        }
+    }
+    for (size_t i = 0; i < picked.size(); i++) {
+        if (assigned[picked[i]] == UINT_MAX) {
+            assigned[picked[i]] = picked[i];
+        }
+    }
+    std::vector<std::pair<unsigned int, unsigned int>> result;
+    for (size_t i = 0; i < n; i++) {
+        result.emplace_back(assigned[i], i);
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+// the sequential set cover ClusteringAlgorithms used before picking sets in parallel rounds. Sets are kept
+// in size buckets, ties go to the set that is last in its bucket, which changes as sets move between buckets.
+static std::vector<std::pair<unsigned int, unsigned int>> baselineSetCover(const std::vector<std::vector<std::pair<unsigned int, short>>> &sets) {
+    const size_t n = sets.size();
+    std::vector<int> size(n);
+    size_t maxSize = 0;
+    for (size_t i = 0; i < n; i++) {
+        size[i] = sets[i].size();
+        maxSize = std::max(maxSize, sets[i].size());
+    }
+    std::vector<unsigned int> borders(maxSize + 1, 0);
+    std::vector<unsigned int> abundance(maxSize + 1, 0);
+    for (size_t i = 0; i < n; i++) {
+        abundance[size[i]]++;
+    }
+    for (size_t i = 1; i <= maxSize; i++) {
+        borders[i] = borders[i - 1] + abundance[i - 1];
+    }
+    std::vector<unsigned int> sorted(n);
+    std::vector<unsigned int> position(n);
+    std::fill(abundance.begin(), abundance.end(), 0);
+    for (size_t i = 0; i < n; i++) {
+        position[i] = borders[size[i]] + abundance[size[i]]++;
+        sorted[position[i]] = i;
+    }
+
+    std::vector<unsigned int> assigned(n, UINT_MAX);
+    std::vector<short> best(n, SHRT_MIN);
+    for (int64_t pos = n - 1; pos >= 0; pos--) {
+        const unsigned int representative = sorted[pos];
+        if (representative == UINT_MAX) {
+            continue;
+        }
+        size[representative] = 0;
+        sorted[position[representative]] = UINT_MAX;
+        assigned[representative] = representative;
+        const std::vector<std::pair<unsigned int, short>> &set = sets[representative];
+        for (size_t i = 0; i < set.size(); i++) {
+            const unsigned int element = set[i].first;
+            if (set[i].second > best[element]) {
+                assigned[element] = representative;
+                best[element] = set[i].second;
+            }
+            if (element != representative && size[element] >= 1) {
+                size[element] = 0;
+                sorted[position[element]] = UINT_MAX;
+            }
+        }
+        for (size_t i = 0; i < set.size(); i++) {
+            const unsigned int element = set[i].first;
+            if (element == representative) {
+                size[element] = -1;
+                continue;
+            }
+            if (size[element] < 0) {
+                continue;
+            }
+            size[element] = -1;
+            for (size_t j = 0; j < sets[element].size(); j++) {
+                const unsigned int decrease = sets[element][j].first;
+                if (size[decrease] <= 1) {
+                    continue;
+                }
+                const unsigned int oldPosition = position[decrease];
+                const unsigned int newPosition = borders[size[decrease]];
+                const unsigned int swap = sorted[newPosition];
+                if (swap != UINT_MAX) {
+                    position[swap] = oldPosition;
+                }
+                sorted[oldPosition] = swap;
+                sorted[newPosition] = decrease;
+                position[decrease] = newPosition;
+                borders[size[decrease]]++;
+                size[decrease]--;
+            }
+        }
+    }
+    std::vector<std::pair<unsigned int, unsigned int>> result;
+    for (size_t i = 0; i < n; i++) {
+        result.emplace_back(assigned[i], i);
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+static size_t countRepresentatives(const std::vector<std::pair<unsigned int, unsigned int>> &assignment) {
+    size_t count = 0;
+    for (size_t i = 0; i < assignment.size(); i++) {
+        count += (i == 0 || assignment[i].first != assignment[i - 1].first);
+    }
+    return count;
+}
+
+// builds a symmetric similarity graph with overlapping neighbourhoods and few distinct sequence
+// identities, so that many sets tie in size and elements tie in score, and large enough that the
+// set cover needs several windows of sets. The parallel set cover has to give the sequential result.
+int main (int, const char**) {
+    const unsigned int n = 60000;
+    srand(7);
+    std::vector<std::vector<std::pair<unsigned int, short>>> sets(n);
+    for (unsigned int i = 0; i < n; i++) {
+        sets[i].emplace_back(i, 1000);
+    }
+    for (unsigned int i = 0; i < n; i++) {
+        const unsigned int degree = (i % 97 == 0) ? 200 : rand() % 40;
+        for (unsigned int k = 0; k < degree; k++) {
+            const unsigned int j = (i + 1 + rand() % 150) % n;
+            bool exists = false;
+            for (size_t e = 0; e < sets[i].size() && exists == false; e++) {
+                exists = sets[i][e].first == j;
+            }
+            if (exists) {
+                continue;
+            }
+            const short seqId = 500 + 100 * (rand() % 4);
+            sets[i].emplace_back(j, seqId);
+            sets[j].emplace_back(i, seqId);
+        }
+    }
+
+    DBWriter seqWriter("dataSetCoverSeq", "dataSetCoverSeq.index", 1, 0, Parameters::DBTYPE_AMINO_ACIDS);
+    seqWriter.open();
+    DBWriter alnWriter("dataSetCoverAln", "dataSetCoverAln.index", 1, 0, Parameters::DBTYPE_ALIGNMENT_RES);
+    alnWriter.open();
+    std::string buffer;
+    char line[64];
+    for (unsigned int i = 0; i < n; i++) {
+        seqWriter.writeData("A\n", 2, i, 0);
+        for (size_t j = 0; j < sets[i].size(); j++) {
+            int len = snprintf(line, sizeof(line), "%u\t100\t%.3f\n", sets[i][j].first, sets[i][j].second / 1000.0f);
+            buffer.append(line, len);
+        }
+        alnWriter.writeData(buffer.c_str(), buffer.size(), i, 0);
+        buffer.clear();
+    }
+    seqWriter.close();
+    alnWriter.close();
+
+    std::vector<std::pair<unsigned int, unsigned int>> expected = greedySetCover(sets);
+
+    // ties are broken differently than by the sequential version, on this graph with many ties
+    // the number of clusters should still stay within 2%
+    int failed = 0;
+    std::vector<std::pair<unsigned int, unsigned int>> baseline = baselineSetCover(sets);
+    std::vector<unsigned int> baselineCluster(n);
+    std::vector<unsigned int> expectedCluster(n);
+    for (size_t i = 0; i < n; i++) {
+        baselineCluster[baseline[i].second] = baseline[i].first;
+        expectedCluster[expected[i].second] = expected[i].first;
+    }
+    size_t sameCluster = 0;
+    for (size_t i = 0; i < n; i++) {
+        sameCluster += baselineCluster[i] == expectedCluster[i];
+    }
+    const size_t baselineClusters = countRepresentatives(baseline);
+    const size_t expectedClusters = countRepresentatives(expected);
+    const bool close = expectedClusters <= baselineClusters + baselineClusters / 50
+                       && baselineClusters <= expectedClusters + expectedClusters / 50;
+    std::cout << "baseline clusters=" << baselineClusters << " clusters=" << expectedClusters
+              << " same representative=" << sameCluster << "/" << n << (close ? " ok" : " FAILED") << std::endl;
+    failed += (close == false);
+
+    // the last run spills the graph to temporary files
+    const int threadCounts[] = { 1, 2, 4, 8, 32, 4 };
+    const size_t runs = sizeof(threadCounts) / sizeof(threadCounts[0]);
+    for (size_t t = 0; t < runs; t++) {
+        const bool spill = t == runs - 1;
+#ifdef OPENMP
+        omp_set_num_threads(threadCounts[t]);
+#endif
+        DBReader<unsigned int> seqDbr("dataSetCoverSeq", "dataSetCoverSeq.index", threadCounts[t], DBReader<unsigned int>::USE_INDEX);
+        seqDbr.open(DBReader<unsigned int>::SORT_BY_ID);
+        DBReader<unsigned int> alnDbr("dataSetCoverAln", "dataSetCoverAln.index", threadCounts[t], DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
+        alnDbr.open(DBReader<unsigned int>::NOSORT);
+
+        ClusteringAlgorithms algorithm(&seqDbr, &alnDbr, threadCounts[t], Parameters::APC_SEQID, 1,
+                                       spill ? 1 : SIZE_MAX, "dataSetCoverSpill");
+        std::pair<unsigned int, unsigned int> *assignment = algorithm.execute(1);
+        size_t wrong = 0;
+        for (size_t i = 0; i < n; i++) {
+            wrong += assignment[i] != expected[i];
+        }
+        delete[] assignment;
+        // the spill files are removed as soon as they are mapped
+        const bool removed = FileUtil::fileExists("dataSetCoverSpill_elements") == false
+                             && FileUtil::fileExists("dataSetCoverSpill_scores") == false
+                             && FileUtil::fileExists("dataSetCoverSpill_compressed") == false;
+        std::cout << "threads=" << threadCounts[t] << (spill ? " spilled" : "") << " differing assignments=" << wrong
+                  << ((wrong == 0 && removed) ? " ok" : " FAILED") << std::endl;
+        failed += (wrong != 0 || removed == false);
+        seqDbr.close();
+        alnDbr.close();
+    }
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
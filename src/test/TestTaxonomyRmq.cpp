@@ -0,0 +1,73 @@
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "NcbiTaxonomy.h"
+
+const char* binary_name = "test_taxonomyrmq";
+
+static void writeTaxonomy(const std::vector<TaxID> &parent) {
+    FILE *nodes = fopen("rmqNodes.dmp", "w");
+    FILE *names = fopen("rmqNames.dmp", "w");
+    for (size_t i = 1; i < parent.size(); i++) {
+        fprintf(nodes, "%zu\t|\t%d\t|\tno rank\t|\n", i, parent[i]);
+        fprintf(names, "%zu\t|\ttaxon %zu\t|\t\t|\tscientific name\t|\n", i, i);
+    }
+    fclose(nodes);
+    fclose(names);
+    FILE *merged = fopen("rmqMerged.dmp", "w");
+    fclose(merged);
+}
+
+static TaxID naiveLca(const std::vector<TaxID> &parent, const std::vector<int> &depth, TaxID a, TaxID b) {
+    while (depth[a] > depth[b]) {
+        a = parent[a];
+    }
+    while (depth[b] > depth[a]) {
+        b = parent[b];
+    }
+    while (a != b) {
+        a = parent[a];
+        b = parent[b];
+    }
+    return a;
+}
+
+// builds random trees whose Euler tours end inside, at and just past the RMQ block
+// boundaries, mixing long chains and bushy levels, and compares the LCA of the
+// block-decomposed RMQ (also after a serialization round trip) with walking the parents
+int main (int, const char**) {
+    const size_t sizes[] = { 1, 2, 3, 15, 16, 17, 31, 32, 33, 64, 65, 1000, 20000 };
+    srand(42);
+    int failed = 0;
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        const size_t n = sizes[s];
+        std::vector<TaxID> parent(n + 1, 1);
+        std::vector<int> depth(n + 1, 0);
+        for (size_t i = 2; i <= n; i++) {
+            parent[i] = (rand() % 2) ? static_cast<TaxID>(i - 1) : 1 + rand() % static_cast<int>(i - 1);
+            depth[i] = depth[parent[i]] + 1;
+        }
+        writeTaxonomy(parent);
+
+        NcbiTaxonomy taxonomy("rmqNames.dmp", "rmqNodes.dmp", "rmqMerged.dmp");
+        std::pair<char*, size_t> serialized = NcbiTaxonomy::serialize(taxonomy);
+        NcbiTaxonomy *copy = NcbiTaxonomy::unserialize(serialized.first);
+
+        size_t wrong = 0;
+        const size_t queries = std::min(n * n, static_cast<size_t>(200000));
+        for (size_t q = 0; q < queries; q++) {
+            TaxID a = (queries == n * n) ? 1 + q / n : 1 + rand() % n;
+            TaxID b = (queries == n * n) ? 1 + q % n : 1 + rand() % n;
+            TaxID expected = naiveLca(parent, depth, a, b);
+            wrong += (taxonomy.LCA(a, b) != expected);
+            wrong += (copy->LCA(a, b) != expected);
+        }
+        std::cout << "nodes=" << n << " queries=" << queries << (wrong == 0 ? " ok" : " FAILED") << std::endl;
+        failed += (wrong != 0);
+        delete copy;
+        free(serialized.first);
+    }
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,232 @@
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "BandedNucleotideAligner.h"
+#include "EvalueComputation.h"
+#include "NucleotideMatrix.h"
+#include "Parameters.h"
+#include "Sequence.h"
+#include "WavefrontAligner.h"
+
+const char* binary_name = "test_wavefrontaligner";
+
+char random_base() {
+    const char table[4] = {'A', 'C', 'G', 'T'};
+    return table[rand() % 4];
+}
+
+std::string generate_random_sequence(int len) {
+    std::string seq;
+    for (int i = 0; i < len; i++) {
+        seq.push_back(random_base());
+    }
+    return seq;
+}
+
+// substitutes with rate x, inserts or deletes a base with rate d
+std::string generate_mutated_sequence(const std::string &seq, double x, double d) {
+    std::string mutated;
+    for (size_t i = 0; i < seq.size(); i++) {
+        const double r = static_cast<double>(rand()) / RAND_MAX;
+        if (r < x) {
+            char base = random_base();
+            while (base == seq[i]) {
+                base = random_base();
+            }
+            mutated.push_back(base);
+        } else if (r < x + d / 2) {
+            mutated.push_back(seq[i]);
+            mutated.push_back(random_base());
+        } else if (r >= x + d) {
+            mutated.push_back(seq[i]);
+        }
+    }
+    return mutated;
+}
+
+std::string cigarToString(const s_align &alignment) {
+    std::string cigar;
+    for (int32_t i = 0; i < alignment.cigarLen; i++) {
+        cigar += SSTR(SmithWaterman::cigar_int_to_len(alignment.cigar[i]));
+        cigar.push_back(SmithWaterman::cigar_int_to_op(alignment.cigar[i]));
+    }
+    return cigar;
+}
+
+// score of the cigar with the matrix and the ksw2 gap costs
+int cigarScore(const s_align &alignment, const Sequence &query, const Sequence &target, const NucleotideMatrix &subMat,
+               int gapOpen, int gapExtend) {
+    int score = 0;
+    int queryPos = alignment.qStartPos1;
+    int targetPos = alignment.dbStartPos1;
+    for (int32_t i = 0; i < alignment.cigarLen; i++) {
+        const int len = SmithWaterman::cigar_int_to_len(alignment.cigar[i]);
+        switch (SmithWaterman::cigar_int_to_op(alignment.cigar[i])) {
+            case 'M':
+                for (int pos = 0; pos < len; pos++) {
+                    score += subMat.subMatrix[query.numSequence[queryPos++]][target.numSequence[targetPos++]];
+                }
+                break;
+            case 'I':
+                score -= gapOpen + len * gapExtend;
+                queryPos += len;
+                break;
+            default:
+                score -= gapOpen + len * gapExtend;
+                targetPos += len;
+                break;
+        }
+    }
+    return (queryPos == alignment.qEndPos1 + 1 && targetPos == alignment.dbEndPos1 + 1) ? score : INT_MIN;
+}
+
+struct Comparison {
+    bool sameResult;
+    bool sameCigar;
+    // score of the wavefront cigar agrees with the reported score
+    bool consistent;
+    // the wavefront path scores at least as well as the ksw2 path under the matrix
+    bool atLeastKsw2;
+};
+
+Comparison compare(BandedNucleotideAligner &ksw2, BandedNucleotideAligner &wavefront, Sequence &query, Sequence &target,
+                   NucleotideMatrix &subMat, EvalueComputation &evaluer, int gapOpen, int gapExtend) {
+    std::string backtrace;
+    ksw2.initQuery(&query);
+    s_align ksw2Result = ksw2.align(&target, 0, false, backtrace, &evaluer);
+    backtrace.clear();
+    wavefront.initQuery(&query);
+    s_align wavefrontResult = wavefront.align(&target, 0, false, backtrace, &evaluer);
+
+    Comparison result;
+    result.sameResult = ksw2Result.score1 == wavefrontResult.score1
+                        && ksw2Result.qStartPos1 == wavefrontResult.qStartPos1 && ksw2Result.qEndPos1 == wavefrontResult.qEndPos1
+                        && ksw2Result.dbStartPos1 == wavefrontResult.dbStartPos1 && ksw2Result.dbEndPos1 == wavefrontResult.dbEndPos1;
+    result.sameCigar = cigarToString(ksw2Result) == cigarToString(wavefrontResult);
+    const int wavefrontScore = cigarScore(wavefrontResult, query, target, subMat, gapOpen, gapExtend);
+    result.consistent = wavefrontScore == static_cast<int>(wavefrontResult.score1);
+    result.atLeastKsw2 = wavefrontScore >= cigarScore(ksw2Result, query, target, subMat, gapOpen, gapExtend);
+    delete[] ksw2Result.cigar;
+    delete[] wavefrontResult.cigar;
+    return result;
+}
+
+// runs the wavefront aligner with the penalties BandedNucleotideAligner derives from the matrix on diagonal 0
+bool wavefrontAligns(NucleotideMatrix &subMat, Sequence &query, Sequence &target, int gapOpen, int gapExtend,
+                     int maxPenalty, float penaltyPerPosition) {
+    const int match = subMat.subMatrix[0][0];
+    const int mismatch = 2 * (match - subMat.subMatrix[0][1]);
+    WavefrontAligner aligner(mismatch, 2 * gapOpen, 2 * gapExtend + match, subMat.aa2num[static_cast<int>('X')]);
+    return aligner.align(query.numSequence, query.L, target.numSequence, target.L, 0,
+                         BandedNucleotideAligner::WAVEFRONT_START_BAND, maxPenalty, penaltyPerPosition);
+}
+
+// aligns random query target pairs with ksw2 and with the wavefront aligner and compares them
+// each line: pairs, pairs the wavefront aligner accepts with the BandedNucleotideAligner limits,
+// pairs with the same score and coordinates, pairs with the same cigar, pairs that were either left to ksw2
+// or have a wavefront score that matches its cigar and is at least the matrix score of the ksw2 cigar
+// ksw2 scores N/X as 0 while the wavefront aligner scores it as a mismatch like the matrix does,
+// so pairs are also checked by rescoring both cigars with the matrix
+int main (int, const char**) {
+    srand(1);
+    const int gapOpen = 5;
+    const int gapExtend = 2;
+    const int zdrop = 40;
+    const int pairs = 100;
+    int failed = 0;
+
+    Parameters& par = Parameters::getInstance();
+    par.initMatrices();
+    NucleotideMatrix subMat(par.scoringMatrixFile.values.nucleotide().c_str(), 1.0, 0.0);
+    EvalueComputation evaluer(100000, &subMat, gapOpen, gapExtend);
+    BandedNucleotideAligner ksw2(&subMat, 20000, gapOpen, gapExtend, zdrop, Parameters::NUCL_ALIGNER_KSW2);
+    BandedNucleotideAligner wavefront(&subMat, 20000, gapOpen, gapExtend, zdrop, Parameters::NUCL_ALIGNER_WAVEFRONT);
+    Sequence query(20000, Parameters::DBTYPE_NUCLEOTIDES, &subMat, 0, false, false);
+    Sequence target(20000, Parameters::DBTYPE_NUCLEOTIDES, &subMat, 0, false, false);
+    const int mismatch = 2 * (subMat.subMatrix[0][0] - subMat.subMatrix[0][1]);
+    const float penaltyPerPosition = static_cast<float>(mismatch) / BandedNucleotideAligner::WAVEFRONT_MAX_DIVERGENCE;
+
+    struct Setting {
+        const char *name;
+        int len;
+        // substitution and indel rate
+        double x;
+        double d;
+        // N runs in both sequences
+        bool unknown;
+        // beyond WAVEFRONT_MAX_DIVERGENCE or WAVEFRONT_MAX_PENALTY, has to be aligned by ksw2
+        bool divergent;
+    };
+    const Setting settings[] = {
+        {"similar",     1000,  0.01, 0.002, false, false},
+        {"indels",      1000,  0.02, 0.01,  false, false},
+        {"unknown",     1000,  0.01, 0.002, true,  false},
+        {"divergent",   1000,  0.25, 0.02,  false, true},
+        {"max-penalty", 15000, 0.04, 0.0,   false, true},
+    };
+    for (size_t s = 0; s < sizeof(settings) / sizeof(settings[0]); s++) {
+        const Setting &setting = settings[s];
+        int accepted = 0;
+        int sameResult = 0;
+        int sameCigar = 0;
+        int valid = 0;
+        for (int i = 0; i < pairs; i++) {
+            std::string querySeq = generate_random_sequence(setting.len);
+            std::string targetSeq = generate_mutated_sequence(querySeq, setting.x, setting.d);
+            if (setting.unknown) {
+                for (size_t pos = 100; pos + 5 < std::min(querySeq.size(), targetSeq.size()); pos += 300) {
+                    querySeq.replace(pos, 5, "NNNNN");
+                    targetSeq.replace(pos, 5, "NNNNN");
+                }
+            }
+            query.mapSequence(0, 0, querySeq.c_str(), querySeq.size());
+            target.mapSequence(1, 1, targetSeq.c_str(), targetSeq.size());
+            const int overlap = std::min(query.L, target.L);
+            const int maxPenalty = std::min(static_cast<int>(BandedNucleotideAligner::WAVEFRONT_MAX_PENALTY),
+                                            (overlap / BandedNucleotideAligner::WAVEFRONT_MAX_DIVERGENCE + 1) * mismatch);
+            accepted += wavefrontAligns(subMat, query, target, gapOpen, gapExtend, maxPenalty, penaltyPerPosition);
+            if (s == 4) {
+                // without the per position limit only the penalty cap rejects the pair
+                const bool capped = wavefrontAligns(subMat, query, target, gapOpen, gapExtend, maxPenalty, 1000.0f) == false
+                                    && wavefrontAligns(subMat, query, target, gapOpen, gapExtend, 4 * maxPenalty, 1000.0f);
+                failed += (capped == false);
+            }
+            Comparison result = compare(ksw2, wavefront, query, target, subMat, evaluer, gapOpen, gapExtend);
+            sameResult += result.sameResult;
+            sameCigar += result.sameCigar;
+            // pairs the wavefront aligner gives up on are left to ksw2
+            valid += (result.sameResult && result.sameCigar) || (result.consistent && result.atLeastKsw2);
+        }
+        std::cout << setting.name << "\t" << pairs << "\t" << accepted << "\t" << sameResult << "\t" << sameCigar << "\t" << valid << std::endl;
+        if (setting.divergent) {
+            failed += (accepted != 0 || sameResult != pairs || sameCigar != pairs);
+        } else {
+            failed += (valid != pairs);
+        }
+    }
+
+    // any other matrix is left to ksw2
+    NucleotideMatrix changedMat(par.scoringMatrixFile.values.nucleotide().c_str(), 1.0, 0.0);
+    changedMat.subMatrix[0][0] += 1;
+    BandedNucleotideAligner changedKsw2(&changedMat, 20000, gapOpen, gapExtend, zdrop, Parameters::NUCL_ALIGNER_KSW2);
+    BandedNucleotideAligner changedWavefront(&changedMat, 20000, gapOpen, gapExtend, zdrop, Parameters::NUCL_ALIGNER_WAVEFRONT);
+    int sameResult = 0;
+    int sameCigar = 0;
+    for (int i = 0; i < pairs; i++) {
+        std::string querySeq = generate_random_sequence(1000);
+        std::string targetSeq = generate_mutated_sequence(querySeq, 0.02, 0.01);
+        query.mapSequence(0, 0, querySeq.c_str(), querySeq.size());
+        target.mapSequence(1, 1, targetSeq.c_str(), targetSeq.size());
+        Comparison result = compare(changedKsw2, changedWavefront, query, target, changedMat, evaluer, gapOpen, gapExtend);
+        sameResult += result.sameResult;
+        sameCigar += result.sameCigar;
+    }
+    std::cout << "non-uniform\t" << pairs << "\t-\t" << sameResult << "\t" << sameCigar << "\t-" << std::endl;
+    failed += (sameResult != pairs || sameCigar != pairs);
+
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
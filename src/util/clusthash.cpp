@@ -8,16 +8,356 @@
 #include "DistanceCalculator.h"
 #include "Orf.h"
 #include "FastSort.h"
+#include "QueryMatcher.h"
+
+#include <cmath>
 
 #ifdef OPENMP
 #include <omp.h>
 #endif
 
+// MinHash sketches with one permutation hashing: each k-mer hash selects one of SKETCH_SIZE buckets,
+// every bucket keeps its smallest hash. Buckets are grouped into bands of SKETCH_ROWS, sequences
+// that agree in all buckets of at least one band become candidate pairs (LSH banding).
+const int SKETCH_SIZE = 32;
+const int SKETCH_ROWS = 2;
+const int SKETCH_BANDS = SKETCH_SIZE / SKETCH_ROWS;
+// bands shared by more sequences only pair the first sequence with all others
+const size_t SKETCH_MAX_BAND_PAIRS = 256;
+const unsigned int SKETCH_EMPTY = UINT_MAX;
+
+struct SketchBucket {
+    unsigned int hash;
+    // k-mer position in the sequence, used to estimate the diagonal
+    int pos;
+    // nucleotide k-mer was hashed as its reverse complement
+    bool reverse;
+};
+
+static inline size_t mixHash(size_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static inline void initSketch(SketchBucket *sketch) {
+    for (int i = 0; i < SKETCH_SIZE; ++i) {
+        sketch[i].hash = SKETCH_EMPTY;
+        sketch[i].pos = 0;
+        sketch[i].reverse = false;
+    }
+}
+
+static inline void addToSketch(SketchBucket *sketch, size_t mixed, int pos, bool reverse) {
+    const int bucket = static_cast<int>(mixed >> 59);
+    // SKETCH_EMPTY is reserved
+    const unsigned int value = std::min(static_cast<unsigned int>(mixed), SKETCH_EMPTY - 1);
+    if (value < sketch[bucket].hash) {
+        sketch[bucket].hash = value;
+        sketch[bucket].pos = pos;
+        sketch[bucket].reverse = reverse;
+    }
+}
+
+// fill empty buckets from the next filled bucket to the right
+static void fillEmptyBuckets(SketchBucket *sketch) {
+    for (int i = 0; i < SKETCH_SIZE; ++i) {
+        if (sketch[i].hash != SKETCH_EMPTY) {
+            continue;
+        }
+        for (int distance = 1; distance < SKETCH_SIZE; ++distance) {
+            const SketchBucket &source = sketch[(i + distance) % SKETCH_SIZE];
+            if (source.hash != SKETCH_EMPTY && source.hash < SKETCH_EMPTY - 1 - distance) {
+                sketch[i].hash = source.hash + distance;
+                sketch[i].pos = source.pos;
+                sketch[i].reverse = source.reverse;
+                break;
+            }
+        }
+    }
+}
+
+// returns false if the sequence is shorter than the k-mer
+static bool computeSketch(const unsigned char *seq, int length, int kmerSize, SketchBucket *sketch) {
+    initSketch(sketch);
+    if (length < kmerSize) {
+        return false;
+    }
+    // rolling version of Util::hash
+    const size_t A = 31;
+    size_t highestPower = 1;
+    for (int i = 1; i < kmerSize; ++i) {
+        highestPower *= A;
+    }
+    size_t h = Util::hash(seq, kmerSize);
+    for (int pos = 0; pos + kmerSize <= length; ++pos) {
+        if (pos > 0) {
+            h = (h - seq[pos - 1] * highestPower) * A + seq[pos + kmerSize - 1];
+        }
+        addToSketch(sketch, mixHash(h), pos, false);
+    }
+    fillEmptyBuckets(sketch);
+    return true;
+}
+
+// nucleotide k-mers are 2 bit encoded and hashed in their canonical form, the smaller of the k-mer
+// and its reverse complement, so that both strands of a sequence give the same sketch.
+// Each bucket remembers which strand its k-mer came from.
+// Soft-masked (lower case) bases count as regular bases, k-mers containing other letters are skipped.
+// returns false if the sequence has no valid k-mer
+static bool computeNuclSketch(const char *seq, int length, int kmerSize, SketchBucket *sketch) {
+    initSketch(sketch);
+    const uint64_t mask = (kmerSize < 32) ? ((1ull << (2 * kmerSize)) - 1) : UINT64_MAX;
+    const int complementShift = 2 * (kmerSize - 1);
+    uint64_t forward = 0;
+    uint64_t reverse = 0;
+    int validBases = 0;
+    bool hasKmer = false;
+    for (int i = 0; i < length; ++i) {
+        uint64_t code;
+        switch (seq[i]) {
+            case 'A': case 'a': code = 0; break;
+            case 'C': case 'c': code = 1; break;
+            case 'G': case 'g': code = 2; break;
+            case 'T': case 't': case 'U': case 'u': code = 3; break;
+            default:
+                validBases = 0;
+                continue;
+        }
+        forward = ((forward << 2) | code) & mask;
+        reverse = (reverse >> 2) | ((3 - code) << complementShift);
+        validBases++;
+        if (validBases >= kmerSize) {
+            addToSketch(sketch, mixHash(std::min(forward, reverse)), i - kmerSize + 1, reverse < forward);
+            hasKmer = true;
+        }
+    }
+    if (hasKmer == false) {
+        return false;
+    }
+    fillEmptyBuckets(sketch);
+    return true;
+}
+
+static int sketchDefaultKmerSize(int alphabetSize) {
+    // about 24 bits of k-mer space, so random k-mer matches between unrelated sequences are rare
+    return static_cast<int>(ceil(24.0 / log2(static_cast<double>(alphabetSize))));
+}
+
+static int writeSketchCandidates(Parameters &par, DBReader<unsigned int> &reader, BaseMatrix *subMat, bool isNuclInput) {
+    const int kmerSize = (par.kmerSize > 0) ? par.kmerSize : sketchDefaultKmerSize(isNuclInput ? 4 : par.alphabetSize.values.aminoacid());
+    if (isNuclInput && kmerSize > 32) {
+        Debug(Debug::ERROR) << "Nucleotide sketches support k-mer lengths up to 32\n";
+        EXIT(EXIT_FAILURE);
+    }
+    const size_t dbSize = reader.getSize();
+    Debug(Debug::INFO) << "Sketching sequences with k-mer length " << kmerSize << "...\n";
+
+    SketchBucket *sketches = new SketchBucket[dbSize * SKETCH_SIZE];
+    bool *hasSketch = new bool[dbSize];
+    Debug::Progress progress(dbSize);
+#pragma omp parallel
+    {
+        unsigned int thread_idx = 0;
+#ifdef OPENMP
+        thread_idx = static_cast<unsigned int>(omp_get_thread_num());
+#endif
+        if (isNuclInput) {
+#pragma omp for schedule(dynamic, 100)
+            for (size_t id = 0; id < dbSize; ++id) {
+                progress.updateProgress();
+                char *data = reader.getData(id, thread_idx);
+                int length = static_cast<int>(reader.getSeqLen(id));
+                hasSketch[id] = computeNuclSketch(data, length, kmerSize, sketches + id * SKETCH_SIZE);
+            }
+        } else {
+            Sequence seq(par.maxSeqLen, reader.getDbtype(), subMat, 0, false, false);
+#pragma omp for schedule(dynamic, 100)
+            for (size_t id = 0; id < dbSize; ++id) {
+                progress.updateProgress();
+                char *data = reader.getData(id, thread_idx);
+                seq.mapSequence(id, 0, data, reader.getSeqLen(id));
+                hasSketch[id] = computeSketch(seq.numSequence, seq.L, kmerSize, sketches + id * SKETCH_SIZE);
+            }
+        }
+    }
+
+    Debug(Debug::INFO) << "Binning sketches...\n";
+    std::pair<size_t, unsigned int> *bandSeqPair = new std::pair<size_t, unsigned int>[dbSize * SKETCH_BANDS];
+    size_t bandEntries = 0;
+    for (size_t id = 0; id < dbSize; ++id) {
+        if (hasSketch[id] == false) {
+            continue;
+        }
+        const SketchBucket *sketch = sketches + id * SKETCH_SIZE;
+        for (int band = 0; band < SKETCH_BANDS; ++band) {
+            size_t h = mixHash(band + 1);
+            for (int row = 0; row < SKETCH_ROWS; ++row) {
+                h = mixHash(h ^ sketch[band * SKETCH_ROWS + row].hash);
+            }
+            bandSeqPair[bandEntries++] = std::make_pair(h, static_cast<unsigned int>(id));
+        }
+    }
+    SORT_PARALLEL(bandSeqPair, bandSeqPair + bandEntries);
+
+    std::vector<size_t> binStarts;
+    for (size_t i = 0; i < bandEntries; ++i) {
+        if (i == 0 || bandSeqPair[i].first != bandSeqPair[i - 1].first) {
+            binStarts.push_back(i);
+        }
+    }
+    binStarts.push_back(bandEntries);
+
+    std::vector<std::pair<unsigned int, unsigned int>> candidates;
+#pragma omp parallel
+    {
+        std::vector<std::pair<unsigned int, unsigned int>> threadCandidates;
+#pragma omp for schedule(dynamic, 100) nowait
+        for (size_t bin = 0; bin < binStarts.size() - 1; ++bin) {
+            const size_t start = binStarts[bin];
+            const size_t end = binStarts[bin + 1];
+            const size_t queryEnd = (end - start > SKETCH_MAX_BAND_PAIRS) ? start + 1 : end;
+            for (size_t i = start; i < queryEnd; ++i) {
+                for (size_t j = i + 1; j < end; ++j) {
+                    if (bandSeqPair[i].second == bandSeqPair[j].second) {
+                        continue;
+                    }
+                    threadCandidates.emplace_back(bandSeqPair[i].second, bandSeqPair[j].second);
+                    threadCandidates.emplace_back(bandSeqPair[j].second, bandSeqPair[i].second);
+                }
+            }
+        }
+#pragma omp critical
+        candidates.insert(candidates.end(), threadCandidates.begin(), threadCandidates.end());
+    }
+    delete[] bandSeqPair;
+    SORT_PARALLEL(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    std::vector<size_t> queryStarts(dbSize + 1, 0);
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        queryStarts[candidates[i].first + 1]++;
+    }
+    for (size_t id = 0; id < dbSize; ++id) {
+        queryStarts[id + 1] += queryStarts[id];
+    }
+    Debug(Debug::INFO) << "Found " << candidates.size() << " candidate pairs\n";
+
+    // a mismatch destroys the k-mers covering it, so a pair with identity id shares about id^k of its k-mers
+    // keep pairs whose Jaccard estimate is within two standard deviations of the one expected at --min-seq-id
+    const double conservedAtThreshold = pow(par.seqIdThr, kmerSize);
+    const double jaccardAtThreshold = conservedAtThreshold / (2.0 - conservedAtThreshold);
+    const double minJaccard = jaccardAtThreshold - 2.0 * sqrt(jaccardAtThreshold * (1.0 - jaccardAtThreshold) / SKETCH_SIZE);
+
+    // nucleotide pairs on opposite strands are written as reverse hits with a negative score,
+    // their diagonal is relative to the reverse complement of the query
+    DBWriter writer(par.db2.c_str(), par.db2Index.c_str(), par.threads, par.compressed,
+                    isNuclInput ? Parameters::DBTYPE_PREFILTER_REV_RES : Parameters::DBTYPE_PREFILTER_RES);
+    writer.open();
+    Debug::Progress writeProgress(dbSize);
+#pragma omp parallel
+    {
+        unsigned int thread_idx = 0;
+#ifdef OPENMP
+        thread_idx = static_cast<unsigned int>(omp_get_thread_num());
+#endif
+        std::vector<hit_t> hits;
+        std::string result;
+        result.reserve(1024);
+        char buffer[100];
+        int diagonals[SKETCH_SIZE];
+        int reverseDiagonals[SKETCH_SIZE];
+
+#pragma omp for schedule(dynamic, 100)
+        for (size_t queryId = 0; queryId < dbSize; ++queryId) {
+            writeProgress.updateProgress();
+            const SketchBucket *querySketch = sketches + queryId * SKETCH_SIZE;
+            const int queryLen = static_cast<int>(reader.getSeqLen(queryId));
+            for (size_t i = queryStarts[queryId]; i < queryStarts[queryId + 1]; ++i) {
+                const unsigned int targetId = candidates[i].second;
+                const SketchBucket *targetSketch = sketches + targetId * SKETCH_SIZE;
+                int forwardMatches = 0;
+                int reverseMatches = 0;
+                for (int bucket = 0; bucket < SKETCH_SIZE; ++bucket) {
+                    if (querySketch[bucket].hash != targetSketch[bucket].hash) {
+                        continue;
+                    }
+                    if (querySketch[bucket].reverse == targetSketch[bucket].reverse) {
+                        diagonals[forwardMatches++] = querySketch[bucket].pos - targetSketch[bucket].pos;
+                    } else {
+                        // the query k-mer starts at queryLen - kmerSize - pos in the reverse complemented query
+                        reverseDiagonals[reverseMatches++] = (queryLen - kmerSize - querySketch[bucket].pos) - targetSketch[bucket].pos;
+                    }
+                }
+                const int matches = forwardMatches + reverseMatches;
+                const double jaccard = static_cast<double>(matches) / SKETCH_SIZE;
+                if (matches == 0 || jaccard < minJaccard) {
+                    continue;
+                }
+                // the pair is on the strand most shared k-mers agree on
+                const bool isReverse = reverseMatches > forwardMatches;
+                const int *strandDiagonals = isReverse ? reverseDiagonals : diagonals;
+                const int strandMatches = isReverse ? reverseMatches : forwardMatches;
+                // most frequent diagonal of the shared k-mers
+                int bestDiagonal = strandDiagonals[0];
+                int bestCount = 0;
+                for (int a = 0; a < strandMatches; ++a) {
+                    int count = 0;
+                    for (int b = 0; b < strandMatches; ++b) {
+                        count += (strandDiagonals[a] == strandDiagonals[b]);
+                    }
+                    if (count > bestCount) {
+                        bestCount = count;
+                        bestDiagonal = strandDiagonals[a];
+                    }
+                }
+                const double conserved = 2.0 * jaccard / (1.0 + jaccard);
+                hit_t hit;
+                hit.seqId = reader.getDbKey(targetId);
+                hit.prefScore = static_cast<int>(100.0 * pow(conserved, 1.0 / kmerSize) + 0.5);
+                if (isReverse) {
+                    hit.prefScore = -hit.prefScore;
+                }
+                hit.diagonal = static_cast<unsigned short>(static_cast<short>(bestDiagonal));
+                hits.push_back(hit);
+            }
+            std::sort(hits.begin(), hits.end(), hit_t::compareHitsByScoreAndId);
+
+            const unsigned int queryKey = reader.getDbKey(queryId);
+            hit_t self;
+            self.seqId = queryKey;
+            self.prefScore = 100;
+            self.diagonal = 0;
+            size_t len = QueryMatcher::prefilterHitToBuffer(buffer, self);
+            result.append(buffer, len);
+            for (size_t i = 0; i < hits.size(); ++i) {
+                len = QueryMatcher::prefilterHitToBuffer(buffer, hits[i]);
+                result.append(buffer, len);
+            }
+            writer.writeData(result.c_str(), result.length(), queryKey, thread_idx);
+            result.clear();
+            hits.clear();
+        }
+    }
+    writer.close();
+
+    delete[] hasSketch;
+    delete[] sketches;
+    return EXIT_SUCCESS;
+}
+
 int clusthash(int argc, const char **argv, const Command &command) {
     Parameters &par = Parameters::getInstance();
     par.alphabetSize = MultiParam<NuclAA<int>>(NuclAA<int>(Parameters::CLUST_HASH_DEFAULT_ALPH_SIZE,5));
     par.seqIdThr = (float)Parameters::CLUST_HASH_DEFAULT_MIN_SEQ_ID/100.0f;
     par.parseParameters(argc, argv, command, true, 0, 0);
+    // exact hashing works on a coarse alphabet, sketches need more informative k-mers
+    if (par.clustHashMode == Parameters::CLUST_HASH_MODE_SKETCH && par.PARAM_ALPH_SIZE.wasSet == false) {
+        par.alphabetSize = MultiParam<NuclAA<int>>(NuclAA<int>(Parameters::CLUST_LINEAR_DEFAULT_ALPH_SIZE, 5));
+    }
 
     DBReader<unsigned int> reader(par.db1.c_str(), par.db1Index.c_str(), par.threads, DBReader<unsigned int>::USE_DATA | DBReader<unsigned int>::USE_INDEX);
     reader.open(DBReader<unsigned int>::LINEAR_ACCCESS);
@@ -32,6 +372,15 @@ int clusthash(int argc, const char **argv, const Command &command) {
         subMat = new ReducedMatrix(sMat.probMatrix, sMat.subMatrixPseudoCounts, sMat.aa2num, sMat.num2aa, sMat.alphabetSize, par.alphabetSize.values.aminoacid(), 2.0);
     }
 
+    if (par.clustHashMode == Parameters::CLUST_HASH_MODE_SKETCH) {
+        int status = writeSketchCandidates(par, reader, subMat, isNuclInput);
+        reader.close();
+        if (subMat != NULL) {
+            delete subMat;
+        }
+        return status;
+    }
+
     DBWriter writer(par.db2.c_str(), par.db2Index.c_str(), par.threads, par.compressed, Parameters::DBTYPE_ALIGNMENT_RES);
     writer.open();
     Debug(Debug::INFO) << "Hashing sequences...\n";
@@ -12,6 +12,7 @@
 #include "MemoryMapped.h"
 #include "NcbiTaxonomy.h"
 #include "MappingReader.h"
+#include "QueryMatcher.h"
 
 #define ZSTD_STATIC_LINKING_ONLY
 #include <zstd.h>
@@ -23,6 +24,17 @@
 #include <omp.h>
 #endif
 
+// binary prefilter hits carry no alignment, only the target key, the prefilter score and the diagonal
+void readBinaryPrefilterResults(std::vector<Matcher::result_t> &results, const char *data, size_t entryLength) {
+    const hit_bin_t *hits = QueryMatcher::getBinaryPrefilterHits(data);
+    const unsigned int hitCount = QueryMatcher::getBinaryPrefilterHitCount(data, entryLength);
+    for (unsigned int i = 0; i < hitCount; ++i) {
+        const hit_bin_t hit = hits[i];
+        const int diagonal = static_cast<short>(hit.diagonal);
+        results.emplace_back(hit.seqId, hit.prefScore, 0.0f, 0.0f, 0.0f, 0.0, 0, std::max(diagonal, 0), std::max(diagonal, 0), 0,
+                             std::max(-diagonal, 0), std::max(-diagonal, 0), 0, "");
+    }
+}
 
 void printSeqBasedOnAln(std::string &out, const char *seq, unsigned int offset,
                         const std::string &bt, bool reverse, bool isReverseStrand,
@@ -254,6 +266,9 @@ int convertalignments(int argc, const char **argv, const Command &command) {
 
     DBReader<unsigned int> alnDbr(par.db3.c_str(), par.db3Index.c_str(), par.threads, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
     alnDbr.open(DBReader<unsigned int>::LINEAR_ACCCESS);
+    const bool binaryPrefilterInput = QueryMatcher::isBinaryPrefilterResult(alnDbr.getDbtype());
+    const bool binaryAlignmentInput = Matcher::isBinaryAlignmentResult(alnDbr.getDbtype());
+    const bool binaryInput = binaryPrefilterInput || binaryAlignmentInput;
 
     size_t localThreads = 1;
 #ifdef OPENMP
@@ -279,10 +294,25 @@ int convertalignments(int argc, const char **argv, const Command &command) {
 
         for (size_t i = 0; i < alnDbr.getSize(); i++) {
             char *data = alnDbr.getData(i, 0);
-            while (*data != '\0') {
-                char dbKeyBuffer[255 + 1];
-                Util::parseKey(data, dbKeyBuffer);
-                const unsigned int dbKey = (unsigned int) strtoul(dbKeyBuffer, NULL, 10);
+            // only the target keys are needed, binary records are read in place
+            unsigned int binaryCount = 0;
+            if (binaryPrefilterInput) {
+                binaryCount = QueryMatcher::getBinaryPrefilterHitCount(data, alnDbr.getEntryLen(i));
+            } else if (binaryAlignmentInput) {
+                binaryCount = Matcher::getBinaryResultCount(data, alnDbr.getEntryLen(i));
+            }
+            unsigned int binaryIdx = 0;
+            while (binaryInput ? binaryIdx < binaryCount : *data != '\0') {
+                unsigned int dbKey;
+                if (binaryPrefilterInput) {
+                    dbKey = QueryMatcher::getBinaryPrefilterHits(data)[binaryIdx++].seqId;
+                } else if (binaryAlignmentInput) {
+                    dbKey = Matcher::getBinaryResults(data)[binaryIdx++].dbKey;
+                } else {
+                    char dbKeyBuffer[255 + 1];
+                    Util::parseKey(data, dbKeyBuffer);
+                    dbKey = (unsigned int) strtoul(dbKeyBuffer, NULL, 10);
+                }
                 if (headerWritten[dbKey] == false) {
                     headerWritten[dbKey] = true;
                     unsigned int tId = tDbr->sequenceReader->getId(dbKey);
@@ -299,7 +329,9 @@ int convertalignments(int argc, const char **argv, const Command &command) {
                     resultWriter.writeAdd(buffer, count, 0);
                 }
                 resultWriter.writeEnd(0, 0, false, 0);
-                data = Util::skipLine(data);
+                if (binaryInput == false) {
+                    data = Util::skipLine(data);
+                }
             }
         }
         delete[] headerWritten;
@@ -349,6 +381,9 @@ int convertalignments(int argc, const char **argv, const Command &command) {
         std::string newBacktrace;
         newBacktrace.reserve(1024);
 
+        std::vector<Matcher::result_t> results;
+        results.reserve(300);
+
         const TaxonNode * taxonNode = NULL;
 
 #pragma omp  for schedule(dynamic, 10)
@@ -399,9 +434,14 @@ int convertalignments(int argc, const char **argv, const Command &command) {
             }
 
             char *data = alnDbr.getData(i, thread_idx);
-            while (*data != '\0') {
-                Matcher::result_t res = Matcher::parseAlignmentRecord(data, true);
-                data = Util::skipLine(data);
+            results.clear();
+            if (binaryPrefilterInput) {
+                readBinaryPrefilterResults(results, data, alnDbr.getEntryLen(i));
+            } else {
+                Matcher::readAlignmentResults(results, data, alnDbr.getEntryLen(i), binaryAlignmentInput, true);
+            }
+            for (size_t resIdx = 0; resIdx < results.size(); ++resIdx) {
+                Matcher::result_t &res = results[resIdx];
 
                 if (res.backtrace.empty() && needBacktrace == true) {
                     Debug(Debug::ERROR) << "Backtrace cigar is missing in the alignment result. Please recompute the alignment with the -a flag.\n"
@@ -816,7 +856,7 @@ int convertalignments(int argc, const char **argv, const Command &command) {
     // tsv output
     resultWriter.close(true);
     if (isDb == false) {
-        FileUtil::remove(par.db4Index.c_str());
+        DBWriter::removeIndex(par.db4Index.c_str());
     }
     if (needTaxonomy) {
         delete t;
@@ -12,6 +12,52 @@
 #include "KSeqWrapper.h"
 #include "itoa.h"
 
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+// input entries up to a record boundary
+struct CreatedbChunk {
+    struct Entry {
+        unsigned int id;
+        // offsets into data, with --createdb-mode 0 offsets into the input file
+        size_t headerOffset;
+        size_t headerLength;
+        size_t sequenceOffset;
+        size_t sequenceLength;
+    };
+    std::string data;
+    std::vector<Entry> entries;
+
+    void clear() {
+        data.clear();
+        entries.clear();
+    }
+};
+
+static const size_t CREATEDB_CHUNK_SIZE = 64 * 1024 * 1024;
+static const size_t CREATEDB_CHUNK_ENTRIES = 1024 * 1024;
+
+// writes the entries of a chunk that belong to one shuffle split
+static void writeChunk(const CreatedbChunk &chunk, unsigned int split, unsigned int shuffleSplits, bool softMode,
+                       DBWriter &hdrWriter, DBWriter &seqWriter) {
+    const char newline = '\n';
+    const size_t first = (split + shuffleSplits - chunk.entries[0].id % shuffleSplits) % shuffleSplits;
+    for (size_t i = first; i < chunk.entries.size(); i += shuffleSplits) {
+        const CreatedbChunk::Entry &e = chunk.entries[i];
+        if (softMode) {
+            hdrWriter.writeIndexEntry(e.id, e.headerOffset, e.headerLength, 0);
+            seqWriter.writeIndexEntry(e.id, e.sequenceOffset, e.sequenceLength, 0);
+        } else {
+            hdrWriter.writeData(chunk.data.c_str() + e.headerOffset, e.headerLength, e.id, split);
+            seqWriter.writeStart(split);
+            seqWriter.writeAdd(chunk.data.c_str() + e.sequenceOffset, e.sequenceLength, split);
+            seqWriter.writeAdd(&newline, 1, split);
+            seqWriter.writeEnd(e.id, split, true);
+        }
+    }
+}
+
 int createdb(int argc, const char **argv, const Command& command) {
     Parameters &par = Parameters::getInstance();
     par.parseParameters(argc, argv, command, true, Parameters::PARSE_VARIADIC, 0);
@@ -70,8 +116,6 @@ int createdb(int argc, const char **argv, const Command& command) {
     unsigned int entries_num = 0;
     size_t sampleCount = 0;
 
-    const char newline = '\n';
-
     const size_t testForNucSequence = 100;
     size_t isNuclCnt = 0;
     Debug::Progress progress;
@@ -104,83 +148,97 @@ int createdb(int argc, const char **argv, const Command& command) {
         fileCount = reader->getSize();
     }
 
-    for (size_t fileIdx = 0; fileIdx < fileCount; fileIdx++) {
-        unsigned int numEntriesInCurrFile = 0;
-        std::string header;
-        header.reserve(1024);
-
-        std::string sourceName;
-        if (dbInput == true) {
-            unsigned int dbKey = reader->getDbKey(fileIdx);
-            size_t lookupId = reader->getLookupIdByKey(dbKey);
-            sourceName = reader->getLookupEntryName(lookupId);
-        } else {
-            sourceName = FileUtil::baseName(filenames[fileIdx]);
-        }
-        char buffer[4096];
-        size_t len = snprintf(buffer, sizeof(buffer), "%zu\t%s\n", fileIdx, sourceName.c_str());
-        int written = fwrite(buffer, sizeof(char), len, source);
-        if (written != (int) len) {
-            Debug(Debug::ERROR) << "Cannot write to source file " << sourceFile << "\n";
-            EXIT(EXIT_FAILURE);
-        }
+    size_t fileIdx = 0;
+    unsigned int numEntriesInCurrFile = 0;
+    KSeqWrapper* kseq = NULL;
+    std::string sourceName;
+    std::string header;
+    header.reserve(1024);
+    bool restart = false;
+    // reads the input entries into chunk until it is full
+    // stops early at the end of the input or if createdb has to be restarted with --createdb-mode 1
+    auto readChunk = [&](CreatedbChunk &chunk) {
+        chunk.clear();
+        while (restart == false && fileIdx < fileCount && chunk.data.size() < CREATEDB_CHUNK_SIZE && chunk.entries.size() < CREATEDB_CHUNK_ENTRIES) {
+            if (kseq == NULL) {
+                numEntriesInCurrFile = 0;
+                if (dbInput == true) {
+                    unsigned int dbKey = reader->getDbKey(fileIdx);
+                    size_t lookupId = reader->getLookupIdByKey(dbKey);
+                    sourceName = reader->getLookupEntryName(lookupId);
+                } else {
+                    sourceName = FileUtil::baseName(filenames[fileIdx]);
+                }
+                char buffer[4096];
+                size_t len = snprintf(buffer, sizeof(buffer), "%zu\t%s\n", fileIdx, sourceName.c_str());
+                int written = fwrite(buffer, sizeof(char), len, source);
+                if (written != (int) len) {
+                    Debug(Debug::ERROR) << "Cannot write to source file " << sourceFile << "\n";
+                    EXIT(EXIT_FAILURE);
+                }
 
-        KSeqWrapper* kseq = NULL;
-        if (dbInput == true) {
-            kseq = new KSeqBuffer(reader->getData(fileIdx, 0), reader->getEntryLen(fileIdx) - 1);
-        } else {
-            kseq = KSeqFactory(filenames[fileIdx].c_str());
-        }
+                if (dbInput == true) {
+                    kseq = new KSeqBuffer(reader->getData(fileIdx, 0), reader->getEntryLen(fileIdx) - 1);
+                } else {
+                    kseq = KSeqFactory(filenames[fileIdx].c_str());
+                }
 
-        bool resetNotFile = par.createdbMode == Parameters::SEQUENCE_SPLIT_MODE_SOFT && kseq->type != KSeqWrapper::KSEQ_FILE;
-        if (resetNotFile) {
-            Debug(Debug::WARNING) << "Only uncompressed fasta files can be used with --createdb-mode 0\n";
-            Debug(Debug::WARNING) << "We recompute with --createdb-mode 1\n";
-        }
+                bool resetNotFile = par.createdbMode == Parameters::SEQUENCE_SPLIT_MODE_SOFT && kseq->type != KSeqWrapper::KSEQ_FILE;
+                if (resetNotFile) {
+                    Debug(Debug::WARNING) << "Only uncompressed fasta files can be used with --createdb-mode 0\n";
+                    Debug(Debug::WARNING) << "We recompute with --createdb-mode 1\n";
+                }
 
-        bool resetIncorrectNewline = false;
-        if (par.createdbMode == Parameters::SEQUENCE_SPLIT_MODE_SOFT && kseq->type == KSeqWrapper::KSEQ_FILE) {
-            // get last byte from filenames[fileIdx].c_str()
-            FILE* fp = fopen(filenames[fileIdx].c_str(), "rb");
-            if (fp == NULL) {
-                Debug(Debug::ERROR) << "Cannot open file " << filenames[fileIdx] << "\n";
-                EXIT(EXIT_FAILURE);
-            }
-            int res = fseek(fp, -1, SEEK_END);
-            if (res != 0) {
-                Debug(Debug::ERROR) << "Cannot seek at the end of file " << filenames[fileIdx] << "\n";
-                EXIT(EXIT_FAILURE);
-            }
-            int lastChar = fgetc(fp);
-            if (lastChar == EOF) {
-                Debug(Debug::ERROR) << "Error reading from " << filenames[fileIdx] << "\n";
-                EXIT(EXIT_FAILURE);
-            }
-            if (fclose(fp) != 0) {
-                Debug(Debug::ERROR) << "Error closing " << filenames[fileIdx] << "\n";
-                EXIT(EXIT_FAILURE);
-            }
-            if (lastChar != '\n') {
-                Debug(Debug::WARNING) << "Last byte is not a newline. We recompute with --createdb-mode 1\n";
-                resetIncorrectNewline = true;
-            }
-        }
-        if (resetNotFile || resetIncorrectNewline) {
-            par.createdbMode = Parameters::SEQUENCE_SPLIT_MODE_HARD;
-            progress.reset(SIZE_MAX);
-            hdrWriter.close();
-            seqWriter.close();
-            delete kseq;
-            if (fclose(source) != 0) {
-                Debug(Debug::ERROR) << "Cannot close file " << sourceFile << "\n";
-                EXIT(EXIT_FAILURE);
+                bool resetIncorrectNewline = false;
+                if (par.createdbMode == Parameters::SEQUENCE_SPLIT_MODE_SOFT && kseq->type == KSeqWrapper::KSEQ_FILE) {
+                    // get last byte from filenames[fileIdx].c_str()
+                    FILE* fp = fopen(filenames[fileIdx].c_str(), "rb");
+                    if (fp == NULL) {
+                        Debug(Debug::ERROR) << "Cannot open file " << filenames[fileIdx] << "\n";
+                        EXIT(EXIT_FAILURE);
+                    }
+                    int res = fseek(fp, -1, SEEK_END);
+                    if (res != 0) {
+                        Debug(Debug::ERROR) << "Cannot seek at the end of file " << filenames[fileIdx] << "\n";
+                        EXIT(EXIT_FAILURE);
+                    }
+                    int lastChar = fgetc(fp);
+                    if (lastChar == EOF) {
+                        Debug(Debug::ERROR) << "Error reading from " << filenames[fileIdx] << "\n";
+                        EXIT(EXIT_FAILURE);
+                    }
+                    if (fclose(fp) != 0) {
+                        Debug(Debug::ERROR) << "Error closing " << filenames[fileIdx] << "\n";
+                        EXIT(EXIT_FAILURE);
+                    }
+                    if (lastChar != '\n') {
+                        Debug(Debug::WARNING) << "Last byte is not a newline. We recompute with --createdb-mode 1\n";
+                        resetIncorrectNewline = true;
+                    }
+                }
+                if (resetNotFile || resetIncorrectNewline) {
+                    par.createdbMode = Parameters::SEQUENCE_SPLIT_MODE_HARD;
+                    restart = true;
+                    break;
+                }
             }
-            for (size_t i = 0; i < shuffleSplits; ++i) {
-                sourceLookup[i].clear();
+
+            if (kseq->ReadEntry() == false) {
+                if (numEntriesInCurrFile == 0) {
+                    Debug(Debug::WARNING) << "File " << sourceName << " is empty or invalid and was ignored\n";
+                }
+
+                delete kseq;
+                kseq = NULL;
+                if (filenames.size() > 1 && par.createdbMode == Parameters::SEQUENCE_SPLIT_MODE_SOFT) {
+                    size_t fileSize = FileUtil::getFileSize(filenames[fileIdx].c_str());
+                    headerFileOffset += fileSize;
+                    seqFileOffset += fileSize;
+                }
+                fileIdx++;
+                continue;
             }
-            goto redoComputation;
-        }
-        while (kseq->ReadEntry()) {
+
             progress.updateProgress();
             const KSeqWrapper::KSeqEntry &e = kseq->entry;
             if (e.name.l == 0) {
@@ -239,51 +297,74 @@ int createdb(int argc, const char **argv, const Command& command) {
                     }
                     Debug(Debug::WARNING) << "We recompute with --createdb-mode 1\n";
                     par.createdbMode = Parameters::SEQUENCE_SPLIT_MODE_HARD;
-                    progress.reset(SIZE_MAX);
-                    hdrWriter.close();
-                    seqWriter.close();
-                    delete kseq;
-                    if (fclose(source) != 0) {
-                        Debug(Debug::ERROR) << "Cannot close file " << sourceFile << "\n";
-                        EXIT(EXIT_FAILURE);
-                    }
-                    for (size_t i = 0; i < shuffleSplits; ++i) {
-                        sourceLookup[i].clear();
-                    }
-                    goto redoComputation;
+                    restart = true;
+                    break;
                 }
             }
 
-            // Finally write down the entry
+            // the entry is written down by the writer tasks
             unsigned int splitIdx = id % shuffleSplits;
             sourceLookup[splitIdx].emplace_back(fileIdx);
+            CreatedbChunk::Entry entry;
+            entry.id = id;
             if (par.createdbMode == Parameters::SEQUENCE_SPLIT_MODE_SOFT) {
                 // +2 to emulate the \n\0
-                hdrWriter.writeIndexEntry(id, headerFileOffset + e.headerOffset, (e.sequenceOffset-e.headerOffset)+1, 0);
-                seqWriter.writeIndexEntry(id, seqFileOffset + e.sequenceOffset, e.sequence.l+2, 0);
+                entry.headerOffset = headerFileOffset + e.headerOffset;
+                entry.headerLength = (e.sequenceOffset-e.headerOffset)+1;
+                entry.sequenceOffset = seqFileOffset + e.sequenceOffset;
+                entry.sequenceLength = e.sequence.l+2;
             } else {
-                hdrWriter.writeData(header.c_str(), header.length(), id, splitIdx);
-                seqWriter.writeStart(splitIdx);
-                seqWriter.writeAdd(e.sequence.s, e.sequence.l, splitIdx);
-                seqWriter.writeAdd(&newline, 1, splitIdx);
-                seqWriter.writeEnd(id, splitIdx, true);
+                entry.headerOffset = chunk.data.size();
+                entry.headerLength = header.length();
+                chunk.data.append(header);
+                entry.sequenceOffset = chunk.data.size();
+                entry.sequenceLength = e.sequence.l;
+                chunk.data.append(e.sequence.s, e.sequence.l);
             }
+            chunk.entries.push_back(entry);
 
             entries_num++;
             numEntriesInCurrFile++;
             header.clear();
         }
-
-        if (numEntriesInCurrFile == 0) {
-            Debug(Debug::WARNING) << "File " << sourceName << " is empty or invalid and was ignored\n";
+    };
+
+    // the next chunk is read while the writer tasks of each shuffle split write the current one
+    const bool softMode = par.createdbMode == Parameters::SEQUENCE_SPLIT_MODE_SOFT;
+    CreatedbChunk chunks[2];
+    readChunk(chunks[0]);
+#pragma omp parallel num_threads(par.threads)
+    {
+#pragma omp single
+        {
+            for (size_t current = 0; chunks[current].entries.empty() == false; current ^= 1) {
+#pragma omp task
+                readChunk(chunks[current ^ 1]);
+
+                for (unsigned int split = 0; split < shuffleSplits; split++) {
+#pragma omp task
+                    writeChunk(chunks[current], split, shuffleSplits, softMode, hdrWriter, seqWriter);
+                }
+#pragma omp taskwait
+            }
         }
+    }
 
-        delete kseq;
-        if (filenames.size() > 1 && par.createdbMode == Parameters::SEQUENCE_SPLIT_MODE_SOFT) {
-            size_t fileSize = FileUtil::getFileSize(filenames[fileIdx].c_str());
-            headerFileOffset += fileSize;
-            seqFileOffset += fileSize;
+    if (restart == true) {
+        progress.reset(SIZE_MAX);
+        hdrWriter.close();
+        seqWriter.close();
+        if (kseq != NULL) {
+            delete kseq;
+        }
+        if (fclose(source) != 0) {
+            Debug(Debug::ERROR) << "Cannot close file " << sourceFile << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+        for (size_t i = 0; i < shuffleSplits; ++i) {
+            sourceLookup[i].clear();
         }
+        goto redoComputation;
     }
     Debug(Debug::INFO) << "\n";
     if (fclose(source) != 0) {
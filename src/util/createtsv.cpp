@@ -165,9 +165,9 @@ int createtsv(int argc, const char **argv, const Command &command) {
 
     if (par.dbOut == false) {
         if (hasTargetDB) {
-            FileUtil::remove(par.db4Index.c_str());
+            DBWriter::removeIndex(par.db4Index.c_str());
         } else {
-            FileUtil::remove(par.db3Index.c_str());
+            DBWriter::removeIndex(par.db3Index.c_str());
         }
     }
 
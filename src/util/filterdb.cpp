@@ -6,6 +6,8 @@
 #include "FileUtil.h"
 #include "ExpressionParser.h"
 #include "FastSort.h"
+#include "QueryMatcher.h"
+#include "Matcher.h"
 #include <fstream>
 #include <random>
 #include <iostream>
@@ -97,7 +99,16 @@ int filterdb(int argc, const char **argv, const Command &command) {
     DBReader<unsigned int> reader(par.db1.c_str(), par.db1Index.c_str(), par.threads, DBReader<unsigned int>::USE_INDEX | DBReader<unsigned int>::USE_DATA);
     reader.open(DBReader<unsigned int>::LINEAR_ACCCESS);
 
-    DBWriter writer(par.db2.c_str(), par.db2Index.c_str(), par.threads, par.compressed, reader.getDbtype());
+    // binary prefilter results are filtered as text lines and written back as text
+    const bool binaryPrefilterInput = QueryMatcher::isBinaryPrefilterResult(reader.getDbtype());
+    const bool binaryAlignmentInput = Matcher::isBinaryAlignmentResult(reader.getDbtype());
+    int outputDbtype = reader.getDbtype();
+    if (binaryPrefilterInput) {
+        outputDbtype = Parameters::DBTYPE_PREFILTER_RES;
+    } else if (binaryAlignmentInput) {
+        outputDbtype = Parameters::DBTYPE_ALIGNMENT_RES;
+    }
+    DBWriter writer(par.db2.c_str(), par.db2Index.c_str(), par.threads, par.compressed, outputDbtype);
     writer.open();
 
     // FILE_FILTERING
@@ -238,6 +249,8 @@ int filterdb(int argc, const char **argv, const Command &command) {
 
         std::vector<std::pair<double, std::string>> toSort;
 
+        std::string binaryText;
+
         char dbKeyBuffer[255 + 1];
 
         // EXPRESSION_FILTERING
@@ -260,6 +273,16 @@ int filterdb(int argc, const char **argv, const Command &command) {
             char *data = reader.getData(id, thread_idx);
             unsigned int queryKey = reader.getDbKey(id);
             size_t dataLength = reader.getEntryLen(id);
+            if (binaryPrefilterInput || binaryAlignmentInput) {
+                binaryText.clear();
+                if (binaryPrefilterInput) {
+                    QueryMatcher::binaryPrefilterHitsToText(data, dataLength, binaryText);
+                } else {
+                    Matcher::binaryResultsToText(data, dataLength, binaryText);
+                }
+                data = (char *) binaryText.c_str();
+                dataLength = binaryText.size() + 1;
+            }
             int counter = 0;
 
             bool addSelfMatch = false;
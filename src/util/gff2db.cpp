@@ -172,7 +172,7 @@ int gff2db(int argc, const char **argv, const Command &command) {
         }
     }
     lookupWriter.close(true);
-    FileUtil::remove(lookupWriter.getIndexFileName());
+    DBWriter::removeIndex(lookupWriter.getIndexFileName());
     headerWriter.close(true);
     writer.close(true);
     headerReader.close();
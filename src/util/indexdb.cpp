@@ -4,6 +4,8 @@
 #include "PrefilteringIndexReader.h"
 #include "Prefiltering.h"
 #include "Parameters.h"
+#include "EvalueComputation.h"
+#include "NucleotideMatrix.h"
 
 #ifdef OPENMP
 #include <omp.h>
@@ -173,11 +175,35 @@ int indexdb(int argc, const char **argv, const Command &command) {
             alndbr->open(DBReader<unsigned int>::NOSORT);
         }
 
+        // store E-value parameters that are not built in, so alignments against the index do not rerun ALP
+        // translated searches align with a scoring that is not known from the indexed database alone
+        std::string evalueParameters;
+        const bool isTranslated = par.searchType == Parameters::SEARCH_TYPE_TRANSLATED || par.searchType == Parameters::SEARCH_TYPE_TRANS_NUCL_ALN;
+        if (isProfileSearch == false && isTranslated == false) {
+            BaseMatrix *alignSubMat;
+            int gapOpen, gapExtend;
+            if (db1IsNucl) {
+                alignSubMat = new NucleotideMatrix(par.scoringMatrixFile.values.nucleotide().c_str(), 1.0, par.scoreBias);
+                gapOpen = par.gapOpen.values.nucleotide();
+                gapExtend = par.gapExtend.values.nucleotide();
+            } else {
+                alignSubMat = new SubstitutionMatrix(par.scoringMatrixFile.values.aminoacid().c_str(), 2.0, par.scoreBias);
+                gapOpen = par.gapOpen.values.aminoacid();
+                gapExtend = par.gapExtend.values.aminoacid();
+            }
+            if (EvalueComputation::hasDefaultParameters(alignSubMat, gapOpen, gapExtend, true) == false) {
+                EvalueComputation evaluer(dbr.getAminoAcidDBSize(), alignSubMat, gapOpen, gapExtend);
+                evalueParameters = EvalueComputation::getCacheEntry(alignSubMat, gapOpen, gapExtend, true);
+            }
+            delete alignSubMat;
+        }
+
         DBReader<unsigned int>::removeDb(indexDB);
         PrefilteringIndexReader::createIndexFile(indexDB, &dbr, dbr2, hdbr1, hdbr2, alndbr, seedSubMat, par.maxSeqLen,
                                                  par.spacedKmer, par.spacedKmerPattern, par.compBiasCorrection,
                                                  seedSubMat->alphabetSize, par.kmerSize, par.maskMode, par.maskLowerCaseMode,
-                                                 par.maskProb, kmerScore, par.targetSearchMode, par.split, par.indexSubset);
+                                                 par.maskProb, kmerScore, par.targetSearchMode, par.split, par.indexSubset,
+                                                 evalueParameters, par.packIndexEntries);
 
         if (alndbr != NULL) {
             alndbr->close();
@@ -4,6 +4,8 @@
 #include "Debug.h"
 #include "Parameters.h"
 #include "Util.h"
+#include "QueryMatcher.h"
+#include "Matcher.h"
 
 int mergedbs(int argc, const char **argv, const Command& command) {
     Parameters& par = Parameters::getInstance();
@@ -28,6 +30,26 @@ int mergedbs(int argc, const char **argv, const Command& command) {
         filesToMerge[i]->open(DBReader<unsigned int>::NOSORT);
     }
 
+    // binary entries are rebuilt since each carries its own record count (and backtrace arena)
+    const bool binaryPrefilter = QueryMatcher::isBinaryPrefilterResult(filesToMerge[0]->getDbtype());
+    const bool binaryAlignment = Matcher::isBinaryAlignmentResult(filesToMerge[0]->getDbtype());
+    if (binaryPrefilter || binaryAlignment) {
+        if (prefices.empty() == false) {
+            Debug(Debug::ERROR) << "Prefixes cannot be added to binary results\n";
+            EXIT(EXIT_FAILURE);
+        }
+        for (size_t i = 1; i < fileCount; i++) {
+            if (Parameters::isEqualDbtype(filesToMerge[i]->getDbtype(), filesToMerge[0]->getDbtype()) == false) {
+                Debug(Debug::ERROR) << "Binary results can only be merged with binary results of the same type\n";
+                EXIT(EXIT_FAILURE);
+            }
+        }
+    }
+    std::string alnRecords;
+    std::string alnArena;
+    std::vector<hit_t> prefHits;
+    std::string binaryBuffer;
+
     DBWriter writer(par.db2.c_str(), par.db2Index.c_str(), 1, par.compressed, filesToMerge[0]->getDbtype());
     writer.open();
 
@@ -51,11 +73,32 @@ int mergedbs(int argc, const char **argv, const Command& command) {
                     continue;
                 }
             }
+            if (binaryPrefilter) {
+                QueryMatcher::parsePrefilterHits((char *) data, filesToMerge[i]->getEntryLen(entryId), true, prefHits);
+                continue;
+            }
+            if (binaryAlignment) {
+                Matcher::appendBinaryRecords(data, filesToMerge[i]->getEntryLen(entryId), alnRecords, alnArena);
+                continue;
+            }
             if (i < prefices.size()) {
                 writer.writeAdd(prefices[i].c_str(), prefices[i].size(), 0);
             }
             writer.writeAdd(data, filesToMerge[i]->getEntryLen(entryId) - 1, 0);
         }
+        if (binaryAlignment) {
+            Matcher::binaryRecordsToBuffer(binaryBuffer, alnRecords, alnArena);
+            writer.writeAdd(binaryBuffer.c_str(), binaryBuffer.size(), 0);
+            binaryBuffer.clear();
+            alnRecords.clear();
+            alnArena.clear();
+        }
+        if (binaryPrefilter) {
+            QueryMatcher::prefilterHitsToBinaryBuffer(binaryBuffer, prefHits.data(), prefHits.size());
+            writer.writeAdd(binaryBuffer.c_str(), binaryBuffer.size(), 0);
+            binaryBuffer.clear();
+            prefHits.clear();
+        }
         writer.writeEnd(key, 0);
     }
     writer.close();
@@ -220,7 +220,7 @@ int nrtotaxmapping(int argc, const char **argv, const Command& command) {
         }
     }
     writer.close(true);
-    FileUtil::remove(resultDbIndex.c_str());
+    DBWriter::removeIndex(resultDbIndex.c_str());
     reader.close();
     uniqueNames.clear();
     accessionMapping.clear();
@@ -74,7 +74,7 @@ const bool tsvOut, const std::string &mappingFile, const std::string &userStrToA
     }
     writer.close(tsvOut);
     if (tsvOut) {
-        FileUtil::remove(writer.getIndexFileName());
+        DBWriter::removeIndex(writer.getIndexFileName());
     }
     reader.close();
     if(doMapping){
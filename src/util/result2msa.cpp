@@ -112,6 +112,7 @@ int result2msa(int argc, const char **argv, const Command &command) {
 
     DBReader<unsigned int> resultReader(par.db3.c_str(), par.db3Index.c_str(), par.threads, DBReader<unsigned int>::USE_DATA | DBReader<unsigned int>::USE_INDEX);
     resultReader.open(DBReader<unsigned int>::LINEAR_ACCCESS);
+    const bool binaryAlignment = Matcher::isBinaryAlignmentResult(resultReader.getDbtype());
     size_t dbFrom = 0;
     size_t dbSize = 0;
 #ifdef HAVE_MPI
@@ -239,13 +240,23 @@ int result2msa(int argc, const char **argv, const Command &command) {
 
             bool isQueryInit = false;
             char *data = resultReader.getData(id, thread_idx);
-            while (*data != '\0') {
-                Util::parseKey(data, dbKey);
-
-                const unsigned int key = (unsigned int) strtoul(dbKey, NULL, 10);
+            const unsigned int binaryCount = binaryAlignment ? Matcher::getBinaryResultCount(data, resultReader.getEntryLen(id)) : 0;
+            const char *binaryArena = Matcher::getBinaryBacktraceArena(data, binaryCount);
+            unsigned int binaryIdx = 0;
+            while (binaryAlignment ? (binaryIdx < binaryCount) : (*data != '\0')) {
+                const Matcher::result_bin_t *record = binaryAlignment ? &Matcher::getBinaryResults(data)[binaryIdx++] : NULL;
+                unsigned int key;
+                if (record != NULL) {
+                    key = record->dbKey;
+                } else {
+                    Util::parseKey(data, dbKey);
+                    key = (unsigned int) strtoul(dbKey, NULL, 10);
+                }
                 // in the same database case, we have the query repeated
                 if (key == queryKey && sameDatabase == true) {
-                    data = Util::skipLine(data);
+                    if (record == NULL) {
+                        data = Util::skipLine(data);
+                    }
                     continue;
                 }
 
@@ -258,8 +269,9 @@ int result2msa(int argc, const char **argv, const Command &command) {
                 seqSet.emplace_back(std::vector<unsigned char>(edgeSequence.numSequence, edgeSequence.numSequence + edgeSequence.L));
                 seqKeys.emplace_back(key);
 
-                const size_t columns = Util::getWordsOfLine(data, entry, 255);
-                if (columns > Matcher::ALN_RES_WITHOUT_BT_COL_CNT) {
+                if (record != NULL && record->backtraceLength > 0) {
+                    alnResults.emplace_back(Matcher::binaryRecordToResult(*record, binaryArena));
+                } else if (record == NULL && Util::getWordsOfLine(data, entry, 255) > Matcher::ALN_RES_WITHOUT_BT_COL_CNT) {
                     alnResults.emplace_back(Matcher::parseAlignmentRecord(data));
                 } else {
                     // Recompute if not all the backtraces are present
@@ -269,7 +281,9 @@ int result2msa(int argc, const char **argv, const Command &command) {
                     }
                     alnResults.emplace_back(matcher.getSWResult(&edgeSequence, INT_MAX, false, 0, 0.0, FLT_MAX, Matcher::SCORE_COV_SEQID, 0, false));
                 }
-                data = Util::skipLine(data);
+                if (record == NULL) {
+                    data = Util::skipLine(data);
+                }
             }
 
             MultipleAlignment::MSAResult res = aligner.computeMSA(&centerSequence, seqSet, alnResults, !par.allowDeletion);
@@ -545,7 +559,7 @@ int result2msa(int argc, const char **argv, const Command &command) {
     }
     resultWriter.close(true);
     if (shouldWriteNullByte == false) {
-        FileUtil::remove(resultWriter.getIndexFileName());
+        DBWriter::removeIndex(resultWriter.getIndexFileName());
     }
     resultReader.close();
 
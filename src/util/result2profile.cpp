@@ -43,6 +43,7 @@ int result2profile(int argc, const char **argv, const Command &command, bool ret
 
     DBReader<unsigned int> resultReader(par.db3.c_str(), par.db3Index.c_str(), par.threads, DBReader<unsigned int>::USE_DATA | DBReader<unsigned int>::USE_INDEX);
     resultReader.open(DBReader<unsigned int>::LINEAR_ACCCESS);
+    const bool binaryAlignment = Matcher::isBinaryAlignmentResult(resultReader.getDbtype());
     size_t dbFrom = 0;
     size_t dbSize = 0;
 #ifdef HAVE_MPI
@@ -188,25 +189,43 @@ int result2profile(int argc, const char **argv, const Command &command, bool ret
 
             bool isQueryInit = false;
             char *data = resultReader.getData(id, thread_idx);
-            while (*data != '\0') {
-                Util::parseKey(data, dbKey);
-                const unsigned int key = (unsigned int) strtoul(dbKey, NULL, 10);
+            const unsigned int binaryCount = binaryAlignment ? Matcher::getBinaryResultCount(data, resultReader.getEntryLen(id)) : 0;
+            const char *binaryArena = Matcher::getBinaryBacktraceArena(data, binaryCount);
+            unsigned int binaryIdx = 0;
+            while (binaryAlignment ? (binaryIdx < binaryCount) : (*data != '\0')) {
+                const Matcher::result_bin_t *record = binaryAlignment ? &Matcher::getBinaryResults(data)[binaryIdx++] : NULL;
+                unsigned int key;
+                if (record != NULL) {
+                    key = record->dbKey;
+                } else {
+                    Util::parseKey(data, dbKey);
+                    key = (unsigned int) strtoul(dbKey, NULL, 10);
+                }
                 // in the same database case, we have the query repeated
                 if (key == queryKey && sameDatabase == true) {
                     if(returnAlnRes && par.includeIdentity){
-                        Matcher::result_t res = Matcher::parseAlignmentRecord(data);
+                        Matcher::result_t res = (record != NULL) ? Matcher::binaryRecordToResult(*record, binaryArena) : Matcher::parseAlignmentRecord(data);
                         size_t len = Matcher::resultToBuffer(buffer, res, true);
                         result.append(buffer, len);
                     }
 
-                    data = Util::skipLine(data);
+                    if (record == NULL) {
+                        data = Util::skipLine(data);
+                    }
                     continue;
                 }
 
-                const size_t columns = Util::getWordsOfLine(data, entry, 255);
+                bool hasBacktrace;
                 float evalue = 0.0;
-                if (returnAlnRes == false && columns >= 4) {
-                    evalue = strtod(entry[3], NULL);
+                if (record != NULL) {
+                    hasBacktrace = record->backtraceLength > 0;
+                    evalue = record->eval;
+                } else {
+                    const size_t columns = Util::getWordsOfLine(data, entry, 255);
+                    hasBacktrace = columns > Matcher::ALN_RES_WITHOUT_BT_COL_CNT;
+                    if (returnAlnRes == false && columns >= 4) {
+                        evalue = strtod(entry[3], NULL);
+                    }
                 }
 
                 if (returnAlnRes == true || evalue < par.evalProfile) {
@@ -218,8 +237,8 @@ int result2profile(int argc, const char **argv, const Command &command, bool ret
                     edgeSequence.mapSequence(edgeId, key, tDbr->getData(edgeId, thread_idx), tDbr->getSeqLen(edgeId));
                     seqSet.emplace_back(std::vector<unsigned char>(edgeSequence.numSequence, edgeSequence.numSequence + edgeSequence.L));
 
-                    if (columns > Matcher::ALN_RES_WITHOUT_BT_COL_CNT) {
-                        alnResults.emplace_back(Matcher::parseAlignmentRecord(data));
+                    if (hasBacktrace) {
+                        alnResults.emplace_back((record != NULL) ? Matcher::binaryRecordToResult(*record, binaryArena) : Matcher::parseAlignmentRecord(data));
                     } else {
                         // Recompute if not all the backtraces are present
                         if (isQueryInit == false) {
@@ -229,7 +248,9 @@ int result2profile(int argc, const char **argv, const Command &command, bool ret
                         alnResults.emplace_back(matcher.getSWResult(&edgeSequence, INT_MAX, false, 0, 0.0, FLT_MAX, Matcher::SCORE_COV_SEQID, 0, false));
                     }
                 }
-                data = Util::skipLine(data);
+                if (record == NULL) {
+                    data = Util::skipLine(data);
+                }
             }
 
             // Recompute if not all the backtraces are present
@@ -123,7 +123,7 @@ int StatsComputer::run() {
 StatsComputer::~StatsComputer() {
     statWriter->close(tsvOut);
     if (tsvOut) {
-        FileUtil::remove(statWriter->getIndexFileName());
+        DBWriter::removeIndex(statWriter->getIndexFileName());
     }
     resultReader->close();
     delete statWriter;
@@ -47,6 +47,8 @@ int doswap(Parameters& par, bool isGeneralMode) {
     if (isGeneralMode) {
         DBReader<unsigned int> resultReader(parResultDb, parResultDbIndex, par.threads, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
         resultReader.open(DBReader<unsigned int>::SORT_BY_OFFSET);
+        const bool isBinary = QueryMatcher::isBinaryPrefilterResult(resultReader.getDbtype());
+        const bool isBinaryAlignment = Matcher::isBinaryAlignmentResult(resultReader.getDbtype());
         //search for the maxTargetId (value of first column) in parallel
         Debug::Progress progress(resultReader.getSize());
 
@@ -61,6 +63,22 @@ int doswap(Parameters& par, bool isGeneralMode) {
             for (size_t i = 0; i < resultReader.getSize(); ++i) {
                 progress.updateProgress();
                 char *data = resultReader.getData(i, thread_idx);
+                if (isBinary) {
+                    const hit_bin_t *hits = QueryMatcher::getBinaryPrefilterHits(data);
+                    const unsigned int hitCount = QueryMatcher::getBinaryPrefilterHitCount(data, resultReader.getEntryLen(i));
+                    for (unsigned int j = 0; j < hitCount; ++j) {
+                        maxTargetId = std::max(maxTargetId, static_cast<unsigned int>(hits[j].seqId));
+                    }
+                    continue;
+                }
+                if (isBinaryAlignment) {
+                    const Matcher::result_bin_t *records = Matcher::getBinaryResults(data);
+                    const unsigned int count = Matcher::getBinaryResultCount(data, resultReader.getEntryLen(i));
+                    for (unsigned int j = 0; j < count; ++j) {
+                        maxTargetId = std::max(maxTargetId, static_cast<unsigned int>(records[j].dbKey));
+                    }
+                    continue;
+                }
                 while (*data != '\0') {
                     Util::parseKey(data, key);
                     unsigned int dbKey = std::strtoul(key, NULL, 10);
@@ -101,6 +119,10 @@ int doswap(Parameters& par, bool isGeneralMode) {
 
     DBReader<unsigned int> resultDbr(parResultDb, parResultDbIndex, par.threads, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
     resultDbr.open(DBReader<unsigned int>::SORT_BY_OFFSET);
+    // binary prefilter records keep their fixed width, only the key is replaced
+    const bool isBinary = QueryMatcher::isBinaryPrefilterResult(resultDbr.getDbtype());
+    // binary alignment records are moved together with their backtrace, which directly follows each record
+    const bool isBinaryAlignment = Matcher::isBinaryAlignmentResult(resultDbr.getDbtype());
 
     const size_t resultSize = resultDbr.getSize();
     Debug(Debug::INFO) << "Computing offsets.\n";
@@ -124,6 +146,22 @@ int doswap(Parameters& par, bool isGeneralMode) {
                 *(tmpBuff) = '\0';
                 size_t queryKeyLen = strlen(queryKeyStr);
                 char *data = resultDbr.getData(i, thread_idx);
+                if (isBinary) {
+                    const hit_bin_t *hits = QueryMatcher::getBinaryPrefilterHits(data);
+                    const unsigned int hitCount = QueryMatcher::getBinaryPrefilterHitCount(data, resultDbr.getEntryLen(i));
+                    for (unsigned int j = 0; j < hitCount; ++j) {
+                        __sync_fetch_and_add(&(targetElementSize[hits[j].seqId]), sizeof(hit_bin_t));
+                    }
+                    continue;
+                }
+                if (isBinaryAlignment) {
+                    const Matcher::result_bin_t *records = Matcher::getBinaryResults(data);
+                    const unsigned int count = Matcher::getBinaryResultCount(data, resultDbr.getEntryLen(i));
+                    for (unsigned int j = 0; j < count; ++j) {
+                        __sync_fetch_and_add(&(targetElementSize[records[j].dbKey]), sizeof(Matcher::result_bin_t) + records[j].backtraceLength);
+                    }
+                    continue;
+                }
                 char dbKeyBuffer[255 + 1];
                 while (*data != '\0') {
                     Util::parseKey(data, dbKeyBuffer);
@@ -187,6 +225,39 @@ int doswap(Parameters& par, bool isGeneralMode) {
                 char *tmpBuff = Itoa::u32toa_sse2((uint32_t) queryKey, queryKeyStr);
                 *(tmpBuff) = '\0';
                 size_t queryKeyLen = strlen(queryKeyStr);
+                if (isBinary) {
+                    // the swapped records are collected without the hit count, which is added when writing
+                    const hit_bin_t *hits = QueryMatcher::getBinaryPrefilterHits(data);
+                    const unsigned int hitCount = QueryMatcher::getBinaryPrefilterHitCount(data, resultDbr.getEntryLen(i));
+                    for (unsigned int j = 0; j < hitCount; ++j) {
+                        hit_bin_t hit = hits[j];
+                        const unsigned int dbKey = hit.seqId;
+                        hit.seqId = queryKey;
+                        size_t offset = __sync_fetch_and_add(&(targetElementSize[dbKey]), sizeof(hit_bin_t)) - prevBytesToWrite;
+                        if (dbKey >= prevDbKeyToWrite && dbKey <= dbKeyToWrite) {
+                            memcpy(&tmpData[offset], &hit, sizeof(hit_bin_t));
+                        }
+                    }
+                    continue;
+                }
+                if (isBinaryAlignment) {
+                    const Matcher::result_bin_t *records = Matcher::getBinaryResults(data);
+                    const unsigned int count = Matcher::getBinaryResultCount(data, resultDbr.getEntryLen(i));
+                    const char *arena = Matcher::getBinaryBacktraceArena(data, count);
+                    for (unsigned int j = 0; j < count; ++j) {
+                        Matcher::result_bin_t record = records[j];
+                        const unsigned int dbKey = record.dbKey;
+                        const char *backtrace = arena + record.backtraceOffset;
+                        record.dbKey = queryKey;
+                        record.backtraceOffset = 0;
+                        size_t offset = __sync_fetch_and_add(&(targetElementSize[dbKey]), sizeof(Matcher::result_bin_t) + record.backtraceLength) - prevBytesToWrite;
+                        if (dbKey >= prevDbKeyToWrite && dbKey <= dbKeyToWrite) {
+                            memcpy(&tmpData[offset], &record, sizeof(Matcher::result_bin_t));
+                            memcpy(&tmpData[offset + sizeof(Matcher::result_bin_t)], backtrace, record.backtraceLength);
+                        }
+                    }
+                    continue;
+                }
                 char dbKeyBuffer[255 + 1];
                 while (*data != '\0') {
                     Util::parseKey(data, dbKeyBuffer);
@@ -217,7 +288,7 @@ int doswap(Parameters& par, bool isGeneralMode) {
         bool isAlignmentResult = false;
         bool hasBacktrace = false;
         const char *entry[255];
-        for (size_t i = 0; i < resultDbr.getSize(); i++){
+        for (size_t i = 0; i < resultDbr.getSize() && isBinary == false && isBinaryAlignment == false; i++){
             char *data = resultDbr.getData(i, 0);
             if (*data == '\0'){
                 continue;
@@ -247,6 +318,9 @@ int doswap(Parameters& par, bool isGeneralMode) {
             // and alnLength for diagonal because its the first int value after
             std::vector<Matcher::result_t> curRes;
             curRes.reserve(300);
+            std::vector<hit_t> binaryHits;
+            std::string binaryRecords;
+            std::string binaryArena;
 
             char buffer[1024 + 32768*4];
             std::string ss;
@@ -259,7 +333,33 @@ int doswap(Parameters& par, bool isGeneralMode) {
                 char *data = &tmpData[targetElementSize[i] - prevBytesToWrite];
                 size_t dataSize = targetElementSize[i + 1] - targetElementSize[i];
 
-                if (isGeneralMode) {
+                if (isGeneralMode && isBinary && dataSize > 0) {
+                    const unsigned int hitCount = static_cast<unsigned int>(dataSize / sizeof(hit_bin_t));
+                    ss.append(reinterpret_cast<const char *>(&hitCount), sizeof(unsigned int));
+                    ss.append(data, dataSize);
+                    resultWriter.writeData(ss.c_str(), ss.size(), i, thread_idx);
+                    ss.clear();
+                    continue;
+                }
+
+                // binary alignment entries need their count and arena rebuilt even without swapping
+                if (isGeneralMode && isBinaryAlignment && dataSize > 0) {
+                    const char *end = data + dataSize;
+                    while (data < end) {
+                        Matcher::result_bin_t record;
+                        memcpy(&record, data, sizeof(Matcher::result_bin_t));
+                        Matcher::appendBinaryRecord(record, data + sizeof(Matcher::result_bin_t), binaryRecords, binaryArena);
+                        data += sizeof(Matcher::result_bin_t) + record.backtraceLength;
+                    }
+                    Matcher::binaryRecordsToBuffer(ss, binaryRecords, binaryArena);
+                    resultWriter.writeData(ss.c_str(), ss.size(), i, thread_idx);
+                    ss.clear();
+                    binaryRecords.clear();
+                    binaryArena.clear();
+                    continue;
+                }
+
+                if (isGeneralMode && (dataSize == 0 || isBinaryAlignment == false)) {
                     if (dataSize > 0) {
                         resultWriter.writeData(data, dataSize, i, thread_idx);
                     }
@@ -267,6 +367,31 @@ int doswap(Parameters& par, bool isGeneralMode) {
                 }
 
                 bool evalBreak = false;
+                if (isBinary) {
+                    const hit_bin_t *hits = reinterpret_cast<const hit_bin_t *>(data);
+                    for (size_t j = 0; j < dataSize / sizeof(hit_bin_t); ++j) {
+                        hit_bin_t hit = hits[j];
+                        hit.diagonal = static_cast<unsigned short>(static_cast<short>(hit.diagonal) * -1);
+                        curRes.emplace_back(static_cast<unsigned int>(hit.seqId), static_cast<int>(hit.prefScore), 0, 0, 0, -static_cast<float>(hit.prefScore), static_cast<unsigned int>(hit.diagonal), 0, 0, 0, 0, 0, 0, "");
+                    }
+                    dataSize = 0;
+                }
+                if (isBinaryAlignment) {
+                    const char *end = data + dataSize;
+                    while (data < end) {
+                        Matcher::result_bin_t record;
+                        memcpy(&record, data, sizeof(Matcher::result_bin_t));
+                        Matcher::result_t res = Matcher::binaryRecordToResult(record, data + sizeof(Matcher::result_bin_t), true);
+                        data += sizeof(Matcher::result_bin_t) + record.backtraceLength;
+                        Matcher::result_t::swapResult(res, *evaluer, record.backtraceLength > 0);
+                        if (res.eval > par.evalThr) {
+                            evalBreak = true;
+                        } else {
+                            curRes.emplace_back(res);
+                        }
+                    }
+                    dataSize = 0;
+                }
                 while (dataSize > 0) {
                     if (isAlignmentResult) {
                         Matcher::result_t res = Matcher::parseAlignmentRecord(data, true);
@@ -279,7 +404,7 @@ int doswap(Parameters& par, bool isGeneralMode) {
                     } else {
                         hit_t hit = QueryMatcher::parsePrefilterHit(data);
                         hit.diagonal = static_cast<unsigned short>(static_cast<short>(hit.diagonal) * -1);
-                        curRes.emplace_back(hit.seqId, hit.prefScore, 0, 0, 0, -static_cast<float>(hit.prefScore), hit.diagonal, 0, 0, 0, 0, 0, 0, "");
+                        curRes.emplace_back(static_cast<unsigned int>(hit.seqId), static_cast<int>(hit.prefScore), 0, 0, 0, -static_cast<float>(hit.prefScore), static_cast<unsigned int>(hit.diagonal), 0, 0, 0, 0, 0, 0, "");
                     }
                     char *nextLine = Util::skipLine(data);
                     size_t lineLen = nextLine - data;
@@ -288,11 +413,21 @@ int doswap(Parameters& par, bool isGeneralMode) {
                 }
 
                 if (curRes.empty() == false) {
-                    if (curRes.size() > 1) {
+                    if (curRes.size() > 1 && isGeneralMode == false) {
                         SORT_SERIAL(curRes.begin(), curRes.end(), Matcher::compareHits);
                     }
 
-                    for (size_t j = 0; j < curRes.size(); j++) {
+                    if (isBinaryAlignment) {
+                        Matcher::resultsToBinaryBuffer(ss, curRes, true, false);
+                    } else if (isBinary) {
+                        for (size_t j = 0; j < curRes.size(); j++) {
+                            hit_t hit = { curRes[j].dbKey, curRes[j].score, static_cast<unsigned short>(curRes[j].alnLength) };
+                            binaryHits.push_back(hit);
+                        }
+                        QueryMatcher::prefilterHitsToBinaryBuffer(ss, binaryHits.data(), binaryHits.size());
+                        binaryHits.clear();
+                    }
+                    for (size_t j = 0; j < curRes.size() && isBinaryAlignment == false && isBinary == false; j++) {
                         const Matcher::result_t &res = curRes[j];
                         if (isAlignmentResult) {
                             size_t len = Matcher::resultToBuffer(buffer, res, hasBacktrace, false);
@@ -2,6 +2,8 @@
 #include "IndexReader.h"
 #include "Debug.h"
 #include "Util.h"
+#include "QueryMatcher.h"
+#include "Matcher.h"
 
 int view(int argc, const char **argv, const Command& command) {
     Parameters& par = Parameters::getInstance();
@@ -28,6 +30,9 @@ int view(int argc, const char **argv, const Command& command) {
         dbMode |= DBReader<unsigned int>::USE_LOOKUP_REV;
     }
     IndexReader reader(par.db1, par.threads, indexSrcType, false, dbMode);
+    const bool binaryPrefilterInput = QueryMatcher::isBinaryPrefilterResult(reader.sequenceReader->getDbtype());
+    const bool binaryAlignmentInput = Matcher::isBinaryAlignmentResult(reader.sequenceReader->getDbtype());
+    std::string binaryText;
     for (size_t i = 0; i < ids.size(); ++i) {
         unsigned int key;
         std::string& ref = ids[i];
@@ -49,6 +54,16 @@ int view(int argc, const char **argv, const Command& command) {
         }
         char* data = reader.sequenceReader->getData(id, 0);
         size_t size = reader.sequenceReader->getEntryLen(id) - 1;
+        if (binaryPrefilterInput || binaryAlignmentInput) {
+            binaryText.clear();
+            if (binaryPrefilterInput) {
+                QueryMatcher::binaryPrefilterHitsToText(data, size + 1, binaryText);
+            } else {
+                Matcher::binaryResultsToText(data, size + 1, binaryText);
+            }
+            data = (char*) binaryText.c_str();
+            size = binaryText.size();
+        }
         fwrite(data, sizeof(char), size, stdout);
     }
     EXIT(EXIT_SUCCESS);
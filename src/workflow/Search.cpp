@@ -528,6 +528,20 @@ int search(int argc, const char **argv, const Command& command) {
         } else {
             cmd.addVariable("ALIGNMENT_PAR", par.createParameterString(par.align).c_str());
         }
+        if (par.fusedSearch) {
+            if (par.prefMode == Parameters::PREF_MODE_KMER && isUngappedMode == false && par.lcaSearch == false) {
+                std::vector<MMseqsParameter*> prefilterAlignWithoutS;
+                for (size_t i = 0; i < par.prefilteralign.size(); i++) {
+                    if (par.prefilteralign[i]->uniqid != par.PARAM_S.uniqid) {
+                        prefilterAlignWithoutS.push_back(par.prefilteralign[i]);
+                    }
+                }
+                cmd.addVariable("FUSED_SEARCH", "TRUE");
+                cmd.addVariable("FUSED_PAR", par.createParameterString(prefilterAlignWithoutS).c_str());
+            } else {
+                Debug(Debug::WARNING) << "--fused-search is only supported with the k-mer prefilter and gapped alignment. Run prefilter and alignment separately.\n";
+            }
+        }
         FileUtil::writeFile(tmpDir + "/blastp.sh", blastp_sh, blastp_sh_len);
         program = std::string(tmpDir + "/blastp.sh");
     }